@@ -33,3 +33,8 @@
 
 #cmakedefine BCTBX_STATIC
 #cmakedefine HAVE_EXECINFO 
+#cmakedefine HAVE_PREAD 1
+#cmakedefine HAVE_PWRITE 1
+#cmakedefine HAVE_MMAP 1
+#cmakedefine HAVE_PREADV 1
+#cmakedefine HAVE_PWRITEV 1
@@ -878,6 +878,51 @@ BCTBX_PUBLIC void bctbx_sha256(const uint8_t *input,
 		uint8_t hashLength,
 		uint8_t *output);
 
+/**
+ * @brief One input of a hash batch
+ */
+typedef struct bctbx_hash_batch_entry_struct {
+	const uint8_t *input; /**< Input data buffer */
+	size_t inputLength; /**< Input data length in bytes */
+	uint8_t *output; /**< Output data buffer, hashLength bytes */
+} bctbx_hash_batch_entry_t;
+
+/**
+ * @brief Hash a batch of independent inputs with SHA512
+ * When the batch holds enough data and the crypto library allows it, the inputs are hashed in parallel lanes.
+ *
+ * @param[in,out]	entries		the inputs, their output is written
+ * @param[in]		entriesCount	number of entries
+ * @param[in]		hashLength	Length of output required in bytes, Output is truncated to the hashLength left bytes. 64 bytes maximum
+ */
+BCTBX_PUBLIC void bctbx_sha512_batch(bctbx_hash_batch_entry_t *entries,
+		size_t entriesCount,
+		uint8_t hashLength);
+
+/**
+ * @brief Hash a batch of independent inputs with SHA384
+ * When the batch holds enough data and the crypto library allows it, the inputs are hashed in parallel lanes.
+ *
+ * @param[in,out]	entries		the inputs, their output is written
+ * @param[in]		entriesCount	number of entries
+ * @param[in]		hashLength	Length of output required in bytes, Output is truncated to the hashLength left bytes. 48 bytes maximum
+ */
+BCTBX_PUBLIC void bctbx_sha384_batch(bctbx_hash_batch_entry_t *entries,
+		size_t entriesCount,
+		uint8_t hashLength);
+
+/**
+ * @brief Hash a batch of independent inputs with SHA256
+ * When the batch holds enough data and the crypto library allows it, the inputs are hashed in parallel lanes.
+ *
+ * @param[in,out]	entries		the inputs, their output is written
+ * @param[in]		entriesCount	number of entries
+ * @param[in]		hashLength	Length of output required in bytes, Output is truncated to the hashLength left bytes. 32 bytes maximum
+ */
+BCTBX_PUBLIC void bctbx_sha256_batch(bctbx_hash_batch_entry_t *entries,
+		size_t entriesCount,
+		uint8_t hashLength);
+
 /*
  * @brief HMAC-SHA512 wrapper
  * @param[in] 	key		HMAC secret key
@@ -1055,6 +1100,148 @@ BCTBX_PUBLIC int32_t bctbx_aes_gcm_process_chunk(bctbx_aes_gcm_context_t *contex
 BCTBX_PUBLIC int32_t bctbx_aes_gcm_finish(bctbx_aes_gcm_context_t *context,
 		uint8_t *tag, size_t tagLength);
 
+typedef struct bctbx_aes_gcm_keyed_context_struct bctbx_aes_gcm_keyed_context_t;
+/**
+ * @Brief create an AES-GCM context holding an expanded key, to encrypt or decrypt many buffers with the same key
+ * The key is expanded once here instead of at each bctbx_aes_gcm_encrypt_and_tag or bctbx_aes_gcm_decrypt_and_auth call.
+ * A context must not be used by several threads at the same time.
+ *
+ * @param[in]	key							encryption key
+ * @param[in]	keyLength					key buffer length, in bytes, must be 16,24 or 32
+ *
+ * @return a pointer to the created context, to be freed using bctbx_aes_gcm_keyed_context_free(), NULL on error
+ */
+BCTBX_PUBLIC bctbx_aes_gcm_keyed_context_t *bctbx_aes_gcm_keyed_context_new(const uint8_t *key, size_t keyLength);
+
+/**
+ * @Brief AES-GCM encrypt and tag buffer using a keyed context
+ *
+ * @param[in/out]	context					a context created by bctbx_aes_gcm_keyed_context_new
+ * @param[in]	plainText					buffer to be encrypted
+ * @param[in]	plainTextLength				Length in bytes of buffer to be encrypted
+ * @param[in]	authenticatedData			Buffer holding additional data to be used in tag computation
+ * @param[in]	authenticatedDataLength		Additional data length in bytes
+ * @param[in]	initializationVector		Buffer holding the initialisation vector
+ * @param[in]	initializationVectorLength	Initialisation vector length in bytes
+ * @param[out]	tag							Buffer holding the generated tag
+ * @param[in]	tagLength					Requested length for the generated tag
+ * @param[out]	output						Buffer holding the output, shall be at least the length of plainText buffer
+ *
+ * @return 0 on success, crypto library error code otherwise
+ */
+BCTBX_PUBLIC int32_t bctbx_aes_gcm_keyed_encrypt_and_tag(bctbx_aes_gcm_keyed_context_t *context,
+		const uint8_t *plainText, size_t plainTextLength,
+		const uint8_t *authenticatedData, size_t authenticatedDataLength,
+		const uint8_t *initializationVector, size_t initializationVectorLength,
+		uint8_t *tag, size_t tagLength,
+		uint8_t *output);
+
+/**
+ * @Brief AES-GCM decrypt, compute authentication tag and compare it to the one provided, using a keyed context
+ *
+ * @param[in/out]	context					a context created by bctbx_aes_gcm_keyed_context_new
+ * @param[in]	cipherText					Buffer to be decrypted
+ * @param[in]	cipherTextLength			Length in bytes of buffer to be decrypted
+ * @param[in]	authenticatedData			Buffer holding additional data to be used in auth tag computation
+ * @param[in]	authenticatedDataLength		Additional data length in bytes
+ * @param[in]	initializationVector		Buffer holding the initialisation vector
+ * @param[in]	initializationVectorLength	Initialisation vector length in bytes
+ * @param[in]	tag							Buffer holding the authentication tag
+ * @param[in]	tagLength					Length in bytes for the authentication tag
+ * @param[out]	output						Buffer holding the output, shall be at least the length of cipherText buffer
+ *
+ * @return 0 on succes, BCTBX_ERROR_AUTHENTICATION_FAILED if tag doesn't match or crypto library error code
+ */
+BCTBX_PUBLIC int32_t bctbx_aes_gcm_keyed_decrypt_and_auth(bctbx_aes_gcm_keyed_context_t *context,
+		const uint8_t *cipherText, size_t cipherTextLength,
+		const uint8_t *authenticatedData, size_t authenticatedDataLength,
+		const uint8_t *initializationVector, size_t initializationVectorLength,
+		const uint8_t *tag, size_t tagLength,
+		uint8_t *output);
+
+/**
+ * @Brief Clean the key material and free a context created by bctbx_aes_gcm_keyed_context_new
+ *
+ * @param[in/out]	context			the context to free, may be NULL
+ */
+BCTBX_PUBLIC void bctbx_aes_gcm_keyed_context_free(bctbx_aes_gcm_keyed_context_t *context);
+
+/**
+ * @brief One message of an AES-GCM batch
+ */
+typedef struct bctbx_aes_gcm_batch_entry_struct {
+	const uint8_t *initializationVector; /**< Buffer holding the initialisation vector */
+	size_t initializationVectorLength; /**< Initialisation vector length in bytes */
+	const uint8_t *authenticatedData; /**< Buffer holding additional data to be used in tag computation, can be NULL if its length is 0 */
+	size_t authenticatedDataLength; /**< Additional data length in bytes */
+	const uint8_t *input; /**< Plain text to encrypt or cipher text to decrypt */
+	size_t inputLength; /**< Input length in bytes */
+	uint8_t *output; /**< Cipher or plain text output, at least inputLength bytes, can be the input buffer */
+	uint8_t *tag; /**< Authentication tag: written by encryption, checked by decryption */
+	int32_t status; /**< Set by the batch function: 0 on success, BCTBX_ERROR_AUTHENTICATION_FAILED or crypto library error code */
+} bctbx_aes_gcm_batch_entry_t;
+
+/**
+ * @Brief AES-GCM encrypt and tag a batch of independent messages under the same key
+ * The key is expanded once for the whole batch.
+ *
+ * @param[in/out]	context		a context created by bctbx_aes_gcm_keyed_context_new
+ * @param[in/out]	entries		the messages, the status of each one is set
+ * @param[in]		entriesCount	number of messages
+ * @param[in]		tagLength	Requested length for the generated tags
+ *
+ * @return 0 if all the messages were processed, the first error code found in the entries status otherwise
+ */
+BCTBX_PUBLIC int32_t bctbx_aes_gcm_keyed_encrypt_and_tag_batch(bctbx_aes_gcm_keyed_context_t *context,
+		bctbx_aes_gcm_batch_entry_t *entries, size_t entriesCount,
+		size_t tagLength);
+
+/**
+ * @Brief AES-GCM decrypt and authenticate a batch of independent messages under the same key
+ * A message failing authentication does not stop the processing of the others.
+ *
+ * @param[in/out]	context		a context created by bctbx_aes_gcm_keyed_context_new
+ * @param[in/out]	entries		the messages, the status of each one is set
+ * @param[in]		entriesCount	number of messages
+ * @param[in]		tagLength	Length in bytes of the authentication tags
+ *
+ * @return 0 if all the messages were decrypted and authenticated, the first error code found in the entries status otherwise
+ */
+BCTBX_PUBLIC int32_t bctbx_aes_gcm_keyed_decrypt_and_auth_batch(bctbx_aes_gcm_keyed_context_t *context,
+		bctbx_aes_gcm_batch_entry_t *entries, size_t entriesCount,
+		size_t tagLength);
+
+/**
+ * @Brief AES-GCM encrypt and tag a batch of independent messages under the same key
+ *
+ * @param[in]		key		Encryption key
+ * @param[in]		keyLength	Key buffer length, in bytes, must be 16,24 or 32
+ * @param[in/out]	entries		the messages, the status of each one is set
+ * @param[in]		entriesCount	number of messages
+ * @param[in]		tagLength	Requested length for the generated tags
+ *
+ * @return 0 if all the messages were processed, BCTBX_ERROR_INVALID_INPUT_DATA if the key cannot be used, crypto library error code otherwise
+ */
+BCTBX_PUBLIC int32_t bctbx_aes_gcm_encrypt_and_tag_batch(const uint8_t *key, size_t keyLength,
+		bctbx_aes_gcm_batch_entry_t *entries, size_t entriesCount,
+		size_t tagLength);
+
+/**
+ * @Brief AES-GCM decrypt and authenticate a batch of independent messages under the same key
+ *
+ * @param[in]		key		Encryption key
+ * @param[in]		keyLength	Key buffer length, in bytes, must be 16,24 or 32
+ * @param[in/out]	entries		the messages, the status of each one is set
+ * @param[in]		entriesCount	number of messages
+ * @param[in]		tagLength	Length in bytes of the authentication tags
+ *
+ * @return 0 if all the messages were decrypted and authenticated, BCTBX_ERROR_INVALID_INPUT_DATA if the key cannot be used,
+ * the first error code found in the entries status otherwise
+ */
+BCTBX_PUBLIC int32_t bctbx_aes_gcm_decrypt_and_auth_batch(const uint8_t *key, size_t keyLength,
+		bctbx_aes_gcm_batch_entry_t *entries, size_t entriesCount,
+		size_t tagLength);
+
 
 /**
  * @brief Wrapper for AES-128 in CFB128 mode encryption
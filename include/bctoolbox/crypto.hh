@@ -88,6 +88,8 @@ class RNG {
 struct SHA256 {
 	/// maximum output size for SHA256 is 32 bytes
 	static constexpr size_t ssize() {return 32;}
+	/// SHA256 processes its input by blocks of 64 bytes
+	static constexpr size_t blockSize() {return 64;}
 };
 
 /**
@@ -96,6 +98,8 @@ struct SHA256 {
 struct SHA384 {
 	/// maximum output size for SHA384 is 48 bytes
 	static constexpr size_t ssize() {return 48;}
+	/// SHA384 processes its input by blocks of 128 bytes
+	static constexpr size_t blockSize() {return 128;}
 };
 
 /**
@@ -104,8 +108,35 @@ struct SHA384 {
 struct SHA512 {
 	/// maximum output size for SHA512 is 64 bytes
 	static constexpr size_t ssize() {return 64;}
+	/// SHA512 processes its input by blocks of 128 bytes
+	static constexpr size_t blockSize() {return 128;}
 };
 
+/**
+ * @brief One input of a hash batch, see HashBatch
+ */
+struct HashBatchEntry {
+	const uint8_t *input; /**< Data to hash, may be nullptr if inputSize is 0 */
+	size_t inputSize; /**< Input size in bytes */
+	uint8_t *output; /**< Hash output, size given by hashAlgo::ssize() */
+};
+
+/**
+ * @brief Hash a batch of independent inputs, to fingerprint many certificates or file chunks at once.
+ * When the batch holds enough data, the inputs are spread over parallel lanes, one thread per available core.
+ *
+ * @tparam	hashAlgo	the hash algorithm used: SHA256, SHA384, SHA512
+ *
+ * @param[in,out]	entries		the inputs, their output is written
+ * @param[in]		count		number of entries
+ */
+template <typename hashAlgo>
+void HashBatch(HashBatchEntry *entries, const size_t count);
+/* declare template specialisations */
+template <> void HashBatch<SHA256>(HashBatchEntry *entries, const size_t count);
+template <> void HashBatch<SHA384>(HashBatchEntry *entries, const size_t count);
+template <> void HashBatch<SHA512>(HashBatchEntry *entries, const size_t count);
+
 
 /**
  * @brief templated HMAC
@@ -125,6 +156,98 @@ template <> std::vector<uint8_t>  HMAC<SHA256>(const std::vector<uint8_t> &key,
 template <> std::vector<uint8_t>  HMAC<SHA384>(const std::vector<uint8_t> &key, const std::vector<uint8_t> &input);
 template <> std::vector<uint8_t>  HMAC<SHA512>(const std::vector<uint8_t> &key, const std::vector<uint8_t> &input);
 
+/**
+ * @brief templated HMAC writing into a caller provided buffer, it does not allocate any memory
+ *
+ * @tparam	hashAlgo	the hash algorithm used: SHA256, SHA384, SHA512
+ *
+ * @param[in]	key		HMAC key
+ * @param[in]	keySize		HMAC key size in bytes
+ * @param[in]	input		HMAC input
+ * @param[in]	inputSize	HMAC input size in bytes
+ * @param[out]	output		HMAC output, hashAlgo::ssize() bytes
+ */
+template <typename hashAlgo>
+void HMAC(const uint8_t *key, const size_t keySize, const uint8_t *input, const size_t inputSize, uint8_t *output);
+/* declare template specialisations */
+template <> void HMAC<SHA256>(const uint8_t *key, const size_t keySize, const uint8_t *input, const size_t inputSize, uint8_t *output);
+template <> void HMAC<SHA384>(const uint8_t *key, const size_t keySize, const uint8_t *input, const size_t inputSize, uint8_t *output);
+template <> void HMAC<SHA512>(const uint8_t *key, const size_t keySize, const uint8_t *input, const size_t inputSize, uint8_t *output);
+
+/**
+ * @brief Keyed incremental HMAC: the key is processed once, at creation, any number of HMAC can then be computed
+ * with it, each one fed by any number of update calls. Copying a context clones its keyed state and its pending input,
+ * it is cheaper than keying a new context.
+ *
+ * It does not allocate any memory but its own implementation object.
+ * A context must not be used by several threads at the same time.
+ *
+ * @tparam	hashAlgo	the hash algorithm used: SHA256, SHA384, SHA512
+ */
+template <typename hashAlgo>
+class HMACContext {
+	public:
+		/**
+		 * @param[in]	key		HMAC key
+		 * @param[in]	keySize		HMAC key size in bytes
+		 */
+		HMACContext(const uint8_t *key, const size_t keySize);
+		/**
+		 * @param[in]	key		HMAC key
+		 */
+		explicit HMACContext(const std::vector<uint8_t> &key);
+		HMACContext(const HMACContext &other);
+		HMACContext &operator=(const HMACContext &other);
+		~HMACContext();
+
+		/**
+		 * @brief Feed the HMAC with input data
+		 *
+		 * @param[in]	input		HMAC input
+		 * @param[in]	inputSize	HMAC input size in bytes
+		 *
+		 * @return the context itself so calls can be chained
+		 */
+		HMACContext &update(const uint8_t *input, const size_t inputSize);
+		/**
+		 * @brief Feed the HMAC with input data
+		 *
+		 * @param[in]	input		HMAC input
+		 *
+		 * @return the context itself so calls can be chained
+		 */
+		HMACContext &update(const std::vector<uint8_t> &input);
+
+		/**
+		 * @brief Compute the HMAC of all the data given since creation or last finalize/reset,
+		 * the context is then ready for a new computation with the same key
+		 *
+		 * @param[out]	output		HMAC output, hashAlgo::ssize() bytes
+		 */
+		void finalize(uint8_t *output);
+		/**
+		 * @brief Compute the HMAC of all the data given since creation or last finalize/reset,
+		 * the context is then ready for a new computation with the same key
+		 *
+		 * @return the HMAC output, hashAlgo::ssize() bytes
+		 */
+		std::vector<uint8_t> finalize();
+
+		/**
+		 * @brief Drop the data given since creation or last finalize/reset, keep the key
+		 */
+		void reset();
+
+	private:
+		struct Impl;
+		std::unique_ptr<Impl> pImpl;
+};
+
+/* HMACContext is instanciated in the library for SHA256, SHA384 and SHA512 */
+extern template class HMACContext<SHA256>;
+extern template class HMACContext<SHA384>;
+extern template class HMACContext<SHA512>;
+
 /**
  * @brief HKDF as described in RFC5869
  *	@par Compute:
@@ -164,6 +287,26 @@ template <> std::vector<uint8_t> HKDF<SHA256>(const std::vector<uint8_t> &salt,
 template <> std::vector<uint8_t> HKDF<SHA512>(const std::vector<uint8_t> &salt, const std::vector<uint8_t> &ikm, const std::vector<uint8_t> &info, size_t outputSize);
 template <> std::vector<uint8_t> HKDF<SHA512>(const std::vector<uint8_t> &salt, const std::vector<uint8_t> &ikm, const std::string &info, size_t outputSize);
 
+/**
+ * @brief HKDF as described in RFC5869 writing into a caller provided buffer, it does not allocate any memory
+ *
+ * @tparam	hashAlgo	the hash algorithm to use
+ *
+ * @param[in]	salt 		salt
+ * @param[in]	saltSize	salt size in bytes
+ * @param[in]	ikm		input key material
+ * @param[in]	ikmSize		input key material size in bytes
+ * @param[in]	info		info buffer, may be nullptr if infoSize is 0
+ * @param[in]	infoSize	info size in bytes
+ * @param[out]	okm		output key material
+ * @param[in]	okmSize		requested amount of data, at most 255*hashAlgo::ssize(). (L in the RFC doc)
+ */
+template <typename hashAlgo>
+void HKDF(const uint8_t *salt, const size_t saltSize, const uint8_t *ikm, const size_t ikmSize, const uint8_t *info, const size_t infoSize, uint8_t *okm, const size_t okmSize);
+/* declare template specialisations */
+template <> void HKDF<SHA256>(const uint8_t *salt, const size_t saltSize, const uint8_t *ikm, const size_t ikmSize, const uint8_t *info, const size_t infoSize, uint8_t *okm, const size_t okmSize);
+template <> void HKDF<SHA512>(const uint8_t *salt, const size_t saltSize, const uint8_t *ikm, const size_t ikmSize, const uint8_t *info, const size_t infoSize, uint8_t *okm, const size_t okmSize);
+
 
 /************************ AEAD interface *************************************/
 // AEAD function defines
@@ -177,6 +320,18 @@ struct AES256GCM128 {
 	static constexpr size_t tagSize(void) {return 16;};
 };
 
+/**
+ * @brief ChaCha20-Poly1305 (RFC8439) buffers size definition
+ */
+struct CHACHA20POLY1305 {
+	/// key size is 32 bytes
+	static constexpr size_t keySize(void) {return 32;};
+	/// tag size is 16 bytes
+	static constexpr size_t tagSize(void) {return 16;};
+	/// IV (nonce) size is 12 bytes, no other size is supported
+	static constexpr size_t IVSize(void) {return 12;};
+};
+
 /**
  * @brief Encrypt and tag using scheme given as template parameter
  *
@@ -207,6 +362,44 @@ template <typename AEADAlgo>
 bool AEADDecrypt(const std::vector<uint8_t> &key, const std::vector<uint8_t> &IV, const std::vector<uint8_t> &cipher, const std::vector<uint8_t> &AD,
 		const std::vector<uint8_t> &tag, std::vector<uint8_t> &plain);
 
+/**
+ * @brief Encrypt and tag using scheme given as template parameter
+ * Buffer version: no allocation, caller provides all the buffers
+ *
+ * @param[in]	key		Encryption key, size given by AEADAlgo::keySize()
+ * @param[in]	IV		Initialisation vector
+ * @param[in]	IVSize		Initialisation vector size in bytes
+ * @param[in]	plain		Plain text
+ * @param[in]	plainSize	Plain text size in bytes
+ * @param[in]	AD		Additional data used in tag computation, may be nullptr if ADSize is 0
+ * @param[in]	ADSize		Additional data size in bytes
+ * @param[out]	tag		Generated authentication tag, size given by AEADAlgo::tagSize()
+ * @param[out]	cipher		Cipher text, must be at least plainSize bytes, may be the plain buffer
+ */
+template <typename AEADAlgo>
+void AEADEncrypt(const uint8_t *key, const uint8_t *IV, const size_t IVSize, const uint8_t *plain, const size_t plainSize,
+		const uint8_t *AD, const size_t ADSize, uint8_t *tag, uint8_t *cipher);
+
+/**
+ * @brief Authenticate and Decrypt using scheme given as template parameter
+ * Buffer version: no allocation, caller provides all the buffers
+ *
+ * @param[in]	key		Encryption key, size given by AEADAlgo::keySize()
+ * @param[in]	IV		Initialisation vector
+ * @param[in]	IVSize		Initialisation vector size in bytes
+ * @param[in]	cipher		Cipher text
+ * @param[in]	cipherSize	Cipher text size in bytes
+ * @param[in]	AD		Additional data used in tag computation, may be nullptr if ADSize is 0
+ * @param[in]	ADSize		Additional data size in bytes
+ * @param[in]	tag		Authentication tag, size given by AEADAlgo::tagSize()
+ * @param[out]	plain		Plain text, must be at least cipherSize bytes, may be the cipher buffer
+ *
+ * @return true if authentication tag match and decryption was successful
+ */
+template <typename AEADAlgo>
+bool AEADDecrypt(const uint8_t *key, const uint8_t *IV, const size_t IVSize, const uint8_t *cipher, const size_t cipherSize,
+		const uint8_t *AD, const size_t ADSize, const uint8_t *tag, uint8_t *plain);
+
 /* declare AEAD template specialisations : AES256-GCM with 128 bits auth tag*/
 template <> std::vector<uint8_t> AEADEncrypt<AES256GCM128>(const std::vector<uint8_t> &key, const std::vector<uint8_t> IV, const std::vector<uint8_t> &plain, const std::vector<uint8_t> &AD,
 		std::vector<uint8_t> &tag);
@@ -214,6 +407,180 @@ template <> std::vector<uint8_t> AEADEncrypt<AES256GCM128>(const std::vector<uin
 template <> bool AEADDecrypt<AES256GCM128>(const std::vector<uint8_t> &key, const std::vector<uint8_t> &IV, const std::vector<uint8_t> &cipher, const std::vector<uint8_t> &AD,
 		const std::vector<uint8_t> &tag, std::vector<uint8_t> &plain);
 
+template <> void AEADEncrypt<AES256GCM128>(const uint8_t *key, const uint8_t *IV, const size_t IVSize, const uint8_t *plain, const size_t plainSize,
+		const uint8_t *AD, const size_t ADSize, uint8_t *tag, uint8_t *cipher);
+
+template <> bool AEADDecrypt<AES256GCM128>(const uint8_t *key, const uint8_t *IV, const size_t IVSize, const uint8_t *cipher, const size_t cipherSize,
+		const uint8_t *AD, const size_t ADSize, const uint8_t *tag, uint8_t *plain);
+
+/* declare AEAD template specialisations : ChaCha20-Poly1305, requires mbedtls 2.12 or above: they throw an exception otherwise */
+template <> std::vector<uint8_t> AEADEncrypt<CHACHA20POLY1305>(const std::vector<uint8_t> &key, const std::vector<uint8_t> IV, const std::vector<uint8_t> &plain, const std::vector<uint8_t> &AD,
+		std::vector<uint8_t> &tag);
+
+template <> bool AEADDecrypt<CHACHA20POLY1305>(const std::vector<uint8_t> &key, const std::vector<uint8_t> &IV, const std::vector<uint8_t> &cipher, const std::vector<uint8_t> &AD,
+		const std::vector<uint8_t> &tag, std::vector<uint8_t> &plain);
+
+template <> void AEADEncrypt<CHACHA20POLY1305>(const uint8_t *key, const uint8_t *IV, const size_t IVSize, const uint8_t *plain, const size_t plainSize,
+		const uint8_t *AD, const size_t ADSize, uint8_t *tag, uint8_t *cipher);
+
+template <> bool AEADDecrypt<CHACHA20POLY1305>(const uint8_t *key, const uint8_t *IV, const size_t IVSize, const uint8_t *cipher, const size_t cipherSize,
+		const uint8_t *AD, const size_t ADSize, const uint8_t *tag, uint8_t *plain);
+
+/**
+ * @brief One message of an AEAD batch, see AEADEncryptBatch and AEADDecryptBatch
+ */
+struct AEADBatchEntry {
+	const uint8_t *IV; /**< Initialisation vector */
+	size_t IVSize; /**< Initialisation vector size in bytes */
+	const uint8_t *AD; /**< Additional data used in tag computation, may be nullptr if ADSize is 0 */
+	size_t ADSize; /**< Additional data size in bytes */
+	const uint8_t *input; /**< Plain text to encrypt or cipher text to decrypt */
+	size_t inputSize; /**< Input size in bytes */
+	uint8_t *output; /**< Cipher or plain text, at least inputSize bytes, may be the input buffer */
+	uint8_t *tag; /**< Authentication tag, size given by AEADAlgo::tagSize(): written by encryption, checked by decryption */
+	bool authenticated; /**< Set by decryption: true if the tag matches */
+};
+
+/**
+ * @brief Keyed AEAD context: the key is expanded once, at creation, and then used to process any number of
+ * messages, each one with its own IV. Use it instead of AEADEncrypt/AEADDecrypt when many messages share a key.
+ *
+ * The underlying crypto library uses the CPU AES and carry-less multiplication instructions when they are available.
+ * A context must not be used by several threads at the same time.
+ *
+ * @tparam	AEADAlgo	the AEAD scheme: AES256GCM128 or CHACHA20POLY1305
+ */
+template <typename AEADAlgo>
+class AEADContext {
+	public:
+		/**
+		 * @param[in]	key	Encryption key, size given by AEADAlgo::keySize()
+		 */
+		explicit AEADContext(const std::vector<uint8_t> &key);
+		/**
+		 * @param[in]	key	Encryption key, AEADAlgo::keySize() bytes
+		 */
+		explicit AEADContext(const uint8_t *key);
+		~AEADContext();
+		AEADContext(const AEADContext &) = delete;
+		AEADContext &operator=(const AEADContext &) = delete;
+
+		/**
+		 * @brief Encrypt and tag, same as AEADEncrypt with the context key
+		 *
+		 * @param[in]	IV		Initialisation vector
+		 * @param[in]	IVSize		Initialisation vector size in bytes
+		 * @param[in]	plain		Plain text
+		 * @param[in]	plainSize	Plain text size in bytes
+		 * @param[in]	AD		Additional data used in tag computation, may be nullptr if ADSize is 0
+		 * @param[in]	ADSize		Additional data size in bytes
+		 * @param[out]	tag		Generated authentication tag, size given by AEADAlgo::tagSize()
+		 * @param[out]	cipher		Cipher text, must be at least plainSize bytes, may be the plain buffer
+		 */
+		void encrypt(const uint8_t *IV, const size_t IVSize, const uint8_t *plain, const size_t plainSize,
+				const uint8_t *AD, const size_t ADSize, uint8_t *tag, uint8_t *cipher);
+
+		/**
+		 * @brief Authenticate and decrypt, same as AEADDecrypt with the context key
+		 *
+		 * @param[in]	IV		Initialisation vector
+		 * @param[in]	IVSize		Initialisation vector size in bytes
+		 * @param[in]	cipher		Cipher text
+		 * @param[in]	cipherSize	Cipher text size in bytes
+		 * @param[in]	AD		Additional data used in tag computation, may be nullptr if ADSize is 0
+		 * @param[in]	ADSize		Additional data size in bytes
+		 * @param[in]	tag		Authentication tag, size given by AEADAlgo::tagSize()
+		 * @param[out]	plain		Plain text, must be at least cipherSize bytes, may be the cipher buffer
+		 *
+		 * @return true if authentication tag match and decryption was successful
+		 */
+		bool decrypt(const uint8_t *IV, const size_t IVSize, const uint8_t *cipher, const size_t cipherSize,
+				const uint8_t *AD, const size_t ADSize, const uint8_t *tag, uint8_t *plain);
+
+		/**
+		 * @brief Encrypt and tag, same as AEADEncrypt with the context key
+		 *
+		 * @param[in]	IV		Initialisation vector
+		 * @param[in]	plain		Plain text
+		 * @param[in]	AD		Additional data used in tag computation
+		 * @param[out]	tag		Generated authentication tag
+		 * @return	the cipher text
+		 */
+		std::vector<uint8_t> encrypt(const std::vector<uint8_t> &IV, const std::vector<uint8_t> &plain, const std::vector<uint8_t> &AD,
+				std::vector<uint8_t> &tag);
+
+		/**
+		 * @brief Authenticate and decrypt, same as AEADDecrypt with the context key
+		 *
+		 * @param[in]	IV		Initialisation vector
+		 * @param[in]	cipher		Cipher text
+		 * @param[in]	AD		Additional data used in tag computation
+		 * @param[in]	tag		Authentication tag
+		 * @param[out]	plain		A vector to store the plain text
+		 *
+		 * @return true if authentication tag match and decryption was successful
+		 */
+		bool decrypt(const std::vector<uint8_t> &IV, const std::vector<uint8_t> &cipher, const std::vector<uint8_t> &AD,
+				const std::vector<uint8_t> &tag, std::vector<uint8_t> &plain);
+
+		/**
+		 * @brief Encrypt and tag a batch of independent messages
+		 *
+		 * @param[in,out]	entries		the messages
+		 * @param[in]		count		number of messages
+		 */
+		void encryptBatch(AEADBatchEntry *entries, const size_t count);
+
+		/**
+		 * @brief Authenticate and decrypt a batch of independent messages, a failing one does not stop the processing of the others
+		 *
+		 * @param[in,out]	entries		the messages, their authenticated flag is set
+		 * @param[in]		count		number of messages
+		 *
+		 * @return the number of messages failing authentication
+		 */
+		size_t decryptBatch(AEADBatchEntry *entries, const size_t count);
+
+	private:
+		struct Impl;
+		std::unique_ptr<Impl> pImpl;
+};
+
+/* AEADContext is instanciated in the library for AES256-GCM with 128 bits auth tag and ChaCha20-Poly1305 */
+extern template class AEADContext<AES256GCM128>;
+extern template class AEADContext<CHACHA20POLY1305>;
+
+/**
+ * @brief Encrypt and tag a batch of independent messages under the same key, using scheme given as template parameter
+ * The key is expanded once for the whole batch and no allocation is made per message.
+ *
+ * @param[in]		key		Encryption key, size given by AEADAlgo::keySize()
+ * @param[in,out]	entries		the messages
+ * @param[in]		count		number of messages
+ */
+template <typename AEADAlgo>
+void AEADEncryptBatch(const uint8_t *key, AEADBatchEntry *entries, const size_t count);
+
+/**
+ * @brief Authenticate and decrypt a batch of independent messages under the same key, using scheme given as template parameter
+ * A message failing authentication does not stop the processing of the others.
+ *
+ * @param[in]		key		Encryption key, size given by AEADAlgo::keySize()
+ * @param[in,out]	entries		the messages, their authenticated flag is set
+ * @param[in]		count		number of messages
+ *
+ * @return the number of messages failing authentication
+ */
+template <typename AEADAlgo>
+size_t AEADDecryptBatch(const uint8_t *key, AEADBatchEntry *entries, const size_t count);
+
+/* declare AEAD batch template specialisations : AES256-GCM with 128 bits auth tag*/
+template <> void AEADEncryptBatch<AES256GCM128>(const uint8_t *key, AEADBatchEntry *entries, const size_t count);
+template <> size_t AEADDecryptBatch<AES256GCM128>(const uint8_t *key, AEADBatchEntry *entries, const size_t count);
+/* declare AEAD batch template specialisations : ChaCha20-Poly1305 */
+template <> void AEADEncryptBatch<CHACHA20POLY1305>(const uint8_t *key, AEADBatchEntry *entries, const size_t count);
+template <> size_t AEADDecryptBatch<CHACHA20POLY1305>(const uint8_t *key, AEADBatchEntry *entries, const size_t count);
+
 } // namespace bctoolbox
 #endif // BCTBX_CRYPTO_HH
 
@@ -104,15 +104,87 @@ BCTBX_PUBLIC bctbx_log_handler_t* bctbx_create_file_log_handler(uint64_t max_siz
  * @brief Request reopening of the log file.
  * @param[in] file_log_handler The log handler whose file will be reopened.
  * @note This function is thread-safe and reopening is done asynchronously.
+ * It applies to file log handlers and buffered file log handlers.
  */
 BCTBX_PUBLIC void bctbx_file_log_handler_reopen(bctbx_log_handler_t *file_log_handler);
 
+/**
+ * Behaviour of the asynchronous logging mode and of the buffered file log handlers when their buffer is full.
+ */
+typedef enum {
+	BCTBX_LOG_ASYNC_DROP, /**< the record is discarded and accounted in bctbx_log_async_get_dropped_count(), or in the log file */
+	BCTBX_LOG_ASYNC_BLOCK /**< the logging thread waits for the writer thread to free some room */
+} BctbxLogAsyncOverflowPolicy;
+
+/*
+ Function called by a buffered file log handler, from its background thread, on each log file it rotated.
+ It can for example compress the file.
+ @param[in] void* user_data : the data given to bctbx_buffered_file_log_handler_set_rotated_callback()
+ @param[in] const char* rotated_file : the path of the rotated log file
+*/
+typedef void (*BctbxLogFileRotatedFunc)(void *user_data, const char *rotated_file);
+
+/*
+ Function to create a buffered file log handler.
+ Log records are appended to a memory buffer that a background thread writes to the file in a single write, once it holds
+ flush_size bytes or flush_interval_ms after the previous write. Rotation is also performed by the background thread.
+ Fatal log records are written before the log function returns. If the file cannot be opened again after a rotation or
+ a reopen request, the background thread retries on each write and the size of the records lost meanwhile is written
+ to the file once it is open.
+ @param[in] uint64_t max_size : the maximum size of the log file before rotating to a new one (if 0 then no rotation)
+ @param[in] const char* path : the path where to put the log files
+ @param[in] const char* name : the name of the log files
+ @param[in] size_t flush_size : the buffered size triggering a write
+ @param[in] unsigned int flush_interval_ms : the maximum delay before a log record is written
+ @return a new bctbx_log_handler_t, NULL if the file cannot be opened. bctbx_remove_log_handler() writes the pending records and frees it.
+*/
+BCTBX_PUBLIC bctbx_log_handler_t* bctbx_create_buffered_file_log_handler(uint64_t max_size, const char* path, const char* name, size_t flush_size, unsigned int flush_interval_ms);
+
+/*
+ Set the function called on each log file rotated by a buffered file log handler.
+*/
+BCTBX_PUBLIC void bctbx_buffered_file_log_handler_set_rotated_callback(bctbx_log_handler_t *buffered_file_log_handler, BctbxLogFileRotatedFunc func, void *user_data);
+
+/*
+ Set the maximum size of the records a buffered file log handler holds while its background thread is writing, and what
+ to do with the records logged once it is reached. Dropped records are accounted in the log file.
+ By default the size is 16 times the flush size, and at least 1MB, and the logging threads wait.
+ A record logged from the background thread, by the rotation callback, is never dropped nor waits.
+*/
+BCTBX_PUBLIC void bctbx_buffered_file_log_handler_set_overflow_policy(bctbx_log_handler_t *buffered_file_log_handler, size_t max_buffered_size, BctbxLogAsyncOverflowPolicy policy);
+
+/*
+ Wait until the log records given to a buffered file log handler before this call are written to its file.
+*/
+BCTBX_PUBLIC void bctbx_buffered_file_log_handler_flush(bctbx_log_handler_t *buffered_file_log_handler);
+
+/*
+ Function to create a binary file log handler.
+ Log records are not formatted: the format string identifier, the raw arguments, the timestamp, the thread id and the domain
+ are appended to a compact binary file, rendered as text later by bctbx_binary_log_decode() or the bctbx-log-decode tool.
+ Format strings and domains are stored once per opening of the file. The file is flushed on records of warning level and above.
+ Arguments of %n and wide characters conversions are not stored.
+ @param[in] const char* path : the path where to put the log file
+ @param[in] const char* name : the name of the log file
+ @return a new bctbx_log_handler_t, NULL if the file cannot be opened. bctbx_remove_log_handler() closes the file and frees it.
+*/
+BCTBX_PUBLIC bctbx_log_handler_t* bctbx_create_binary_file_log_handler(const char* path, const char* name);
+
+/*
+ Render a binary log file as text, one line per record in the file log handler format with the thread id.
+ @param[in] FILE* input : the binary log file
+ @param[in] FILE* output : where to write the text
+ @return 0 on success, -1 if the input is not a binary log file or is truncated. The records preceding the error are output.
+*/
+BCTBX_PUBLIC int bctbx_binary_log_decode(FILE *input, FILE *output);
+
 /* set domain the handler is limited to. NULL for ALL*/
 BCTBX_PUBLIC void bctbx_log_handler_set_domain(bctbx_log_handler_t * log_handler,const char *domain);
 BCTBX_PUBLIC void bctbx_log_handler_set_user_data(bctbx_log_handler_t*, void* user_data);
 BCTBX_PUBLIC void *bctbx_log_handler_get_user_data(const bctbx_log_handler_t* log_handler);
 
 BCTBX_PUBLIC void bctbx_add_log_handler(bctbx_log_handler_t* handler);
+/* the records queued by the asynchronous logging mode before this call are given to the handler before it is destroyed */
 BCTBX_PUBLIC void bctbx_remove_log_handler(bctbx_log_handler_t* handler);
 
 /*
@@ -140,6 +212,31 @@ BCTBX_PUBLIC int bctbx_log_level_enabled(const char *domain, BctbxLogLevel level
 
 BCTBX_PUBLIC void bctbx_logv(const char *domain, BctbxLogLevel level, const char *fmt, va_list args);
 
+/**
+ * Interned log domain.
+ * It is obtained once with bctbx_log_domain_get() and remains valid for the process lifetime, so that logging through it
+ * does not look the domain up by its name.
+ */
+typedef struct _BctoolboxLogDomain bctbx_log_domain_t;
+
+/**
+ * Get the interned log domain for a name, creating it if needed.
+ * Until its level is set, the domain follows the default log level, like domains that are not interned.
+ * @param[in] domain The domain name, NULL for the default domain.
+ */
+BCTBX_PUBLIC bctbx_log_domain_t *bctbx_log_domain_get(const char *domain);
+
+/**
+ * Same as bctbx_log_level_enabled() for an interned domain.
+ * A level disabled for all threads is detected with a single load and a branch.
+ */
+BCTBX_PUBLIC int bctbx_log_domain_level_enabled(const bctbx_log_domain_t *domain, BctbxLogLevel level);
+
+/**
+ * Same as bctbx_logv() for an interned domain.
+ */
+BCTBX_PUBLIC void bctbx_log_domain_logv(bctbx_log_domain_t *domain, BctbxLogLevel level, const char *fmt, va_list args);
+
 /**
  * Flushes the log output queue.
  * WARNING: Must be called from the thread that has been defined with bctbx_set_log_thread_id().
@@ -174,6 +271,38 @@ BCTBX_PUBLIC void bctbx_clear_thread_log_level(const char *domain);
  */
 BCTBX_PUBLIC void bctbx_set_log_thread_id(unsigned long thread_id);
 
+/**
+ * Start the asynchronous logging mode.
+ * Log records are formatted by the logging thread into a preallocated lock-free queue and given to the log handlers
+ * by a dedicated writer thread, so that logging does not take any lock nor perform any system call.
+ * While records keep coming the writer thread picks them up every few milliseconds, it is woken up earlier only when the
+ * queue is half full or flushed.
+ * Records are given to the log handlers in the order they were queued. Fatal logs are not queued: the pending records
+ * are flushed and the fatal one is output synchronously.
+ * @param[in] capacity The number of records the queue can hold, rounded up to a power of 2.
+ * @param[in] record_size The size of the buffer preallocated for each record message, longer messages are allocated on the heap.
+ * @param[in] policy What to do with a record when the queue is full.
+ * @return 0 on success, -1 if the asynchronous logging mode is already started or the writer thread cannot be created.
+ */
+BCTBX_PUBLIC int bctbx_log_async_start(size_t capacity, size_t record_size, BctbxLogAsyncOverflowPolicy policy);
+
+/**
+ * Wait until all the records queued before this call have been given to the log handlers.
+ * Does nothing if the asynchronous logging mode is not started.
+ */
+BCTBX_PUBLIC void bctbx_log_async_flush(void);
+
+/**
+ * Stop the asynchronous logging mode: the queued records are given to the log handlers and the writer thread is joined.
+ * Logs are then output synchronously again.
+ */
+BCTBX_PUBLIC void bctbx_log_async_stop(void);
+
+/**
+ * Get the number of records dropped because the queue was full since the asynchronous logging mode was started.
+ */
+BCTBX_PUBLIC uint64_t bctbx_log_async_get_dropped_count(void);
+
 #ifdef __GNUC__
 #define CHECK_FORMAT_ARGS(m,n) __attribute__((format(printf,m,n)))
 #else
@@ -200,6 +329,7 @@ static BCTBX_INLINE void CHECK_FORMAT_ARGS(1,2) bctbx_debug(const char *fmt,...)
 #ifdef BCTBX_NOMESSAGE_MODE
 
 #define bctbx_log(...)
+#define bctbx_log_domain_log(...)
 #define bctbx_message(...)
 #define bctbx_warning(...)
 
@@ -212,6 +342,13 @@ static BCTBX_INLINE void bctbx_log(const char* domain, BctbxLogLevel lev, const
 	va_end (args);
 }
 
+static BCTBX_INLINE void CHECK_FORMAT_ARGS(3,4) bctbx_log_domain_log(bctbx_log_domain_t *domain, BctbxLogLevel lev, const char *fmt,...) {
+	va_list args;
+	va_start (args, fmt);
+	bctbx_log_domain_logv(domain, lev, fmt, args);
+	va_end (args);
+}
+
 static BCTBX_INLINE void CHECK_FORMAT_ARGS(1,2) bctbx_message(const char *fmt,...)
 {
 	va_list args;
@@ -305,19 +442,80 @@ namespace bctoolbox {
 
 #include <ostream>
 
-class pumpstream : public std::ostringstream {
+namespace bctoolbox {
+	namespace log {
+
+		struct StreamStorage;
+
+		/**
+		 * Stream buffer of the BCTBX_SLOG macros.
+		 * It writes into a storage of the calling thread reused from one log statement to the next, so that logging does not
+		 * allocate once the storage is large enough. A log statement nested in the formatting of another one uses its own storage.
+		 * The buffer must be destroyed by the thread that built it, in any order with respect to the other buffers.
+		 */
+		class BCTBX_PUBLIC StreamBuffer : public std::streambuf {
+		private:
+			StreamStorage *mStorage; /**< borrowed from the thread storages for the lifetime of the buffer, NULL when disabled */
+
+			void grow(size_t count);
+
+		protected:
+			int_type overflow(int_type ch) override;
+			std::streamsize xsputn(const char *s, std::streamsize count) override;
+
+		public:
+			explicit StreamBuffer(bool enabled);
+			~StreamBuffer();
+			StreamBuffer(const StreamBuffer &) = delete;
+			StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+			/** @return the text written so far, null terminated */
+			const char *c_str();
+			/** @return a copy of the text written so far */
+			std::string str() const;
+			/** Replace the text written so far */
+			void str(const std::string &text);
+		};
+
+		/* Base of pumpstream holding its stream buffer, so that the buffer is built before the std::ostream using it */
+		struct StreamBufferHolder {
+			StreamBuffer mBuffer;
+			explicit StreamBufferHolder(bool enabled) : mBuffer(enabled) {}
+		};
+
+		/* Turns a stream insertion chain into a void expression, so that the BCTBX_SLOG macros can be a conditional expression */
+		struct StreamVoidify {
+			void operator&(const std::ostream &) {}
+		};
+	}
+}
+
+/*
+ * Stream logging its text when destroyed.
+ * It is a std::ostream providing the str() functions of std::ostringstream, but no longer a std::ostringstream:
+ * code taking a std::ostringstream & must take a std::ostream & instead.
+ */
+class pumpstream : private bctoolbox::log::StreamBufferHolder, public std::ostream {
 public:
 	/*contructor used to disable logging*/
-	pumpstream():mDomain(""),mLevel(BCTBX_LOG_DEBUG),mTraceEnabled(false){}
-	pumpstream(const char *domain, BctbxLogLevel level) : mDomain(domain ? domain : ""), mLevel(level),mTraceEnabled(true) {}
+	pumpstream() : StreamBufferHolder(false), std::ostream(nullptr), mDomain(NULL), mLevel(BCTBX_LOG_DEBUG), mTraceEnabled(false) {}
+	/* domain must remain valid until the destruction of the stream, which is the case of the temporaries of the BCTBX_SLOG macros */
+	pumpstream(const char *domain, BctbxLogLevel level)
+		: StreamBufferHolder(true), std::ostream(&mBuffer), mDomain((domain && domain[0] != '\0') ? domain : NULL), mLevel(level), mTraceEnabled(true) {}
 	~pumpstream() {
-		const char *domain = mDomain.empty() ? NULL : mDomain.c_str();
-		if (mTraceEnabled && bctbx_log_level_enabled(domain, mLevel))
-			bctbx_log(domain, mLevel, "%s", str().c_str());
+		if (mTraceEnabled)
+			bctbx_log(mDomain, mLevel, "%s", mBuffer.c_str());
+	}
+
+	std::string str() const {
+		return mBuffer.str();
+	}
+	void str(const std::string &text) {
+		mBuffer.str(text);
 	}
 
 private:
-	const std::string mDomain;
+	const char *const mDomain;
 	const BctbxLogLevel mLevel;
 	const bool mTraceEnabled;
 };
@@ -325,17 +523,24 @@ private:
 
 #if (__GNUC__ == 4 && __GNUC_MINOR__ < 5 && __cplusplus > 199711L)
 template <typename _Tp> inline pumpstream &operator<<(pumpstream &&__os, const _Tp &__x) {
-	(static_cast<std::ostringstream &>(__os)) << __x;
+	(static_cast<std::ostream &>(__os)) << __x;
 	return __os;
 }
 #endif
 
-#define BCTBX_SLOG(domain, thelevel) pumpstream(domain, thelevel)
+/*
+ * The level is checked before the stream is built: a disabled log statement neither builds it nor evaluates the streamed values.
+ * The macros are therefore void expressions, to be used as statements only: BCTBX_SLOGI << "text";
+ * Code using the stream itself, for example to keep a reference on it or to call its members, must build a
+ * pumpstream(domain, level) instead.
+ */
+#define BCTBX_SLOG(domain, thelevel) \
+	!bctbx_log_level_enabled((domain), (thelevel)) ? (void)0 : bctoolbox::log::StreamVoidify() & pumpstream((domain), (thelevel))
 
 #ifndef BCTBX_DEBUG_MODE
 #define BCTBX_SLOGD BCTBX_SLOG(BCTBX_LOG_DOMAIN, BCTBX_LOG_DEBUG)
 #else
-#define BCTBX_SLOGD pumpstream()
+#define BCTBX_SLOGD true ? (void)0 : bctoolbox::log::StreamVoidify() & pumpstream()
 #endif
 
 #define BCTBX_SLOGI BCTBX_SLOG(BCTBX_LOG_DOMAIN, BCTBX_LOG_MESSAGE)
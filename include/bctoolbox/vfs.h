@@ -21,6 +21,7 @@
 #define BCTBX_VFS_H
 
 #include <fcntl.h>
+#include <stddef.h>
 
 #include <bctoolbox/port.h>
 
@@ -67,6 +68,7 @@ typedef struct bctbx_io_methods_t bctbx_io_methods_t;
 
 /**
  * VFS file handle.
+ * Handles are allocated by bctbx_file_open and bctbx_file_open2: the default implementation keeps its own state after this structure.
  */
 typedef struct bctbx_vfs_file_t bctbx_vfs_file_t;
 struct bctbx_vfs_file_t {
@@ -78,6 +80,15 @@ struct bctbx_vfs_file_t {
 };
 
 
+/**
+ * A buffer of a vectored read or write
+ */
+typedef struct bctbx_iovec_t bctbx_iovec_t;
+struct bctbx_iovec_t {
+	void *base; /* start of the buffer */
+	size_t len; /* size of the buffer in bytes */
+};
+
 /**
  */
 struct bctbx_io_methods_t {
@@ -91,6 +102,25 @@ struct bctbx_io_methods_t {
 	bool_t (*pFuncIsEncrypted)(bctbx_vfs_file_t *pFile);
 };
 
+/**
+ * Optional methods, in addition to the bctbx_io_methods_t ones which layout is fixed.
+ * A vfs registers them for its bctbx_io_methods_t with bctbx_io_methods_set_ext.
+ * New methods are only appended: size, set by the vfs to the sizeof(bctbx_io_methods_ext_t) it was built with,
+ * tells which ones it knows. Check a method with BCTBX_IO_METHODS_EXT_HAS before calling it.
+ */
+typedef struct bctbx_io_methods_ext_t bctbx_io_methods_ext_t;
+struct bctbx_io_methods_ext_t {
+	size_t size;
+	/* vectored operations, the generic implementation calls pFuncRead/pFuncWrite on each buffer */
+	ssize_t (*pFuncReadv)(bctbx_vfs_file_t *pFile, const bctbx_iovec_t *iov, int iovcnt, off_t offset);
+	ssize_t (*pFuncWritev)(bctbx_vfs_file_t *pFile, const bctbx_iovec_t *iov, int iovcnt, off_t offset);
+	/* preferred read size, called at open. The generic bctbx_file_get_nxtline reads ahead by multiples of it, 0 for the default */
+	size_t (*pFuncGetBlockSize)(bctbx_vfs_file_t *pFile);
+};
+
+/* true when the optional methods ext provide method */
+#define BCTBX_IO_METHODS_EXT_HAS(ext, method) ((ext) != NULL && (ext)->size >= offsetof(bctbx_io_methods_ext_t, method) + sizeof((ext)->method) && (ext)->method != NULL)
+
 
 /**
  * VFS definition
@@ -112,6 +142,16 @@ struct bctbx_vfs_t {
  */
 BCTBX_PUBLIC ssize_t bctbx_file_read(bctbx_vfs_file_t *pFile, void *buf, size_t count, off_t offset);
 
+/**
+ * Reads from the file at offset into several buffers, filled in order as if they were a single contiguous one.
+ * @param  pFile  bctbx_vfs_file_t File handle pointer.
+ * @param  iov    Buffers holding the read bytes.
+ * @param  iovcnt Number of buffers.
+ * @param  offset Where to start reading in the file (in bytes).
+ * @return        Number of bytes read on success, BCTBX_VFS_ERROR otherwise.
+ */
+BCTBX_PUBLIC ssize_t bctbx_file_readv(bctbx_vfs_file_t *pFile, const bctbx_iovec_t *iov, int iovcnt, off_t offset);
+
 /**
  * Close the file from its descriptor pointed by thw bctbx_vfs_file_t handle.
  * @param  pFile File handle pointer.
@@ -168,6 +208,16 @@ BCTBX_PUBLIC int bctbx_file_truncate(bctbx_vfs_file_t *pFile, int64_t size);
  */
 BCTBX_PUBLIC ssize_t bctbx_file_write(bctbx_vfs_file_t *pFile, const void *buf, size_t count, off_t offset);
 
+/**
+ * Writes the content of several buffers, in order, to the file at offset as if they were a single contiguous one.
+ * @param  pFile 	File handle pointer.
+ * @param  iov    	Buffers holding the values to write.
+ * @param  iovcnt  	Number of buffers.
+ * @param  offset 	Position in the file where to start writing.
+ * @return        	Number of bytes written on success, BCTBX_VFS_ERROR if an error occurred.
+ */
+BCTBX_PUBLIC ssize_t bctbx_file_writev(bctbx_vfs_file_t *pFile, const bctbx_iovec_t *iov, int iovcnt, off_t offset);
+
 /**
  * Writes to file.
  * @param  pFile  File handle pointer.
@@ -177,6 +227,26 @@ BCTBX_PUBLIC ssize_t bctbx_file_write(bctbx_vfs_file_t *pFile, const void *buf,
  */
 BCTBX_PUBLIC ssize_t bctbx_file_fprintf(bctbx_vfs_file_t *pFile, off_t offset, const char *fmt, ...);
 
+/**
+ * Enables or disables the buffered writer mode of bctbx_file_fprintf.
+ * In this mode bctbx_file_fprintf formats into a reusable buffer and appends the result to a write buffer,
+ * contiguous appends are coalesced and written by whole blocks of the file (chunks on an encrypted file).
+ * The write buffer is flushed by bctbx_file_flush, bctbx_file_sync, bctbx_file_close and before any other
+ * read, write, truncate or size query through the file handle.
+ * The write buffer is shared, under a lock, by the threads using the handle, asynchronous I/O threads included.
+ * @param  pFile  File handle pointer.
+ * @param  size   Size of the write buffer in bytes, rounded up to a multiple of the file block size. 0 flushes and disables the buffered mode.
+ * @return        BCTBX_VFS_OK on success, BCTBX_VFS_ERROR otherwise.
+ */
+BCTBX_PUBLIC int bctbx_file_set_write_buffer(bctbx_vfs_file_t *pFile, size_t size);
+
+/**
+ * Writes the content pending in the write buffer of bctbx_file_fprintf to the file.
+ * @param  pFile  File handle pointer.
+ * @return        BCTBX_VFS_OK on success or when nothing is pending, BCTBX_VFS_ERROR otherwise: the pending content is then lost.
+ */
+BCTBX_PUBLIC int bctbx_file_flush(bctbx_vfs_file_t *pFile);
+
 /**
  * Wrapper to pFuncGetNxtLine. Returns a line with at most maxlen characters
  * from the file associated to pFile and  writes it into s.
@@ -212,6 +282,58 @@ BCTBX_PUBLIC off_t bctbx_file_seek(bctbx_vfs_file_t *pFile, off_t offset, int wh
  */
 BCTBX_PUBLIC bool_t bctbx_file_is_encrypted(bctbx_vfs_file_t *pFile);
 
+/**
+ * Completion callback of an asynchronous read or write.
+ * It is called from an I/O thread.
+ * @param  user_data  The pointer given at submission.
+ * @param  result     Same as the synchronous function: number of bytes read or written, BCTBX_VFS_ERROR on error.
+ */
+typedef void (*bctbx_vfs_async_cb_t)(void *user_data, ssize_t result);
+
+/**
+ * Read from a file on a background I/O thread, then call cb with the result.
+ * Requests are started in submission order. The file and the buffer must stay valid until cb is called.
+ * The vfs read function is called concurrently with the other accesses to the file: it must support it,
+ * as the standard vfs does when it uses positional reads.
+ * @param  pFile     File handle pointer.
+ * @param  buf       Buffer holding the read bytes.
+ * @param  count     Number of bytes to read.
+ * @param  offset    Where to start reading in the file (in bytes).
+ * @param  cb        Completion callback.
+ * @param  user_data Given back to cb.
+ * @return BCTBX_VFS_OK if the request is queued, BCTBX_VFS_ERROR otherwise.
+ */
+BCTBX_PUBLIC int bctbx_file_read_async(bctbx_vfs_file_t *pFile, void *buf, size_t count, off_t offset, bctbx_vfs_async_cb_t cb, void *user_data);
+
+/**
+ * Write to a file on a background I/O thread, then call cb with the result.
+ * Requests are started in submission order but may complete in any order. The file and the buffer must stay valid until cb is called.
+ * @param  pFile     File handle pointer.
+ * @param  buf       Buffer holding the bytes to write.
+ * @param  count     Number of bytes to write.
+ * @param  offset    Where to start writing in the file (in bytes).
+ * @param  cb        Completion callback.
+ * @param  user_data Given back to cb.
+ * @return BCTBX_VFS_OK if the request is queued, BCTBX_VFS_ERROR otherwise.
+ */
+BCTBX_PUBLIC int bctbx_file_write_async(bctbx_vfs_file_t *pFile, const void *buf, size_t count, off_t offset, bctbx_vfs_async_cb_t cb, void *user_data);
+
+/**
+ * Registers the optional methods of a vfs.
+ * Register them once, at first use: the lookup done at each file opening does not lock, registrations do.
+ * @param methods The methods the vfs sets in the file handles it opens.
+ * @param ext     Its optional methods, they must stay valid until unregistered. NULL unregisters them.
+ * @return BCTBX_VFS_OK, BCTBX_VFS_ERROR when too many vfs registered optional methods.
+ */
+BCTBX_PUBLIC int bctbx_io_methods_set_ext(const bctbx_io_methods_t *methods, const bctbx_io_methods_ext_t *ext);
+
+/**
+ * Gets the optional methods registered for methods.
+ * @param methods The methods of a file handle.
+ * @return the optional methods, NULL if none were registered.
+ */
+BCTBX_PUBLIC const bctbx_io_methods_ext_t *bctbx_io_methods_get_ext(const bctbx_io_methods_t *methods);
+
 /**
  * Set default VFS pointer pDefault to my_vfs.
  * By default, the global pointer is set to use VFS implemnted in vfs.c
@@ -23,8 +23,11 @@
 #include "bctoolbox/vfs.h"
 #include "bctoolbox/exception.hh"
 #include <functional>
-#include <vector>
+#include <list>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 #include "bctoolbox/port.h"
 
 namespace bctoolbox {
@@ -63,6 +66,7 @@ enum class EncryptionSuite : uint16_t {
 	unset = 0,/**< no encryption suite selected */
 	dummy = 1, /**< a test suite, do not use other than for test */
 	aes256gcm128_sha256 = 2, /**< This module encrypts blocks with AES256GCM and authenticate header using HMAC-sha256 */
+	chacha20poly1305_sha256 = 3, /**< This module encrypts blocks with ChaCha20-Poly1305 and authenticate header using HMAC-sha256 */
 	plain = 0xFFFF /**< no encryption activated, direct use of standard file system API */
 };
 
@@ -82,14 +86,28 @@ class VfsEncryption;
  */
 using EncryptedVfsOpenCb = std::function<void(VfsEncryption &settings)>;
 
+/**
+ * Define a function prototype to report the progress of a long operation on an encrypted file
+ * Called with the number of chunks processed so far and the total number of chunks
+ */
+using EncryptedVfsProgressCb = std::function<void(uint32_t processedChunks, uint32_t totalChunks)>;
+
 // forward declare this type, store all the encryption data and functions
 class VfsEncryptionModule;
+// forward declare this type, threads used to process chunks in parallel
+class WorkerPool;
 
 /** Store in the bctbx_vfs_file_t userData field an object specific to encryption */
 class VfsEncryption {
 	/* Class properties and method */
 	private:
 		static EncryptedVfsOpenCb s_openCallback; /**< a class callback to get secret material at file opening. Implemented as static as it is called by constructor */
+		static std::shared_ptr<WorkerPool> s_workerPool; /**< optional threads shared by all files to encrypt/decrypt chunks in parallel */
+		static size_t s_workerPoolChunkThreshold; /**< operations on less chunks than this threshold are not spread on the worker pool */
+		/**
+		 * @return the worker pool to use for an operation on the given number of chunks, nullptr if it shall be processed by the calling thread only
+		 */
+		static std::shared_ptr<WorkerPool> workerPoolGet(size_t chunkCount) noexcept;
 	public:
 		/**
 		 * at file opening a callback ask for crypto material, it is class property, set it using this class method
@@ -97,6 +115,21 @@ class VfsEncryption {
 		static void openCallbackSet(EncryptedVfsOpenCb cb) noexcept;
 		static EncryptedVfsOpenCb openCallbackGet() noexcept;
 
+		/**
+		 * Set the worker pool used by all the encrypted files to encrypt/decrypt the chunks of large reads and writes in parallel.
+		 * Reads and writes on less than chunkThreshold chunks are always processed by the calling thread.
+		 * The pool is disabled by default.
+		 * Operations in progress keep using the previous pool until they complete.
+		 *
+		 * @param[in]	threadCount	number of worker threads, the calling thread also takes its share of the work. 0 disables the pool
+		 * @param[in]	chunkThreshold	minimum number of chunks involved in an operation to use the pool
+		 */
+		static void workerPoolSet(size_t threadCount, size_t chunkThreshold = 16);
+		/**
+		 * @return the number of threads in the worker pool, 0 when disabled
+		 */
+		static size_t workerPoolThreadCountGet() noexcept;
+
 	/* Object properties and methods */
 	private:
 		uint16_t mVersionNumber; /**< version number of the encryption vfs */
@@ -104,17 +137,49 @@ class VfsEncryption {
 		size_t rawChunkSizeGet() const noexcept; /** return the size of a chunk including its encryption header, as stored in the raw file */
 		std::shared_ptr<VfsEncryptionModule> m_module; /**< one of the available encryption module : if nullptr, assume we deal with regular plain file */
 		size_t mHeaderExtensionSize; /**< header extension size */
+		std::vector<uint8_t> mHeaderExtension; /**< header extension content, authenticated with the rest of the header */
 		const std::string mFilename; /**< the filename as given to the open function */
 		uint64_t mFileSize; /**< size of the plaintext file */
 
 		uint64_t rawFileSizeGet() const noexcept; /**< return the size of the raw file */
 		uint32_t getChunkIndex(uint64_t offset) const noexcept; /**< return the chunk index where to find the given offset */
 		size_t getChunkOffset(uint32_t index) const noexcept; /**< return the offset in the actual file of the begining of the chunk */
+		size_t chunkPlainSizeGet(uint32_t index, uint64_t fileSize) const noexcept; /**< return the plain size of the given chunk in a file of the given plain size */
 		std::vector<uint8_t> r_header; /**< a cache of the header - without the encryption module data */
 		/** flags use to communicate during differents functions involved at file opening **/
 		bool mEncryptExistingPlainFile; /**< when opening a plain file, if the callback set an encryption suite and key material : migrate the file */
 		bool mIntegrityFullCheck; /**< if the file size given in the header metadata is incorrect, full check the file integrity and revrite header */
 		int mAccessMode; /**< the flags used to open the file, filtered on the access mode */
+		size_t mChunkKeyCacheSize; /**< maximum number of derived chunk keys the encryption module keeps in cache */
+		bool mHeaderWriteBack; /**< when set, file size changes are written to the header only on sync or close */
+		bool mHeaderDirty; /**< the file size in the header written on disk is not up to date */
+
+		/**
+		 * Plain chunks cache: most recently used chunk first, the map gives direct access to the list element
+		 * Cached chunks hold the whole plain content of the chunk. Read is a const method so all of it is mutable
+		 */
+		size_t mPlainCacheSize; /**< maximum size in bytes of the plain chunks cache, 0 disables it */
+		mutable std::list<std::pair<uint32_t, std::vector<uint8_t>>> mPlainChunks;
+		mutable std::unordered_map<uint32_t, decltype(mPlainChunks)::iterator> mPlainChunksIndex;
+		mutable std::mutex mPlainCacheMutex; /**< chunks may be processed concurrently, protect the plain chunks cache and its size */
+		bool mRekeyPending; /**< the temporary file of an interrupted rekey exists, it is discarded at the first modification */
+		/**
+		 * Copy a part of a cached plain chunk
+		 * @param[in]	index		the chunk index
+		 * @param[out]	plainData	where to copy the cached content
+		 * @param[in]	begin		start of the part to copy, from the begining of the chunk
+		 * @param[in]	end		end of the part to copy, from the begining of the chunk
+		 * @return false if the chunk is not in cache
+		 */
+		bool plainCacheRead(uint32_t index, uint8_t *plainData, size_t begin, size_t end) const;
+		/**
+		 * Store the plain content of a chunk in cache, replacing any previous one. Zeroize evicted chunks
+		 */
+		void plainCacheStore(uint32_t index, const uint8_t *plainData, size_t size) const;
+		/**
+		 * Zeroize and remove from cache all the chunks with an index greater or equal to the given one
+		 */
+		void plainCacheDrop(uint32_t fromIndex) const noexcept;
 
 		/**
 		 * Parse the header of an encrypted file, check everything seems correct
@@ -131,6 +196,23 @@ class VfsEncryption {
 		 * @throw a EvfsException if something goes wrong
 		 **/
 		void writeHeader(bctbx_vfs_file_t *fp=nullptr);
+		/**
+		 * Encrypt the existing plain file: the encrypted version is written to a temporary file which
+		 * then atomically replaces the original one.
+		 * @param[in]	openFlags	flags used to reopen the file once encrypted
+		 *
+		 * @throw a EvfsException if something goes wrong, the original file is then left untouched
+		 */
+		void migratePlainFile(int openFlags);
+		/**
+		 * Remove the temporary file of an interrupted rekey, if any: it cannot be resumed once the file is modified
+		 * Whether there is one is checked once when opening the file, so that writes do not hit the file system
+		 */
+		void discardPendingRekey() noexcept;
+		/**
+		 * Same as the public constructor but use the given callback instead of the class one
+		 */
+		VfsEncryption(bctbx_vfs_file_t *stdFp, const std::string &filename, int openFlags, int accessMode, const EncryptedVfsOpenCb &openCallback);
 
 	public:
 		bctbx_vfs_file_t *pFileStd; /**< The encrypted vfs encapsulate a standard one */
@@ -149,13 +231,81 @@ class VfsEncryption {
 
 		/* Read from file at given offset the requested size */
 		std::vector<uint8_t> read(size_t offset, size_t count) const;
+		/**
+		 * Read from file at given offset the requested size, decrypt directly in the given buffer
+		 * @param[out]	plainData	buffer of at least count bytes
+		 * @param[in]	count		number of bytes to read
+		 * @param[in]	offset		offset in the plain file
+		 * @return the number of bytes read, less than count when reaching the end of file
+		 */
+		size_t read(uint8_t *plainData, size_t count, size_t offset) const;
+		/**
+		 * Read from file at given offset into several buffers, chunks are decrypted directly in them
+		 * Only the chunks spread over several buffers are decrypted in a temporary one.
+		 * @param[in]	iov		buffers to fill, in order
+		 * @param[in]	iovcnt		number of buffers
+		 * @param[in]	offset		offset in the plain file
+		 * @return the number of bytes read, less than the buffers total size when reaching the end of file
+		 */
+		size_t readv(const bctbx_iovec_t *iov, int iovcnt, size_t offset) const;
 
 		/* write to file at given offset the requested size */
 		size_t write(const std::vector<uint8_t> &plainData, size_t offset);
+		/**
+		 * Write to file at given offset, encrypt directly from the given buffer
+		 * @param[in]	plainData	buffer of count bytes
+		 * @param[in]	count		number of bytes to write
+		 * @param[in]	offset		offset in the plain file, if it is after the end of file, the gap is filled with 0
+		 * @return the number of bytes written
+		 */
+		size_t write(const uint8_t *plainData, size_t count, size_t offset);
+		/**
+		 * Write several buffers to file at given offset, as a single write: chunks are encrypted directly from them
+		 * Only the chunks spread over several buffers are gathered in a temporary one.
+		 * @param[in]	iov		buffers to write, in order
+		 * @param[in]	iovcnt		number of buffers
+		 * @param[in]	offset		offset in the plain file, if it is after the end of file, the gap is filled with 0
+		 * @return the number of bytes written
+		 */
+		size_t writev(const bctbx_iovec_t *iov, int iovcnt, size_t offset);
 
 		/* Truncate the file to the given size, if given size is greater than current, pad with 0 */
 		void truncate(const uint64_t size);
 
+		/**
+		 * Authenticate all the chunks of the file
+		 * The file is read by large sequential blocks and the chunks are authenticated in parallel
+		 * on the worker pool if one is set, or on a temporary one using all the available cores.
+		 *
+		 * @param[out]	firstBadChunk	index of the first chunk failing authentication or missing, untouched if all chunks are authenticated
+		 * @param[in]	progress	optional callback called after each block of chunks is checked
+		 *
+		 * @return true if all the chunks are authenticated
+		 * @throw a EvfsException if the file is plain or cannot be read
+		 */
+		bool integrityCheck(uint32_t &firstBadChunk, const EncryptedVfsProgressCb &progress = nullptr) const;
+
+		/**
+		 * Re-encrypt the whole file with a new secret material and a new file salt
+		 * The file is re-encrypted to a temporary file which then atomically replaces the original one.
+		 * The progress is checkpointed in the temporary file header extension: if the operation is interrupted,
+		 * calling rekey again with the same secret material resumes it. Any modification of the file discards
+		 * the interrupted operation.
+		 * Note: chunk keys are derived from the master key, so all the chunks are re-encrypted.
+		 *
+		 * @param[in]	newSecretMaterial	the new secret material, the file is then encrypted with it only
+		 * @param[in]	progress		optional callback called after each block of chunks is re-encrypted
+		 *
+		 * @throw a EvfsException if the file is plain, read only or if something goes wrong
+		 */
+		void rekey(const std::vector<uint8_t> &newSecretMaterial, const EncryptedVfsProgressCb &progress = nullptr);
+
+		/**
+		 * Write the pending header update, if any, and sync the underlying file to the persistent media
+		 * @return the underlying vfs sync return value
+		 */
+		int sync();
+
 		/**
 		 *  Get the filename
 		 *  @return a string with the filename as given to the open function
@@ -199,6 +349,47 @@ class VfsEncryption {
 		 */
 		void chunkSizeSet(const size_t size);
 
+		/**
+		 * Returns the maximum number of derived chunk keys kept in cache by the encryption module
+		 */
+		size_t chunkKeyCacheSizeGet() const noexcept;
+		/**
+		 * Set the maximum number of derived chunk keys kept in cache by the encryption module.
+		 * Modules deriving a key per chunk use this cache to skip the key derivation on access to a recently used chunk.
+		 * Evicted keys are zeroized. 0 disables the cache, default is 64 keys.
+		 * Can be called at any time, typically from the open callback.
+		 */
+		void chunkKeyCacheSizeSet(const size_t size) noexcept;
+
+		/**
+		 * Returns the maximum size in bytes of the plain chunks cache
+		 */
+		size_t plainCacheSizeGet() const noexcept;
+		/**
+		 * Set the maximum size in bytes of the plain chunks cache.
+		 * The most recently read or written chunks are kept decrypted in memory and used to serve reads
+		 * and partial chunk writes without decryption. Evicted chunks are zeroized, so is the whole
+		 * cache when the file is closed.
+		 * The cache holds plainCacheSize/chunkSize chunks. 0 disables the cache, default is disabled.
+		 * Can be called at any time, typically from the open callback.
+		 */
+		void plainCacheSizeSet(const size_t size) noexcept;
+
+		/**
+		 * Returns true if the header write-back mode is enabled
+		 */
+		bool headerWriteBackGet() const noexcept;
+		/**
+		 * Enable or disable the header write-back mode.
+		 * The header is rewritten only when the file size changes. In write-back mode, this rewrite
+		 * is further deferred to the next sync or to the file closing: a sequence of appending writes
+		 * updates the header only once.
+		 * In case of crash before the header is written, the file size is recovered at next opening
+		 * by a whole file integrity check.
+		 * Disabling it writes the pending header update if any. Disabled by default.
+		 */
+		void headerWriteBackSet(bool enable);
+
 		/**
 		 * Get raw header: encryption module might check integrity on header
 		 * This function returns the raw header, without the encryption module part
@@ -33,6 +33,32 @@ extern "C"{
  */
 extern BCTBX_PUBLIC bctbx_vfs_t bcStandardVfs;
 
+/**
+ * Read only virtual file system serving reads from a memory mapping of the file.
+ * Files must be opened with O_RDONLY, writes and truncates fail.
+ * The mapping follows the file when it grows, a file must not be truncated while it is mapped.
+ * On platforms without mmap, files are accessed through the standard VFS.
+ */
+extern BCTBX_PUBLIC bctbx_vfs_t bcMmapVfs;
+
+/**
+ * Access pattern hints for a file opened with bcMmapVfs
+ */
+typedef enum {
+	BCTBX_VFS_MMAP_ADVICE_NORMAL, /**< no specific access pattern */
+	BCTBX_VFS_MMAP_ADVICE_SEQUENTIAL, /**< the file is read sequentially: aggressive read-ahead */
+	BCTBX_VFS_MMAP_ADVICE_RANDOM /**< the file is read at random offsets: no read-ahead */
+} bctbx_vfs_mmap_advice_t;
+
+/**
+ * Give the kernel a hint on how a file opened with bcMmapVfs is accessed.
+ * The hint is kept when the mapping is extended after the file grew.
+ * @param  pFile  File handle pointer, opened with bcMmapVfs.
+ * @param  advice The expected access pattern.
+ * @return BCTBX_VFS_OK on success, BCTBX_VFS_ERROR if the file is not mapped or the hint is refused.
+ */
+BCTBX_PUBLIC int bctbx_vfs_mmap_advise(bctbx_vfs_file_t *pFile, bctbx_vfs_mmap_advice_t advice);
+
 #ifdef __cplusplus
 }
 #endif
@@ -104,3 +104,64 @@ int bctbx_aes_gcm_decryptFile(void **cryptoContext, unsigned char *key, size_t l
 
 	return 0;
 }
+
+/*****************************************************************************/
+/***** AES GCM batch of messages under the same key                      *****/
+/*****************************************************************************/
+int32_t bctbx_aes_gcm_keyed_encrypt_and_tag_batch(bctbx_aes_gcm_keyed_context_t *context,
+		bctbx_aes_gcm_batch_entry_t *entries, size_t entriesCount,
+		size_t tagLength) {
+	int32_t ret = 0;
+	size_t i;
+
+	for (i = 0; i < entriesCount; i++) {
+		bctbx_aes_gcm_batch_entry_t *entry = entries + i;
+		entry->status = bctbx_aes_gcm_keyed_encrypt_and_tag(context, entry->input, entry->inputLength,
+				entry->authenticatedData, entry->authenticatedDataLength,
+				entry->initializationVector, entry->initializationVectorLength,
+				entry->tag, tagLength, entry->output);
+		if (ret == 0) ret = entry->status;
+	}
+	return ret;
+}
+
+int32_t bctbx_aes_gcm_keyed_decrypt_and_auth_batch(bctbx_aes_gcm_keyed_context_t *context,
+		bctbx_aes_gcm_batch_entry_t *entries, size_t entriesCount,
+		size_t tagLength) {
+	int32_t ret = 0;
+	size_t i;
+
+	for (i = 0; i < entriesCount; i++) {
+		bctbx_aes_gcm_batch_entry_t *entry = entries + i;
+		entry->status = bctbx_aes_gcm_keyed_decrypt_and_auth(context, entry->input, entry->inputLength,
+				entry->authenticatedData, entry->authenticatedDataLength,
+				entry->initializationVector, entry->initializationVectorLength,
+				entry->tag, tagLength, entry->output);
+		if (ret == 0) ret = entry->status;
+	}
+	return ret;
+}
+
+int32_t bctbx_aes_gcm_encrypt_and_tag_batch(const uint8_t *key, size_t keyLength,
+		bctbx_aes_gcm_batch_entry_t *entries, size_t entriesCount,
+		size_t tagLength) {
+	int32_t ret;
+	bctbx_aes_gcm_keyed_context_t *context = bctbx_aes_gcm_keyed_context_new(key, keyLength);
+
+	if (context == NULL) return BCTBX_ERROR_INVALID_INPUT_DATA;
+	ret = bctbx_aes_gcm_keyed_encrypt_and_tag_batch(context, entries, entriesCount, tagLength);
+	bctbx_aes_gcm_keyed_context_free(context);
+	return ret;
+}
+
+int32_t bctbx_aes_gcm_decrypt_and_auth_batch(const uint8_t *key, size_t keyLength,
+		bctbx_aes_gcm_batch_entry_t *entries, size_t entriesCount,
+		size_t tagLength) {
+	int32_t ret;
+	bctbx_aes_gcm_keyed_context_t *context = bctbx_aes_gcm_keyed_context_new(key, keyLength);
+
+	if (context == NULL) return BCTBX_ERROR_INVALID_INPUT_DATA;
+	ret = bctbx_aes_gcm_keyed_decrypt_and_auth_batch(context, entries, entriesCount, tagLength);
+	bctbx_aes_gcm_keyed_context_free(context);
+	return ret;
+}
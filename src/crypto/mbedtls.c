@@ -1733,6 +1733,96 @@ int32_t bctbx_aes_gcm_finish(bctbx_aes_gcm_context_t *context,
 	return ret;
 }
 
+/**
+ * @Brief create an AES-GCM context holding an expanded key, to encrypt or decrypt many buffers with the same key
+ *
+ * @param[in]	key							encryption key
+ * @param[in]	keyLength					key buffer length, in bytes, must be 16,24 or 32
+ *
+ * @return a pointer to the created context, to be freed using bctbx_aes_gcm_keyed_context_free(), NULL on error
+ */
+bctbx_aes_gcm_keyed_context_t *bctbx_aes_gcm_keyed_context_new(const uint8_t *key, size_t keyLength) {
+	int ret;
+	mbedtls_gcm_context *ctx = bctbx_malloc0(sizeof(mbedtls_gcm_context));
+
+	mbedtls_gcm_init(ctx);
+	ret = mbedtls_gcm_setkey(ctx, MBEDTLS_CIPHER_ID_AES, key, (unsigned int)keyLength*8);
+	if (ret != 0) {
+		mbedtls_gcm_free(ctx);
+		bctbx_free(ctx);
+		return NULL;
+	}
+
+	return (bctbx_aes_gcm_keyed_context_t *)ctx;
+}
+
+/**
+ * @Brief AES-GCM encrypt and tag buffer using a keyed context
+ *
+ * @param[in/out]	context					a context created by bctbx_aes_gcm_keyed_context_new
+ * @param[in]	plainText					Buffer to be encrypted
+ * @param[in]	plainTextLength				Length in bytes of buffer to be encrypted
+ * @param[in]	authenticatedData			Buffer holding additional data to be used in tag computation
+ * @param[in]	authenticatedDataLength		Additional data length in bytes
+ * @param[in]	initializationVector		Buffer holding the initialisation vector
+ * @param[in]	initializationVectorLength	Initialisation vector length in bytes
+ * @param[out]	tag							Buffer holding the generated tag
+ * @param[in]	tagLength					Requested length for the generated tag
+ * @param[out]	output						Buffer holding the output, shall be at least the length of plainText buffer
+ *
+ * @return 0 on success, mbedtls error code otherwise
+ */
+int32_t bctbx_aes_gcm_keyed_encrypt_and_tag(bctbx_aes_gcm_keyed_context_t *context,
+		const uint8_t *plainText, size_t plainTextLength,
+		const uint8_t *authenticatedData, size_t authenticatedDataLength,
+		const uint8_t *initializationVector, size_t initializationVectorLength,
+		uint8_t *tag, size_t tagLength,
+		uint8_t *output) {
+	return mbedtls_gcm_crypt_and_tag((mbedtls_gcm_context *)context, MBEDTLS_GCM_ENCRYPT, plainTextLength, initializationVector, initializationVectorLength, authenticatedData, authenticatedDataLength, plainText, output, tagLength, tag);
+}
+
+/**
+ * @Brief AES-GCM decrypt, compute authentication tag and compare it to the one provided, using a keyed context
+ *
+ * @param[in/out]	context					a context created by bctbx_aes_gcm_keyed_context_new
+ * @param[in]	cipherText					Buffer to be decrypted
+ * @param[in]	cipherTextLength			Length in bytes of buffer to be decrypted
+ * @param[in]	authenticatedData			Buffer holding additional data to be used in auth tag computation
+ * @param[in]	authenticatedDataLength		Additional data length in bytes
+ * @param[in]	initializationVector		Buffer holding the initialisation vector
+ * @param[in]	initializationVectorLength	Initialisation vector length in bytes
+ * @param[in]	tag							Buffer holding the authentication tag
+ * @param[in]	tagLength					Length in bytes for the authentication tag
+ * @param[out]	output						Buffer holding the output, shall be at least the length of cipherText buffer
+ *
+ * @return 0 on succes, BCTBX_ERROR_AUTHENTICATION_FAILED if tag doesn't match or mbedtls error code
+ */
+int32_t bctbx_aes_gcm_keyed_decrypt_and_auth(bctbx_aes_gcm_keyed_context_t *context,
+		const uint8_t *cipherText, size_t cipherTextLength,
+		const uint8_t *authenticatedData, size_t authenticatedDataLength,
+		const uint8_t *initializationVector, size_t initializationVectorLength,
+		const uint8_t *tag, size_t tagLength,
+		uint8_t *output) {
+	int ret = mbedtls_gcm_auth_decrypt((mbedtls_gcm_context *)context, cipherTextLength, initializationVector, initializationVectorLength, authenticatedData, authenticatedDataLength, tag, tagLength, cipherText, output);
+
+	if (ret == MBEDTLS_ERR_GCM_AUTH_FAILED) {
+		return BCTBX_ERROR_AUTHENTICATION_FAILED;
+	}
+
+	return ret;
+}
+
+/**
+ * @Brief Clean the key material and free a context created by bctbx_aes_gcm_keyed_context_new
+ *
+ * @param[in/out]	context			the context to free, may be NULL
+ */
+void bctbx_aes_gcm_keyed_context_free(bctbx_aes_gcm_keyed_context_t *context) {
+	if (context == NULL) return;
+	mbedtls_gcm_free((mbedtls_gcm_context *)context);
+	bctbx_free(context);
+}
+
 /*
  * @brief Wrapper for AES-128 in CFB128 mode encryption
  * Both key and IV must be 16 bytes long, IV is not updated
@@ -24,12 +24,11 @@
 #include <mbedtls/version.h>
 #include <mbedtls/entropy.h>
 #include <mbedtls/ctr_drbg.h>
-#include <mbedtls/md.h>
 #include <mbedtls/sha256.h>
 #include <mbedtls/sha512.h>
 #include <mbedtls/gcm.h>
-#if MBEDTLS_VERSION_NUMBER >= 0x020B0000 // v2.11.0
-#include <mbedtls/hkdf.h> // HKDF implemented in version 2.11.0 of mbedtls
+#if MBEDTLS_VERSION_NUMBER >= 0x020C0000 // v2.12.0
+#include <mbedtls/chachapoly.h> // ChaCha20-Poly1305 implemented in version 2.12.0 of mbedtls
 #endif
 
 
@@ -38,7 +37,11 @@
 #include "bctoolbox/crypto.h"
 #include "bctoolbox/exception.hh"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <system_error>
+#include <thread>
 
 namespace bctoolbox {
 
@@ -129,6 +132,193 @@ uint32_t RNG::cRandomize() {
 /*****************************************************************************/
 /***                      Hash related function                            ***/
 /*****************************************************************************/
+/* mbedtls hash functions are suffixed by _ret from version 2.7.0 to 2.28, not before nor after */
+#if MBEDTLS_VERSION_NUMBER >= 0x02070000 && MBEDTLS_VERSION_NUMBER < 0x03000000
+#define BCTBX_MBEDTLS_SHA256_STARTS mbedtls_sha256_starts_ret
+#define BCTBX_MBEDTLS_SHA256_UPDATE mbedtls_sha256_update_ret
+#define BCTBX_MBEDTLS_SHA256_FINISH mbedtls_sha256_finish_ret
+#define BCTBX_MBEDTLS_SHA512_STARTS mbedtls_sha512_starts_ret
+#define BCTBX_MBEDTLS_SHA512_UPDATE mbedtls_sha512_update_ret
+#define BCTBX_MBEDTLS_SHA512_FINISH mbedtls_sha512_finish_ret
+#else
+#define BCTBX_MBEDTLS_SHA256_STARTS mbedtls_sha256_starts
+#define BCTBX_MBEDTLS_SHA256_UPDATE mbedtls_sha256_update
+#define BCTBX_MBEDTLS_SHA256_FINISH mbedtls_sha256_finish
+#define BCTBX_MBEDTLS_SHA512_STARTS mbedtls_sha512_starts
+#define BCTBX_MBEDTLS_SHA512_UPDATE mbedtls_sha512_update
+#define BCTBX_MBEDTLS_SHA512_FINISH mbedtls_sha512_finish
+#endif
+
+/**
+ * @brief Hash context on the mbedtls SHA-2 implementation: unlike the mbedtls_md one, it does not allocate memory
+ * and it can be cloned
+ */
+template <typename hashAlgo>
+struct HashContext;
+
+template <>
+struct HashContext<SHA256> {
+	mbedtls_sha256_context ctx;
+
+	HashContext() {mbedtls_sha256_init(&ctx);}
+	~HashContext() {mbedtls_sha256_free(&ctx);}
+	HashContext(const HashContext &) = delete;
+	HashContext &operator=(const HashContext &) = delete;
+
+	void starts() {BCTBX_MBEDTLS_SHA256_STARTS(&ctx, 0);} // 0: SHA256, not SHA224
+	void update(const uint8_t *input, const size_t inputSize) {BCTBX_MBEDTLS_SHA256_UPDATE(&ctx, input, inputSize);}
+	void finish(uint8_t *output) {BCTBX_MBEDTLS_SHA256_FINISH(&ctx, output);}
+	void clone(const HashContext &src) {mbedtls_sha256_clone(&ctx, &src.ctx);}
+};
+
+template <>
+struct HashContext<SHA512> {
+	mbedtls_sha512_context ctx;
+
+	HashContext() {mbedtls_sha512_init(&ctx);}
+	~HashContext() {mbedtls_sha512_free(&ctx);}
+	HashContext(const HashContext &) = delete;
+	HashContext &operator=(const HashContext &) = delete;
+
+	void starts() {BCTBX_MBEDTLS_SHA512_STARTS(&ctx, 0);} // 0: SHA512, not SHA384
+	void update(const uint8_t *input, const size_t inputSize) {BCTBX_MBEDTLS_SHA512_UPDATE(&ctx, input, inputSize);}
+	void finish(uint8_t *output) {BCTBX_MBEDTLS_SHA512_FINISH(&ctx, output);}
+	void clone(const HashContext &src) {mbedtls_sha512_clone(&ctx, &src.ctx);}
+};
+
+template <>
+struct HashContext<SHA384> {
+	mbedtls_sha512_context ctx;
+
+	HashContext() {mbedtls_sha512_init(&ctx);}
+	~HashContext() {mbedtls_sha512_free(&ctx);}
+	HashContext(const HashContext &) = delete;
+	HashContext &operator=(const HashContext &) = delete;
+
+	void starts() {BCTBX_MBEDTLS_SHA512_STARTS(&ctx, 1);} // 1: SHA384
+	void update(const uint8_t *input, const size_t inputSize) {BCTBX_MBEDTLS_SHA512_UPDATE(&ctx, input, inputSize);}
+	void finish(uint8_t *output) {
+		// some mbedtls versions expect a 64 bytes output buffer even when computing SHA384
+		std::array<uint8_t, SHA512::ssize()> digest;
+		BCTBX_MBEDTLS_SHA512_FINISH(&ctx, digest.data());
+		std::copy(digest.cbegin(), digest.cbegin()+SHA384::ssize(), output);
+	}
+	void clone(const HashContext &src) {mbedtls_sha512_clone(&ctx, &src.ctx);}
+};
+
+/**
+ * @brief HMAC keyed state (RFC2104): the inner and outer hash contexts after processing the key xored with ipad and opad.
+ * Computing an HMAC clones them so they can be reused with the same key.
+ */
+template <typename hashAlgo>
+struct HMACKeyedState {
+	HashContext<hashAlgo> inner; /**< inner hash context, the ipad block is already processed */
+	HashContext<hashAlgo> outer; /**< outer hash context, the opad block is already processed */
+
+	HMACKeyedState() = default; /**< unkeyed, contexts must be cloned from a keyed state */
+	HMACKeyedState(const uint8_t *key, const size_t keySize) {
+		std::array<uint8_t, hashAlgo::blockSize()> pad{};
+		if (keySize > hashAlgo::blockSize()) { // key longer than the hash block are hashed first
+			HashContext<hashAlgo> keyHash;
+			keyHash.starts();
+			keyHash.update(key, keySize);
+			keyHash.finish(pad.data());
+		} else if (keySize > 0) {
+			std::copy(key, key+keySize, pad.begin());
+		}
+		for (auto &b:pad) b ^= 0x36;
+		inner.starts();
+		inner.update(pad.data(), pad.size());
+		for (auto &b:pad) b ^= (0x36^0x5C);
+		outer.starts();
+		outer.update(pad.data(), pad.size());
+		bctbx_clean(pad.data(), pad.size());
+	}
+
+	/**
+	 * @brief Complete the HMAC computation
+	 * @param[in,out]	innerHash	an inner hash context fed with the input data, consumed
+	 * @param[out]		output		hashAlgo::ssize() bytes
+	 */
+	void finish(HashContext<hashAlgo> &innerHash, uint8_t *output) const {
+		std::array<uint8_t, hashAlgo::ssize()> innerDigest;
+		innerHash.finish(innerDigest.data());
+		HashContext<hashAlgo> outerHash;
+		outerHash.clone(outer);
+		outerHash.update(innerDigest.data(), innerDigest.size());
+		outerHash.finish(output);
+		bctbx_clean(innerDigest.data(), innerDigest.size());
+	}
+};
+
+/* Hash batch */
+/* a lane is started for each chunk of this amount of input data: starting a thread on a smaller job costs more than it gains */
+static constexpr size_t hashBatchLaneMinSize = 1<<20;
+
+static const uint8_t *hashBatchInput(const HashBatchEntry &entry) {return entry.input;}
+static size_t hashBatchInputSize(const HashBatchEntry &entry) {return entry.inputSize;}
+static uint8_t *hashBatchOutput(const HashBatchEntry &entry) {return entry.output;}
+static const uint8_t *hashBatchInput(const bctbx_hash_batch_entry_t &entry) {return entry.input;}
+static size_t hashBatchInputSize(const bctbx_hash_batch_entry_t &entry) {return entry.inputLength;}
+static uint8_t *hashBatchOutput(const bctbx_hash_batch_entry_t &entry) {return entry.output;}
+
+/**
+ * Hash all the entries, each lane picks the next entry to process so lanes stay busy whatever the inputs sizes are.
+ * The calling thread is one of the lanes.
+ *
+ * @param[in,out]	entries		the inputs, their output is written
+ * @param[in]		count		number of entries
+ * @param[in]		hashLength	output is truncated to this length, at most hashAlgo::ssize()
+ */
+template <typename hashAlgo, typename Entry>
+static void hashBatch(Entry *entries, const size_t count, const size_t hashLength) {
+	size_t totalSize = 0;
+	for (size_t i=0; i<count; i++) {
+		totalSize += hashBatchInputSize(entries[i]);
+	}
+	size_t lanes = std::min({count, totalSize/hashBatchLaneMinSize, static_cast<size_t>(std::thread::hardware_concurrency())});
+
+	std::atomic<size_t> next{0};
+	auto lane = [entries, count, hashLength, &next]() {
+		HashContext<hashAlgo> ctx;
+		std::array<uint8_t, hashAlgo::ssize()> digest;
+		for (size_t i=next++; i<count; i=next++) {
+			ctx.starts();
+			ctx.update(hashBatchInput(entries[i]), hashBatchInputSize(entries[i]));
+			ctx.finish(digest.data());
+			std::copy(digest.cbegin(), digest.cbegin()+hashLength, hashBatchOutput(entries[i]));
+		}
+	};
+
+	std::vector<std::thread> threads{};
+	for (size_t i=1; i<lanes; i++) {
+		try {
+			threads.emplace_back(lane);
+		} catch (std::system_error const &) { // cannot start more threads, the running lanes process the whole batch
+			break;
+		}
+	}
+	lane();
+	for (auto &thread:threads) {
+		thread.join();
+	}
+}
+
+template <typename hashAlgo>
+void HashBatch(HashBatchEntry *entries, const size_t count) {
+	/* if this template is instanciated the static_assert will fail but will give us an error message */
+	static_assert(sizeof(hashAlgo) != sizeof(hashAlgo), "You must specialize HashBatch function template");
+}
+template <> void HashBatch<SHA256>(HashBatchEntry *entries, const size_t count) {
+	hashBatch<SHA256>(entries, count, SHA256::ssize());
+}
+template <> void HashBatch<SHA384>(HashBatchEntry *entries, const size_t count) {
+	hashBatch<SHA384>(entries, count, SHA384::ssize());
+}
+template <> void HashBatch<SHA512>(HashBatchEntry *entries, const size_t count) {
+	hashBatch<SHA512>(entries, count, SHA512::ssize());
+}
+
 /* HMAC templates */
 /* HMAC must use a specialized template */
 template <typename hashAlgo>
@@ -137,28 +327,121 @@ std::vector<uint8_t> HMAC(const std::vector<uint8_t> &key, const std::vector<uin
 	static_assert(sizeof(hashAlgo) != sizeof(hashAlgo), "You must specialize HMAC function template");
 	return std::vector<uint8_t>(0);
 }
+template <typename hashAlgo>
+void HMAC(const uint8_t *key, const size_t keySize, const uint8_t *input, const size_t inputSize, uint8_t *output) {
+	/* if this template is instanciated the static_assert will fail but will give us an error message */
+	static_assert(sizeof(hashAlgo) != sizeof(hashAlgo), "You must specialize HMAC function template");
+}
+
+/* generic HMAC on the mbedtls SHA-2 contexts */
+template <typename hashAlgo>
+static void HMAC_generic(const uint8_t *key, const size_t keySize, const uint8_t *input, const size_t inputSize, uint8_t *output) {
+	HMACKeyedState<hashAlgo> state(key, keySize);
+	state.inner.update(input, inputSize);
+	state.finish(state.inner, output);
+}
 
 /* HMAC specialized template for SHA256 */
+template <> void HMAC<SHA256>(const uint8_t *key, const size_t keySize, const uint8_t *input, const size_t inputSize, uint8_t *output) {
+	HMAC_generic<SHA256>(key, keySize, input, inputSize, output);
+}
 template <> std::vector<uint8_t> HMAC<SHA256>(const std::vector<uint8_t> &key, const std::vector<uint8_t> &input) {
 	std::vector<uint8_t> hmacOutput(SHA256::ssize());
-	mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), key.data(), key.size(), input.data(), input.size(), hmacOutput.data());
+	HMAC<SHA256>(key.data(), key.size(), input.data(), input.size(), hmacOutput.data());
 	return  hmacOutput;
 }
 
 /* HMAC specialized template for SHA384 */
+template <> void HMAC<SHA384>(const uint8_t *key, const size_t keySize, const uint8_t *input, const size_t inputSize, uint8_t *output) {
+	HMAC_generic<SHA384>(key, keySize, input, inputSize, output);
+}
 template <> std::vector<uint8_t> HMAC<SHA384>(const std::vector<uint8_t> &key, const std::vector<uint8_t> &input) {
 	std::vector<uint8_t> hmacOutput(SHA384::ssize());
-	mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA384), key.data(), key.size(), input.data(), input.size(), hmacOutput.data());
+	HMAC<SHA384>(key.data(), key.size(), input.data(), input.size(), hmacOutput.data());
 	return  hmacOutput;
 }
 
 /* HMAC specialized template for SHA512 */
+template <> void HMAC<SHA512>(const uint8_t *key, const size_t keySize, const uint8_t *input, const size_t inputSize, uint8_t *output) {
+	HMAC_generic<SHA512>(key, keySize, input, inputSize, output);
+}
 template <> std::vector<uint8_t> HMAC<SHA512>(const std::vector<uint8_t> &key, const std::vector<uint8_t> &input) {
 	std::vector<uint8_t> hmacOutput(SHA512::ssize());
-	mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA512), key.data(), key.size(), input.data(), input.size(), hmacOutput.data());
+	HMAC<SHA512>(key.data(), key.size(), input.data(), input.size(), hmacOutput.data());
 	return  hmacOutput;
 }
 
+/* Keyed incremental HMAC */
+template <typename hashAlgo>
+struct HMACContext<hashAlgo>::Impl {
+	HMACKeyedState<hashAlgo> keyed; /**< inner and outer contexts just after keying */
+	HashContext<hashAlgo> inner; /**< inner context fed with the current input */
+
+	Impl(const uint8_t *key, const size_t keySize) : keyed(key, keySize) {
+		inner.clone(keyed.inner);
+	}
+	Impl(const Impl &other) {
+		copy(other);
+	}
+	void copy(const Impl &other) {
+		keyed.inner.clone(other.keyed.inner);
+		keyed.outer.clone(other.keyed.outer);
+		inner.clone(other.inner);
+	}
+};
+
+template <typename hashAlgo>
+HMACContext<hashAlgo>::HMACContext(const uint8_t *key, const size_t keySize) : pImpl(new Impl(key, keySize)) {}
+
+template <typename hashAlgo>
+HMACContext<hashAlgo>::HMACContext(const std::vector<uint8_t> &key) : HMACContext(key.data(), key.size()) {}
+
+template <typename hashAlgo>
+HMACContext<hashAlgo>::HMACContext(const HMACContext &other) : pImpl(new Impl(*other.pImpl)) {}
+
+template <typename hashAlgo>
+HMACContext<hashAlgo> &HMACContext<hashAlgo>::operator=(const HMACContext &other) {
+	if (this != &other) {
+		pImpl->copy(*other.pImpl);
+	}
+	return *this;
+}
+
+template <typename hashAlgo>
+HMACContext<hashAlgo>::~HMACContext() = default;
+
+template <typename hashAlgo>
+HMACContext<hashAlgo> &HMACContext<hashAlgo>::update(const uint8_t *input, const size_t inputSize) {
+	pImpl->inner.update(input, inputSize);
+	return *this;
+}
+
+template <typename hashAlgo>
+HMACContext<hashAlgo> &HMACContext<hashAlgo>::update(const std::vector<uint8_t> &input) {
+	return update(input.data(), input.size());
+}
+
+template <typename hashAlgo>
+void HMACContext<hashAlgo>::finalize(uint8_t *output) {
+	pImpl->keyed.finish(pImpl->inner, output);
+	reset();
+}
+
+template <typename hashAlgo>
+std::vector<uint8_t> HMACContext<hashAlgo>::finalize() {
+	std::vector<uint8_t> output(hashAlgo::ssize());
+	finalize(output.data());
+	return output;
+}
+
+template <typename hashAlgo>
+void HMACContext<hashAlgo>::reset() {
+	pImpl->inner.clone(pImpl->keyed.inner);
+}
+
+template class HMACContext<SHA256>;
+template class HMACContext<SHA384>;
+template class HMACContext<SHA512>;
 
 /* HKDF templates */
 /* HKDF must use a specialized template */
@@ -175,88 +458,74 @@ std::vector<uint8_t> HKDF(const std::vector<uint8_t> &salt, const std::vector<ui
 
 	return std::vector<uint8_t>(0);
 }
+template <typename hashAlgo>
+void HKDF(const uint8_t *salt, const size_t saltSize, const uint8_t *ikm, const size_t ikmSize, const uint8_t *info, const size_t infoSize, uint8_t *okm, const size_t okmSize) {
+	/* if this template is instanciated the static_assert will fail but will give us an error message */
+	static_assert(sizeof(hashAlgo) != sizeof(hashAlgo), "You must specialize HKDF function template");
+}
+
+/* generic implementation, of HKDF RFC-5869: the PRK is keyed once for all the expansion rounds, no memory is allocated */
+template <typename hashAlgo>
+static void HMAC_KDF(const uint8_t *salt, const size_t saltSize, const uint8_t *ikm, const size_t ikmSize, const uint8_t *info, const size_t infoSize, uint8_t *okm, const size_t okmSize) {
+	if (okmSize > 255*hashAlgo::ssize()) {
+		throw BCTBX_EXCEPTION<<"HKDF cannot produce "<<okmSize<<" bytes, maximum is "<<255*hashAlgo::ssize();
+	}
+	// extraction
+	std::array<uint8_t, hashAlgo::ssize()> prk;
+	HMAC<hashAlgo>(salt, saltSize, ikm, ikmSize, prk.data());
+	HMACKeyedState<hashAlgo> state(prk.data(), prk.size());
+	bctbx_clean(prk.data(), prk.size());
+
+	// expansion rounds: T(i) = HMAC-Hash(PRK, T(i-1) | info | i)
+	std::array<uint8_t, hashAlgo::ssize()> T;
+	size_t index = 0;
+	for (uint8_t i=0x01; index < okmSize; i++) {
+		HashContext<hashAlgo> inner;
+		inner.clone(state.inner);
+		if (index > 0) {
+			inner.update(T.data(), T.size());
+		}
+		inner.update(info, infoSize);
+		inner.update(&i, 1);
+		state.finish(inner, T.data());
+		// each round compute hashAlgo::ssize() bytes of data, we may need only a fraction of the last round
+		size_t roundSize = std::min(okmSize-index, hashAlgo::ssize());
+		std::copy(T.cbegin(), T.cbegin()+roundSize, okm+index);
+		index += roundSize;
+	}
+	bctbx_clean(T.data(), T.size());
+}
 
-#if MBEDTLS_VERSION_NUMBER >= 0x020B0000 // v2.11.0 - HKDF provided by mbedtls
 /* HKDF specialized template for SHA256 */
+template <> void HKDF<SHA256>(const uint8_t *salt, const size_t saltSize, const uint8_t *ikm, const size_t ikmSize, const uint8_t *info, const size_t infoSize, uint8_t *okm, const size_t okmSize) {
+	HMAC_KDF<SHA256>(salt, saltSize, ikm, ikmSize, info, infoSize, okm, okmSize);
+}
 template <> std::vector<uint8_t> HKDF<SHA256>(const std::vector<uint8_t> &salt, const std::vector<uint8_t> &ikm, const std::vector<uint8_t> &info, size_t outputSize) {
 	std::vector<uint8_t> okm(outputSize);
-	if (mbedtls_hkdf(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), salt.data(), salt.size(), ikm.data(), ikm.size(), info.data(), info.size(), okm.data(), outputSize) != 0) {
-		throw BCTBX_EXCEPTION<<"HKDF-SHA256 error";
-	}
+	HKDF<SHA256>(salt.data(), salt.size(), ikm.data(), ikm.size(), info.data(), info.size(), okm.data(), outputSize);
 	return okm;
 };
 template <> std::vector<uint8_t> HKDF<SHA256>(const std::vector<uint8_t> &salt, const std::vector<uint8_t> &ikm, const std::string &info, size_t outputSize) {
 	std::vector<uint8_t> okm(outputSize);
-	if (mbedtls_hkdf(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), salt.data(), salt.size(), ikm.data(), ikm.size(), reinterpret_cast<const unsigned char*>(info.data()), info.size(), okm.data(), outputSize) != 0) {
-		throw BCTBX_EXCEPTION<<"HKDF-SHA256 error";
-	}
+	HKDF<SHA256>(salt.data(), salt.size(), ikm.data(), ikm.size(), reinterpret_cast<const uint8_t*>(info.data()), info.size(), okm.data(), outputSize);
 	return okm;
 };
 
 /* HKDF specialized template for SHA512 */
+template <> void HKDF<SHA512>(const uint8_t *salt, const size_t saltSize, const uint8_t *ikm, const size_t ikmSize, const uint8_t *info, const size_t infoSize, uint8_t *okm, const size_t okmSize) {
+	HMAC_KDF<SHA512>(salt, saltSize, ikm, ikmSize, info, infoSize, okm, okmSize);
+}
 template <> std::vector<uint8_t> HKDF<SHA512>(const std::vector<uint8_t> &salt, const std::vector<uint8_t> &ikm, const std::vector<uint8_t> &info, size_t outputSize) {
 	std::vector<uint8_t> okm(outputSize);
-	if (mbedtls_hkdf(mbedtls_md_info_from_type(MBEDTLS_MD_SHA512), salt.data(), salt.size(), ikm.data(), ikm.size(), info.data(), info.size(), okm.data(), outputSize) != 0) {
-		throw BCTBX_EXCEPTION<<"HKDF-SHA512 error";
-	}
+	HKDF<SHA512>(salt.data(), salt.size(), ikm.data(), ikm.size(), info.data(), info.size(), okm.data(), outputSize);
 	return okm;
 };
 template <> std::vector<uint8_t> HKDF<SHA512>(const std::vector<uint8_t> &salt, const std::vector<uint8_t> &ikm, const std::string &info, size_t outputSize) {
 	std::vector<uint8_t> okm(outputSize);
-	if (mbedtls_hkdf(mbedtls_md_info_from_type(MBEDTLS_MD_SHA512), salt.data(), salt.size(), ikm.data(), ikm.size(), reinterpret_cast<const unsigned char*>(info.data()), info.size(), okm.data(), outputSize) != 0) {
-		throw BCTBX_EXCEPTION<<"HKDF-SHA512 error";
-	}
+	HKDF<SHA512>(salt.data(), salt.size(), ikm.data(), ikm.size(), reinterpret_cast<const uint8_t*>(info.data()), info.size(), okm.data(), outputSize);
 	return okm;
 };
 
-#else // MBEDTLS_VERSION_NUMBER >= 0x020B0000 - HKDF not provided by mbedtls
-
-/* generic implementation, of HKDF RFC-5869 - use this one if mbedtls does not provide it */
-template <typename hashAlgo, typename infoType>
-std::vector<uint8_t> HMAC_KDF(const std::vector<uint8_t> &salt, const std::vector<uint8_t> &ikm, const infoType &info, size_t outputSize) {
-	// extraction
-	auto prk = HMAC<hashAlgo>(salt, ikm);
-
-	// expansion round 0
-	std::vector<uint8_t> T(info.cbegin(), info.cend());
-	T.push_back(0x01);
-	auto output = HMAC<hashAlgo>(prk, T);
-	output.reserve(outputSize);
-
-	// successives expansion rounds
-	size_t index = std::min(outputSize, hashAlgo::ssize());
-	for(uint8_t i=0x02; index < outputSize; i++) {
-		T.assign(output.cbegin()+(i-2)*hashAlgo::ssize(), output.cbegin()+(i-1)*hashAlgo::ssize());
-		T.insert(T.end(), info.cbegin(), info.cend());
-		T.push_back(i);
-		auto round = HMAC<hashAlgo>(prk, T);
-		output.insert(output.end(), round.cbegin(), round.cend());
-		index += hashAlgo::ssize();
-	}
-	bctbx_clean(prk.data(), prk.size());
-	bctbx_clean(T.data(), T.size());
-	output.resize(outputSize); // dump what is not needed (each round compute hashAlgo::ssize() bytes of data, we may need only a fraction of the last round)
-	return output;
-}
-
-/* HKDF specialized template for SHA256 */
-template <> std::vector<uint8_t> HKDF<SHA256>(const std::vector<uint8_t> &salt, const std::vector<uint8_t> &ikm, const std::vector<uint8_t> &info, size_t outputSize) {
-	return HMAC_KDF<SHA256, std::vector<uint8_t>>(salt, ikm, info, outputSize);
-};
-template <> std::vector<uint8_t> HKDF<SHA256>(const std::vector<uint8_t> &salt, const std::vector<uint8_t> &ikm, const std::string &info, size_t outputSize) {
-	return HMAC_KDF<SHA256, std::string>(salt, ikm, info, outputSize);
-};
-
-/* HKDF specialized template for SHA512 */
-template <> std::vector<uint8_t> HKDF<SHA512>(const std::vector<uint8_t> &salt, const std::vector<uint8_t> &ikm, const std::vector<uint8_t> &info, size_t outputSize) {
-	return HMAC_KDF<SHA512, std::vector<uint8_t>>(salt, ikm, info, outputSize);
-};
-template <> std::vector<uint8_t> HKDF<SHA512>(const std::vector<uint8_t> &salt, const std::vector<uint8_t> &ikm, const std::string &info, size_t outputSize) {
-	return HMAC_KDF<SHA512, std::string>(salt, ikm, info, outputSize);
-};
-
-#endif // MBEDTLS_VERSION_NUMBER >= 0x020B0000
-
 /*****************************************************************************/
 /***                      Authenticated Encryption                         ***/
 /*****************************************************************************/
@@ -337,6 +606,351 @@ template <> bool AEADDecrypt<AES256GCM128>(const std::vector<uint8_t> &key, cons
 	throw BCTBX_EXCEPTION<<"Error during AES_GCM decryption : return value "<<ret;
 }
 
+template <typename AEADAlgo>
+void AEADEncrypt(const uint8_t *key, const uint8_t *IV, const size_t IVSize, const uint8_t *plain, const size_t plainSize,
+		const uint8_t *AD, const size_t ADSize, uint8_t *tag, uint8_t *cipher) {
+	/* if this template is instanciated the static_assert will fail but will give us an error message with faulty type */
+	static_assert(sizeof(AEADAlgo) != sizeof(AEADAlgo), "You must specialize AEADEncrypt function template");
+}
+
+template <typename AEADAlgo>
+bool AEADDecrypt(const uint8_t *key, const uint8_t *IV, const size_t IVSize, const uint8_t *cipher, const size_t cipherSize,
+		const uint8_t *AD, const size_t ADSize, const uint8_t *tag, uint8_t *plain) {
+	/* if this template is instanciated the static_assert will fail but will give us an error message with faulty type */
+	static_assert(sizeof(AEADAlgo) != sizeof(AEADAlgo), "You must specialize AEADDecrypt function template");
+	return false;
+}
+
+template <> void AEADEncrypt<AES256GCM128>(const uint8_t *key, const uint8_t *IV, const size_t IVSize, const uint8_t *plain, const size_t plainSize,
+		const uint8_t *AD, const size_t ADSize, uint8_t *tag, uint8_t *cipher) {
+	mbedtls_gcm_context gcmContext;
+	mbedtls_gcm_init(&gcmContext);
+
+	auto ret = mbedtls_gcm_setkey(&gcmContext, MBEDTLS_CIPHER_ID_AES, key, AES256GCM128::keySize()*8); // key size in bits
+	if (ret != 0) {
+		mbedtls_gcm_free(&gcmContext);
+		throw BCTBX_EXCEPTION<<"Unable to set key in AES_GCM context : return value "<<ret;
+	}
+
+	ret = mbedtls_gcm_crypt_and_tag(&gcmContext, MBEDTLS_GCM_ENCRYPT, plainSize, IV, IVSize, AD, ADSize, plain, cipher, AES256GCM128::tagSize(), tag);
+	mbedtls_gcm_free(&gcmContext);
+
+	if (ret != 0) {
+		throw BCTBX_EXCEPTION<<"Error during AES_GCM encryption : return value "<<ret;
+	}
+}
+
+template <> bool AEADDecrypt<AES256GCM128>(const uint8_t *key, const uint8_t *IV, const size_t IVSize, const uint8_t *cipher, const size_t cipherSize,
+		const uint8_t *AD, const size_t ADSize, const uint8_t *tag, uint8_t *plain) {
+	mbedtls_gcm_context gcmContext;
+	mbedtls_gcm_init(&gcmContext);
+	auto ret = mbedtls_gcm_setkey(&gcmContext, MBEDTLS_CIPHER_ID_AES, key, AES256GCM128::keySize()*8); // key size in bits
+	if (ret != 0) {
+		mbedtls_gcm_free(&gcmContext);
+		throw BCTBX_EXCEPTION<<"Unable to set key in AES_GCM context : return value "<<ret;
+	}
+
+	ret = mbedtls_gcm_auth_decrypt(&gcmContext, cipherSize, IV, IVSize, AD, ADSize, tag, AES256GCM128::tagSize(), cipher, plain);
+	mbedtls_gcm_free(&gcmContext);
+
+	if (ret == 0) {
+		return true;
+	}
+	if (ret == MBEDTLS_ERR_GCM_AUTH_FAILED) {
+		return false;
+	}
+
+	throw BCTBX_EXCEPTION<<"Error during AES_GCM decryption : return value "<<ret;
+}
+
+/* declare AEAD template specialisations : ChaCha20-Poly1305 */
+#if MBEDTLS_VERSION_NUMBER >= 0x020C0000 // v2.12.0 - ChaCha20-Poly1305 provided by mbedtls
+template <> void AEADEncrypt<CHACHA20POLY1305>(const uint8_t *key, const uint8_t *IV, const size_t IVSize, const uint8_t *plain, const size_t plainSize,
+		const uint8_t *AD, const size_t ADSize, uint8_t *tag, uint8_t *cipher) {
+	if (IVSize != CHACHA20POLY1305::IVSize()) {
+		throw BCTBX_EXCEPTION<<"AEADEncrypt: Bad input parameter, ChaCha20-Poly1305 IV is expected to be "<<CHACHA20POLY1305::IVSize()<<" bytes but "<<IVSize<<" provided";
+	}
+	mbedtls_chachapoly_context chachapolyContext;
+	mbedtls_chachapoly_init(&chachapolyContext);
+
+	auto ret = mbedtls_chachapoly_setkey(&chachapolyContext, key);
+	if (ret != 0) {
+		mbedtls_chachapoly_free(&chachapolyContext);
+		throw BCTBX_EXCEPTION<<"Unable to set key in ChaCha20-Poly1305 context : return value "<<ret;
+	}
+
+	ret = mbedtls_chachapoly_encrypt_and_tag(&chachapolyContext, plainSize, IV, AD, ADSize, plain, cipher, tag);
+	mbedtls_chachapoly_free(&chachapolyContext);
+
+	if (ret != 0) {
+		throw BCTBX_EXCEPTION<<"Error during ChaCha20-Poly1305 encryption : return value "<<ret;
+	}
+}
+
+template <> bool AEADDecrypt<CHACHA20POLY1305>(const uint8_t *key, const uint8_t *IV, const size_t IVSize, const uint8_t *cipher, const size_t cipherSize,
+		const uint8_t *AD, const size_t ADSize, const uint8_t *tag, uint8_t *plain) {
+	if (IVSize != CHACHA20POLY1305::IVSize()) {
+		throw BCTBX_EXCEPTION<<"AEADDecrypt: Bad input parameter, ChaCha20-Poly1305 IV is expected to be "<<CHACHA20POLY1305::IVSize()<<" bytes but "<<IVSize<<" provided";
+	}
+	mbedtls_chachapoly_context chachapolyContext;
+	mbedtls_chachapoly_init(&chachapolyContext);
+
+	auto ret = mbedtls_chachapoly_setkey(&chachapolyContext, key);
+	if (ret != 0) {
+		mbedtls_chachapoly_free(&chachapolyContext);
+		throw BCTBX_EXCEPTION<<"Unable to set key in ChaCha20-Poly1305 context : return value "<<ret;
+	}
+
+	ret = mbedtls_chachapoly_auth_decrypt(&chachapolyContext, cipherSize, IV, AD, ADSize, tag, cipher, plain);
+	mbedtls_chachapoly_free(&chachapolyContext);
+
+	if (ret == 0) {
+		return true;
+	}
+	if (ret == MBEDTLS_ERR_CHACHAPOLY_AUTH_FAILED) {
+		return false;
+	}
+
+	throw BCTBX_EXCEPTION<<"Error during ChaCha20-Poly1305 decryption : return value "<<ret;
+}
+#else // MBEDTLS_VERSION_NUMBER >= 0x020C0000 - ChaCha20-Poly1305 not provided by mbedtls
+template <> void AEADEncrypt<CHACHA20POLY1305>(const uint8_t *key, const uint8_t *IV, const size_t IVSize, const uint8_t *plain, const size_t plainSize,
+		const uint8_t *AD, const size_t ADSize, uint8_t *tag, uint8_t *cipher) {
+	throw BCTBX_EXCEPTION<<"ChaCha20-Poly1305 is not available: mbedtls version 2.12.0 or above is required";
+}
+
+template <> bool AEADDecrypt<CHACHA20POLY1305>(const uint8_t *key, const uint8_t *IV, const size_t IVSize, const uint8_t *cipher, const size_t cipherSize,
+		const uint8_t *AD, const size_t ADSize, const uint8_t *tag, uint8_t *plain) {
+	throw BCTBX_EXCEPTION<<"ChaCha20-Poly1305 is not available: mbedtls version 2.12.0 or above is required";
+}
+#endif // MBEDTLS_VERSION_NUMBER >= 0x020C0000
+
+template <> std::vector<uint8_t> AEADEncrypt<CHACHA20POLY1305>(const std::vector<uint8_t> &key, const std::vector<uint8_t> IV, const std::vector<uint8_t> &plain, const std::vector<uint8_t> &AD,
+		std::vector<uint8_t> &tag) {
+	if (key.size() != CHACHA20POLY1305::keySize()) {
+		throw BCTBX_EXCEPTION<<"AEADEncrypt: Bad input parameter, key is expected to be "<<CHACHA20POLY1305::keySize()<<" bytes but "<<key.size()<<" provided";
+	}
+	tag.resize(CHACHA20POLY1305::tagSize());
+	std::vector<uint8_t> cipher(plain.size()); // cipher size is the same than plain
+	AEADEncrypt<CHACHA20POLY1305>(key.data(), IV.data(), IV.size(), plain.data(), plain.size(), AD.data(), AD.size(), tag.data(), cipher.data());
+	return cipher;
+}
+
+template <> bool AEADDecrypt<CHACHA20POLY1305>(const std::vector<uint8_t> &key, const std::vector<uint8_t> &IV, const std::vector<uint8_t> &cipher, const std::vector<uint8_t> &AD,
+		const std::vector<uint8_t> &tag, std::vector<uint8_t> &plain) {
+	if (key.size() != CHACHA20POLY1305::keySize()) {
+		throw BCTBX_EXCEPTION<<"AEADDecrypt: Bad input parameter, key is expected to be "<<CHACHA20POLY1305::keySize()<<" bytes but "<<key.size()<<" provided";
+	}
+	if (tag.size() != CHACHA20POLY1305::tagSize()) {
+		throw BCTBX_EXCEPTION<<"AEADDecrypt: Bad input parameter, tag is expected to be "<<CHACHA20POLY1305::tagSize()<<" bytes but "<<tag.size()<<" provided";
+	}
+	plain.resize(cipher.size()); // plain is the same size than cipher
+	return AEADDecrypt<CHACHA20POLY1305>(key.data(), IV.data(), IV.size(), cipher.data(), cipher.size(), AD.data(), AD.size(), tag.data(), plain.data());
+}
+
+/*** Keyed AEAD context ***/
+/**
+ * @brief Wrapper around mbedtls GCM context: the key schedule and the GHASH table are computed once by setkey
+ * and reused by every message
+ **/
+template <>
+struct AEADContext<AES256GCM128>::Impl {
+	mbedtls_gcm_context gcmContext; /**< keyed GCM context */
+
+	Impl(const uint8_t *key) {
+		mbedtls_gcm_init(&gcmContext);
+		auto ret = mbedtls_gcm_setkey(&gcmContext, MBEDTLS_CIPHER_ID_AES, key, AES256GCM128::keySize()*8); // key size in bits
+		if (ret != 0) {
+			mbedtls_gcm_free(&gcmContext);
+			throw BCTBX_EXCEPTION<<"Unable to set key in AES_GCM context : return value "<<ret;
+		}
+	}
+	~Impl() {
+		mbedtls_gcm_free(&gcmContext); // also cleans the key material
+	}
+
+	void encrypt(const uint8_t *IV, const size_t IVSize, const uint8_t *plain, const size_t plainSize,
+			const uint8_t *AD, const size_t ADSize, uint8_t *tag, uint8_t *cipher) {
+		auto ret = mbedtls_gcm_crypt_and_tag(&gcmContext, MBEDTLS_GCM_ENCRYPT, plainSize, IV, IVSize, AD, ADSize, plain, cipher, AES256GCM128::tagSize(), tag);
+		if (ret != 0) {
+			throw BCTBX_EXCEPTION<<"Error during AES_GCM encryption : return value "<<ret;
+		}
+	}
+
+	bool decrypt(const uint8_t *IV, const size_t IVSize, const uint8_t *cipher, const size_t cipherSize,
+			const uint8_t *AD, const size_t ADSize, const uint8_t *tag, uint8_t *plain) {
+		auto ret = mbedtls_gcm_auth_decrypt(&gcmContext, cipherSize, IV, IVSize, AD, ADSize, tag, AES256GCM128::tagSize(), cipher, plain);
+		if (ret == 0) {
+			return true;
+		}
+		if (ret == MBEDTLS_ERR_GCM_AUTH_FAILED) {
+			return false;
+		}
+		throw BCTBX_EXCEPTION<<"Error during AES_GCM decryption : return value "<<ret;
+	}
+};
+
+#if MBEDTLS_VERSION_NUMBER >= 0x020C0000 // v2.12.0 - ChaCha20-Poly1305 provided by mbedtls
+/**
+ * @brief Wrapper around mbedtls ChaCha20-Poly1305 context
+ **/
+template <>
+struct AEADContext<CHACHA20POLY1305>::Impl {
+	mbedtls_chachapoly_context chachapolyContext; /**< keyed ChaCha20-Poly1305 context */
+
+	Impl(const uint8_t *key) {
+		mbedtls_chachapoly_init(&chachapolyContext);
+		auto ret = mbedtls_chachapoly_setkey(&chachapolyContext, key);
+		if (ret != 0) {
+			mbedtls_chachapoly_free(&chachapolyContext);
+			throw BCTBX_EXCEPTION<<"Unable to set key in ChaCha20-Poly1305 context : return value "<<ret;
+		}
+	}
+	~Impl() {
+		mbedtls_chachapoly_free(&chachapolyContext); // also cleans the key material
+	}
+
+	void encrypt(const uint8_t *IV, const size_t IVSize, const uint8_t *plain, const size_t plainSize,
+			const uint8_t *AD, const size_t ADSize, uint8_t *tag, uint8_t *cipher) {
+		if (IVSize != CHACHA20POLY1305::IVSize()) {
+			throw BCTBX_EXCEPTION<<"AEADContext: Bad input parameter, ChaCha20-Poly1305 IV is expected to be "<<CHACHA20POLY1305::IVSize()<<" bytes but "<<IVSize<<" provided";
+		}
+		auto ret = mbedtls_chachapoly_encrypt_and_tag(&chachapolyContext, plainSize, IV, AD, ADSize, plain, cipher, tag);
+		if (ret != 0) {
+			throw BCTBX_EXCEPTION<<"Error during ChaCha20-Poly1305 encryption : return value "<<ret;
+		}
+	}
+
+	bool decrypt(const uint8_t *IV, const size_t IVSize, const uint8_t *cipher, const size_t cipherSize,
+			const uint8_t *AD, const size_t ADSize, const uint8_t *tag, uint8_t *plain) {
+		if (IVSize != CHACHA20POLY1305::IVSize()) {
+			throw BCTBX_EXCEPTION<<"AEADContext: Bad input parameter, ChaCha20-Poly1305 IV is expected to be "<<CHACHA20POLY1305::IVSize()<<" bytes but "<<IVSize<<" provided";
+		}
+		auto ret = mbedtls_chachapoly_auth_decrypt(&chachapolyContext, cipherSize, IV, AD, ADSize, tag, cipher, plain);
+		if (ret == 0) {
+			return true;
+		}
+		if (ret == MBEDTLS_ERR_CHACHAPOLY_AUTH_FAILED) {
+			return false;
+		}
+		throw BCTBX_EXCEPTION<<"Error during ChaCha20-Poly1305 decryption : return value "<<ret;
+	}
+};
+#else // MBEDTLS_VERSION_NUMBER >= 0x020C0000 - ChaCha20-Poly1305 not provided by mbedtls
+template <>
+struct AEADContext<CHACHA20POLY1305>::Impl {
+	Impl(const uint8_t *key) {
+		throw BCTBX_EXCEPTION<<"ChaCha20-Poly1305 is not available: mbedtls version 2.12.0 or above is required";
+	}
+	void encrypt(const uint8_t *IV, const size_t IVSize, const uint8_t *plain, const size_t plainSize,
+			const uint8_t *AD, const size_t ADSize, uint8_t *tag, uint8_t *cipher) {}
+	bool decrypt(const uint8_t *IV, const size_t IVSize, const uint8_t *cipher, const size_t cipherSize,
+			const uint8_t *AD, const size_t ADSize, const uint8_t *tag, uint8_t *plain) {return false;}
+};
+#endif // MBEDTLS_VERSION_NUMBER >= 0x020C0000
+
+template <typename AEADAlgo>
+AEADContext<AEADAlgo>::AEADContext(const std::vector<uint8_t> &key) {
+	if (key.size() != AEADAlgo::keySize()) {
+		throw BCTBX_EXCEPTION<<"AEADContext: Bad input parameter, key is expected to be "<<AEADAlgo::keySize()<<" bytes but "<<key.size()<<" provided";
+	}
+	pImpl = std::unique_ptr<Impl>(new Impl(key.data()));
+}
+
+template <typename AEADAlgo>
+AEADContext<AEADAlgo>::AEADContext(const uint8_t *key)
+:pImpl(std::unique_ptr<Impl>(new Impl(key))) {}
+
+template <typename AEADAlgo>
+AEADContext<AEADAlgo>::~AEADContext() = default;
+
+template <typename AEADAlgo>
+void AEADContext<AEADAlgo>::encrypt(const uint8_t *IV, const size_t IVSize, const uint8_t *plain, const size_t plainSize,
+		const uint8_t *AD, const size_t ADSize, uint8_t *tag, uint8_t *cipher) {
+	pImpl->encrypt(IV, IVSize, plain, plainSize, AD, ADSize, tag, cipher);
+}
+
+template <typename AEADAlgo>
+bool AEADContext<AEADAlgo>::decrypt(const uint8_t *IV, const size_t IVSize, const uint8_t *cipher, const size_t cipherSize,
+		const uint8_t *AD, const size_t ADSize, const uint8_t *tag, uint8_t *plain) {
+	return pImpl->decrypt(IV, IVSize, cipher, cipherSize, AD, ADSize, tag, plain);
+}
+
+template <typename AEADAlgo>
+std::vector<uint8_t> AEADContext<AEADAlgo>::encrypt(const std::vector<uint8_t> &IV, const std::vector<uint8_t> &plain, const std::vector<uint8_t> &AD,
+		std::vector<uint8_t> &tag) {
+	std::vector<uint8_t> cipher(plain.size());
+	tag.resize(AEADAlgo::tagSize());
+	pImpl->encrypt(IV.data(), IV.size(), plain.data(), plain.size(), AD.data(), AD.size(), tag.data(), cipher.data());
+	return cipher;
+}
+
+template <typename AEADAlgo>
+bool AEADContext<AEADAlgo>::decrypt(const std::vector<uint8_t> &IV, const std::vector<uint8_t> &cipher, const std::vector<uint8_t> &AD,
+		const std::vector<uint8_t> &tag, std::vector<uint8_t> &plain) {
+	if (tag.size() != AEADAlgo::tagSize()) {
+		throw BCTBX_EXCEPTION<<"AEADContext: Bad input parameter, tag is expected to be "<<AEADAlgo::tagSize()<<" bytes but "<<tag.size()<<" provided";
+	}
+	plain.resize(cipher.size());
+	return pImpl->decrypt(IV.data(), IV.size(), cipher.data(), cipher.size(), AD.data(), AD.size(), tag.data(), plain.data());
+}
+
+template <typename AEADAlgo>
+void AEADContext<AEADAlgo>::encryptBatch(AEADBatchEntry *entries, const size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		auto &entry = entries[i];
+		pImpl->encrypt(entry.IV, entry.IVSize, entry.input, entry.inputSize, entry.AD, entry.ADSize, entry.tag, entry.output);
+	}
+}
+
+template <typename AEADAlgo>
+size_t AEADContext<AEADAlgo>::decryptBatch(AEADBatchEntry *entries, const size_t count) {
+	size_t failures = 0;
+	for (size_t i = 0; i < count; i++) {
+		auto &entry = entries[i];
+		entry.authenticated = pImpl->decrypt(entry.IV, entry.IVSize, entry.input, entry.inputSize, entry.AD, entry.ADSize, entry.tag, entry.output);
+		if (!entry.authenticated) {
+			failures++;
+		}
+	}
+	return failures;
+}
+
+template class AEADContext<AES256GCM128>;
+template class AEADContext<CHACHA20POLY1305>;
+
+template <typename AEADAlgo>
+void AEADEncryptBatch(const uint8_t *key, AEADBatchEntry *entries, const size_t count) {
+	/* if this template is instanciated the static_assert will fail but will give us an error message with faulty type */
+	static_assert(sizeof(AEADAlgo) != sizeof(AEADAlgo), "You must specialize AEADEncryptBatch function template");
+}
+
+template <typename AEADAlgo>
+size_t AEADDecryptBatch(const uint8_t *key, AEADBatchEntry *entries, const size_t count) {
+	/* if this template is instanciated the static_assert will fail but will give us an error message with faulty type */
+	static_assert(sizeof(AEADAlgo) != sizeof(AEADAlgo), "You must specialize AEADDecryptBatch function template");
+	return 0;
+}
+
+template <> void AEADEncryptBatch<AES256GCM128>(const uint8_t *key, AEADBatchEntry *entries, const size_t count) {
+	AEADContext<AES256GCM128> context(key);
+	context.encryptBatch(entries, count);
+}
+
+template <> size_t AEADDecryptBatch<AES256GCM128>(const uint8_t *key, AEADBatchEntry *entries, const size_t count) {
+	AEADContext<AES256GCM128> context(key);
+	return context.decryptBatch(entries, count);
+}
+
+template <> void AEADEncryptBatch<CHACHA20POLY1305>(const uint8_t *key, AEADBatchEntry *entries, const size_t count) {
+	AEADContext<CHACHA20POLY1305> context(key);
+	context.encryptBatch(entries, count);
+}
+
+template <> size_t AEADDecryptBatch<CHACHA20POLY1305>(const uint8_t *key, AEADBatchEntry *entries, const size_t count) {
+	AEADContext<CHACHA20POLY1305> context(key);
+	return context.decryptBatch(entries, count);
+}
 
 } // namespace bctoolbox
 
@@ -360,3 +974,16 @@ void bctbx_rng_context_free(bctbx_rng_context_t *context) {
 	context->m_rng=nullptr; // destroy the RNG
 	delete(context);
 }
+
+/*** Hash batch: C API ***/
+void bctbx_sha512_batch(bctbx_hash_batch_entry_t *entries, size_t entriesCount, uint8_t hashLength) {
+	bctoolbox::hashBatch<bctoolbox::SHA512>(entries, entriesCount, std::min(static_cast<size_t>(hashLength), bctoolbox::SHA512::ssize()));
+}
+
+void bctbx_sha384_batch(bctbx_hash_batch_entry_t *entries, size_t entriesCount, uint8_t hashLength) {
+	bctoolbox::hashBatch<bctoolbox::SHA384>(entries, entriesCount, std::min(static_cast<size_t>(hashLength), bctoolbox::SHA384::ssize()));
+}
+
+void bctbx_sha256_batch(bctbx_hash_batch_entry_t *entries, size_t entriesCount, uint8_t hashLength) {
+	bctoolbox::hashBatch<bctoolbox::SHA256>(entries, entriesCount, std::min(static_cast<size_t>(hashLength), bctoolbox::SHA256::ssize()));
+}
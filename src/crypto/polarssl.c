@@ -1356,6 +1356,28 @@ void bctbx_sha256(const uint8_t *input,
 	}
 }
 
+/* polarssl hash batches: entries are processed one after the other */
+void bctbx_sha512_batch(bctbx_hash_batch_entry_t *entries, size_t entriesCount, uint8_t hashLength) {
+	size_t i;
+	for (i=0; i<entriesCount; i++) {
+		bctbx_sha512(entries[i].input, entries[i].inputLength, hashLength, entries[i].output);
+	}
+}
+
+void bctbx_sha384_batch(bctbx_hash_batch_entry_t *entries, size_t entriesCount, uint8_t hashLength) {
+	size_t i;
+	for (i=0; i<entriesCount; i++) {
+		bctbx_sha384(entries[i].input, entries[i].inputLength, hashLength, entries[i].output);
+	}
+}
+
+void bctbx_sha256_batch(bctbx_hash_batch_entry_t *entries, size_t entriesCount, uint8_t hashLength) {
+	size_t i;
+	for (i=0; i<entriesCount; i++) {
+		bctbx_sha256(entries[i].input, entries[i].inputLength, hashLength, entries[i].output);
+	}
+}
+
 /**
  * @brief HMAC-SHA1 wrapper
  * @param[in] 	key			HMAC secret key
@@ -1559,6 +1581,94 @@ int32_t bctbx_aes_gcm_finish(bctbx_aes_gcm_context_t *context,
 	return ret;
 }
 
+/**
+ * @Brief create an AES-GCM context holding an expanded key, to encrypt or decrypt many buffers with the same key
+ *
+ * @param[in]	key							encryption key
+ * @param[in]	keyLength					key buffer length, in bytes, must be 16,24 or 32
+ *
+ * @return a pointer to the created context, to be freed using bctbx_aes_gcm_keyed_context_free(), NULL on error
+ */
+bctbx_aes_gcm_keyed_context_t *bctbx_aes_gcm_keyed_context_new(const uint8_t *key, size_t keyLength) {
+	int ret;
+	gcm_context *ctx = bctbx_malloc0(sizeof(gcm_context));
+
+	ret = gcm_init(ctx, POLARSSL_CIPHER_ID_AES, key, keyLength*8);
+	if (ret != 0) {
+		bctbx_free(ctx);
+		return NULL;
+	}
+
+	return (bctbx_aes_gcm_keyed_context_t *)ctx;
+}
+
+/**
+ * @Brief AES-GCM encrypt and tag buffer using a keyed context
+ *
+ * @param[in/out]	context					a context created by bctbx_aes_gcm_keyed_context_new
+ * @param[in]	plainText					Buffer to be encrypted
+ * @param[in]	plainTextLength				Length in bytes of buffer to be encrypted
+ * @param[in]	authenticatedData			Buffer holding additional data to be used in tag computation
+ * @param[in]	authenticatedDataLength		Additional data length in bytes
+ * @param[in]	initializationVector		Buffer holding the initialisation vector
+ * @param[in]	initializationVectorLength	Initialisation vector length in bytes
+ * @param[out]	tag							Buffer holding the generated tag
+ * @param[in]	tagLength					Requested length for the generated tag
+ * @param[out]	output						Buffer holding the output, shall be at least the length of plainText buffer
+ *
+ * @return 0 on success, polarssl error code otherwise
+ */
+int32_t bctbx_aes_gcm_keyed_encrypt_and_tag(bctbx_aes_gcm_keyed_context_t *context,
+		const uint8_t *plainText, size_t plainTextLength,
+		const uint8_t *authenticatedData, size_t authenticatedDataLength,
+		const uint8_t *initializationVector, size_t initializationVectorLength,
+		uint8_t *tag, size_t tagLength,
+		uint8_t *output) {
+	return gcm_crypt_and_tag((gcm_context *)context, GCM_ENCRYPT, plainTextLength, initializationVector, initializationVectorLength, authenticatedData, authenticatedDataLength, plainText, output, tagLength, tag);
+}
+
+/**
+ * @Brief AES-GCM decrypt, compute authentication tag and compare it to the one provided, using a keyed context
+ *
+ * @param[in/out]	context					a context created by bctbx_aes_gcm_keyed_context_new
+ * @param[in]	cipherText					Buffer to be decrypted
+ * @param[in]	cipherTextLength			Length in bytes of buffer to be decrypted
+ * @param[in]	authenticatedData			Buffer holding additional data to be used in auth tag computation
+ * @param[in]	authenticatedDataLength		Additional data length in bytes
+ * @param[in]	initializationVector		Buffer holding the initialisation vector
+ * @param[in]	initializationVectorLength	Initialisation vector length in bytes
+ * @param[in]	tag							Buffer holding the authentication tag
+ * @param[in]	tagLength					Length in bytes for the authentication tag
+ * @param[out]	output						Buffer holding the output, shall be at least the length of cipherText buffer
+ *
+ * @return 0 on succes, BCTBX_ERROR_AUTHENTICATION_FAILED if tag doesn't match or polarssl error code
+ */
+int32_t bctbx_aes_gcm_keyed_decrypt_and_auth(bctbx_aes_gcm_keyed_context_t *context,
+		const uint8_t *cipherText, size_t cipherTextLength,
+		const uint8_t *authenticatedData, size_t authenticatedDataLength,
+		const uint8_t *initializationVector, size_t initializationVectorLength,
+		const uint8_t *tag, size_t tagLength,
+		uint8_t *output) {
+	int ret = gcm_auth_decrypt((gcm_context *)context, cipherTextLength, initializationVector, initializationVectorLength, authenticatedData, authenticatedDataLength, tag, tagLength, cipherText, output);
+
+	if (ret == POLARSSL_ERR_GCM_AUTH_FAILED) {
+		return BCTBX_ERROR_AUTHENTICATION_FAILED;
+	}
+
+	return ret;
+}
+
+/**
+ * @Brief Clean the key material and free a context created by bctbx_aes_gcm_keyed_context_new
+ *
+ * @param[in/out]	context			the context to free, may be NULL
+ */
+void bctbx_aes_gcm_keyed_context_free(bctbx_aes_gcm_keyed_context_t *context) {
+	if (context == NULL) return;
+	gcm_free((gcm_context *)context);
+	bctbx_free(context);
+}
+
 /*
  * @brief Wrapper for AES-128 in CFB128 mode encryption
  * Both key and IV must be 16 bytes long, IV is not updated
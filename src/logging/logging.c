@@ -22,6 +22,8 @@
 #endif
 
 #include "bctoolbox/logging.h"
+#include "logging_async.h"
+#include "logging_buffered_file.h"
 #include <time.h>
 #include <stdio.h>
 #include <sys/stat.h>
@@ -48,26 +50,59 @@
 #include <android/log.h>
 #endif /* __ANDROID__ */
 
-typedef struct{
+#define BCTBX_LOG_DOMAIN_BUCKETS 64 /* power of 2, applications use a few dozens of domains */
+#define BCTBX_LOG_ALL_LEVELS (BCTBX_LOG_LOGLEV_END - 1)
+
+/* relaxed atomic access to the level masks read without lock when logging */
+#ifdef _MSC_VER
+#define log_mask_load(mask) (*(volatile const unsigned int *)(mask))
+#define log_mask_store(mask, value) (*(volatile unsigned int *)(mask) = (value))
+#else
+#define log_mask_load(mask) __atomic_load_n((mask), __ATOMIC_RELAXED)
+#define log_mask_store(mask, value) __atomic_store_n((mask), (value), __ATOMIC_RELAXED)
+#endif
+
+typedef struct _BctoolboxLogDomain{
 	char *domain;
+	unsigned int hash;
 	unsigned int logmask;
+	unsigned int enabled_mask; /* levels possibly enabled for at least one thread: the fast path of the level check.
+				Written under the domains mutex on level changes and read without lock when logging,
+				through log_mask_load() and log_mask_store() only. */
+	bool_t inherits_default; /* created by bctbx_log_domain_get() and never configured: follows the default domain */
 #ifdef THREAD_LOG_LEVEL_ENABLED
 	int thread_level_set; /* Set to 1 if a thread specific log level has been set. This enables an optimisation
 				only for the case of an app that never uses per-thread log levels.*/
 	pthread_key_t thread_level_key; /* The key to access the thread specific level. */
+	bctbx_list_t *thread_levels; /* bctbx_thread_log_level_t of the threads having set a specific level, protected by the domains mutex */
 #endif
 }BctoolboxLogDomain;
 
 #ifdef THREAD_LOG_LEVEL_ENABLED
-static void thread_level_key_destroy(void *ptr){
-	bctbx_free(ptr);
-}
+typedef struct _bctbx_thread_log_level {
+	unsigned int mask; /* 0 when cleared. Written by its thread under the domains mutex */
+	BctoolboxLogDomain *ld;
+} bctbx_thread_log_level_t;
+
+static void thread_level_key_destroy(void *ptr);
 #endif
 
+static unsigned int bctbx_log_domain_hash(const char *domain){
+	/* FNV-1a */
+	unsigned int hash = 2166136261u;
+	for (; *domain != '\0'; domain++) {
+		hash ^= (unsigned char)*domain;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
 static BctoolboxLogDomain * bctbx_log_domain_new(const char *domain, unsigned int logmask){
 	BctoolboxLogDomain *ld = bctbx_new0(BctoolboxLogDomain, 1);
 	ld->domain = domain ? bctbx_strdup(domain) : NULL;
+	ld->hash = domain ? bctbx_log_domain_hash(domain) : 0;
 	ld->logmask = logmask;
+	log_mask_store(&ld->enabled_mask, logmask);
 #ifdef THREAD_LOG_LEVEL_ENABLED
 	ld->thread_level_set = FALSE;
 	pthread_key_create(&ld->thread_level_key, thread_level_key_destroy);
@@ -78,6 +113,8 @@ static BctoolboxLogDomain * bctbx_log_domain_new(const char *domain, unsigned in
 void bctbx_log_domain_destroy(BctoolboxLogDomain *obj){
 #if THREAD_LOG_LEVEL_ENABLED
 	pthread_key_delete(obj->thread_level_key);
+	/* the thread specific levels are no longer reachable, nor destroyed when their thread exits */
+	bctbx_list_free_with_data(obj->thread_levels, bctbx_free);
 #endif	
 	if (obj->domain) bctbx_free(obj->domain);
 	bctbx_free(obj);
@@ -85,9 +122,9 @@ void bctbx_log_domain_destroy(BctoolboxLogDomain *obj){
 
 #if THREAD_LOG_LEVEL_ENABLED
 unsigned int bctbx_log_domain_get_thread_log_level_mask(BctoolboxLogDomain *ld){
-	unsigned int *specific = (unsigned int*)pthread_getspecific(ld->thread_level_key);
+	bctbx_thread_log_level_t *specific = (bctbx_thread_log_level_t*)pthread_getspecific(ld->thread_level_key);
 	if (!specific) return 0;
-	return *specific;
+	return specific->mask;
 }
 #endif
 
@@ -96,7 +133,7 @@ typedef struct _bctbx_logger_t {
 	bctbx_list_t *logv_outs;
 	unsigned long log_thread_id;
 	bctbx_list_t *log_stored_messages_list;
-	bctbx_list_t *log_domains;
+	bctbx_list_t *log_domains[BCTBX_LOG_DOMAIN_BUCKETS]; /* hashed by domain name */
 	bctbx_mutex_t log_stored_messages_mutex;
 	bctbx_mutex_t domains_mutex;
 	bctbx_mutex_t log_mutex;
@@ -167,7 +204,9 @@ void bctbx_uninit_logger(void){
 	bctbx_mutex_destroy(&logger->log_mutex);
 	bctbx_log_handlers_free();
 	logger->logv_outs = bctbx_list_free(logger->logv_outs);
-	logger->log_domains = bctbx_list_free_with_data(logger->log_domains, (void (*)(void*))bctbx_log_domain_destroy);
+	for (int i = 0; i < BCTBX_LOG_DOMAIN_BUCKETS; i++) {
+		logger->log_domains[i] = bctbx_list_free_with_data(logger->log_domains[i], (void (*)(void*))bctbx_log_domain_destroy);
+	}
 	bctbx_log_domain_destroy(logger->default_log_domain);
 	logger->default_log_domain = NULL;
 #endif
@@ -233,6 +272,10 @@ end:
 void bctbx_file_log_handler_reopen(bctbx_log_handler_t *file_log_handler) {
 	bctbx_file_log_handler_t *filehandler = (bctbx_file_log_handler_t *)file_log_handler->user_info;
 	bctbx_logger_t *logger = bctbx_get_logger();
+	if (file_log_handler->func == bctbx_logv_buffered_file) {
+		bctbx_buffered_file_log_handler_request_reopen(file_log_handler->user_info);
+		return;
+	}
 	bctbx_mutex_lock(&logger->log_mutex);
 	filehandler->reopen_requested = TRUE;
 	bctbx_mutex_unlock(&logger->log_mutex);
@@ -244,14 +287,20 @@ void bctbx_file_log_handler_reopen(bctbx_log_handler_t *file_log_handler) {
 **/
 void bctbx_add_log_handler(bctbx_log_handler_t* handler){
 	bctbx_logger_t *logger = bctbx_get_logger();
+	bctbx_log_handlers_lock();
 	if (handler && !bctbx_list_find(logger->logv_outs, handler))
 		logger->logv_outs = bctbx_list_append(logger->logv_outs, (void*)handler);
 	/*else, already in*/
+	bctbx_log_handlers_unlock();
 }
 
 void bctbx_remove_log_handler(bctbx_log_handler_t* handler){
 	bctbx_logger_t *logger = bctbx_get_logger();
+	/* give the handler the records queued before its removal, then make sure the writer thread is not using it */
+	bctbx_log_async_flush();
+	bctbx_log_handlers_lock();
 	logger->logv_outs = bctbx_list_remove(logger->logv_outs,  handler);
+	bctbx_log_handlers_unlock();
 	handler->destroy(handler);
 	return;
 }
@@ -282,43 +331,95 @@ bctbx_list_t* bctbx_get_log_handlers(void){
 	return bctbx_get_logger()->logv_outs;
 }
 
-static BctoolboxLogDomain * get_log_domain(const char *domain){
+static BctoolboxLogDomain * get_log_domain_hashed(bctbx_logger_t *logger, const char *domain, unsigned int hash){
 	bctbx_list_t *it;
-	bctbx_logger_t *logger = bctbx_get_logger();
-
-	if (domain == NULL) return logger->default_log_domain;
-	for (it = logger->log_domains; it != NULL; it = bctbx_list_next(it)) {
+	for (it = logger->log_domains[hash & (BCTBX_LOG_DOMAIN_BUCKETS - 1)]; it != NULL; it = bctbx_list_next(it)) {
 		BctoolboxLogDomain *ld = (BctoolboxLogDomain*)bctbx_list_get_data(it);
-		if (ld->domain && strcmp(ld->domain, domain) == 0 ){
+		if (ld->hash == hash && strcmp(ld->domain, domain) == 0 ){
 			return ld;
 		}
 	}
 	return NULL;
 }
 
-static BctoolboxLogDomain *get_log_domain_rw(const char *domain){
+static BctoolboxLogDomain * get_log_domain(const char *domain){
+	bctbx_logger_t *logger = bctbx_get_logger();
+
+	if (domain == NULL) return logger->default_log_domain;
+	return get_log_domain_hashed(logger, domain, bctbx_log_domain_hash(domain));
+}
+
+static BctoolboxLogDomain *get_log_domain_rw(const char *domain, bool_t configured){
 	BctoolboxLogDomain *ret;
 	bctbx_logger_t *logger = bctbx_get_logger();
+	unsigned int hash;
 	
-	ret = get_log_domain(domain);
+	if (domain == NULL) return logger->default_log_domain;
+	hash = bctbx_log_domain_hash(domain);
+	ret = get_log_domain_hashed(logger, domain, hash);
 	if (ret) return ret;
 	/*it does not exist, hence create it by taking the mutex*/
 	bctbx_mutex_lock(&logger->domains_mutex);
-	ret = get_log_domain(domain);
+	ret = get_log_domain_hashed(logger, domain, hash);
 	if (!ret){
+		bctbx_list_t **bucket = &logger->log_domains[hash & (BCTBX_LOG_DOMAIN_BUCKETS - 1)];
 		ret = bctbx_log_domain_new(domain, logger->default_log_domain->logmask);
-		logger->log_domains = bctbx_list_prepend(logger->log_domains, ret);
+		if (!configured) {
+			ret->inherits_default = TRUE;
+			log_mask_store(&ret->enabled_mask, log_mask_load(&logger->default_log_domain->enabled_mask));
+		}
+		*bucket = bctbx_list_prepend(*bucket, ret);
 	}
 	bctbx_mutex_unlock(&logger->domains_mutex);
 	return ret;
 }
 
+/* Must be called with the domains mutex held */
+static void update_enabled_mask(BctoolboxLogDomain *ld, unsigned int default_enabled_mask){
+	unsigned int mask = ld->inherits_default ? default_enabled_mask : ld->logmask;
+#ifdef THREAD_LOG_LEVEL_ENABLED
+	if (ld->thread_level_set) {
+		/* the threads without a specific level use the domain one, the others their own */
+		bctbx_list_t *it;
+		mask = ld->logmask;
+		for (it = ld->thread_levels; it != NULL; it = bctbx_list_next(it)) {
+			mask |= ((bctbx_thread_log_level_t*)bctbx_list_get_data(it))->mask;
+		}
+	}
+#endif
+	log_mask_store(&ld->enabled_mask, mask);
+}
+
+/* The domains following the default one copy its masks, so that their level check does not need to look at it */
+static void propagate_default_log_level(bctbx_logger_t *logger){
+	int i;
+	bctbx_mutex_lock(&logger->domains_mutex);
+	for (i = 0; i < BCTBX_LOG_DOMAIN_BUCKETS; i++) {
+		bctbx_list_t *it;
+		for (it = logger->log_domains[i]; it != NULL; it = bctbx_list_next(it)) {
+			BctoolboxLogDomain *ld = (BctoolboxLogDomain*)bctbx_list_get_data(it);
+			if (ld->inherits_default) {
+				ld->logmask = logger->default_log_domain->logmask;
+				update_enabled_mask(ld, log_mask_load(&logger->default_log_domain->enabled_mask));
+			}
+		}
+	}
+	bctbx_mutex_unlock(&logger->domains_mutex);
+}
+
 /**
 * @ param levelmask a mask of BCTBX_DEBUG, BCTBX_MESSAGE, BCTBX_WARNING, BCTBX_ERROR
 * BCTBX_FATAL .
 **/
 void bctbx_set_log_level_mask(const char *domain, int levelmask){
-	get_log_domain_rw(domain)->logmask = levelmask;
+	bctbx_logger_t *logger = bctbx_get_logger();
+	BctoolboxLogDomain *ld = get_log_domain_rw(domain, TRUE);
+	bctbx_mutex_lock(&logger->domains_mutex);
+	ld->logmask = levelmask;
+	ld->inherits_default = FALSE;
+	update_enabled_mask(ld, log_mask_load(&logger->default_log_domain->enabled_mask));
+	bctbx_mutex_unlock(&logger->domains_mutex);
+	if (ld == logger->default_log_domain) propagate_default_log_level(logger);
 }
 
 static unsigned int level_to_mask(BctbxLogLevel level){
@@ -351,18 +452,33 @@ unsigned int bctbx_get_log_level_mask(const char *domain) {
 	return ld->logmask;
 }
 
-int bctbx_log_level_enabled(const char *domain, BctbxLogLevel level){
+static int log_domain_level_enabled(const BctoolboxLogDomain *ld, BctbxLogLevel level){
 	unsigned int logmask = 0;
-	BctoolboxLogDomain *ld = get_log_domain(domain);
-	if (!ld) ld = bctbx_get_logger()->default_log_domain;
-	
+
+	/* fast path: a level disabled for all threads costs a load and a branch */
+	if ((log_mask_load(&ld->enabled_mask) & (unsigned int)level) == 0) return 0;
 #ifdef THREAD_LOG_LEVEL_ENABLED
-	if (ld->thread_level_set) logmask = bctbx_log_domain_get_thread_log_level_mask(ld);
+	if (ld->inherits_default && !ld->thread_level_set) ld = bctbx_get_logger()->default_log_domain;
+	if (ld->thread_level_set) logmask = bctbx_log_domain_get_thread_log_level_mask((BctoolboxLogDomain *)ld);
 #endif
 	if (logmask == 0) logmask = ld->logmask; /* if there is no thread specific log level, revert to global log level.*/
 	return (logmask & (unsigned int)level) != 0;
 }
 
+int bctbx_log_level_enabled(const char *domain, BctbxLogLevel level){
+	BctoolboxLogDomain *ld = get_log_domain(domain);
+	if (!ld) ld = bctbx_get_logger()->default_log_domain;
+	return log_domain_level_enabled(ld, level);
+}
+
+bctbx_log_domain_t *bctbx_log_domain_get(const char *domain){
+	return get_log_domain_rw(domain, FALSE);
+}
+
+int bctbx_log_domain_level_enabled(const bctbx_log_domain_t *domain, BctbxLogLevel level){
+	return log_domain_level_enabled(domain, level);
+}
+
 void bctbx_set_log_thread_id(unsigned long thread_id) {
 	bctbx_logger_t *logger = bctbx_get_logger();
 	if (thread_id == 0) {
@@ -515,36 +631,44 @@ void bctbx_logv_flush(void) {
 	_bctbx_logv_flush(0);
 }
 
-void bctbx_logv(const char *domain, BctbxLogLevel level, const char *fmt, va_list args) {
+static void bctbx_log_handlers_dispatch(bctbx_logger_t *logger, const char *domain, BctbxLogLevel level, const char *fmt, va_list args) {
+	bctbx_list_t *handlers = bctbx_list_first_elem(logger->logv_outs);
+	while (handlers) {
+		bctbx_log_handler_t* handler = (bctbx_log_handler_t*)handlers->data;
+		if(handler && (!handler->domain || !domain || strcmp(handler->domain,domain)==0)) {
+			va_list tmp;
+			va_copy(tmp, args);
+			handler->func(handler->user_info, domain, level, fmt, tmp);
+			va_end(tmp);
+		}
+		handlers = handlers->next;
+	}
+}
+
+void bctbx_log_dispatch(const char *domain, BctbxLogLevel level, const char *fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	bctbx_log_handlers_lock();
+	bctbx_log_handlers_dispatch(bctbx_get_logger(), domain, level, fmt, args);
+	bctbx_log_handlers_unlock();
+	va_end(args);
+}
+
+static void log_domain_logv(const BctoolboxLogDomain *ld, const char *domain, BctbxLogLevel level, const char *fmt, va_list args) {
 	bctbx_logger_t *logger = bctbx_get_logger();
 	
-	if ((logger->logv_outs != NULL) && bctbx_log_level_enabled(domain, level)) {
+	if (log_domain_level_enabled(ld, level) && (logger->logv_outs != NULL)) {
+		if (level == BCTBX_LOG_FATAL) {
+			/* fatal logs are never queued: output the pending asynchronous records before them */
+			bctbx_log_async_flush();
+		} else if (bctbx_log_async_push(domain, level, fmt, args) == 0) {
+			return; /* the asynchronous logging writer thread dispatches it */
+		}
 		if (logger->log_thread_id == 0) {
-			bctbx_list_t *handlers = bctbx_list_first_elem(logger->logv_outs);
-			while (handlers) {
-				bctbx_log_handler_t* handler = (bctbx_log_handler_t*)handlers->data;
-				if(handler && (!handler->domain || !domain || strcmp(handler->domain,domain)==0)) {
-					va_list tmp;
-					va_copy(tmp, args);
-					handler->func(handler->user_info, domain, level, fmt, tmp);
-					va_end(tmp);
-				}
-				handlers = handlers->next;
-			}
+			bctbx_log_handlers_dispatch(logger, domain, level, fmt, args);
 		} else if (logger->log_thread_id == bctbx_thread_self()) {
-			bctbx_list_t *handlers;
 			bctbx_logv_flush();
-			handlers = bctbx_list_first_elem(logger->logv_outs);
-			while (handlers) {
-				bctbx_log_handler_t* handler = (bctbx_log_handler_t*)handlers->data;
-				if(handler && (!handler->domain || !domain || strcmp(handler->domain,domain)==0)) {
-					va_list tmp;
-					va_copy(tmp, args);
-					handler->func(handler->user_info, domain, level, fmt, tmp);
-					va_end(tmp);
-				}
-				handlers = handlers->next;
-			}
+			bctbx_log_handlers_dispatch(logger, domain, level, fmt, args);
 		} else {
 			bctbx_stored_log_t *l = bctbx_new(bctbx_stored_log_t, 1);
 			l->domain = domain ? bctbx_strdup(domain) : NULL;
@@ -567,6 +691,16 @@ void bctbx_logv(const char *domain, BctbxLogLevel level, const char *fmt, va_lis
 	}
 #endif
 }
+
+void bctbx_logv(const char *domain, BctbxLogLevel level, const char *fmt, va_list args) {
+	BctoolboxLogDomain *ld = get_log_domain(domain);
+	if (!ld) ld = bctbx_get_logger()->default_log_domain;
+	log_domain_logv(ld, domain, level, fmt, args);
+}
+
+void bctbx_log_domain_logv(bctbx_log_domain_t *domain, BctbxLogLevel level, const char *fmt, va_list args) {
+	log_domain_logv(domain, domain->domain, level, fmt, args);
+}
 void bctbx_logv_out( const char *domain, BctbxLogLevel lev, const char *fmt, va_list args){
 	bctbx_logv_out_cb(NULL, domain, lev, fmt, args);
 }
@@ -660,17 +794,17 @@ static int _try_open_log_collection_file(bctbx_file_log_handler_t *filehandler)
 	return 0;
 }
 
-static void _rotate_log_collection_files(bctbx_file_log_handler_t *filehandler) {
+char *bctbx_log_files_rotate(const char *path, const char *name) {
 	char *log_filename;
 	char *log_filename2;
-	char *file_no_extension = bctbx_strdup(filehandler->name);
+	char *file_no_extension = bctbx_strdup(name);
 	char *extension = strrchr(file_no_extension, '.');
 	char *extension2 = bctbx_strdup(extension);
 	int n = 1;
 	file_no_extension[extension - file_no_extension] = '\0';
 
 	log_filename = bctbx_strdup_printf("%s/%s_1%s",
-		filehandler->path,
+		path,
 		file_no_extension,
 		extension2);
 	while(access(log_filename, F_OK) != -1) {
@@ -678,7 +812,7 @@ static void _rotate_log_collection_files(bctbx_file_log_handler_t *filehandler)
 		n++;
 		bctbx_free(log_filename);
 		log_filename = bctbx_strdup_printf("%s/%s_%d%s",
-		filehandler->path,
+		path,
 		file_no_extension,
 		n,
 		extension2);
@@ -687,12 +821,12 @@ static void _rotate_log_collection_files(bctbx_file_log_handler_t *filehandler)
 	while(n > 1) {
 		bctbx_free(log_filename);
 		log_filename = bctbx_strdup_printf("%s/%s_%d%s",
-		filehandler->path,
+		path,
 		file_no_extension,
 		n-1,
 		extension2);
 		log_filename2 = bctbx_strdup_printf("%s/%s_%d%s",
-		filehandler->path,
+		path,
 		file_no_extension,
 		n,
 		extension2);
@@ -703,17 +837,21 @@ static void _rotate_log_collection_files(bctbx_file_log_handler_t *filehandler)
 	}
 	bctbx_free(log_filename);
 	log_filename = bctbx_strdup_printf("%s/%s",
-	filehandler->path,
-	filehandler->name);
+	path,
+	name);
 	log_filename2 = bctbx_strdup_printf("%s/%s_1%s",
-	filehandler->path,
+	path,
 	file_no_extension,
 	extension2);
 	rename(log_filename, log_filename2);
 	bctbx_free(log_filename);
-	bctbx_free(log_filename2);
 	bctbx_free(extension2);
 	bctbx_free(file_no_extension);
+	return log_filename2;
+}
+
+static void _rotate_log_collection_files(bctbx_file_log_handler_t *filehandler) {
+	bctbx_free(bctbx_log_files_rotate(filehandler->path, filehandler->name));
 }
 
 static void _open_log_collection_file(bctbx_file_log_handler_t *filehandler) {
@@ -827,14 +965,45 @@ void bctbx_logv_file_destroy(bctbx_log_handler_t* handler) {
 	bctbx_logv_out_destroy(handler);
 }
 
+#ifdef THREAD_LOG_LEVEL_ENABLED
+/* Set the level of the calling thread, 0 to clear it, and recompute the enabled masks depending on it */
+static void set_thread_log_level_mask(BctoolboxLogDomain *ld, bctbx_thread_log_level_t *specific, unsigned int mask){
+	bctbx_logger_t *logger = bctbx_get_logger();
+	bctbx_mutex_lock(&logger->domains_mutex);
+	specific->mask = mask;
+	update_enabled_mask(ld, log_mask_load(&logger->default_log_domain->enabled_mask));
+	bctbx_mutex_unlock(&logger->domains_mutex);
+	if (ld == logger->default_log_domain) propagate_default_log_level(logger);
+}
+
+static void thread_level_key_destroy(void *ptr){
+	bctbx_thread_log_level_t *specific = (bctbx_thread_log_level_t*)ptr;
+	BctoolboxLogDomain *ld = specific->ld;
+	bctbx_logger_t *logger = bctbx_get_logger();
+	bctbx_mutex_lock(&logger->domains_mutex);
+	ld->thread_levels = bctbx_list_remove(ld->thread_levels, specific);
+	update_enabled_mask(ld, log_mask_load(&logger->default_log_domain->enabled_mask));
+	bctbx_mutex_unlock(&logger->domains_mutex);
+	if (ld == logger->default_log_domain) propagate_default_log_level(logger);
+	bctbx_free(specific);
+}
+#endif
+
 void bctbx_set_thread_log_level(const char *domain, BctbxLogLevel level){
 #ifdef THREAD_LOG_LEVEL_ENABLED
-	BctoolboxLogDomain * ld = get_log_domain(domain);
-	unsigned int *specific = (unsigned int*)pthread_getspecific(ld->thread_level_key);
-	if (!specific) specific = bctbx_new0(unsigned int, 1);
-	*specific = level_to_mask(level);
-	pthread_setspecific(ld->thread_level_key, specific);
-	ld->thread_level_set = TRUE;
+	bctbx_logger_t *logger = bctbx_get_logger();
+	BctoolboxLogDomain * ld = get_log_domain_rw(domain, FALSE);
+	bctbx_thread_log_level_t *specific = (bctbx_thread_log_level_t*)pthread_getspecific(ld->thread_level_key);
+	if (!specific) {
+		specific = bctbx_new0(bctbx_thread_log_level_t, 1);
+		specific->ld = ld;
+		pthread_setspecific(ld->thread_level_key, specific);
+		bctbx_mutex_lock(&logger->domains_mutex);
+		ld->thread_levels = bctbx_list_prepend(ld->thread_levels, specific);
+		ld->thread_level_set = TRUE;
+		bctbx_mutex_unlock(&logger->domains_mutex);
+	}
+	set_thread_log_level_mask(ld, specific, level_to_mask(level));
 #endif
 }
 
@@ -842,8 +1011,10 @@ void bctbx_set_thread_log_level(const char *domain, BctbxLogLevel level){
 void bctbx_clear_thread_log_level(const char *domain){
 #ifdef THREAD_LOG_LEVEL_ENABLED
 	BctoolboxLogDomain * ld = get_log_domain(domain);
-	unsigned int *specific = (unsigned int*)pthread_getspecific(ld->thread_level_key);
-	if (specific) *specific = 0;
+	bctbx_thread_log_level_t *specific;
+	if (!ld) return;
+	specific = (bctbx_thread_log_level_t*)pthread_getspecific(ld->thread_level_key);
+	if (specific) set_thread_log_level_mask(ld, specific, 0);
 #endif
 }
 
@@ -0,0 +1,407 @@
+/*
+ * Copyright (c) 2016-2020 Belledonne Communications SARL.
+ *
+ * This file is part of bctoolbox.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "logging_async.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace {
+/**
+ * Bounded multi-producers single-consumer queue of log records dispatched by a writer thread
+ * Each slot carries a sequence number telling whether it is free for the producer claiming position pos (sequence == pos)
+ * or holds the record of position pos (sequence == pos + 1), so producers only contend on the enqueue position.
+ * Record texts are formatted into a buffer preallocated for each slot.
+ * Producers do not wake the writer up for each record: after dispatching records, it naps and picks the next ones up
+ * when the nap is over, unless the queue gets half full or is flushed meanwhile. When a nap found no record, the writer
+ * sleeps until the next record is published: only the producer publishing it wakes the writer up.
+ */
+class AsyncLogger {
+	private:
+		struct Record {
+			std::atomic<size_t> sequence;
+			BctbxLogLevel level;
+			bool hasDomain;
+			size_t messageOffset; /**< the domain, when any, is stored before the message */
+			char *text; /**< the slot buffer or a heap allocated one when the record does not fit in it */
+		};
+
+		const size_t mMask;
+		const size_t mRecordSize;
+		const BctbxLogAsyncOverflowPolicy mPolicy;
+		std::unique_ptr<Record[]> mRecords;
+		std::vector<char> mTexts; /**< mRecordSize bytes per slot */
+		std::atomic<size_t> mEnqueuePos;
+		std::atomic<size_t> mDequeuePos; /**< written by the writer thread only */
+		std::atomic<uint64_t> mDropped;
+		uint64_t mReportedDropped; /**< writer thread only */
+
+		std::atomic<bool> mWriterIdle; /**< the writer sleeps until a record is published: set by the writer under mMutex, cleared by whoever wakes it up */
+		std::atomic<bool> mWakeUpRequested; /**< cut the writer nap short: set by a producer filling half the queue or by a flush, cleared by the writer */
+		std::mutex mMutex; /**< protect the stop flag and the flush waiters count */
+		std::condition_variable mWakeUp; /**< wake the writer up: record published while idle, half full queue, flush or stop */
+		std::condition_variable mFlushed; /**< signal flushing threads that the dequeue position moved */
+		bool mStop;
+		int mFlushWaiters;
+		std::thread mWriter;
+
+		static constexpr std::chrono::milliseconds sNapDuration{5};
+
+		static size_t roundCapacity(size_t capacity) {
+			size_t rounded = 2;
+			while (rounded < capacity) rounded <<= 1;
+			return rounded;
+		}
+
+		void format(Record &record, const char *inlineText, const char *domain, const char *fmt, va_list args) {
+			size_t domainSize = domain ? strlen(domain) + 1 : 0;
+			record.hasDomain = (domain != nullptr);
+			record.messageOffset = domainSize;
+			record.text = const_cast<char *>(inlineText);
+			int messageLength = -1;
+			if (domainSize < mRecordSize) {
+				va_list copy;
+				va_copy(copy, args);
+				messageLength = vsnprintf(record.text + domainSize, mRecordSize - domainSize, fmt, copy);
+				va_end(copy);
+				if (messageLength >= 0 && (size_t)messageLength < mRecordSize - domainSize) {
+					if (domain) memcpy(record.text, domain, domainSize);
+					return;
+				}
+			}
+			if (messageLength < 0) { // the domain alone fills the slot buffer, get the message length
+				va_list copy;
+				va_copy(copy, args);
+				messageLength = vsnprintf(nullptr, 0, fmt, copy);
+				va_end(copy);
+			}
+			size_t messageSize = (messageLength > 0) ? (size_t)messageLength + 1 : 1;
+			record.text = (char *)bctbx_malloc(domainSize + messageSize);
+			if (domain) memcpy(record.text, domain, domainSize);
+			record.text[domainSize] = '\0';
+			if (messageLength > 0) {
+				va_list copy;
+				va_copy(copy, args);
+				vsnprintf(record.text + domainSize, messageSize, fmt, copy);
+				va_end(copy);
+			}
+		}
+
+		bool isInline(const Record &record, size_t pos) const {
+			return record.text == &mTexts[(pos & mMask) * mRecordSize];
+		}
+
+		/* Dispatch all the records ready in the queue, stop at the first one still being written. Return the number of records dispatched */
+		size_t drain() {
+			size_t dispatched = 0;
+			for (;; dispatched++) {
+				size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+				Record &record = mRecords[pos & mMask];
+				if (record.sequence.load(std::memory_order_acquire) != pos + 1) return dispatched;
+				bctbx_log_dispatch(record.hasDomain ? record.text : NULL, record.level, "%s", record.text + record.messageOffset);
+				if (!isInline(record, pos)) bctbx_free(record.text);
+				record.sequence.store(pos + mMask + 1, std::memory_order_release);
+				mDequeuePos.store(pos + 1, std::memory_order_release);
+			}
+		}
+
+		void reportDropped() {
+			uint64_t dropped = mDropped.load(std::memory_order_relaxed);
+			if (dropped != mReportedDropped) {
+				bctbx_log_dispatch(BCTBX_LOG_DOMAIN, BCTBX_LOG_WARNING, "Asynchronous logging queue full: %llu log records dropped",
+						(unsigned long long)(dropped - mReportedDropped));
+				mReportedDropped = dropped;
+			}
+		}
+
+		/* true when the next record to dispatch is published */
+		bool recordReady() const {
+			size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+			return mRecords[pos & mMask].sequence.load(std::memory_order_acquire) == pos + 1;
+		}
+
+		/* Wake the writer up if it sleeps, called by producers after publishing a record */
+		void wakeUpIdleWriter() {
+			if (mWriterIdle.load(std::memory_order_relaxed) && mWriterIdle.exchange(false)) {
+				// the writer releases the lock only once waiting: the notification cannot be lost
+				std::lock_guard<std::mutex> lock(mMutex);
+				mWakeUp.notify_one();
+			}
+		}
+
+		/* Wake the writer up whether it naps or sleeps, only the first caller until the writer wakes up notifies it */
+		void requestWakeUp() {
+			if (!mWakeUpRequested.load(std::memory_order_relaxed) && !mWakeUpRequested.exchange(true)) {
+				std::lock_guard<std::mutex> lock(mMutex);
+				mWakeUp.notify_one();
+			}
+		}
+
+		void writerLoop() {
+			for (;;) {
+				size_t dispatched = drain();
+				reportDropped();
+				bool stop;
+				{
+					std::unique_lock<std::mutex> lock(mMutex);
+					if (mFlushWaiters > 0) mFlushed.notify_all();
+					stop = mStop;
+					if (!stop && dispatched > 0) {
+						// records are coming: nap rather than having every producer wake the writer up
+						mWakeUp.wait_for(lock, sNapDuration, [this]{return mStop || mWakeUpRequested.load(std::memory_order_relaxed);});
+					} else if (!stop) {
+						// announce the writer is idle before checking the queue a last time: a producer publishing
+						// a record after this check sees the flag (both sides are ordered by a full fence)
+						mWriterIdle.store(true, std::memory_order_relaxed);
+						std::atomic_thread_fence(std::memory_order_seq_cst);
+						mWakeUp.wait(lock, [this]{return mStop || mWakeUpRequested.load(std::memory_order_relaxed)
+							|| !mWriterIdle.load(std::memory_order_relaxed) || recordReady();});
+						mWriterIdle.store(false, std::memory_order_relaxed);
+					}
+					// requests made from now on are for records the next drain may miss
+					mWakeUpRequested.store(false, std::memory_order_relaxed);
+				}
+				// producers are all gone when stopping: once every claimed position is dispatched, the queue is empty for good
+				if (stop && mDequeuePos.load(std::memory_order_relaxed) == mEnqueuePos.load(std::memory_order_acquire)) return;
+			}
+		}
+
+	public:
+		AsyncLogger(size_t capacity, size_t recordSize, BctbxLogAsyncOverflowPolicy policy)
+			: mMask(roundCapacity(capacity) - 1), mRecordSize(recordSize > 0 ? recordSize : 1), mPolicy(policy),
+			mRecords(new Record[mMask + 1]), mTexts((mMask + 1) * mRecordSize), mEnqueuePos(0), mDequeuePos(0),
+			mDropped(0), mReportedDropped(0), mWriterIdle(false), mWakeUpRequested(false), mStop(false), mFlushWaiters(0) {
+			for (size_t i = 0; i <= mMask; i++) {
+				mRecords[i].sequence.store(i, std::memory_order_relaxed);
+			}
+			mWriter = std::thread(&AsyncLogger::writerLoop, this);
+		}
+		~AsyncLogger() {
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mStop = true;
+			}
+			mWakeUp.notify_one();
+			mWriter.join();
+		}
+		AsyncLogger(const AsyncLogger &) = delete;
+		AsyncLogger &operator=(const AsyncLogger &) = delete;
+
+		/**
+		 * Queue a record, or drop it when the queue is full and the policy says so.
+		 * @return false when the record must be dispatched synchronously by the caller
+		 */
+		bool push(const char *domain, BctbxLogLevel level, const char *fmt, va_list args) {
+			// a log handler logging from the writer thread would wait for itself on a full queue
+			if (std::this_thread::get_id() == mWriter.get_id()) return false;
+
+			size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+			Record *record;
+			for (;;) {
+				record = &mRecords[pos & mMask];
+				size_t sequence = record->sequence.load(std::memory_order_acquire);
+				intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+				if (diff == 0) {
+					if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+				} else if (diff < 0) { // full: the slot still holds the record of the previous lap
+					if (mPolicy == BCTBX_LOG_ASYNC_DROP) {
+						mDropped.fetch_add(1, std::memory_order_relaxed);
+						return true;
+					}
+					requestWakeUp();
+					std::this_thread::yield();
+					pos = mEnqueuePos.load(std::memory_order_relaxed);
+				} else { // another producer claimed this position
+					pos = mEnqueuePos.load(std::memory_order_relaxed);
+				}
+			}
+			record->level = level;
+			format(*record, &mTexts[(pos & mMask) * mRecordSize], domain, fmt, args);
+			record->sequence.store(pos + 1, std::memory_order_release);
+			// pairs with the writer fence: either it sees this record or it is seen idle here
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (pos + 1 - mDequeuePos.load(std::memory_order_relaxed) > (mMask + 1) / 2) {
+				requestWakeUp();
+			} else {
+				wakeUpIdleWriter();
+			}
+			return true;
+		}
+
+		void flush() {
+			// called by a log handler: the records queued before are already dispatched
+			if (std::this_thread::get_id() == mWriter.get_id()) return;
+			size_t target = mEnqueuePos.load(std::memory_order_acquire);
+			std::unique_lock<std::mutex> lock(mMutex);
+			mFlushWaiters++;
+			mWakeUpRequested.store(true, std::memory_order_relaxed);
+			mWakeUp.notify_one();
+			mFlushed.wait(lock, [this, target]{return (intptr_t)(mDequeuePos.load(std::memory_order_acquire) - target) >= 0;});
+			mFlushWaiters--;
+		}
+
+		uint64_t droppedCount() const {
+			return mDropped.load(std::memory_order_relaxed);
+		}
+};
+
+constexpr std::chrono::milliseconds AsyncLogger::sNapDuration;
+
+std::atomic<AsyncLogger *> asyncLogger{nullptr};
+std::mutex asyncLoggerMutex; /**< serialize start and stop */
+
+class UserEpoch;
+
+/* The epochs of all the threads, registered on their first use of the asynchronous logger */
+struct UserEpochs {
+	std::mutex mutex;
+	std::vector<UserEpoch *> epochs;
+};
+
+UserEpochs &userEpochs() {
+	static UserEpochs *epochs = new UserEpochs(); // never deleted: threads may exit after the static destructors ran
+	return *epochs;
+}
+
+/**
+ * Epoch of a thread using the asynchronous logger: odd while the thread may hold it.
+ * Written by its thread only, so holding the logger does not write any memory shared with other threads.
+ * bctbx_log_async_stop() waits for every odd epoch to move before deleting the logger.
+ */
+class UserEpoch {
+	public:
+		std::atomic<unsigned int> value;
+
+		UserEpoch() : value(0) {
+			std::lock_guard<std::mutex> lock(userEpochs().mutex);
+			userEpochs().epochs.push_back(this);
+		}
+		~UserEpoch() {
+			std::lock_guard<std::mutex> lock(userEpochs().mutex);
+			auto &epochs = userEpochs().epochs;
+			for (auto it = epochs.begin(); it != epochs.end(); ++it) {
+				if (*it == this) {
+					epochs.erase(it);
+					break;
+				}
+			}
+		}
+		UserEpoch(const UserEpoch &) = delete;
+		UserEpoch &operator=(const UserEpoch &) = delete;
+};
+
+thread_local UserEpoch userEpoch;
+
+/* Hold the asynchronous logger, if any, so that it is not deleted while in use */
+class AsyncLoggerRef {
+	private:
+		std::atomic<unsigned int> &mEpoch;
+		AsyncLogger *mLogger;
+		bool mNested;
+	public:
+		AsyncLoggerRef() : mEpoch(userEpoch.value) {
+			unsigned int epoch = mEpoch.load(std::memory_order_relaxed);
+			mNested = (epoch & 1) != 0;
+			if (!mNested) mEpoch.store(epoch + 1, std::memory_order_relaxed);
+			// pairs with the fence of bctbx_log_async_stop(): either it sees the odd epoch or the logger is read as gone
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			mLogger = asyncLogger.load(std::memory_order_relaxed);
+		}
+		~AsyncLoggerRef() {
+			if (!mNested) mEpoch.store(mEpoch.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+		AsyncLoggerRef(const AsyncLoggerRef &) = delete;
+		AsyncLoggerRef &operator=(const AsyncLoggerRef &) = delete;
+		AsyncLogger *get() const {return mLogger;}
+};
+
+std::recursive_mutex &logHandlersMutex() {
+	static std::recursive_mutex *mutex = new std::recursive_mutex(); // usable by the static constructors and destructors of other modules
+	return *mutex;
+}
+} // anonymous namespace
+
+extern "C" void bctbx_log_handlers_lock(void) {
+	logHandlersMutex().lock();
+}
+
+extern "C" void bctbx_log_handlers_unlock(void) {
+	logHandlersMutex().unlock();
+}
+
+extern "C" int bctbx_log_async_push(const char *domain, BctbxLogLevel level, const char *fmt, va_list args) {
+	if (asyncLogger.load(std::memory_order_relaxed) == nullptr) return -1;
+	AsyncLoggerRef logger;
+	return (logger.get() != nullptr && logger.get()->push(domain, level, fmt, args)) ? 0 : -1;
+}
+
+extern "C" int bctbx_log_async_start(size_t capacity, size_t record_size, BctbxLogAsyncOverflowPolicy policy) {
+	std::lock_guard<std::mutex> lock(asyncLoggerMutex);
+	if (asyncLogger.load() != nullptr) return -1;
+	try {
+		asyncLogger.store(new AsyncLogger(capacity, record_size, policy));
+	} catch (const std::system_error &) {
+		return -1;
+	}
+	return 0;
+}
+
+extern "C" void bctbx_log_async_flush(void) {
+	if (asyncLogger.load(std::memory_order_relaxed) == nullptr) return;
+	AsyncLoggerRef logger;
+	if (logger.get() != nullptr) logger.get()->flush();
+}
+
+extern "C" void bctbx_log_async_stop(void) {
+	std::lock_guard<std::mutex> lock(asyncLoggerMutex);
+	AsyncLogger *logger = asyncLogger.exchange(nullptr);
+	if (logger == nullptr) return;
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	// wait for the producers still holding it: new ones see no logger and log synchronously
+	{
+		std::lock_guard<std::mutex> epochsLock(userEpochs().mutex);
+		for (UserEpoch *epoch : userEpochs().epochs) {
+			unsigned int value = epoch->value.load(std::memory_order_acquire);
+			if ((value & 1) == 0) continue;
+			while (epoch->value.load(std::memory_order_acquire) == value) {
+				std::this_thread::yield();
+			}
+		}
+	}
+	delete logger; // dispatch the remaining records and join the writer thread
+}
+
+extern "C" uint64_t bctbx_log_async_get_dropped_count(void) {
+	if (asyncLogger.load(std::memory_order_relaxed) == nullptr) return 0;
+	AsyncLoggerRef logger;
+	return logger.get() != nullptr ? logger.get()->droppedCount() : 0;
+}
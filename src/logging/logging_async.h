@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2016-2020 Belledonne Communications SARL.
+ *
+ * This file is part of bctoolbox.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BCTBX_LOGGING_ASYNC_H
+#define BCTBX_LOGGING_ASYNC_H
+
+#include "bctoolbox/logging.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Queue a log record when the asynchronous logging mode is started.
+ * Implemented in logging_async.cc
+ *
+ * @return 0 if the record was handled (queued or dropped), -1 if the caller must dispatch it itself
+ */
+int bctbx_log_async_push(const char *domain, BctbxLogLevel level, const char *fmt, va_list args);
+
+/**
+ * Give a log record to all the log handlers matching its domain.
+ * Implemented in logging.c
+ */
+void bctbx_log_dispatch(const char *domain, BctbxLogLevel level, const char *fmt, ...);
+
+/**
+ * Serialize the changes of the log handlers list with its use by the asynchronous logging writer thread.
+ * The lock is recursive: a log handler may add or remove handlers.
+ * Implemented in logging_async.cc
+ */
+void bctbx_log_handlers_lock(void);
+void bctbx_log_handlers_unlock(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BCTBX_LOGGING_ASYNC_H */
@@ -0,0 +1,586 @@
+/*
+ * Copyright (c) 2016-2020 Belledonne Communications SARL.
+ *
+ * This file is part of bctoolbox.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "bctoolbox/logging.h"
+#include <cerrno>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <cwchar>
+
+/*
+ * Binary log file format, integers are LEB128 varints unless stated otherwise:
+ * - file header, written at each opening: the 8 bytes "BCTBXLOG" then one version byte.
+ *   It resets the format and domain dictionaries.
+ * - format definition: byte 1, id, length, format string
+ * - domain definition: byte 2, id, length, domain name. Id 0 is the NULL domain.
+ * - log record: byte 3, timestamp in microseconds, thread id, domain id, format id, level byte, arguments length, arguments
+ * The arguments are encoded in the order of the format conversions: signed integers as zigzag varints, unsigned integers
+ * and pointers as varints, floating points as 8 bytes little endian IEEE-754 doubles, strings as length + 1 then the
+ * characters, 0 standing for a NULL string.
+ */
+
+namespace {
+constexpr char binaryLogMagic[] = {'B', 'C', 'T', 'B', 'X', 'L', 'O', 'G'};
+constexpr uint8_t binaryLogVersion = 1;
+constexpr uint8_t formatDefinition = 1;
+constexpr uint8_t domainDefinition = 2;
+constexpr uint8_t logRecord = 3;
+constexpr size_t maxInternedStrings = 65536; // when reached, the dictionaries are restarted with a new file header
+
+enum class ArgLength {none, hh, h, l, ll, j, z, t, L};
+
+/* A printf conversion specification */
+struct ConversionSpec {
+	std::string flags;
+	int width = -1;
+	bool widthArg = false;
+	int precision = -1; /**< -1 when there is no precision */
+	bool precisionArg = false;
+	ArgLength length = ArgLength::none;
+	char conversion = '\0';
+};
+
+static int parseNumber(const char *&p) {
+	int value = 0;
+	while (*p >= '0' && *p <= '9') {
+		value = value * 10 + (*p - '0');
+		p++;
+	}
+	return value;
+}
+
+/**
+ * Parse the conversion specification following a '%'.
+ * Used by both the encoder and the decoder, which stop at the same unsupported conversion.
+ * @return the position following the specification, nullptr when it is not supported
+ */
+static const char *parseConversion(const char *p, ConversionSpec &spec) {
+	while (*p != '\0' && strchr("-+ #0'", *p) != nullptr) spec.flags += *p++;
+	if (*p == '*') {
+		spec.widthArg = true;
+		p++;
+	} else if (*p >= '0' && *p <= '9') {
+		spec.width = parseNumber(p);
+	}
+	if (*p == '.') {
+		p++;
+		if (*p == '*') {
+			spec.precisionArg = true;
+			p++;
+		} else {
+			spec.precision = parseNumber(p);
+		}
+	}
+	switch (*p) {
+		case 'h':
+			if (p[1] == 'h') {
+				spec.length = ArgLength::hh;
+				p++;
+			} else {
+				spec.length = ArgLength::h;
+			}
+			p++;
+			break;
+		case 'l':
+			if (p[1] == 'l') {
+				spec.length = ArgLength::ll;
+				p++;
+			} else {
+				spec.length = ArgLength::l;
+			}
+			p++;
+			break;
+		case 'q': spec.length = ArgLength::ll; p++; break;
+		case 'j': spec.length = ArgLength::j; p++; break;
+		case 'z': spec.length = ArgLength::z; p++; break;
+		case 't': spec.length = ArgLength::t; p++; break;
+		case 'L': spec.length = ArgLength::L; p++; break;
+		default: break;
+	}
+	if (*p == '\0' || strchr("diouxXcspfFeEgGaAn%", *p) == nullptr) return nullptr;
+	spec.conversion = *p;
+	return p + 1;
+}
+
+static void putVarint(std::string &out, uint64_t value) {
+	while (value >= 0x80) {
+		out += (char)((value & 0x7F) | 0x80);
+		value >>= 7;
+	}
+	out += (char)value;
+}
+
+static void putSigned(std::string &out, int64_t value) {
+	putVarint(out, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+static void putDouble(std::string &out, double value) {
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	for (int i = 0; i < 8; i++) {
+		out += (char)(bits >> (8 * i));
+	}
+}
+
+static void putString(std::string &out, const char *str, size_t size) {
+	if (str == nullptr) {
+		putVarint(out, 0);
+		return;
+	}
+	putVarint(out, (uint64_t)size + 1);
+	out.append(str, size);
+}
+
+/* Encode the arguments of fmt, in the order of its conversions */
+static void encodeArguments(std::string &out, const char *fmt, va_list args) {
+	va_list ap;
+	va_copy(ap, args);
+	const char *p = fmt;
+	while ((p = strchr(p, '%')) != nullptr) {
+		ConversionSpec spec;
+		p = parseConversion(p + 1, spec);
+		if (p == nullptr) break;
+		if (spec.conversion == '%') continue;
+		if (spec.widthArg) putSigned(out, va_arg(ap, int));
+		int precision = spec.precision;
+		if (spec.precisionArg) {
+			precision = va_arg(ap, int);
+			putSigned(out, precision);
+		}
+		switch (spec.conversion) {
+			case 'd':
+			case 'i': {
+				int64_t value;
+				switch (spec.length) {
+					case ArgLength::hh: value = (signed char)va_arg(ap, int); break;
+					case ArgLength::h: value = (short)va_arg(ap, int); break;
+					case ArgLength::l: value = va_arg(ap, long); break;
+					case ArgLength::ll: value = va_arg(ap, long long); break;
+					case ArgLength::j: value = va_arg(ap, intmax_t); break;
+					case ArgLength::z: value = (int64_t)va_arg(ap, size_t); break;
+					case ArgLength::t: value = va_arg(ap, ptrdiff_t); break;
+					default: value = va_arg(ap, int); break;
+				}
+				putSigned(out, value);
+				break;
+			}
+			case 'o':
+			case 'u':
+			case 'x':
+			case 'X': {
+				uint64_t value;
+				switch (spec.length) {
+					case ArgLength::hh: value = (unsigned char)va_arg(ap, unsigned int); break;
+					case ArgLength::h: value = (unsigned short)va_arg(ap, unsigned int); break;
+					case ArgLength::l: value = va_arg(ap, unsigned long); break;
+					case ArgLength::ll: value = va_arg(ap, unsigned long long); break;
+					case ArgLength::j: value = va_arg(ap, uintmax_t); break;
+					case ArgLength::z: value = va_arg(ap, size_t); break;
+					case ArgLength::t: value = (uint64_t)va_arg(ap, ptrdiff_t); break;
+					default: value = va_arg(ap, unsigned int); break;
+				}
+				putVarint(out, value);
+				break;
+			}
+			case 'c':
+				if (spec.length == ArgLength::l) {
+					putSigned(out, (int64_t)va_arg(ap, wint_t));
+				} else {
+					putSigned(out, va_arg(ap, int));
+				}
+				break;
+			case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+				if (spec.length == ArgLength::L) {
+					putDouble(out, (double)va_arg(ap, long double));
+				} else {
+					putDouble(out, va_arg(ap, double));
+				}
+				break;
+			case 's':
+				if (spec.length == ArgLength::l) {
+					va_arg(ap, wchar_t *);
+					putString(out, "?", 1);
+				} else {
+					const char *str = va_arg(ap, const char *);
+					size_t size = 0;
+					if (str != nullptr) { // a string with a precision is not necessarily null terminated
+						if (precision >= 0) {
+							while (size < (size_t)precision && str[size] != '\0') size++;
+						} else {
+							size = strlen(str);
+						}
+					}
+					putString(out, str, size);
+				}
+				break;
+			case 'p':
+				putVarint(out, (uint64_t)(uintptr_t)va_arg(ap, void *));
+				break;
+			case 'n':
+				va_arg(ap, void *);
+				break;
+		}
+	}
+	va_end(ap);
+}
+
+/**
+ * Append log records to a binary file, format strings and domains are written once and then referred to by id
+ */
+class BinaryFileLogHandler {
+	private:
+		struct InternedString {
+			uint32_t id;
+			std::string text; /**< the pointer keying the table may have been reused for another string */
+		};
+
+		std::mutex mMutex;
+		FILE *mFile;
+		std::unordered_map<const char *, InternedString> mFormats;
+		std::unordered_map<const char *, InternedString> mDomains;
+		uint32_t mNextFormatId;
+		uint32_t mNextDomainId;
+		std::string mRecord; /**< reused for each record, no allocation once large enough */
+		std::string mArguments;
+
+		void writeHeader() {
+			mFormats.clear();
+			mDomains.clear();
+			mNextFormatId = 1;
+			mNextDomainId = 1;
+			fwrite(binaryLogMagic, 1, sizeof(binaryLogMagic), mFile);
+			fputc(binaryLogVersion, mFile);
+		}
+
+		uint32_t intern(std::unordered_map<const char *, InternedString> &table, uint32_t &nextId, uint8_t definition, const char *str) {
+			auto it = table.find(str);
+			if (it != table.end() && it->second.text == str) return it->second.id;
+			uint32_t id = nextId++;
+			table[str] = InternedString{id, str};
+			size_t size = strlen(str);
+			mRecord += (char)definition;
+			putVarint(mRecord, id);
+			putVarint(mRecord, size);
+			mRecord.append(str, size);
+			return id;
+		}
+
+	public:
+		explicit BinaryFileLogHandler(FILE *file) : mFile(file), mNextFormatId(1), mNextDomainId(1) {
+			writeHeader();
+			fflush(mFile);
+		}
+		~BinaryFileLogHandler() {
+			fclose(mFile);
+		}
+		BinaryFileLogHandler(const BinaryFileLogHandler &) = delete;
+		BinaryFileLogHandler &operator=(const BinaryFileLogHandler &) = delete;
+
+		void log(const char *domain, BctbxLogLevel level, const char *fmt, va_list args) {
+			struct timeval tp;
+			bctbx_gettimeofday(&tp, NULL);
+			uint64_t thread = (uint64_t)bctbx_thread_self();
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (mFormats.size() >= maxInternedStrings || mDomains.size() >= maxInternedStrings) writeHeader();
+			mRecord.clear();
+			uint32_t domainId = domain ? intern(mDomains, mNextDomainId, domainDefinition, domain) : 0;
+			uint32_t formatId = intern(mFormats, mNextFormatId, formatDefinition, fmt);
+			mArguments.clear();
+			encodeArguments(mArguments, fmt, args);
+			mRecord += (char)logRecord;
+			putVarint(mRecord, (uint64_t)tp.tv_sec * 1000000 + (uint64_t)tp.tv_usec);
+			putVarint(mRecord, thread);
+			putVarint(mRecord, domainId);
+			putVarint(mRecord, formatId);
+			mRecord += (char)level;
+			putVarint(mRecord, mArguments.size());
+			mRecord += mArguments;
+			fwrite(mRecord.data(), 1, mRecord.size(), mFile);
+			if (level >= BCTBX_LOG_WARNING) fflush(mFile);
+		}
+};
+
+void bctbx_logv_binary_file(void *user_info, const char *domain, BctbxLogLevel level, const char *fmt, va_list args) {
+	static_cast<BinaryFileLogHandler *>(user_info)->log(domain, level, fmt, args);
+}
+
+void bctbx_binary_file_log_handler_destroy(bctbx_log_handler_t *handler) {
+	delete static_cast<BinaryFileLogHandler *>(bctbx_log_handler_get_user_data(handler));
+	bctbx_log_handler_set_domain(handler, NULL);
+	bctbx_free(handler);
+}
+
+/* Sequential reader of the arguments of a record */
+class ArgumentsReader {
+	private:
+		const std::string &mData;
+		size_t mPos;
+		bool mValid;
+
+	public:
+		explicit ArgumentsReader(const std::string &data) : mData(data), mPos(0), mValid(true) {}
+
+		bool valid() const {return mValid;}
+
+		uint64_t varint() {
+			uint64_t value = 0;
+			for (int shift = 0; shift < 64; shift += 7) {
+				if (mPos >= mData.size()) break;
+				uint8_t byte = (uint8_t)mData[mPos++];
+				value |= (uint64_t)(byte & 0x7F) << shift;
+				if ((byte & 0x80) == 0) return value;
+			}
+			mValid = false;
+			return 0;
+		}
+
+		int64_t signedValue() {
+			uint64_t value = varint();
+			return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+		}
+
+		double doubleValue() {
+			if (mPos + 8 > mData.size()) {
+				mValid = false;
+				return 0.0;
+			}
+			uint64_t bits = 0;
+			for (int i = 0; i < 8; i++) {
+				bits |= (uint64_t)(uint8_t)mData[mPos++] << (8 * i);
+			}
+			double value;
+			memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+
+		/* @return false for a NULL string */
+		bool stringValue(std::string &value) {
+			uint64_t size = varint();
+			if (size == 0) return false;
+			size--;
+			if (size > mData.size() - mPos) {
+				mValid = false;
+				return false;
+			}
+			value.assign(mData, mPos, (size_t)size);
+			mPos += (size_t)size;
+			return true;
+		}
+};
+
+static void appendFormatted(std::string &out, const char *fmt, ...) {
+	char buffer[256];
+	va_list args;
+	va_start(args, fmt);
+	int size = vsnprintf(buffer, sizeof(buffer), fmt, args);
+	va_end(args);
+	if (size < 0) return;
+	if ((size_t)size < sizeof(buffer)) {
+		out.append(buffer, (size_t)size);
+		return;
+	}
+	std::string large((size_t)size + 1, '\0');
+	va_start(args, fmt);
+	vsnprintf(&large[0], large.size(), fmt, args);
+	va_end(args);
+	out.append(large, 0, (size_t)size);
+}
+
+/* Format a message from its format string and encoded arguments, mirroring encodeArguments() */
+static std::string render(const std::string &fmt, const std::string &arguments) {
+	ArgumentsReader reader(arguments);
+	std::string out;
+	const char *p = fmt.c_str();
+	while (*p != '\0') {
+		const char *percent = strchr(p, '%');
+		if (percent == nullptr) {
+			out.append(p);
+			break;
+		}
+		out.append(p, (size_t)(percent - p));
+		ConversionSpec spec;
+		const char *next = parseConversion(percent + 1, spec);
+		if (next == nullptr) { // the encoder stopped there too
+			out.append(percent);
+			break;
+		}
+		p = next;
+		if (spec.conversion == '%') {
+			out += '%';
+			continue;
+		}
+		std::string flags = spec.flags;
+		int width = spec.width;
+		int precision = spec.precision;
+		if (spec.widthArg) {
+			width = (int)reader.signedValue();
+			if (width < 0) { // a negative width argument is a '-' flag
+				flags += '-';
+				width = -width;
+			}
+		}
+		if (spec.precisionArg) precision = (int)reader.signedValue(); // negative: as if there was no precision
+		std::string conversion = "%" + flags;
+		if (width >= 0) conversion += std::to_string(width);
+		if (precision >= 0) conversion += "." + std::to_string(precision);
+
+		switch (spec.conversion) {
+			case 'd':
+			case 'i':
+				appendFormatted(out, (conversion + "ll" + spec.conversion).c_str(), (long long)reader.signedValue());
+				break;
+			case 'o':
+			case 'u':
+			case 'x':
+			case 'X':
+				appendFormatted(out, (conversion + "ll" + spec.conversion).c_str(), (unsigned long long)reader.varint());
+				break;
+			case 'c': {
+				int64_t value = reader.signedValue();
+				appendFormatted(out, (conversion + "c").c_str(), (value >= 0 && value < 0x80) ? (int)value : '?');
+				break;
+			}
+			case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+				appendFormatted(out, (conversion + spec.conversion).c_str(), reader.doubleValue());
+				break;
+			case 's': {
+				std::string value;
+				if (reader.stringValue(value)) {
+					appendFormatted(out, (conversion + "s").c_str(), value.c_str());
+				} else {
+					appendFormatted(out, (conversion + "s").c_str(), "(null)");
+				}
+				break;
+			}
+			case 'p':
+				appendFormatted(out, (conversion + "p").c_str(), (void *)(uintptr_t)reader.varint());
+				break;
+			default: // %n
+				break;
+		}
+		if (!reader.valid()) {
+			out += "<truncated arguments>";
+			break;
+		}
+	}
+	return out;
+}
+
+static bool readVarint(FILE *input, uint64_t &value) {
+	value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		int byte = fgetc(input);
+		if (byte == EOF) return false;
+		value |= (uint64_t)(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0) return true;
+	}
+	return false;
+}
+
+static bool readBytes(FILE *input, uint64_t size, std::string &value) {
+	if (size > (1 << 24)) return false; // not a record from the log handler
+	value.resize((size_t)size);
+	return size == 0 || fread(&value[0], 1, (size_t)size, input) == (size_t)size;
+}
+
+static bool readHeader(FILE *input) {
+	char magic[sizeof(binaryLogMagic)];
+	if (fread(magic, 1, sizeof(magic), input) != sizeof(magic) || memcmp(magic, binaryLogMagic, sizeof(magic)) != 0) return false;
+	return fgetc(input) == binaryLogVersion;
+}
+
+static const char *levelName(int level) {
+	switch (level) {
+		case BCTBX_LOG_DEBUG: return "debug";
+		case BCTBX_LOG_TRACE: return "trace";
+		case BCTBX_LOG_MESSAGE: return "message";
+		case BCTBX_LOG_WARNING: return "warning";
+		case BCTBX_LOG_ERROR: return "error";
+		case BCTBX_LOG_FATAL: return "fatal";
+		default: return "badlevel";
+	}
+}
+} // anonymous namespace
+
+extern "C" bctbx_log_handler_t *bctbx_create_binary_file_log_handler(const char *path, const char *name) {
+	std::string fullName = std::string(path) + "/" + name;
+	FILE *f = fopen(fullName.c_str(), "ab");
+	if (f == NULL) {
+		fprintf(stderr, "error while opening '%s': %s\n", fullName.c_str(), strerror(errno));
+		return NULL;
+	}
+	return bctbx_create_log_handler(bctbx_logv_binary_file, bctbx_binary_file_log_handler_destroy, new BinaryFileLogHandler(f));
+}
+
+extern "C" int bctbx_binary_log_decode(FILE *input, FILE *output) {
+	std::unordered_map<uint64_t, std::string> formats;
+	std::unordered_map<uint64_t, std::string> domains;
+	std::string text;
+	std::string arguments;
+
+	if (!readHeader(input)) return -1;
+	for (;;) {
+		int type = fgetc(input);
+		if (type == EOF) return 0;
+		if (type == binaryLogMagic[0]) { // the file was opened again: new dictionaries
+			ungetc(type, input);
+			if (!readHeader(input)) return -1;
+			formats.clear();
+			domains.clear();
+		} else if (type == formatDefinition || type == domainDefinition) {
+			uint64_t id, size;
+			if (!readVarint(input, id) || !readVarint(input, size) || !readBytes(input, size, text)) return -1;
+			(type == formatDefinition ? formats : domains)[id] = text;
+		} else if (type == logRecord) {
+			uint64_t timestamp, thread, domainId, formatId, size;
+			if (!readVarint(input, timestamp) || !readVarint(input, thread) || !readVarint(input, domainId)
+				|| !readVarint(input, formatId)) return -1;
+			int level = fgetc(input);
+			if (level == EOF || !readVarint(input, size) || !readBytes(input, size, arguments)) return -1;
+
+			time_t tt = (time_t)(timestamp / 1000000);
+			struct tm *lt;
+#ifdef _WIN32
+			lt = localtime(&tt);
+#else
+			struct tm tmbuf;
+			lt = localtime_r(&tt, &tmbuf);
+#endif
+			auto domain = domains.find(domainId);
+			auto format = formats.find(formatId);
+			std::string msg = (format != formats.end()) ? render(format->second, arguments) : "<unknown format " + std::to_string(formatId) + ">";
+			fprintf(output, "%i-%.2i-%.2i %.2i:%.2i:%.2i:%.3i [%llx] %s-%s-%s\n",
+				1900 + lt->tm_year, 1 + lt->tm_mon, lt->tm_mday, lt->tm_hour, lt->tm_min, lt->tm_sec, (int)((timestamp / 1000) % 1000),
+				(unsigned long long)thread, (domain != domains.end()) ? domain->second.c_str() : "bctoolbox", levelName(level), msg.c_str());
+		} else {
+			return -1;
+		}
+	}
+}
@@ -0,0 +1,385 @@
+/*
+ * Copyright (c) 2016-2020 Belledonne Communications SARL.
+ *
+ * This file is part of bctoolbox.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "logging_buffered_file.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32) || defined(_WIN32_WCE)
+#define ENDLINE "\r\n"
+#else
+#define ENDLINE "\n"
+#endif
+
+namespace {
+/**
+ * Log records are formatted into the active buffer, swapped with the writing one by the background thread
+ * which writes it to the file without holding the records lock
+ */
+class BufferedFileLogHandler {
+	private:
+		const std::string mPath;
+		const std::string mName;
+		const uint64_t mMaxSize;
+		const size_t mFlushSize;
+		const std::chrono::milliseconds mFlushInterval;
+		FILE *mFile; /**< used by the background thread only */
+		uint64_t mFileSize; /**< used by the background thread only */
+		uint64_t mLostSize; /**< size of the records written while the file could not be opened, background thread only */
+		bool mReopenFailed; /**< the failure is reported once, background thread only */
+
+		std::mutex mMutex; /**< protect all the fields below */
+		std::condition_variable mWakeUp; /**< wake the background thread before the flush interval */
+		std::condition_variable mWritten; /**< signal flushing threads that buffered records were written */
+		std::vector<char> mActive; /**< buffer the log functions write into */
+		size_t mActiveSize;
+		size_t mMaxActiveSize; /**< no record is added to the active buffer once it holds this size */
+		BctbxLogAsyncOverflowPolicy mPolicy;
+		uint64_t mDropped; /**< records dropped since the last one added to the active buffer */
+		std::vector<char> mWriting; /**< buffer being written by the background thread */
+		time_t mTimestampSecond; /**< second of the cached timestamp */
+		char mTimestamp[80]; /**< date and time of the records logged during mTimestampSecond, without the milliseconds */
+		uint64_t mFlushRequests;
+		uint64_t mFlushedRequests;
+		bool mReopenRequested;
+		bool mStop;
+		BctbxLogFileRotatedFunc mRotatedCb;
+		void *mRotatedCbUserData;
+		std::thread mWriter;
+
+		static const char *levelName(BctbxLogLevel level) {
+			switch (level) {
+				case BCTBX_LOG_DEBUG: return "debug";
+				case BCTBX_LOG_TRACE: return "trace";
+				case BCTBX_LOG_MESSAGE: return "message";
+				case BCTBX_LOG_WARNING: return "warning";
+				case BCTBX_LOG_ERROR: return "error";
+				case BCTBX_LOG_FATAL: return "fatal";
+				default: return "badlevel";
+			}
+		}
+
+		bool openFile() {
+			std::string fullName = mPath + "/" + mName;
+			mFile = fopen(fullName.c_str(), "a");
+			if (mFile == nullptr) return false;
+			struct stat buf;
+			mFileSize = (stat(fullName.c_str(), &buf) == 0) ? (uint64_t)buf.st_size : 0;
+			return true;
+		}
+
+		/* Background thread: open the file again when it could not be after a rotation or a reopen */
+		bool reopenFile() {
+			if (mFile) return true;
+			if (!openFile()) {
+				if (!mReopenFailed) fprintf(stderr, "error while reopening log file '%s/%s': %s\n", mPath.c_str(), mName.c_str(), strerror(errno));
+				mReopenFailed = true;
+				return false;
+			}
+			mReopenFailed = false;
+			if (mLostSize > 0) {
+				int noteSize = fprintf(mFile, "%llu bytes of log records lost: the log file could not be opened" ENDLINE, (unsigned long long)mLostSize);
+				if (noteSize > 0) mFileSize += (uint64_t)noteSize;
+				mLostSize = 0;
+			}
+			return true;
+		}
+
+		/* Background thread: rotation happens here, the log functions never wait for it */
+		void rotate() {
+			fclose(mFile);
+			mFile = nullptr;
+			char *rotatedFile = bctbx_log_files_rotate(mPath.c_str(), mName.c_str());
+			// the new file is opened before calling back, so that records flushed by the callback are not lost
+			reopenFile();
+			BctbxLogFileRotatedFunc rotatedCb;
+			void *rotatedCbUserData;
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				rotatedCb = mRotatedCb;
+				rotatedCbUserData = mRotatedCbUserData;
+			}
+			if (rotatedCb) rotatedCb(rotatedCbUserData, rotatedFile);
+			bctbx_free(rotatedFile);
+		}
+
+		/* Background thread: write the active buffer right away, for a flush requested by the rotation callback */
+		void writeActive() {
+			std::vector<char> buffer;
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				buffer.assign(mActive.begin(), mActive.begin() + mActiveSize);
+				mActiveSize = 0;
+			}
+			if (buffer.empty()) return;
+			if (!reopenFile()) {
+				mLostSize += buffer.size();
+				return;
+			}
+			mFileSize += fwrite(buffer.data(), 1, buffer.size(), mFile);
+			fflush(mFile); // no rotation check: we are already rotating
+		}
+
+		void write(const std::vector<char> &buffer, size_t size) {
+			if (size == 0) return;
+			if (!reopenFile()) {
+				mLostSize += size;
+				return;
+			}
+			size_t written = fwrite(buffer.data(), 1, size, mFile);
+			fflush(mFile);
+			mFileSize += written;
+			if (mMaxSize > 0 && mFileSize > mMaxSize) rotate();
+		}
+
+		void writerLoop() {
+			std::unique_lock<std::mutex> lock(mMutex);
+			for (;;) {
+				mWakeUp.wait_for(lock, mFlushInterval, [this]{
+					return mStop || mReopenRequested || mFlushRequests != mFlushedRequests || mActiveSize >= writeSize();
+				});
+				std::swap(mActive, mWriting);
+				size_t size = mActiveSize;
+				mActiveSize = 0;
+				uint64_t flushRequests = mFlushRequests;
+				bool reopen = mReopenRequested;
+				mReopenRequested = false;
+				bool stop = mStop;
+				lock.unlock();
+
+				write(mWriting, size);
+				if (reopen) {
+					if (mFile) fclose(mFile);
+					mFile = nullptr;
+					reopenFile();
+				}
+
+				lock.lock();
+				mFlushedRequests = flushRequests;
+				mWritten.notify_all(); // flushing threads, and logging threads waiting for room
+				if (stop && mActiveSize == 0) return;
+			}
+		}
+
+		/* Called with the lock held: the buffered size triggering a write */
+		size_t writeSize() const {
+			return std::min(mFlushSize, mMaxActiveSize);
+		}
+
+		/* Called with the lock held: make room for at least size more bytes */
+		void reserve(size_t size) {
+			if (mActive.size() - mActiveSize < size) mActive.resize(std::max(mActive.size() * 2, mActiveSize + size));
+		}
+
+		/* Called with the lock held: append a record to the active buffer */
+		void append(const struct timeval &tp, const char *domain, BctbxLogLevel level, const char *fmt, va_list args) {
+			time_t tt = (time_t)tp.tv_sec;
+			if (tt != mTimestampSecond) {
+				struct tm *lt;
+#ifdef _WIN32
+				lt = localtime(&tt);
+#else
+				struct tm tmbuf;
+				lt = localtime_r(&tt, &tmbuf);
+#endif
+				snprintf(mTimestamp, sizeof(mTimestamp), "%i-%.2i-%.2i %.2i:%.2i:%.2i",
+					1900 + lt->tm_year, 1 + lt->tm_mon, lt->tm_mday, lt->tm_hour, lt->tm_min, lt->tm_sec);
+				mTimestampSecond = tt;
+			}
+			reserve(256);
+			int headerSize = snprintf(&mActive[mActiveSize], mActive.size() - mActiveSize, "%s:%.3i %s-%s-",
+				mTimestamp, (int)(tp.tv_usec / 1000), domain ? domain : "bctoolbox", levelName(level));
+			if (headerSize > 0 && (size_t)headerSize >= mActive.size() - mActiveSize) { // unusually long domain
+				reserve((size_t)headerSize + 1);
+				snprintf(&mActive[mActiveSize], mActive.size() - mActiveSize, "%s:%.3i %s-%s-",
+					mTimestamp, (int)(tp.tv_usec / 1000), domain ? domain : "bctoolbox", levelName(level));
+			}
+			if (headerSize > 0) mActiveSize += (size_t)headerSize;
+
+			va_list copy;
+			va_copy(copy, args);
+			int msgSize = vsnprintf(&mActive[mActiveSize], mActive.size() - mActiveSize, fmt, copy);
+			va_end(copy);
+			if (msgSize < 0) msgSize = 0;
+			if ((size_t)msgSize + sizeof(ENDLINE) > mActive.size() - mActiveSize) {
+				reserve((size_t)msgSize + sizeof(ENDLINE));
+				va_copy(copy, args);
+				vsnprintf(&mActive[mActiveSize], mActive.size() - mActiveSize, fmt, copy);
+				va_end(copy);
+			}
+			mActiveSize += (size_t)msgSize;
+			memcpy(&mActive[mActiveSize], ENDLINE, sizeof(ENDLINE) - 1);
+			mActiveSize += sizeof(ENDLINE) - 1;
+		}
+
+		void appendf(const struct timeval &tp, const char *domain, BctbxLogLevel level, const char *fmt, ...) {
+			va_list args;
+			va_start(args, fmt);
+			append(tp, domain, level, fmt, args);
+			va_end(args);
+		}
+
+	public:
+		BufferedFileLogHandler(uint64_t maxSize, const char *path, const char *name, size_t flushSize, unsigned int flushIntervalMs)
+			: mPath(path), mName(name), mMaxSize(maxSize), mFlushSize(flushSize > 0 ? flushSize : 1), mFlushInterval(flushIntervalMs),
+			mFile(nullptr), mFileSize(0), mLostSize(0), mReopenFailed(false), mActive(mFlushSize * 2), mActiveSize(0),
+			mMaxActiveSize(std::max(mFlushSize * 16, (size_t)1 << 20)), mPolicy(BCTBX_LOG_ASYNC_BLOCK), mDropped(0), mWriting(mFlushSize * 2), mTimestampSecond(0),
+			mFlushRequests(0), mFlushedRequests(0), mReopenRequested(false), mStop(false), mRotatedCb(nullptr), mRotatedCbUserData(nullptr) {
+			if (!openFile()) throw std::system_error(errno, std::generic_category(), "cannot open log file");
+			// an existing file already over the limit is rotated right away, as the file log handler does
+			if (mMaxSize > 0 && mFileSize > mMaxSize) rotate();
+			try {
+				// the writer starts by taking the lock: it cannot compare its id to mWriter before it is assigned
+				std::lock_guard<std::mutex> lock(mMutex);
+				mWriter = std::thread(&BufferedFileLogHandler::writerLoop, this);
+			} catch (const std::system_error &) {
+				if (mFile) fclose(mFile);
+				throw;
+			}
+		}
+		~BufferedFileLogHandler() {
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mStop = true;
+			}
+			mWakeUp.notify_one();
+			mWriter.join();
+			if (mFile) fclose(mFile);
+		}
+		BufferedFileLogHandler(const BufferedFileLogHandler &) = delete;
+		BufferedFileLogHandler &operator=(const BufferedFileLogHandler &) = delete;
+
+		void log(const char *domain, BctbxLogLevel level, const char *fmt, va_list args) {
+			struct timeval tp;
+			bctbx_gettimeofday(&tp, NULL);
+			bool wakeUp;
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				// the background thread logging from the rotation callback writes the active buffer right after
+				if (mActiveSize >= mMaxActiveSize && std::this_thread::get_id() != mWriter.get_id()) {
+					if (mPolicy == BCTBX_LOG_ASYNC_DROP && level != BCTBX_LOG_FATAL) {
+						mDropped++;
+						return; // the background thread is already woken up by the record that filled the buffer
+					}
+					mWritten.wait(lock, [this]{return mActiveSize < mMaxActiveSize || mStop;});
+				}
+				if (mDropped > 0) {
+					appendf(tp, BCTBX_LOG_DOMAIN, BCTBX_LOG_WARNING, "Buffered file log handler full: %llu log records dropped",
+						(unsigned long long)mDropped);
+					mDropped = 0;
+				}
+				append(tp, domain, level, fmt, args);
+				wakeUp = (mActiveSize >= writeSize());
+			}
+			if (level == BCTBX_LOG_FATAL) {
+				flush(); // the process aborts right after
+			} else if (wakeUp) {
+				mWakeUp.notify_one();
+			}
+		}
+
+		void flush() {
+			// the rotation callback logging at fatal level would wait for itself
+			if (std::this_thread::get_id() == mWriter.get_id()) {
+				writeActive();
+				return;
+			}
+			std::unique_lock<std::mutex> lock(mMutex);
+			uint64_t request = ++mFlushRequests;
+			mWakeUp.notify_one();
+			mWritten.wait(lock, [this, request]{return mFlushedRequests >= request;});
+		}
+
+		void requestReopen() {
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mReopenRequested = true;
+			}
+			mWakeUp.notify_one();
+		}
+
+		void setOverflowPolicy(size_t maxBufferedSize, BctbxLogAsyncOverflowPolicy policy) {
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mMaxActiveSize = maxBufferedSize > 0 ? maxBufferedSize : 1;
+				mPolicy = policy;
+			}
+			mWritten.notify_all(); // the waiting threads may fit in the new size
+		}
+
+		void setRotatedCallback(BctbxLogFileRotatedFunc func, void *userData) {
+			std::lock_guard<std::mutex> lock(mMutex);
+			mRotatedCb = func;
+			mRotatedCbUserData = userData;
+		}
+};
+
+void bctbx_buffered_file_log_handler_destroy(bctbx_log_handler_t *handler) {
+	delete static_cast<BufferedFileLogHandler *>(bctbx_log_handler_get_user_data(handler));
+	bctbx_log_handler_set_domain(handler, NULL);
+	bctbx_free(handler);
+}
+} // anonymous namespace
+
+extern "C" void bctbx_logv_buffered_file(void *user_info, const char *domain, BctbxLogLevel level, const char *fmt, va_list args) {
+	static_cast<BufferedFileLogHandler *>(user_info)->log(domain, level, fmt, args);
+}
+
+extern "C" void bctbx_buffered_file_log_handler_request_reopen(void *user_info) {
+	static_cast<BufferedFileLogHandler *>(user_info)->requestReopen();
+}
+
+extern "C" bctbx_log_handler_t *bctbx_create_buffered_file_log_handler(uint64_t max_size, const char *path, const char *name, size_t flush_size, unsigned int flush_interval_ms) {
+	BufferedFileLogHandler *bufferedHandler;
+	try {
+		bufferedHandler = new BufferedFileLogHandler(max_size, path, name, flush_size, flush_interval_ms);
+	} catch (const std::system_error &e) {
+		fprintf(stderr, "error while creating buffered file log handler '%s/%s': %s\n", path, name, e.what());
+		return NULL;
+	}
+	return bctbx_create_log_handler(bctbx_logv_buffered_file, bctbx_buffered_file_log_handler_destroy, bufferedHandler);
+}
+
+extern "C" void bctbx_buffered_file_log_handler_set_rotated_callback(bctbx_log_handler_t *buffered_file_log_handler, BctbxLogFileRotatedFunc func, void *user_data) {
+	static_cast<BufferedFileLogHandler *>(bctbx_log_handler_get_user_data(buffered_file_log_handler))->setRotatedCallback(func, user_data);
+}
+
+extern "C" void bctbx_buffered_file_log_handler_set_overflow_policy(bctbx_log_handler_t *buffered_file_log_handler, size_t max_buffered_size, BctbxLogAsyncOverflowPolicy policy) {
+	static_cast<BufferedFileLogHandler *>(bctbx_log_handler_get_user_data(buffered_file_log_handler))->setOverflowPolicy(max_buffered_size, policy);
+}
+
+extern "C" void bctbx_buffered_file_log_handler_flush(bctbx_log_handler_t *buffered_file_log_handler) {
+	static_cast<BufferedFileLogHandler *>(bctbx_log_handler_get_user_data(buffered_file_log_handler))->flush();
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2016-2020 Belledonne Communications SARL.
+ *
+ * This file is part of bctoolbox.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BCTBX_LOGGING_BUFFERED_FILE_H
+#define BCTBX_LOGGING_BUFFERED_FILE_H
+
+#include "bctoolbox/logging.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Log function of the buffered file log handlers.
+ * Implemented in logging_buffered_file.cc
+ */
+void bctbx_logv_buffered_file(void *user_info, const char *domain, BctbxLogLevel level, const char *fmt, va_list args);
+
+/**
+ * Ask the background thread of a buffered file log handler to reopen its file.
+ * Implemented in logging_buffered_file.cc
+ */
+void bctbx_buffered_file_log_handler_request_reopen(void *user_info);
+
+/**
+ * Rotate the log files path/name, path/name_1 ... to path/name_1, path/name_2 ...
+ * Implemented in logging.c
+ *
+ * @return the path of the file previously named path/name, to be freed with bctbx_free()
+ */
+char *bctbx_log_files_rotate(const char *path, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BCTBX_LOGGING_BUFFERED_FILE_H */
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2016-2020 Belledonne Communications SARL.
+ *
+ * This file is part of bctoolbox.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "bctoolbox/logging.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <string>
+
+using namespace bctoolbox::log;
+
+namespace bctoolbox {
+	namespace log {
+		/* A storage of a thread, lent to one stream buffer at a time */
+		struct StreamStorage {
+			std::string text;
+			bool inUse = false;
+		};
+	}
+}
+
+namespace {
+constexpr size_t initialStorageSize = 256;
+constexpr size_t maxKeptStorageSize = 64 * 1024; // a storage grown beyond is released at the end of the log statement
+
+/* Storages of the calling thread, one per nesting level of the log statements */
+thread_local std::deque<StreamStorage> threadStorages; // growing a deque does not move the storages in use
+} // anonymous namespace
+
+StreamBuffer::StreamBuffer(bool enabled) : mStorage(nullptr) {
+	if (!enabled) return;
+	// the buffers in use are not necessarily the first ones: each buffer releases its own storage whatever the order
+	for (StreamStorage &storage : threadStorages) {
+		if (!storage.inUse) {
+			mStorage = &storage;
+			break;
+		}
+	}
+	if (mStorage == nullptr) {
+		threadStorages.emplace_back();
+		mStorage = &threadStorages.back();
+	}
+	mStorage->inUse = true;
+	if (mStorage->text.size() < initialStorageSize) mStorage->text.resize(initialStorageSize);
+	char *base = &mStorage->text[0];
+	setp(base, base + mStorage->text.size() - 1); // keep room for the terminating null character
+}
+
+StreamBuffer::~StreamBuffer() {
+	if (mStorage == nullptr) return;
+	if (mStorage->text.size() > maxKeptStorageSize) std::string().swap(mStorage->text);
+	mStorage->inUse = false;
+}
+
+void StreamBuffer::grow(size_t count) {
+	size_t used = (size_t)(pptr() - pbase());
+	mStorage->text.resize(std::max(mStorage->text.size() * 2, used + count + 1));
+	char *base = &mStorage->text[0];
+	setp(base, base + mStorage->text.size() - 1);
+	pbump((int)used);
+}
+
+StreamBuffer::int_type StreamBuffer::overflow(int_type ch) {
+	if (mStorage == nullptr) return traits_type::eof();
+	if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+	grow(1);
+	*pptr() = traits_type::to_char_type(ch);
+	pbump(1);
+	return ch;
+}
+
+std::streamsize StreamBuffer::xsputn(const char *s, std::streamsize count) {
+	if (mStorage == nullptr || count <= 0) return 0;
+	if (epptr() - pptr() < count) grow((size_t)count);
+	memcpy(pptr(), s, (size_t)count);
+	pbump((int)count);
+	return count;
+}
+
+const char *StreamBuffer::c_str() {
+	if (mStorage == nullptr) return "";
+	*pptr() = '\0';
+	return pbase();
+}
+
+std::string StreamBuffer::str() const {
+	if (mStorage == nullptr) return std::string();
+	return std::string(pbase(), pptr());
+}
+
+void StreamBuffer::str(const std::string &text) {
+	if (mStorage == nullptr) return;
+	setp(pbase(), epptr());
+	xsputn(text.data(), (std::streamsize)text.size());
+}
@@ -33,6 +33,134 @@
 /* Pointer to default VFS initialized to standard VFS implemented here.*/
 static bctbx_vfs_t *pDefaultVfs = &bcStandardVfs; /* bcStandardVfs is defined int vfs_standard.h*/
 
+#define BCTBX_VFS_DEFAULT_BLOCK_SIZE 4096 /* read-ahead unit of bctbx_file_get_nxtline when the vfs does not give one */
+#define BCTBX_VFS_LINE_READ_AHEAD 16384 /* bctbx_file_get_nxtline reads at least this many bytes ahead of the line */
+
+/* Read-ahead buffer of the generic bctbx_file_get_nxtline */
+struct bctbx_vfs_line_buffer_t {
+	char *data;
+	size_t size;                    /* allocated size of data */
+	size_t len;                     /* number of valid bytes in data */
+	off_t offset;                   /* file offset of data[0] */
+};
+
+/* Write buffer of bctbx_file_fprintf, see bctbx_file_set_write_buffer */
+struct bctbx_vfs_write_buffer_t {
+	char *data;                     /* NULL when the buffered mode is disabled */
+	size_t size;                    /* allocated size of data, a multiple of the file block size */
+	size_t len;                     /* number of pending bytes in data */
+	off_t offset;                   /* file offset of data[0] */
+	char *format;                   /* reusable buffer for the formatted string */
+	size_t formatSize;              /* allocated size of format */
+};
+
+/*
+ * File handle allocated by bctbx_file_open: the public bctbx_vfs_file_t followed by the state of the default implementation,
+ * kept out of the public structure so its layout does not change.
+ */
+typedef struct bctbx_vfs_file_private_t bctbx_vfs_file_private_t;
+struct bctbx_vfs_file_private_t {
+	bctbx_vfs_file_t file;          /* must be first: the handle given to the user */
+	const bctbx_io_methods_ext_t *ext; /* optional methods of the vfs, looked up at open */
+	size_t blockSize;               /* read-ahead unit of the generic bctbx_file_get_nxtline */
+	bctbx_mutex_t lock;             /* the handle may be used from several threads (asynchronous I/O): protect the buffers */
+	struct bctbx_vfs_line_buffer_t lineBuffer;
+	struct bctbx_vfs_write_buffer_t writeBuffer;
+};
+
+static bctbx_vfs_file_private_t *bctbx_file_private(bctbx_vfs_file_t *pFile) {
+	return (bctbx_vfs_file_private_t *)pFile;
+}
+
+/* Zero a buffer holding file content before freeing it: it may be the plain content of an encrypted file */
+static void bctbx_file_buffer_clean(void *data, size_t size) {
+	volatile uint8_t *p = (volatile uint8_t *)data;
+	while (size-- > 0) *p++ = 0;
+}
+
+/* Forget the read-ahead content, the file was modified through this handle. Must be called with the lock held */
+static void bctbx_file_line_buffer_reset(bctbx_vfs_file_t *pFile) {
+	bctbx_file_private(pFile)->lineBuffer.len = 0;
+}
+
+/* Write the pending bytes of the write buffer, they are dropped even if the write fails. Must be called with the lock held */
+static int bctbx_file_write_buffer_flush(bctbx_vfs_file_t *pFile) {
+	struct bctbx_vfs_write_buffer_t *buffer = &bctbx_file_private(pFile)->writeBuffer;
+	ssize_t ret;
+	size_t len;
+
+	if (buffer->len == 0) return BCTBX_VFS_OK;
+
+	len = buffer->len;
+	buffer->len = 0;
+	bctbx_file_line_buffer_reset(pFile);
+	ret = pFile->pMethods->pFuncWrite(pFile, buffer->data, len, buffer->offset);
+	if (ret < 0 || (size_t)ret != len) {
+		bctbx_error("bctbx_file_flush: Error writing %lu bytes at offset %lld, write returned %ld", (unsigned long)len, (long long)buffer->offset, (long)ret);
+		return BCTBX_VFS_ERROR;
+	}
+	return BCTBX_VFS_OK;
+}
+
+/* Append count bytes written at offset to the write buffer, flushing it when it is full or the bytes do not follow the pending ones.
+ * Must be called with the lock held */
+static int bctbx_file_write_buffer_append(bctbx_vfs_file_t *pFile, const char *buf, size_t count, off_t offset) {
+	struct bctbx_vfs_write_buffer_t *buffer = &bctbx_file_private(pFile)->writeBuffer;
+	const size_t blockSize = bctbx_file_private(pFile)->blockSize;
+
+	if (buffer->len > 0 && buffer->offset + (off_t)buffer->len != offset) {
+		if (bctbx_file_write_buffer_flush(pFile) != BCTBX_VFS_OK) return BCTBX_VFS_ERROR;
+	}
+	while (count > 0) {
+		/* when the buffer does not start on a block boundary, flush it at the first one so the next writes cover whole blocks */
+		size_t capacity;
+		size_t n;
+		if (buffer->len == 0) buffer->offset = offset;
+		capacity = buffer->size - (size_t)((uint64_t)buffer->offset % blockSize);
+		n = capacity - buffer->len;
+		if (n > count) n = count;
+		memcpy(buffer->data + buffer->len, buf, n);
+		buffer->len += n;
+		buf += n;
+		offset += (off_t)n;
+		count -= n;
+		if (buffer->len == capacity) {
+			if (bctbx_file_write_buffer_flush(pFile) != BCTBX_VFS_OK) return BCTBX_VFS_ERROR;
+		}
+	}
+	return BCTBX_VFS_OK;
+}
+
+/* Zero and free the write buffer, disabling the buffered mode. Must be called with the lock held */
+static void bctbx_file_write_buffer_free(bctbx_vfs_file_t *pFile) {
+	struct bctbx_vfs_write_buffer_t *buffer = &bctbx_file_private(pFile)->writeBuffer;
+	if (buffer->data) {
+		bctbx_file_buffer_clean(buffer->data, buffer->size);
+		bctbx_free(buffer->data);
+	}
+	if (buffer->format) {
+		bctbx_file_buffer_clean(buffer->format, buffer->formatSize);
+		bctbx_free(buffer->format);
+	}
+	memset(buffer, 0, sizeof(struct bctbx_vfs_write_buffer_t));
+}
+
+/* Write the pending buffered writes before an access through the vfs methods */
+static int bctbx_file_pending_flush(bctbx_vfs_file_t *pFile) {
+	int ret;
+	bctbx_mutex_lock(&bctbx_file_private(pFile)->lock);
+	ret = bctbx_file_write_buffer_flush(pFile);
+	bctbx_mutex_unlock(&bctbx_file_private(pFile)->lock);
+	return ret;
+}
+
+/* The file was modified through the vfs methods, forget the read-ahead content */
+static void bctbx_file_modified(bctbx_vfs_file_t *pFile) {
+	bctbx_mutex_lock(&bctbx_file_private(pFile)->lock);
+	bctbx_file_line_buffer_reset(pFile);
+	bctbx_mutex_unlock(&bctbx_file_private(pFile)->lock);
+}
+
 /**
  * Create flags (int) from mode(char*).
  * @param mode Can be r, r+, w+, w
@@ -54,7 +182,9 @@ ssize_t bctbx_file_write(bctbx_vfs_file_t* pFile, const void *buf, size_t count,
 	ssize_t ret;
 
 	if (pFile != NULL) {
+		if (bctbx_file_pending_flush(pFile) != BCTBX_VFS_OK) return BCTBX_VFS_ERROR;
 		ret = pFile->pMethods->pFuncWrite(pFile, buf, count, offset);
+		bctbx_file_modified(pFile);
 		if (ret == BCTBX_VFS_ERROR) {
 			bctbx_error("bctbx_file_write file error");
 			return BCTBX_VFS_ERROR;
@@ -81,37 +211,37 @@ static int file_open(bctbx_vfs_t* pVfs, bctbx_vfs_file_t* pFile, const char *fNa
 	return ret;
 }
 
-bctbx_vfs_file_t* bctbx_file_open(bctbx_vfs_t *pVfs, const char *fName, const char *mode) {
-	int ret;
-	bctbx_vfs_file_t* p_ret = (bctbx_vfs_file_t*)bctbx_malloc(sizeof(bctbx_vfs_file_t));
-	int oflags = set_flags(mode);
-	if (p_ret) {
-		memset(p_ret, 0, sizeof(bctbx_vfs_file_t));
-		ret = file_open(pVfs, p_ret, fName, oflags);
-		if (ret == BCTBX_VFS_OK) return p_ret;
+/* Allocate a handle with the private state of the default implementation and open the file */
+static bctbx_vfs_file_t *file_handle_open(bctbx_vfs_t *pVfs, const char *fName, const int oflags) {
+	bctbx_vfs_file_private_t *p_ret = (bctbx_vfs_file_private_t *)bctbx_malloc0(sizeof(bctbx_vfs_file_private_t));
+	bctbx_vfs_file_t *pFile = &p_ret->file;
+
+	if (file_open(pVfs, pFile, fName, oflags) != BCTBX_VFS_OK) {
+		bctbx_free(p_ret);
+		return NULL;
 	}
+	p_ret->ext = bctbx_io_methods_get_ext(pFile->pMethods);
+	p_ret->blockSize = BCTBX_VFS_DEFAULT_BLOCK_SIZE;
+	if (BCTBX_IO_METHODS_EXT_HAS(p_ret->ext, pFuncGetBlockSize)) {
+		size_t blockSize = p_ret->ext->pFuncGetBlockSize(pFile);
+		if (blockSize > 0) p_ret->blockSize = blockSize;
+	}
+	bctbx_mutex_init(&p_ret->lock, NULL);
+	return pFile;
+}
 
-	if (p_ret) bctbx_free(p_ret);
-	return NULL;
+bctbx_vfs_file_t* bctbx_file_open(bctbx_vfs_t *pVfs, const char *fName, const char *mode) {
+	return file_handle_open(pVfs, fName, set_flags(mode));
 }
 
 bctbx_vfs_file_t* bctbx_file_open2(bctbx_vfs_t *pVfs, const char *fName, const int openFlags) {
-	int ret;
-	bctbx_vfs_file_t *p_ret = (bctbx_vfs_file_t *)bctbx_malloc(sizeof(bctbx_vfs_file_t));
-
-	if (p_ret) {
-		memset(p_ret, 0, sizeof(bctbx_vfs_file_t));
-		ret = file_open(pVfs, p_ret, fName, openFlags);
-		if (ret == BCTBX_VFS_OK) return p_ret;
-	}
-
-	if (p_ret) bctbx_free(p_ret);
-	return NULL;
+	return file_handle_open(pVfs, fName, openFlags);
 }
 
 ssize_t bctbx_file_read(bctbx_vfs_file_t *pFile, void *buf, size_t count, off_t offset) {
 	int ret = BCTBX_VFS_ERROR;
 	if (pFile) {
+		if (bctbx_file_pending_flush(pFile) != BCTBX_VFS_OK) return BCTBX_VFS_ERROR;
 		ret = pFile->pMethods->pFuncRead(pFile, buf, count, offset);
 		/*check if error : in this case pErrSvd is initialized*/
 		if (ret == BCTBX_VFS_ERROR) {
@@ -125,13 +255,91 @@ ssize_t bctbx_file_read(bctbx_vfs_file_t *pFile, void *buf, size_t count, off_t
 	return ret;
 }
 
+/* generic implementation of readv: one read per buffer, stop at end of file */
+static ssize_t bctbx_generic_readv(bctbx_vfs_file_t *pFile, const bctbx_iovec_t *iov, int iovcnt, off_t offset) {
+	ssize_t total = 0;
+	int i;
+	for (i = 0; i < iovcnt; i++) {
+		ssize_t ret = pFile->pMethods->pFuncRead(pFile, iov[i].base, iov[i].len, offset + total);
+		if (ret < 0) return ret;
+		total += ret;
+		if ((size_t)ret < iov[i].len) break; /* end of file */
+	}
+	return total;
+}
+
+ssize_t bctbx_file_readv(bctbx_vfs_file_t *pFile, const bctbx_iovec_t *iov, int iovcnt, off_t offset) {
+	ssize_t ret = BCTBX_VFS_ERROR;
+	if (pFile && (iov != NULL || iovcnt == 0) && iovcnt >= 0) {
+		const bctbx_io_methods_ext_t *ext = bctbx_file_private(pFile)->ext;
+		if (bctbx_file_pending_flush(pFile) != BCTBX_VFS_OK) return BCTBX_VFS_ERROR;
+		if (BCTBX_IO_METHODS_EXT_HAS(ext, pFuncReadv)) {
+			ret = ext->pFuncReadv(pFile, iov, iovcnt, offset);
+		} else {
+			ret = bctbx_generic_readv(pFile, iov, iovcnt, offset);
+		}
+		if (ret == BCTBX_VFS_ERROR) {
+			bctbx_error("bctbx_file_readv: error bctbx_vfs_file_t");
+		} else if (ret < 0) {
+			bctbx_error("bctbx_file_readv: Error read %s", strerror(-(ret)));
+			ret = BCTBX_VFS_ERROR;
+		}
+	}
+	return ret;
+}
+
+/* generic implementation of writev: one write per buffer */
+static ssize_t bctbx_generic_writev(bctbx_vfs_file_t *pFile, const bctbx_iovec_t *iov, int iovcnt, off_t offset) {
+	ssize_t total = 0;
+	int i;
+	for (i = 0; i < iovcnt; i++) {
+		ssize_t ret = pFile->pMethods->pFuncWrite(pFile, iov[i].base, iov[i].len, offset + total);
+		if (ret < 0) return ret;
+		total += ret;
+		if ((size_t)ret < iov[i].len) break; /* partial write */
+	}
+	return total;
+}
+
+ssize_t bctbx_file_writev(bctbx_vfs_file_t *pFile, const bctbx_iovec_t *iov, int iovcnt, off_t offset) {
+	ssize_t ret = BCTBX_VFS_ERROR;
+	if (pFile && (iov != NULL || iovcnt == 0) && iovcnt >= 0) {
+		const bctbx_io_methods_ext_t *ext = bctbx_file_private(pFile)->ext;
+		if (bctbx_file_pending_flush(pFile) != BCTBX_VFS_OK) return BCTBX_VFS_ERROR;
+		if (BCTBX_IO_METHODS_EXT_HAS(ext, pFuncWritev)) {
+			ret = ext->pFuncWritev(pFile, iov, iovcnt, offset);
+		} else {
+			ret = bctbx_generic_writev(pFile, iov, iovcnt, offset);
+		}
+		bctbx_file_modified(pFile);
+		if (ret == BCTBX_VFS_ERROR) {
+			bctbx_error("bctbx_file_writev file error");
+		} else if (ret < 0) {
+			bctbx_error("bctbx_file_writev error %s", strerror(-(ret)));
+			ret = BCTBX_VFS_ERROR;
+		}
+	}
+	return ret;
+}
+
 int bctbx_file_close(bctbx_vfs_file_t *pFile) {
 	int ret = BCTBX_VFS_ERROR;
 	if (pFile) {
+		struct bctbx_vfs_line_buffer_t *lineBuffer = &bctbx_file_private(pFile)->lineBuffer;
+		/* pending buffered writes are lost if the flush fails, the file is closed anyway */
+		bctbx_mutex_lock(&bctbx_file_private(pFile)->lock);
+		bctbx_file_write_buffer_flush(pFile);
+		bctbx_file_write_buffer_free(pFile);
+		bctbx_mutex_unlock(&bctbx_file_private(pFile)->lock);
 		ret = pFile->pMethods->pFuncClose(pFile);
 		if (ret != 0) {
 			bctbx_error("bctbx_file_close: Error %s freeing file handle anyway", strerror(-(ret)));
 		}
+		if (lineBuffer->data) {
+			bctbx_file_buffer_clean(lineBuffer->data, lineBuffer->size);
+			bctbx_free(lineBuffer->data);
+		}
+		bctbx_mutex_destroy(&bctbx_file_private(pFile)->lock);
 	}
 	bctbx_free(pFile);
 	return ret;
@@ -140,6 +348,7 @@ int bctbx_file_close(bctbx_vfs_file_t *pFile) {
 int bctbx_file_sync(bctbx_vfs_file_t *pFile) {
 	int ret = BCTBX_VFS_ERROR;
 	if (pFile) {
+		if (bctbx_file_pending_flush(pFile) != BCTBX_VFS_OK) return BCTBX_VFS_ERROR;
 		ret = pFile->pMethods->pFuncSync(pFile);
 		if (ret != BCTBX_VFS_OK) {
 			bctbx_error("bctbx_file_sync: Error %s ", strerror(-(ret)));
@@ -152,6 +361,7 @@ int bctbx_file_sync(bctbx_vfs_file_t *pFile) {
 int64_t bctbx_file_size(bctbx_vfs_file_t *pFile) {
 	int64_t ret = BCTBX_VFS_ERROR;
 	if (pFile){
+		if (bctbx_file_pending_flush(pFile) != BCTBX_VFS_OK) return BCTBX_VFS_ERROR;
 		ret = pFile->pMethods->pFuncFileSize(pFile);
 		if (ret < 0) bctbx_error("bctbx_file_size: Error file size %s", strerror((int)-(ret)));
 	} 
@@ -162,19 +372,92 @@ int64_t bctbx_file_size(bctbx_vfs_file_t *pFile) {
 int bctbx_file_truncate(bctbx_vfs_file_t *pFile, int64_t size) {
 	int ret = BCTBX_VFS_ERROR;
 	if (pFile){
+		if (bctbx_file_pending_flush(pFile) != BCTBX_VFS_OK) return BCTBX_VFS_ERROR;
 		ret = pFile->pMethods->pFuncTruncate(pFile, size);
+		bctbx_file_modified(pFile);
 		if (ret < 0) bctbx_error("bctbx_file_truncate: Error truncate  %s", strerror((int)-(ret)));
 	} 
 	return ret;
 }
 
+int bctbx_file_set_write_buffer(bctbx_vfs_file_t *pFile, size_t size) {
+	struct bctbx_vfs_write_buffer_t *buffer;
+	size_t blockSize;
+	int ret = BCTBX_VFS_OK;
+
+	if (pFile == NULL) return BCTBX_VFS_ERROR;
+	buffer = &bctbx_file_private(pFile)->writeBuffer;
+	blockSize = bctbx_file_private(pFile)->blockSize;
+	size = ((size + blockSize - 1) / blockSize) * blockSize;
+
+	bctbx_mutex_lock(&bctbx_file_private(pFile)->lock);
+	if (buffer->size != size) {
+		ret = bctbx_file_write_buffer_flush(pFile);
+		if (size == 0) {
+			bctbx_file_write_buffer_free(pFile);
+		} else if (ret == BCTBX_VFS_OK) {
+			if (buffer->data) {
+				bctbx_file_buffer_clean(buffer->data, buffer->size);
+				bctbx_free(buffer->data);
+			}
+			buffer->data = (char *)bctbx_malloc(size);
+			buffer->size = size;
+		}
+	}
+	bctbx_mutex_unlock(&bctbx_file_private(pFile)->lock);
+	return ret;
+}
+
+int bctbx_file_flush(bctbx_vfs_file_t *pFile) {
+	if (pFile == NULL) return BCTBX_VFS_ERROR;
+	return bctbx_file_pending_flush(pFile);
+}
+
+/* bctbx_file_fprintf in write buffer mode: format in the reusable buffer and append it to the pending writes.
+ * Must be called with the lock held */
+static ssize_t bctbx_file_buffered_vfprintf(bctbx_vfs_file_t *pFile, const char *fmt, va_list args) {
+	struct bctbx_vfs_write_buffer_t *buffer = &bctbx_file_private(pFile)->writeBuffer;
+	va_list copy;
+	int count;
+
+	va_copy(copy, args);
+	count = vsnprintf(buffer->format, buffer->formatSize, fmt, copy);
+	va_end(copy);
+	if (count < 0) return BCTBX_VFS_ERROR;
+	if ((size_t)count >= buffer->formatSize) {
+		if (buffer->format) {
+			bctbx_file_buffer_clean(buffer->format, buffer->formatSize);
+			bctbx_free(buffer->format);
+		}
+		buffer->formatSize = (size_t)count + 1;
+		buffer->format = (char *)bctbx_malloc(buffer->formatSize);
+		vsnprintf(buffer->format, buffer->formatSize, fmt, args);
+	}
+	if (bctbx_file_write_buffer_append(pFile, buffer->format, (size_t)count, pFile->offset) != BCTBX_VFS_OK) {
+		return BCTBX_VFS_ERROR;
+	}
+	pFile->offset += count;
+	return count;
+}
+
 ssize_t bctbx_file_fprintf(bctbx_vfs_file_t *pFile, off_t offset, const char *fmt, ...) {
 	char *ret = NULL;
 	va_list args;
 	ssize_t r = BCTBX_VFS_ERROR;
 	size_t count = 0;
 
+	if (pFile == NULL) return BCTBX_VFS_ERROR;
+
 	va_start(args, fmt);
+	bctbx_mutex_lock(&bctbx_file_private(pFile)->lock);
+	if (bctbx_file_private(pFile)->writeBuffer.data != NULL) {
+		if (offset != 0) pFile->offset = offset;
+		r = bctbx_file_buffered_vfprintf(pFile, fmt, args);
+		bctbx_mutex_unlock(&bctbx_file_private(pFile)->lock);
+		va_end(args);
+		return r;
+	}
+	bctbx_mutex_unlock(&bctbx_file_private(pFile)->lock);
 	ret = bctbx_strdup_vprintf(fmt, args);
 	if (ret != NULL) {
 		va_end(args);
@@ -222,57 +505,102 @@ off_t bctbx_file_seek(bctbx_vfs_file_t *pFile, off_t offset, int whence) {
 /**
  * Gets a line of max_len length and stores it to the allocaed buffer s.
  * Reads at most max_len characters from the file descriptor associated with the argument pFile
- * and looks for an end of line character (\r or \n). Stores the line found
+ * and looks for an end of line character (\r, \n or \r\n). Stores the line found
  * into the buffer pointed by s.
  * Modifies the open file offset using pFile->offset.
+ * The file is read ahead by blocks in a buffer attached to pFile, so iterating over the lines reads it once.
+ * The read-ahead buffer is private to the handle, shared by the threads using it under its lock.
  *
  * @param  pFile   File handle pointer.
  * @param  s       Buffer where to store the line.
  * @param  max_len Maximum number of characters to read in one fetch.
  * @return         size of line read, 0 if empty
  */
+/* true when the available bytes hold a line terminator, and the byte after a \r to tell a \r\n */
+static int bctbx_line_complete(const char *start, size_t available) {
+	size_t i;
+	for (i = 0; i < available; i++) {
+		if (start[i] == '\n') return TRUE;
+		if (start[i] == '\r') return i + 1 < available;
+	}
+	return FALSE;
+}
+
 static int bctbx_generic_get_nxtline(bctbx_vfs_file_t *pFile, char *s, int max_len) {
-	int64_t ret;
-	int sizeofline;
-	char *pNextLine = NULL;
-	char *pNextLineR = NULL;
-	char *pNextLineN = NULL;
+	struct bctbx_vfs_line_buffer_t *buffer;
+	size_t window;
+	size_t available = 0;
+	size_t i;
+	int inBuffer;
+	int sizeofline = 0;
+	const char *start;
 
 	if (!pFile) {
 		return BCTBX_VFS_ERROR;
 	}
-	if (s == NULL || max_len < 1) {
+	if (s == NULL || max_len < 1 || pFile->offset < 0) {
 		return BCTBX_VFS_ERROR;
 	}
 
-	sizeofline = 0;
-	s[max_len-1] = '\0';
-
-	/* Read returns 0 if end of file is found */
-	ret = bctbx_file_read(pFile, s, max_len - 1, pFile->offset);
-	if (ret > 0) {
-		pNextLineR = strchr(s, '\r');
-		pNextLineN = strchr(s, '\n');
-		if ((pNextLineR != NULL) && (pNextLineN != NULL)) pNextLine = MIN(pNextLineR, pNextLineN);
-		else if (pNextLineR != NULL) pNextLine = pNextLineR;
-		else if (pNextLineN != NULL) pNextLine = pNextLineN;
-		if (pNextLine) {
-			/* Got a line! */
-			*pNextLine = '\0';
-			sizeofline = (int)(pNextLine - s + 1);
-			if (pNextLine[1] == '\n') sizeofline += 1; /*take into account the \r\n" case*/
-
-			/* offset to next beginning of line*/
-			pFile->offset += sizeofline;
-		} else {
-			/*did not find end of line char, is EOF?*/
-			sizeofline = (int)ret;
-			pFile->offset += sizeofline;
-			s[ret] = '\0';
-		}
-	} else if (ret < 0) {
+	s[0] = '\0';
+	window = (size_t)max_len - 1;
+	buffer = &bctbx_file_private(pFile)->lineBuffer;
+
+	bctbx_mutex_lock(&bctbx_file_private(pFile)->lock);
+	if (bctbx_file_write_buffer_flush(pFile) != BCTBX_VFS_OK) {
+		bctbx_mutex_unlock(&bctbx_file_private(pFile)->lock);
 		bctbx_error("bcGetLine error");
+		return 0;
+	}
+	inBuffer = (pFile->offset >= buffer->offset && (size_t)(pFile->offset - buffer->offset) <= buffer->len);
+	if (inBuffer) {
+		available = buffer->len - (size_t)(pFile->offset - buffer->offset);
+	}
+	/* refill unless the buffer holds the window and the byte after it (to spot \r\n), or a complete line:
+	 * a buffer which stopped at a previous end of file may miss data appended since */
+	if (!inBuffer || available == 0
+		|| (available <= window && !bctbx_line_complete(buffer->data + (pFile->offset - buffer->offset), available))) {
+		const size_t blockSize = bctbx_file_private(pFile)->blockSize;
+		/* a block aligned read covering the window and the read ahead */
+		const off_t readOffset = pFile->offset - (off_t)((uint64_t)pFile->offset % blockSize);
+		const size_t needed = (size_t)(pFile->offset - readOffset) + window + 1 + BCTBX_VFS_LINE_READ_AHEAD;
+		const size_t readSize = ((needed + blockSize - 1) / blockSize) * blockSize;
+		ssize_t ret;
+		if (buffer->size < readSize) {
+			if (buffer->data) {
+				bctbx_file_buffer_clean(buffer->data, buffer->size);
+				bctbx_free(buffer->data);
+			}
+			buffer->data = (char *)bctbx_malloc(readSize);
+			buffer->size = readSize;
+		}
+		buffer->len = 0;
+		ret = pFile->pMethods->pFuncRead(pFile, buffer->data, buffer->size, readOffset);
+		if (ret < 0) {
+			bctbx_mutex_unlock(&bctbx_file_private(pFile)->lock);
+			bctbx_error("bcGetLine error");
+			return 0;
+		}
+		buffer->offset = readOffset;
+		buffer->len = (size_t)ret;
+		available = (buffer->len > (size_t)(pFile->offset - readOffset)) ? buffer->len - (size_t)(pFile->offset - readOffset) : 0;
+	}
+	if (available > 0) { /* not at end of file */
+		start = buffer->data + (pFile->offset - buffer->offset);
+		if (available > window) available = window;
+		for (i = 0; i < available && start[i] != '\r' && start[i] != '\n'; i++);
+		memcpy(s, start, i);
+		s[i] = '\0';
+		sizeofline = (int)i;
+		if (i < available) { /* got a line */
+			sizeofline++;
+			/* take into account the \r\n case, the \n may be right after the window */
+			if (start[i] == '\r' && i + 1 < buffer->len - (size_t)(pFile->offset - buffer->offset) && start[i+1] == '\n') sizeofline++;
+		}
+		/* offset to next beginning of line */
+		pFile->offset += sizeofline;
 	}
+	bctbx_mutex_unlock(&bctbx_file_private(pFile)->lock);
 	return sizeofline;
 }
 
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2016-2020 Belledonne Communications SARL.
+ *
+ * This file is part of bctoolbox.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "vfs_async.hh"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace bctoolbox;
+
+namespace {
+constexpr size_t asyncIoThreadCount = 2; // I/O bound: a few threads are enough to keep the disk busy
+
+class AsyncIoQueue;
+thread_local const AsyncIoQueue *sCurrentQueue = nullptr; // set on the queue threads
+
+/**
+ * Threads running the asynchronous reads and writes in submission order
+ * Started at first use, pending requests are completed before they stop at exit
+ */
+class AsyncIoQueue {
+	private:
+		std::vector<std::thread> mThreads;
+		std::deque<std::function<void()>> mRequests; /**< requests waiting for a thread */
+		std::mutex mMutex; /**< protect the requests queue and the stop flag */
+		std::condition_variable mCondition; /**< signal threads when a request is queued or the queue stops */
+		bool mStop;
+
+		void ioLoop() {
+			sCurrentQueue = this;
+			for (;;) {
+				std::function<void()> request;
+				{
+					std::unique_lock<std::mutex> lock(mMutex);
+					mCondition.wait(lock, [this]{return mStop || !mRequests.empty();});
+					if (mRequests.empty()) return; // stopping and nothing left to do
+					request = std::move(mRequests.front());
+					mRequests.pop_front();
+				}
+				request();
+			}
+		}
+
+	public:
+		explicit AsyncIoQueue(size_t threadCount) : mStop(false) {
+			for (size_t i=0; i<threadCount; i++) {
+				mThreads.emplace_back(&AsyncIoQueue::ioLoop, this);
+			}
+		}
+		~AsyncIoQueue() {
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mStop = true;
+			}
+			mCondition.notify_all();
+			for (auto &thread:mThreads) {
+				thread.join();
+			}
+		}
+		AsyncIoQueue(const AsyncIoQueue &) = delete;
+		AsyncIoQueue &operator=(const AsyncIoQueue &) = delete;
+
+		void submit(std::function<void()> request) {
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mRequests.push_back(std::move(request));
+			}
+			mCondition.notify_one();
+		}
+};
+
+/* Queue of the bctbx_file_read_async and bctbx_file_write_async requests */
+AsyncIoQueue &asyncIoQueue() {
+	static AsyncIoQueue queue(asyncIoThreadCount);
+	return queue;
+}
+
+/* Queue of the library internal requests: a synchronous read pipelined by the encrypted vfs must not wait behind user ones */
+AsyncIoQueue &internalIoQueue() {
+	static AsyncIoQueue queue(asyncIoThreadCount);
+	return queue;
+}
+
+/**
+ * A request running on an internal queue thread may wait for the ones it submits: a read on an encrypted file
+ * reads its blocks through fileReadAsync. With every thread doing so, nothing would be left to run
+ * the nested requests, so they run right away on the calling thread instead.
+ */
+std::future<ssize_t> submitAsync(std::function<ssize_t()> io) {
+	if (sCurrentQueue == &internalIoQueue()) {
+		std::packaged_task<ssize_t()> task(std::move(io));
+		auto result = task.get_future();
+		task();
+		return result;
+	}
+	auto task = std::make_shared<std::packaged_task<ssize_t()>>(std::move(io));
+	auto result = task->get_future();
+	internalIoQueue().submit([task]() {(*task)();});
+	return result;
+}
+} // anonymous namespace
+
+std::future<ssize_t> bctoolbox::fileReadAsync(bctbx_vfs_file_t *pFile, void *buf, size_t count, off_t offset) {
+	return submitAsync([pFile, buf, count, offset]() {
+		return bctbx_file_read(pFile, buf, count, offset);
+	});
+}
+
+std::future<ssize_t> bctoolbox::fileWriteAsync(bctbx_vfs_file_t *pFile, const void *buf, size_t count, off_t offset) {
+	return submitAsync([pFile, buf, count, offset]() {
+		return bctbx_file_write(pFile, buf, count, offset);
+	});
+}
+
+extern "C" int bctbx_file_read_async(bctbx_vfs_file_t *pFile, void *buf, size_t count, off_t offset, bctbx_vfs_async_cb_t cb, void *user_data) {
+	if (pFile == NULL || cb == NULL) return BCTBX_VFS_ERROR;
+	asyncIoQueue().submit([pFile, buf, count, offset, cb, user_data]() {
+		cb(user_data, bctbx_file_read(pFile, buf, count, offset));
+	});
+	return BCTBX_VFS_OK;
+}
+
+extern "C" int bctbx_file_write_async(bctbx_vfs_file_t *pFile, const void *buf, size_t count, off_t offset, bctbx_vfs_async_cb_t cb, void *user_data) {
+	if (pFile == NULL || cb == NULL) return BCTBX_VFS_ERROR;
+	asyncIoQueue().submit([pFile, buf, count, offset, cb, user_data]() {
+		cb(user_data, bctbx_file_write(pFile, buf, count, offset));
+	});
+	return BCTBX_VFS_OK;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2016-2020 Belledonne Communications SARL.
+ *
+ * This file is part of bctoolbox.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BCTBX_VFS_ASYNC_HH
+#define BCTBX_VFS_ASYNC_HH
+
+#include "bctoolbox/vfs.h"
+#include <future>
+
+namespace bctoolbox {
+/**
+ * Read from a vfs file on the asynchronous I/O threads
+ * The file and the buffer must stay valid until the future is ready.
+ * It runs on threads dedicated to the library internal I/O, not the ones of bctbx_file_read_async.
+ * Called from one of these threads, the read is done before returning.
+ *
+ * @return a future holding what bctbx_file_read returns
+ */
+std::future<ssize_t> fileReadAsync(bctbx_vfs_file_t *pFile, void *buf, size_t count, off_t offset);
+
+/**
+ * Write to a vfs file on the asynchronous I/O threads
+ * The file and the buffer must stay valid until the future is ready.
+ * It runs on threads dedicated to the library internal I/O, not the ones of bctbx_file_write_async.
+ * Called from one of these threads, the write is done before returning.
+ *
+ * @return a future holding what bctbx_file_write returns
+ */
+std::future<ssize_t> fileWriteAsync(bctbx_vfs_file_t *pFile, const void *buf, size_t count, off_t offset);
+
+} // namespace bctoolbox
+#endif // BCTBX_VFS_ASYNC_HH
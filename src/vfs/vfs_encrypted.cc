@@ -22,11 +22,19 @@
 #include "bctoolbox/vfs_encrypted.hh"
 #include "vfs_encryption_module.hh"
 #include "vfs_encryption_module_dummy.hh"
-#include "vfs_encryption_module_aes256gcm_sha256.hh"
+#include "vfs_encryption_module_aead_sha256.hh"
+#include "vfs_async.hh"
+#include "vfs_encryption_worker_pool.hh"
 #include "bctoolbox/vfs_standard.h"
 #include "bctoolbox/logging.h"
+#include "bctoolbox/crypto.h" // bctbx_clean
 #include <cstdio>
 #include <algorithm>
+#include <atomic>
+#include <future>
+#include <limits>
+#include <mutex>
+#include <thread>
 
 // MSVC does not define O_ACCMODE...
 #ifndef O_ACCMODE
@@ -45,6 +53,8 @@ static size_t moduleFileHeaderSize(const uint16_t suite) {
 			return VfsEncryptionModuleDummy::moduleFileHeaderSize();
 		case static_cast<uint16_t>(EncryptionSuite::aes256gcm128_sha256):
 			return VfsEM_AES256GCM_SHA256::moduleFileHeaderSize();
+		case static_cast<uint16_t>(EncryptionSuite::chacha20poly1305_sha256):
+			return VfsEM_CHACHA20POLY1305_SHA256::moduleFileHeaderSize();
 		case static_cast<uint16_t>(EncryptionSuite::unset):
 		case static_cast<uint16_t>(EncryptionSuite::plain):
 		default:
@@ -59,6 +69,8 @@ static std::shared_ptr<VfsEncryptionModule> make_VfsEncryptionModule(const Encry
 			return std::make_shared<VfsEncryptionModuleDummy>();
 		case EncryptionSuite::aes256gcm128_sha256:
 			return std::make_shared<VfsEM_AES256GCM_SHA256>();
+		case EncryptionSuite::chacha20poly1305_sha256:
+			return std::make_shared<VfsEM_CHACHA20POLY1305_SHA256>();
 		case EncryptionSuite::plain:
 			return nullptr;
 		case EncryptionSuite::unset:
@@ -74,6 +86,8 @@ static std::shared_ptr<VfsEncryptionModule> make_VfsEncryptionModule(const uint1
 			return std::make_shared<VfsEncryptionModuleDummy>(moduleFileHeader);
 		case static_cast<uint16_t>(EncryptionSuite::aes256gcm128_sha256):
 			return std::make_shared<VfsEM_AES256GCM_SHA256>(moduleFileHeader);
+		case static_cast<uint16_t>(EncryptionSuite::chacha20poly1305_sha256):
+			return std::make_shared<VfsEM_CHACHA20POLY1305_SHA256>(moduleFileHeader);
 		case static_cast<uint16_t>(EncryptionSuite::unset):
 		case static_cast<uint16_t>(EncryptionSuite::plain):
 		default:
@@ -87,6 +101,8 @@ const std::string bctoolbox::encryptionSuiteString(const EncryptionSuite suite)
 			return "dummy";
 		case EncryptionSuite::aes256gcm128_sha256:
 			return "AES256GCM_SHA256";
+		case EncryptionSuite::chacha20poly1305_sha256:
+			return "CHACHA20POLY1305_SHA256";
 		case EncryptionSuite::plain:
 			return "plain";
 		case EncryptionSuite::unset:
@@ -115,13 +131,93 @@ static constexpr uint16_t BcEncFS_v0100=0x0100;
 static constexpr int64_t baseFileHeaderSize=29;
 
 static constexpr size_t defaultChunkSize = 4096; // default chunk size in bytes
+static constexpr size_t defaultChunkKeyCacheSize = 64; // default number of chunk keys cached by the encryption module
+static constexpr size_t integrityCheckBlockSize = 4*1024*1024; // size in bytes of the raw file blocks read during whole file integrity check
+static constexpr size_t migrationBlockSize = 4*1024*1024; // size in bytes of the plain file blocks read during migration
+static constexpr size_t readPipelineBlockSize = 1024*1024; // size in bytes of the raw blocks large reads are split in, to read the next one while the current one is decrypted
+static constexpr size_t rekeyBlockSize = 4*1024*1024; // size in bytes of the raw file blocks re-encrypted between two rekey checkpoints
+static const std::string rekeyFileSuffix{".evfs_rekey"}; // temporary file used during rekey
+// rekey progress marker, stored in the header extension of the rekey temporary file: magic || number of chunks done (4 bytes)
+static const std::vector<uint8_t> rekeyMarkerMagic{0x52, 0x4B, 0x45, 0x59}; // "REKY"
+static constexpr size_t rekeyMarkerSize = 8;
+
+namespace {
+/**
+ * Scatter/gather buffers seen as a single plain buffer, so that chunks are decrypted to and encrypted from them directly
+ * Only the chunks spread over several buffers go through a temporary copy.
+ */
+class PlainBuffers {
+	private:
+		const bctbx_iovec_t *mIov;
+		std::vector<size_t> mStarts; /**< position of each buffer in the whole */
+		size_t mSize;
+
+		/* index of the buffer holding the byte at pos, pos < mSize */
+		size_t bufferAt(size_t pos) const {
+			return static_cast<size_t>(std::upper_bound(mStarts.cbegin(), mStarts.cend(), pos) - mStarts.cbegin()) - 1;
+		}
+
+	public:
+		PlainBuffers(const bctbx_iovec_t *iov, int iovcnt) : mIov(iov), mSize(0) {
+			mStarts.reserve(static_cast<size_t>(std::max(iovcnt, 0)));
+			for (int i=0; i<iovcnt; i++) {
+				mStarts.push_back(mSize);
+				mSize += iov[i].len;
+			}
+		}
+
+		size_t size() const noexcept {
+			return mSize;
+		}
+
+		/* the bytes [pos, pos+len[ when a single buffer holds them all, nullptr otherwise. len > 0 */
+		uint8_t *contiguous(size_t pos, size_t len) const {
+			const size_t i = bufferAt(pos);
+			return (pos+len <= mStarts[i]+mIov[i].len) ? static_cast<uint8_t *>(mIov[i].base)+(pos-mStarts[i]) : nullptr;
+		}
+
+		/* copy len bytes from data to the buffers, at pos */
+		void scatter(size_t pos, const uint8_t *data, size_t len) const {
+			for (size_t i = (len > 0) ? bufferAt(pos) : 0; len > 0; i++) {
+				const size_t size = std::min(len, mIov[i].len-(pos-mStarts[i]));
+				std::copy(data, data+size, static_cast<uint8_t *>(mIov[i].base)+(pos-mStarts[i]));
+				data += size;
+				pos += size;
+				len -= size;
+			}
+		}
+
+		/* copy len bytes from the buffers, at pos, to data */
+		void gather(size_t pos, size_t len, uint8_t *data) const {
+			for (size_t i = (len > 0) ? bufferAt(pos) : 0; len > 0; i++) {
+				const size_t size = std::min(len, mIov[i].len-(pos-mStarts[i]));
+				const uint8_t *base = static_cast<const uint8_t *>(mIov[i].base)+(pos-mStarts[i]);
+				std::copy(base, base+size, data);
+				data += size;
+				pos += size;
+				len -= size;
+			}
+		}
+};
+constexpr size_t noTempChunk = std::numeric_limits<size_t>::max(); // the chunk is processed in place in the plain buffers
+} // anonymous namespace
 
 /**
  * Initialiase the static callback property
  */
 EncryptedVfsOpenCb VfsEncryption::s_openCallback = nullptr;
 
+/**
+ * Worker pool is disabled by default
+ */
+std::shared_ptr<WorkerPool> VfsEncryption::s_workerPool = nullptr;
+size_t VfsEncryption::s_workerPoolChunkThreshold = 16;
+static std::mutex workerPoolMutex; // protect the worker pool static properties
+
 VfsEncryption::VfsEncryption(bctbx_vfs_file_t *stdFp, const std::string &filename, int openFlags, int accessMode) :
+	VfsEncryption(stdFp, filename, openFlags, accessMode, VfsEncryption::openCallbackGet()) {}
+
+VfsEncryption::VfsEncryption(bctbx_vfs_file_t *stdFp, const std::string &filename, int openFlags, int accessMode, const EncryptedVfsOpenCb &openCallback) :
 	mVersionNumber(BcEncFS_v0100),  // default version number is the current one
 	mChunkSize(0), // set to 0 at creation, is will be populated by parseHeader if there is one. If we are creating a file, let a chance to the callback to set the chunk size.
 	m_module(nullptr), // encryption module is set by callback or when parsing the header
@@ -131,6 +227,11 @@ VfsEncryption::VfsEncryption(bctbx_vfs_file_t *stdFp, const std::string &filenam
 	mEncryptExistingPlainFile(false),
 	mIntegrityFullCheck(false),
 	mAccessMode(accessMode),
+	mChunkKeyCacheSize(defaultChunkKeyCacheSize),
+	mHeaderWriteBack(false),
+	mHeaderDirty(false),
+	mPlainCacheSize(0),
+	mRekeyPending(false),
 	pFileStd(stdFp) {
 
 	if (stdFp == NULL) throw EVFS_EXCEPTION<<"Cannot create a vfs encrytion object, vfs pointer is null";
@@ -143,9 +244,9 @@ VfsEncryption::VfsEncryption(bctbx_vfs_file_t *stdFp, const std::string &filenam
 		createFile = false;
 	}
 
-	/* if the static callback is set, call it */
-	if (VfsEncryption::openCallbackGet() != nullptr) {
-		(VfsEncryption::openCallbackGet())(*this);
+	/* if the callback is set, call it */
+	if (openCallback != nullptr) {
+		openCallback(*this);
 	} else {
 		throw EVFS_EXCEPTION << "Encrypted VFS: must provide a callback to setup key material";
 	}
@@ -160,76 +261,24 @@ VfsEncryption::VfsEncryption(bctbx_vfs_file_t *stdFp, const std::string &filenam
 	}
 
 	if (mEncryptExistingPlainFile == true) { // we have a plain file to encrypt
-		// create a temporary file
-		std::string tmpFilename(mFilename);
-		tmpFilename.append(".evfs_tmp");
-		// make sure this file does not exists
-		std::remove(tmpFilename.data());
-		auto stdFdTmp = bctbx_file_open2(bctbx_vfs_get_standard(), tmpFilename.data(), O_WRONLY|O_CREAT);
-		// read the whole file chunk by chunk and write their ciphertext to the temp file
-		char *readBuf = static_cast<char *>(bctbx_malloc(mChunkSize));
-		uint64_t index = 0;
-
-		uint32_t currentChunkIndex = 0;
-		do {
-			// read
-			auto readSize = bctbx_file_read(pFileStd, readBuf, mChunkSize, static_cast<off_t>(index));
-			if (readSize < 0) {
-				bctbx_file_close(stdFdTmp);
-				bctbx_free(readBuf);
-				throw EVFS_EXCEPTION<<"Unable to migrate plain file "<<mFilename<<". Could not read file";
-			}
-			index += readSize;
-			// encrypt
-			auto rawChunk = m_module->encryptChunk(currentChunkIndex, std::vector<uint8_t>(readBuf, readBuf+readSize));
-			// write
-			if (bctbx_file_write(stdFdTmp, rawChunk.data(), rawChunk.size(), getChunkOffset(currentChunkIndex)) - rawChunk.size() != 0 ){
-				bctbx_file_close(stdFdTmp);
-				bctbx_free(readBuf);
-				throw EVFS_EXCEPTION<<"Unable to migrate plain file "<<mFilename<<". Could not write to temporary file "<<tmpFilename;
-			}
-			currentChunkIndex++;
-		} while (index < mFileSize);
-		bctbx_free(readBuf);
-
-		// write header and close
-		writeHeader(stdFdTmp);
-		bctbx_file_close(stdFdTmp);
-
-		// delete the original file
-		bctbx_file_close(pFileStd);
-		std::remove(mFilename.data());
-
-		// rename the temporary one
-		std::rename(tmpFilename.data(), mFilename.data());
-		mEncryptExistingPlainFile = false;
-
-		// and reopen it with the standard vfs
-		pFileStd = bctbx_file_open2(bctbx_vfs_get_standard(), mFilename.data(), openFlags);
-
+		migratePlainFile(openFlags);
 	} else { // no migration but now we shall have all the material (settings and keys ) to check the file integrity
 		if (mFileSize > 0 ) { // this is not a file creation
 			if (m_module->checkIntegrity(*this) != true) {
 				throw EVFS_EXCEPTION<<"Integrity check fail while opening file "<<mFilename;
 			} else { // header integrity is Ok
 				if (mIntegrityFullCheck == true) { // file size in header is wrong, check each chunk and update header
-					for (auto chunkIndex = getChunkIndex(mFileSize); chunkIndex >0; chunkIndex--) { // start from last chunk
-						std::vector<uint8_t> rawData(rawChunkSizeGet());
-						ssize_t readSize = bctbx_file_read(pFileStd, rawData.data(), rawData.size(), getChunkOffset(chunkIndex));
-						if (readSize >= 0) {
-							rawData.resize(readSize);
-						} else {
-							throw EVFS_EXCEPTION<<"fail to read file while trying to check the full integrity, file_read returned "<<readSize;
-						}
-
-						std::vector<uint8_t> plainData(mChunkSize);
-
-						// decrypt the chunk, if it fails it will generate an exception, let it flow up
-						m_module->decryptChunk(chunkIndex, rawData);
+					uint32_t badChunk = 0;
+					if (integrityCheck(badChunk) == false) {
+						throw EVFS_EXCEPTION<<"Integrity check fail on chunk "<<badChunk<<" while opening file "<<mFilename;
 					}
 					// all clear, update header
-					writeHeader();
-					BCTBX_SLOGW<<"Encrypted FS: Whole file integrity check successfull, update header with correct file size";
+					if (mAccessMode == O_RDONLY) {
+						BCTBX_SLOGW<<"Encrypted FS: Whole file integrity check successfull, file opened in read only mode, header not updated";
+					} else {
+						writeHeader();
+						BCTBX_SLOGW<<"Encrypted FS: Whole file integrity check successfull, update header with correct file size";
+					}
 				}
 			}
 		}
@@ -238,12 +287,323 @@ VfsEncryption::VfsEncryption(bctbx_vfs_file_t *stdFp, const std::string &filenam
 	if (createFile) {
 		writeHeader();
 	}
+
+	// an interrupted rekey cannot be resumed once the file is modified: check once if there is one to discard
+	if (mAccessMode != O_RDONLY) {
+		mRekeyPending = (bctbx_file_exist((mFilename + rekeyFileSuffix).data()) == 0);
+	}
+}
+
+void VfsEncryption::migratePlainFile(int openFlags) {
+	// create a temporary file
+	std::string tmpFilename(mFilename);
+	tmpFilename.append(".evfs_tmp");
+	// make sure this file does not exists
+	std::remove(tmpFilename.data());
+	auto stdFdTmp = bctbx_file_open2(bctbx_vfs_get_standard(), tmpFilename.data(), O_WRONLY|O_CREAT);
+	if (stdFdTmp == nullptr) {
+		throw EVFS_EXCEPTION<<"Unable to migrate plain file "<<mFilename<<". Could not create temporary file "<<tmpFilename;
+	}
+
+	const size_t chunkHeaderSize = m_module->getChunkHeaderSize();
+	const size_t rawChunkSize = rawChunkSizeGet();
+	const uint32_t chunkCount = std::max(getChunkIndex(mFileSize + mChunkSize - 1), static_cast<uint32_t>(1)); // an empty file still gets one empty chunk
+	const uint32_t blockChunks = static_cast<uint32_t>(std::max(migrationBlockSize/mChunkSize, static_cast<size_t>(1)));
+	auto workers = workerPoolGet(std::numeric_limits<size_t>::max()); // bulk operation: ignore the chunk threshold
+
+	// Start reading the plain data of the chunks [first, first+count[ in the given buffer on the I/O threads
+	auto readBlockSize = [this](uint32_t first, uint32_t count) {
+		const uint64_t offset = static_cast<uint64_t>(first)*mChunkSize;
+		return static_cast<size_t>(std::min(static_cast<uint64_t>(count)*mChunkSize, mFileSize - offset));
+	};
+	auto readBlock = [this, &readBlockSize](uint32_t first, uint32_t count, std::vector<uint8_t> &plainData) {
+		return fileReadAsync(pFileStd, plainData.data(), readBlockSize(first, count), static_cast<off_t>(static_cast<uint64_t>(first)*mChunkSize));
+	};
+	auto checkReadSize = [this, &readBlockSize](std::future<ssize_t> &read, uint32_t first, uint32_t count) {
+		const size_t size = readBlockSize(first, count);
+		ssize_t readSize = read.get();
+		if (readSize < 0 || static_cast<size_t>(readSize) != size) {
+			throw EVFS_EXCEPTION<<"Unable to migrate plain file "<<mFilename<<". Could not read "<<size<<" bytes at offset "<<static_cast<uint64_t>(first)*mChunkSize<<" file_read returned "<<readSize;
+		}
+	};
+
+	// two plain buffers: the next block is read while the current one is encrypted and written
+	std::vector<uint8_t> plainData(static_cast<size_t>(blockChunks)*mChunkSize);
+	std::vector<uint8_t> nextPlainData(plainData.size());
+	std::vector<uint8_t> rawData(static_cast<size_t>(blockChunks)*rawChunkSize);
+
+	uint32_t first = 0;
+	uint32_t count = std::min(blockChunks, chunkCount);
+	std::future<ssize_t> nextRead = readBlock(first, count, plainData);
+	try {
+		checkReadSize(nextRead, first, count);
+		while (count > 0) {
+			const uint32_t nextFirst = first+count;
+			const uint32_t nextCount = std::min(blockChunks, chunkCount-nextFirst);
+			if (nextCount > 0) {
+				nextRead = readBlock(nextFirst, nextCount, nextPlainData);
+			}
+
+			auto encryptChunk = [&](size_t i) {
+				const uint32_t chunkIndex = first+static_cast<uint32_t>(i);
+				m_module->encryptChunk(chunkIndex, plainData.data()+i*mChunkSize, chunkPlainSizeGet(chunkIndex, mFileSize), rawData.data()+i*rawChunkSize);
+			};
+			if (workers != nullptr) {
+				workers->parallelFor(count, encryptChunk);
+			} else {
+				for (size_t i=0; i<count; i++) {
+					encryptChunk(i);
+				}
+			}
+
+			const uint32_t last = first+count-1;
+			const size_t size = (last-first)*rawChunkSize + chunkHeaderSize + chunkPlainSizeGet(last, mFileSize);
+			ssize_t ret = bctbx_file_write(stdFdTmp, rawData.data(), size, getChunkOffset(first));
+			if (ret - size != 0) { // compare signed and unsigned
+				throw EVFS_EXCEPTION<<"Unable to migrate plain file "<<mFilename<<". Could not write to temporary file "<<tmpFilename;
+			}
+			if (nextRead.valid()) {
+				checkReadSize(nextRead, nextFirst, nextCount);
+			}
+
+			std::swap(plainData, nextPlainData);
+			first = nextFirst;
+			count = nextCount;
+		}
+
+		// write header and make sure everything is on disk before replacing the original file
+		writeHeader(stdFdTmp);
+		if (bctbx_file_sync(stdFdTmp) != BCTBX_VFS_OK) {
+			throw EVFS_EXCEPTION<<"Unable to migrate plain file "<<mFilename<<". Could not sync temporary file "<<tmpFilename;
+		}
+	} catch (...) { // EVFS errors but also allocation or thread failures: do not leave the plain data behind
+		if (nextRead.valid()) {
+			nextRead.wait(); // it uses our buffers
+		}
+		bctbx_clean(plainData.data(), plainData.size());
+		bctbx_clean(nextPlainData.data(), nextPlainData.size());
+		bctbx_file_close(stdFdTmp);
+		std::remove(tmpFilename.data());
+		throw;
+	}
+	bctbx_clean(plainData.data(), plainData.size());
+	bctbx_clean(nextPlainData.data(), nextPlainData.size());
+	bctbx_file_close(stdFdTmp);
+
+	// replace the original file by the encrypted one
+#ifdef _WIN32
+	// rename does not overwrite an existing file nor an open one
+	bctbx_file_close(pFileStd);
+	pFileStd = nullptr;
+	std::remove(mFilename.data());
+#endif
+	if (std::rename(tmpFilename.data(), mFilename.data()) != 0) {
+		std::remove(tmpFilename.data());
+		throw EVFS_EXCEPTION<<"Unable to migrate plain file "<<mFilename<<". Could not rename temporary file "<<tmpFilename;
+	}
+#ifndef _WIN32
+	bctbx_file_close(pFileStd);
+	pFileStd = nullptr;
+#endif
+	mEncryptExistingPlainFile = false;
+
+	// and reopen it with the standard vfs
+	pFileStd = bctbx_file_open2(bctbx_vfs_get_standard(), mFilename.data(), openFlags);
+	if (pFileStd == nullptr) {
+		throw EVFS_EXCEPTION<<"Unable to reopen migrated file "<<mFilename;
+	}
+}
+
+void VfsEncryption::discardPendingRekey() noexcept {
+	if (mRekeyPending) {
+		mRekeyPending = false;
+		std::remove((mFilename + rekeyFileSuffix).data());
+	}
+}
+
+void VfsEncryption::rekey(const std::vector<uint8_t> &newSecretMaterial, const EncryptedVfsProgressCb &progress) {
+	if (m_module == nullptr) {
+		throw EVFS_EXCEPTION<<"Cannot rekey plain file "<<mFilename;
+	}
+	if (mAccessMode == O_RDONLY) {
+		throw EVFS_EXCEPTION<<"Cannot rekey file "<<mFilename<<" opened in read only mode";
+	}
+	// the original file must be complete on disk as the temporary one is built from it
+	if (mHeaderDirty) {
+		writeHeader();
+	}
+
+	const std::string tmpFilename(mFilename + rekeyFileSuffix);
+	const EncryptionSuite suite = encryptionSuiteGet();
+	const size_t chunkSize = mChunkSize;
+	auto openTmp = [&]() {
+		auto stdFdTmp = bctbx_file_open2(bctbx_vfs_get_standard(), tmpFilename.data(), O_RDWR|O_CREAT);
+		if (stdFdTmp == nullptr) {
+			throw EVFS_EXCEPTION<<"Unable to rekey file "<<mFilename<<". Could not open temporary file "<<tmpFilename;
+		}
+		try {
+			// the temporary file is the re-encrypted version of this one: same suite and chunk size, new key and salt
+			return std::unique_ptr<VfsEncryption>(new VfsEncryption(stdFdTmp, tmpFilename, O_RDWR|O_CREAT, O_RDWR, [&](VfsEncryption &settings) {
+				settings.encryptionSuiteSet(suite);
+				settings.secretMaterialSet(newSecretMaterial);
+				settings.chunkSizeSet(chunkSize);
+			}));
+		} catch (...) { // crypto or allocation failures too: do not leak the file handle
+			bctbx_file_close(stdFdTmp);
+			throw;
+		}
+	};
+	// progress marker is magic || number of chunks already re-encrypted
+	auto setMarker = [](VfsEncryption &tmp, uint32_t chunksDone) {
+		tmp.mHeaderExtension = rekeyMarkerMagic;
+		tmp.mHeaderExtension.emplace_back(static_cast<uint8_t>((chunksDone>>24)&0xFF));
+		tmp.mHeaderExtension.emplace_back(static_cast<uint8_t>((chunksDone>>16)&0xFF));
+		tmp.mHeaderExtension.emplace_back(static_cast<uint8_t>((chunksDone>>8)&0xFF));
+		tmp.mHeaderExtension.emplace_back(static_cast<uint8_t>(chunksDone&0xFF));
+		tmp.mHeaderExtensionSize = rekeyMarkerSize;
+		tmp.writeHeader();
+	};
+
+	const uint32_t chunkCount = getChunkIndex(mFileSize + mChunkSize - 1);
+	uint32_t first = 0;
+
+	// resume an interrupted rekey when the temporary file is valid and matches this file
+	std::unique_ptr<VfsEncryption> tmp{};
+	try {
+		tmp = openTmp();
+		if (tmp->mFileSize == mFileSize && tmp->mHeaderExtension.size() == rekeyMarkerSize
+			&& std::equal(rekeyMarkerMagic.cbegin(), rekeyMarkerMagic.cend(), tmp->mHeaderExtension.cbegin())) {
+			first = static_cast<uint32_t>(tmp->mHeaderExtension[4])<<24 | static_cast<uint32_t>(tmp->mHeaderExtension[5])<<16
+				| static_cast<uint32_t>(tmp->mHeaderExtension[6])<<8 | static_cast<uint32_t>(tmp->mHeaderExtension[7]);
+			if (first > chunkCount) {
+				tmp = nullptr;
+			}
+		} else {
+			tmp = nullptr;
+		}
+	} catch (BctbxException const &e) { // EVFS and crypto errors
+		BCTBX_SLOGW<<"Encrypted VFS: cannot resume rekey of file "<<mFilename<<", restart it. "<<e;
+		tmp = nullptr;
+	}
+	if (tmp == nullptr) { // start from scratch
+		first = 0;
+		std::remove(tmpFilename.data());
+		tmp = openTmp();
+		tmp->mFileSize = mFileSize;
+		setMarker(*tmp, 0);
+		// give the raw file its final size so the header file size matches it until the rekey completes
+		bctbx_file_truncate(tmp->pFileStd, tmp->rawFileSizeGet());
+	} else {
+		BCTBX_SLOGI<<"Encrypted VFS: resume rekey of file "<<mFilename<<" at chunk "<<first<<"/"<<chunkCount;
+	}
+	mRekeyPending = true; // discard it if the file is modified before it completes
+
+	const size_t chunkHeaderSize = m_module->getChunkHeaderSize();
+	const size_t rawChunkSize = rawChunkSizeGet();
+	const uint32_t blockChunks = static_cast<uint32_t>(std::max(rekeyBlockSize/rawChunkSize, static_cast<size_t>(1)));
+	auto workers = workerPoolGet(std::numeric_limits<size_t>::max()); // bulk operation: ignore the chunk threshold
+
+	std::vector<uint8_t> rawData(static_cast<size_t>(blockChunks)*rawChunkSize);
+	std::vector<uint8_t> plainData(static_cast<size_t>(blockChunks)*mChunkSize);
+	try {
+		while (first < chunkCount) {
+			const uint32_t count = std::min(blockChunks, chunkCount-first);
+			const uint32_t last = first+count-1;
+			const size_t size = (last-first)*rawChunkSize + chunkHeaderSize + chunkPlainSizeGet(last, mFileSize);
+			ssize_t readSize = bctbx_file_read(pFileStd, rawData.data(), size, getChunkOffset(first));
+			if (readSize < 0 || static_cast<size_t>(readSize) != size) {
+				throw EVFS_EXCEPTION<<"Unable to rekey file "<<mFilename<<". Could not read "<<size<<" bytes at offset "<<getChunkOffset(first)<<" file_read returned "<<readSize;
+			}
+
+			// decrypt with the current key and encrypt in place with the new one
+			auto rekeyChunk = [&](size_t i) {
+				const uint32_t chunkIndex = first+static_cast<uint32_t>(i);
+				const size_t chunkPlainSize = chunkPlainSizeGet(chunkIndex, mFileSize);
+				uint8_t *rawChunk = rawData.data()+i*rawChunkSize;
+				uint8_t *plainChunk = plainData.data()+i*mChunkSize;
+				m_module->decryptChunk(chunkIndex, rawChunk, chunkHeaderSize+chunkPlainSize, plainChunk);
+				tmp->m_module->encryptChunk(chunkIndex, plainChunk, chunkPlainSize, rawChunk);
+			};
+			if (workers != nullptr) {
+				workers->parallelFor(count, rekeyChunk);
+			} else {
+				for (size_t i=0; i<count; i++) {
+					rekeyChunk(i);
+				}
+			}
+
+			ssize_t ret = bctbx_file_write(tmp->pFileStd, rawData.data(), size, tmp->getChunkOffset(first));
+			if (ret - size != 0) { // compare signed and unsigned
+				throw EVFS_EXCEPTION<<"Unable to rekey file "<<mFilename<<". Could not write to temporary file "<<tmpFilename;
+			}
+			// checkpoint: the block must be on disk before the header says it is done
+			if (bctbx_file_sync(tmp->pFileStd) != BCTBX_VFS_OK) {
+				throw EVFS_EXCEPTION<<"Unable to rekey file "<<mFilename<<". Could not sync temporary file "<<tmpFilename;
+			}
+			first += count;
+			setMarker(*tmp, first);
+			if (progress) {
+				progress(first, chunkCount);
+			}
+		}
+
+		// the extension size is part of the layout, keep it but clear the marker
+		tmp->mHeaderExtension.assign(rekeyMarkerSize, 0);
+		tmp->writeHeader();
+		if (bctbx_file_sync(tmp->pFileStd) != BCTBX_VFS_OK) {
+			throw EVFS_EXCEPTION<<"Unable to rekey file "<<mFilename<<". Could not sync temporary file "<<tmpFilename;
+		}
+	} catch (...) { // keep the temporary file: next call resumes from the last checkpoint
+		bctbx_clean(plainData.data(), plainData.size());
+		throw;
+	}
+	bctbx_clean(plainData.data(), plainData.size());
+
+	// grab the new encryption context and close the temporary file
+	auto module = tmp->m_module;
+	auto headerExtension = tmp->mHeaderExtension;
+	tmp = nullptr;
+
+	// replace the original file by the re-encrypted one
+#ifdef _WIN32
+	// rename does not overwrite an existing file nor an open one
+	bctbx_file_close(pFileStd);
+	pFileStd = nullptr;
+	std::remove(mFilename.data());
+#endif
+	if (std::rename(tmpFilename.data(), mFilename.data()) != 0) {
+		throw EVFS_EXCEPTION<<"Unable to rekey file "<<mFilename<<". Could not rename temporary file "<<tmpFilename;
+	}
+	mRekeyPending = false;
+#ifndef _WIN32
+	bctbx_file_close(pFileStd);
+	pFileStd = nullptr;
+#endif
+
+	// switch to the new key and file layout, plain content is unchanged
+	m_module = module;
+	m_module->setChunkKeyCacheSize(mChunkKeyCacheSize);
+	mHeaderExtension = headerExtension;
+	mHeaderExtensionSize = mHeaderExtension.size();
+	pFileStd = bctbx_file_open2(bctbx_vfs_get_standard(), mFilename.data(), O_RDWR);
+	if (pFileStd == nullptr) {
+		throw EVFS_EXCEPTION<<"Unable to reopen rekeyed file "<<mFilename;
+	}
+	writeHeader();
 }
 
 VfsEncryption::~VfsEncryption() {
 	if (pFileStd != nullptr) {
+		if (mHeaderDirty) {
+			try {
+				writeHeader();
+			} catch (EvfsException const &e) { // do not let an exception escape the destructor, file size is recovered at next opening
+				BCTBX_SLOGE<<"Encrypted VFS: fail to write file "<<mFilename<<" header at closing. "<<e;
+			}
+		}
 		bctbx_file_close(pFileStd);
 	}
+	plainCacheDrop(0);
 }
 
 
@@ -280,6 +640,118 @@ void VfsEncryption::chunkSizeSet(const size_t size) {
 	}
 }
 
+size_t VfsEncryption::chunkKeyCacheSizeGet() const noexcept {
+	return mChunkKeyCacheSize;
+}
+
+void VfsEncryption::chunkKeyCacheSizeSet(const size_t size) noexcept {
+	mChunkKeyCacheSize = size;
+	if (m_module != nullptr) {
+		m_module->setChunkKeyCacheSize(mChunkKeyCacheSize);
+	}
+}
+
+size_t VfsEncryption::plainCacheSizeGet() const noexcept {
+	std::lock_guard<std::mutex> lock(mPlainCacheMutex);
+	return mPlainCacheSize;
+}
+
+void VfsEncryption::plainCacheSizeSet(const size_t size) noexcept {
+	std::lock_guard<std::mutex> lock(mPlainCacheMutex);
+	mPlainCacheSize = size;
+	// drop the least recently used chunks if the cache is now too large
+	while (!mPlainChunks.empty() && mPlainChunks.size()*mChunkSize > mPlainCacheSize) {
+		bctbx_clean(mPlainChunks.back().second.data(), mPlainChunks.back().second.size());
+		mPlainChunksIndex.erase(mPlainChunks.back().first);
+		mPlainChunks.pop_back();
+	}
+}
+
+bool VfsEncryption::plainCacheRead(uint32_t index, uint8_t *plainData, size_t begin, size_t end) const {
+	std::lock_guard<std::mutex> lock(mPlainCacheMutex);
+	if (mPlainCacheSize == 0) return false;
+	auto cachedChunk = mPlainChunksIndex.find(index);
+	if (cachedChunk == mPlainChunksIndex.end() || cachedChunk->second->second.size() < end) {
+		return false;
+	}
+	// move it in front of the list: it is now the most recently used
+	mPlainChunks.splice(mPlainChunks.begin(), mPlainChunks, cachedChunk->second);
+	const auto &chunk = cachedChunk->second->second;
+	std::copy(chunk.cbegin()+begin, chunk.cbegin()+end, plainData);
+	return true;
+}
+
+void VfsEncryption::plainCacheStore(uint32_t index, const uint8_t *plainData, size_t size) const {
+	std::lock_guard<std::mutex> lock(mPlainCacheMutex);
+	if (mPlainCacheSize < mChunkSize || mChunkSize == 0) return; // not even one chunk fits in
+	auto cachedChunk = mPlainChunksIndex.find(index);
+	if (cachedChunk != mPlainChunksIndex.end()) { // update it in place
+		mPlainChunks.splice(mPlainChunks.begin(), mPlainChunks, cachedChunk->second);
+	} else if ((mPlainChunks.size()+1)*mChunkSize > mPlainCacheSize) { // cache is full: recycle the least recently used entry
+		auto &evicted = mPlainChunks.back();
+		bctbx_clean(evicted.second.data(), evicted.second.size());
+		mPlainChunksIndex.erase(evicted.first);
+		mPlainChunks.splice(mPlainChunks.begin(), mPlainChunks, std::prev(mPlainChunks.end()));
+		mPlainChunks.front().first = index;
+		mPlainChunksIndex[index] = mPlainChunks.begin();
+	} else {
+		mPlainChunks.emplace_front(index, std::vector<uint8_t>{});
+		mPlainChunks.front().second.reserve(mChunkSize); // so it never reallocates, leaving non zeroized copies
+		mPlainChunksIndex[index] = mPlainChunks.begin();
+	}
+	auto &chunk = mPlainChunks.front().second;
+	chunk.assign(plainData, plainData+size);
+}
+
+void VfsEncryption::plainCacheDrop(uint32_t fromIndex) const noexcept {
+	std::lock_guard<std::mutex> lock(mPlainCacheMutex);
+	for (auto it = mPlainChunks.begin(); it != mPlainChunks.end();) {
+		if (it->first >= fromIndex) {
+			bctbx_clean(it->second.data(), it->second.size());
+			mPlainChunksIndex.erase(it->first);
+			it = mPlainChunks.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+bool VfsEncryption::headerWriteBackGet() const noexcept {
+	return mHeaderWriteBack;
+}
+
+void VfsEncryption::headerWriteBackSet(bool enable) {
+	mHeaderWriteBack = enable;
+	if (!mHeaderWriteBack && mHeaderDirty) {
+		writeHeader();
+	}
+}
+
+void VfsEncryption::workerPoolSet(size_t threadCount, size_t chunkThreshold) {
+	std::shared_ptr<WorkerPool> previousPool{nullptr};
+	{
+		std::lock_guard<std::mutex> lock(workerPoolMutex);
+		previousPool = s_workerPool;
+		s_workerPool = (threadCount > 0)?std::make_shared<WorkerPool>(threadCount):nullptr;
+		s_workerPoolChunkThreshold = std::max(chunkThreshold, static_cast<size_t>(2)); // one chunk does not need to be parallelised
+	}
+	// previous pool threads are joined here, out of the lock, if no operation is still using it
+	previousPool = nullptr;
+}
+
+size_t VfsEncryption::workerPoolThreadCountGet() noexcept {
+	std::lock_guard<std::mutex> lock(workerPoolMutex);
+	return (s_workerPool == nullptr)?0:s_workerPool->sizeGet();
+}
+
+std::shared_ptr<WorkerPool> VfsEncryption::workerPoolGet(size_t chunkCount) noexcept {
+	std::lock_guard<std::mutex> lock(workerPoolMutex);
+	if (chunkCount < s_workerPoolChunkThreshold) {
+		return nullptr;
+	}
+	return s_workerPool;
+}
+
 /**
  * Set a callback called during file opening to get the encryption material and suite
  */
@@ -315,12 +787,16 @@ void VfsEncryption::secretMaterialSet(const std::vector<uint8_t> &secretMaterial
 void VfsEncryption::encryptionSuiteSet(const EncryptionSuite suite) {
 	if (m_module == nullptr && mFileSize == 0) { // file creation
 		m_module = make_VfsEncryptionModule(suite);
+		if (m_module != nullptr) {
+			m_module->setChunkKeyCacheSize(mChunkKeyCacheSize);
+		}
 	} else { // file already exists (if m_filesize!=0 and m_module is nullptr, it is an existing plain file, the encryptionSuiteGet would return plain)
 		if (encryptionSuiteGet() != suite) {
 			if (encryptionSuiteGet() == bctoolbox::EncryptionSuite::plain) { // we want to migrate a plain file to an encrypted one
 				if (mAccessMode != O_RDONLY) { // Do not migrate read-only file
 					mEncryptExistingPlainFile = true;
 					m_module = make_VfsEncryptionModule(suite);
+					m_module->setChunkKeyCacheSize(mChunkKeyCacheSize);
 				} else {
 					BCTBX_SLOGW<<" Encrypted VFS access a plain file "<<mFilename<<"as read only. Kept it plain";
 				}
@@ -421,9 +897,16 @@ void VfsEncryption::parseHeader() {
 	mChunkSize = (r_header[index]<<8|r_header[index+1])*16;
 	index += 2;
 
-	// check the header extension, not used in version 1.0 but use this field to skip them if any
+	// check the header extension, its content is opaque here but part of the authenticated header
 	mHeaderExtensionSize = r_header[index]<<8|r_header[index+1];
 	index += 2;
+	mHeaderExtension.resize(mHeaderExtensionSize);
+	if (mHeaderExtensionSize > 0) {
+		if (bctbx_file_read(pFileStd, mHeaderExtension.data(), mHeaderExtensionSize, baseFileHeaderSize) - mHeaderExtensionSize != 0) {
+			throw EVFS_EXCEPTION<<"Encrypted FS: unable to read header extension";
+		}
+		r_header.insert(r_header.end(), mHeaderExtension.cbegin(), mHeaderExtension.cend());
+	}
 
 	// get the file size
 	mFileSize = (static_cast<uint64_t>(r_header[index])<<56)
@@ -449,6 +932,7 @@ void VfsEncryption::parseHeader() {
 
 	// instanciate the encryption module
 	m_module = make_VfsEncryptionModule(encryptionSuite, encryptionSuiteData);
+	m_module->setChunkKeyCacheSize(mChunkKeyCacheSize);
 
 	// check file size match what we have :
 	// If they do not match, check all chunks integrity and update the header. Recovery from failure between write and header update at last write/truncate
@@ -472,7 +956,7 @@ void VfsEncryption::writeHeader(bctbx_vfs_file_t *fp) {
 		throw EVFS_EXCEPTION<< "Encrypted VFS: cannot write file Header when no encryption module is selected";
 	}
 	std::vector<uint8_t> header{BCENCRYPTEDFS}; // starts with the magic number
-	header.reserve(baseFileHeaderSize+m_module->getModuleFileHeaderSize());
+	header.reserve(baseFileHeaderSize+mHeaderExtension.size()+m_module->getModuleFileHeaderSize());
 
 	// add version number
 	header.emplace_back(mVersionNumber>>8);
@@ -487,9 +971,9 @@ void VfsEncryption::writeHeader(bctbx_vfs_file_t *fp) {
 	header.emplace_back(static_cast<uint8_t>(((mChunkSize/16)>>8)&0xFF));
 	header.emplace_back(static_cast<uint8_t>((mChunkSize/16)&0xFF));
 
-	// add header extension size: none for now
-	header.emplace_back(0x00);
-	header.emplace_back(0x00);
+	// add header extension size
+	header.emplace_back(static_cast<uint8_t>((mHeaderExtension.size()>>8)&0xFF));
+	header.emplace_back(static_cast<uint8_t>(mHeaderExtension.size()&0xFF));
 
 	// add file size
 	header.emplace_back(static_cast<uint8_t>((mFileSize>>56)&0xFF));
@@ -501,6 +985,9 @@ void VfsEncryption::writeHeader(bctbx_vfs_file_t *fp) {
 	header.emplace_back(static_cast<uint8_t>((mFileSize>>8)&0xFF));
 	header.emplace_back(static_cast<uint8_t>(mFileSize&0xFF));
 
+	// add header extension
+	header.insert(header.end(), mHeaderExtension.cbegin(), mHeaderExtension.cend());
+
 	// update header cache (do not cache the encryption module data)
 	// moduleFileHeader shall depends on the file header as it probably authentify it,
 	// so do this update before asking for the encryption module header
@@ -515,6 +1002,9 @@ void VfsEncryption::writeHeader(bctbx_vfs_file_t *fp) {
 	if (ret - header.size() != 0) { // cannot compare directly signed and unsigned...
 		throw EVFS_EXCEPTION<< "Encrypted VFS: something went wrong while writing file header. file_write returns "<<ret<<" but we expected "<< header.size();
 	}
+	if (fp == nullptr) {
+		mHeaderDirty = false;
+	}
 }
 
 int64_t VfsEncryption::fileSizeGet() const noexcept {
@@ -545,132 +1035,343 @@ size_t VfsEncryption::getChunkOffset(uint32_t index) const noexcept {
 		+ baseFileHeaderSize + mHeaderExtensionSize + m_module->getModuleFileHeaderSize();
 }
 
+/**
+ * @returns the size of the plain data stored in the given chunk for a plain file of the given size
+ */
+size_t VfsEncryption::chunkPlainSizeGet(uint32_t index, uint64_t fileSize) const noexcept {
+	uint64_t chunkStart = static_cast<uint64_t>(index)*mChunkSize;
+	if (chunkStart >= fileSize) return 0;
+	return static_cast<size_t>(std::min(static_cast<uint64_t>(mChunkSize), fileSize - chunkStart));
+}
+
 std::vector<uint8_t> VfsEncryption::read(size_t offset, size_t count) const {
+	std::vector<uint8_t> plainData(count);
+	plainData.resize(read(plainData.data(), count, offset));
+	return plainData;
+}
+
+size_t VfsEncryption::read(uint8_t *plainData, size_t count, size_t offset) const {
+	const bctbx_iovec_t iov = {plainData, count};
+	return readv(&iov, 1, offset);
+}
+
+size_t VfsEncryption::readv(const bctbx_iovec_t *iov, int iovcnt, size_t offset) const {
 	// plain file?
 	if (m_module == nullptr) {
-		std::vector<uint8_t> plain(count);
-		auto readSize = bctbx_file_read(pFileStd, plain.data(), plain.size(), offset);
-		plain.resize(readSize);
-		return plain;
+		auto readSize = bctbx_file_readv(pFileStd, iov, iovcnt, offset);
+		if (readSize < 0) {
+			throw EVFS_EXCEPTION<<"fail to read plain file "<<mFilename<<" file_read returned "<<readSize;
+		}
+		return static_cast<size_t>(readSize);
+	}
+
+	const PlainBuffers plainData(iov, iovcnt);
+	size_t count = plainData.size();
+	// Do not read after the end of file
+	if (count == 0 || offset >= mFileSize) {
+		return 0;
 	}
+	count = static_cast<size_t>(std::min(static_cast<uint64_t>(count), mFileSize - offset));
 
 	/* first compute how much of the actual file we must read */
 	uint32_t firstChunk = getChunkIndex(offset);
 	uint32_t lastChunk = getChunkIndex(offset+count-1); // -1 as we read data from indexes offset to offset + count - 1
-	size_t offsetInFirstChunk = offset%mChunkSize;
-
-	// allocate a vector large enough to store all the data to read : number of chunks * size of raw chunk(payload+header)
-	std::vector<uint8_t> rawData((lastChunk-firstChunk+1)*rawChunkSizeGet());
+	const size_t chunkHeaderSize = m_module->getChunkHeaderSize();
+	const size_t rawChunkSize = rawChunkSizeGet();
+
+	// requested part of a chunk
+	auto requestedBegin = [&](uint32_t chunkIndex) {
+		const uint64_t chunkStart = static_cast<uint64_t>(chunkIndex)*mChunkSize;
+		return static_cast<size_t>(std::max(static_cast<uint64_t>(offset), chunkStart) - chunkStart);
+	};
+	auto requestedEnd = [&](uint32_t chunkIndex) {
+		const uint64_t chunkStart = static_cast<uint64_t>(chunkIndex)*mChunkSize;
+		return static_cast<size_t>(std::min(static_cast<uint64_t>(offset+count), chunkStart+chunkPlainSizeGet(chunkIndex, mFileSize)) - chunkStart);
+	};
+
+	// chunks fully requested and held by a single buffer are decrypted directly in it
+	// the others, the first and last ones partially requested and the ones spread over several buffers, go through a temporary chunk
+	std::vector<size_t> tempChunkSlots(lastChunk-firstChunk+1, noTempChunk);
+	size_t tempChunkCount = 0;
+	for (uint32_t chunkIndex = firstChunk; chunkIndex <= lastChunk; chunkIndex++) {
+		const uint64_t chunkStart = static_cast<uint64_t>(chunkIndex)*mChunkSize;
+		const size_t chunkPlainSize = chunkPlainSizeGet(chunkIndex, mFileSize);
+		if (requestedBegin(chunkIndex) != 0 || requestedEnd(chunkIndex) != chunkPlainSize || plainData.contiguous(chunkStart-offset, chunkPlainSize) == nullptr) {
+			tempChunkSlots[chunkIndex-firstChunk] = tempChunkCount++;
+		}
+	}
+	std::vector<uint8_t> tempChunks(tempChunkCount*mChunkSize);
+	auto tempChunk = [&](uint32_t chunkIndex) {
+		return tempChunks.data() + tempChunkSlots[chunkIndex-firstChunk]*mChunkSize;
+	};
+
+	// serve what we can from the plain chunks cache, only read and decrypt the others
+	std::vector<bool> cached(lastChunk-firstChunk+1, false);
+	uint32_t readFirstChunk = lastChunk+1;
+	uint32_t readLastChunk = firstChunk;
+	for (uint32_t chunkIndex = firstChunk; chunkIndex <= lastChunk; chunkIndex++) {
+		const uint64_t chunkStart = static_cast<uint64_t>(chunkIndex)*mChunkSize;
+		const size_t begin = requestedBegin(chunkIndex);
+		const size_t end = requestedEnd(chunkIndex);
+		if (tempChunkSlots[chunkIndex-firstChunk] == noTempChunk) {
+			cached[chunkIndex-firstChunk] = plainCacheRead(chunkIndex, plainData.contiguous(chunkStart-offset, end), begin, end);
+		} else if (plainCacheRead(chunkIndex, tempChunk(chunkIndex)+begin, begin, end)) {
+			plainData.scatter(chunkStart+begin-offset, tempChunk(chunkIndex)+begin, end-begin);
+			cached[chunkIndex-firstChunk] = true;
+		}
+		if (!cached[chunkIndex-firstChunk]) {
+			readFirstChunk = std::min(readFirstChunk, chunkIndex);
+			readLastChunk = std::max(readLastChunk, chunkIndex);
+		}
+	}
+	if (readFirstChunk > lastChunk) { // everything was in cache
+		bctbx_clean(tempChunks.data(), tempChunks.size());
+		return count;
+	}
 
-	/* read all chunks from actual file */
-	ssize_t readSize = bctbx_file_read(pFileStd, rawData.data(), rawData.size(), getChunkOffset(firstChunk));
+	// one buffer large enough to store all the raw chunks to read: the last one may be incomplete
+	std::vector<uint8_t> rawData((readLastChunk-readFirstChunk)*rawChunkSize + chunkHeaderSize + chunkPlainSizeGet(readLastChunk, mFileSize));
+
+	// where each chunk full plain content is, to store it in cache
+	std::vector<const uint8_t *> plainChunks(readLastChunk-readFirstChunk+1, nullptr);
+
+	// each chunk is processed independently from the others
+	auto decryptChunk = [&](uint32_t chunkIndex) {
+		if (cached[chunkIndex-firstChunk]) return;
+		const uint64_t chunkStart = static_cast<uint64_t>(chunkIndex)*mChunkSize;
+		const size_t chunkPlainSize = chunkPlainSizeGet(chunkIndex, mFileSize);
+		const uint8_t *rawChunk = rawData.data() + (chunkIndex-readFirstChunk)*rawChunkSize;
+		const size_t begin = requestedBegin(chunkIndex);
+		const size_t end = requestedEnd(chunkIndex);
+
+		if (tempChunkSlots[chunkIndex-firstChunk] == noTempChunk) {
+			uint8_t *plainChunk = plainData.contiguous(chunkStart-offset, chunkPlainSize);
+			m_module->decryptChunk(chunkIndex, rawChunk, chunkHeaderSize+chunkPlainSize, plainChunk);
+			plainChunks[chunkIndex-readFirstChunk] = plainChunk;
+		} else {
+			uint8_t *plainChunk = tempChunk(chunkIndex);
+			m_module->decryptChunk(chunkIndex, rawChunk, chunkHeaderSize+chunkPlainSize, plainChunk);
+			plainData.scatter(chunkStart+begin-offset, plainChunk+begin, end-begin);
+			plainChunks[chunkIndex-readFirstChunk] = plainChunk;
+		}
+	};
+
+	// raw size of the chunks [first, first+n[, the last one may be incomplete
+	auto rawBlockSize = [&](uint32_t first, uint32_t n) {
+		const uint32_t last = first+n-1;
+		return (last-first)*rawChunkSize + chunkHeaderSize + chunkPlainSizeGet(last, mFileSize);
+	};
+	auto checkReadSize = [&](ssize_t readSize, uint32_t first, uint32_t n) {
+		if (readSize < 0) {
+			throw EVFS_EXCEPTION<<"fail to read file "<<mFilename<<" file_read returned "<<readSize;
+		}
+		if (static_cast<size_t>(readSize) != rawBlockSize(first, n)) {
+			throw EVFS_EXCEPTION<<"fail to read file "<<mFilename<<" expected "<<rawBlockSize(first, n)<<" bytes at offset "<<getChunkOffset(first)<<" but got only "<<readSize;
+		}
+	};
 
-	/* resize rawData to the actual content size - last chunk may be incomplete */
-	if (readSize >= 0) {
-		rawData.resize(readSize);
-	} else {
-		throw EVFS_EXCEPTION<<"fail to read file "<<mFilename<<" file_read returned "<<readSize;
-	}
+	// large reads are pipelined: the next block of raw chunks is read while the current one is decrypted
+	const uint32_t blockChunks = static_cast<uint32_t>(std::max(readPipelineBlockSize/rawChunkSize, static_cast<size_t>(1)));
+	uint32_t first = readFirstChunk;
+	uint32_t n = std::min(blockChunks, readLastChunk-readFirstChunk+1);
+	try {
+		checkReadSize(bctbx_file_read(pFileStd, rawData.data(), rawBlockSize(first, n), getChunkOffset(first)), first, n);
+		while (n > 0) {
+			const uint32_t nextFirst = first+n;
+			const uint32_t nextN = std::min(blockChunks, readLastChunk+1-nextFirst);
+			std::future<ssize_t> nextRead{};
+			if (nextN > 0) {
+				nextRead = fileReadAsync(pFileStd, rawData.data()+(nextFirst-readFirstChunk)*rawChunkSize, rawBlockSize(nextFirst, nextN), getChunkOffset(nextFirst));
+			}
 
-	std::vector<uint8_t> plainData{};
-	plainData.reserve((lastChunk-firstChunk+1)*mChunkSize);
+			try {
+				auto workers = workerPoolGet(n);
+				if (workers != nullptr) {
+					workers->parallelFor(n, [&](size_t i) {decryptChunk(first+static_cast<uint32_t>(i));});
+				} else {
+					for (uint32_t chunkIndex = first; chunkIndex < first+n; chunkIndex++) {
+						decryptChunk(chunkIndex);
+					}
+				}
+			} catch (...) {
+				if (nextRead.valid()) {
+					nextRead.wait(); // it uses our buffer
+				}
+				throw;
+			}
 
-	// decrypt everything we have chunk by chunk, use firstChunk as chunk index
-	while (rawData.size() > m_module->getChunkHeaderSize()) {
-		std::vector<uint8_t> plainChunk = m_module->decryptChunk(firstChunk++, std::vector<uint8_t>(rawData.cbegin(), rawData.cbegin()+std::min(rawChunkSizeGet(), rawData.size())));
-		plainData.insert(plainData.end(), plainChunk.cbegin(), plainChunk.cend());
-		// remove the decrypted chunk
-		rawData.erase(rawData.begin(), rawData.begin()+std::min(rawChunkSizeGet(), rawData.size()));
+			if (nextRead.valid()) {
+				checkReadSize(nextRead.get(), nextFirst, nextN);
+			}
+			first = nextFirst;
+			n = nextN;
+		}
+	} catch (...) { // temporary chunks may hold plain data from the cache or decrypted
+		bctbx_clean(tempChunks.data(), tempChunks.size());
+		throw;
 	}
 
-	// return only the requested part
-	plainData.erase(plainData.begin(), plainData.begin()+std::min(offsetInFirstChunk, plainData.size())); // remove unwanted chunk begining
-	if (count<plainData.size()) { // if we have too much data, remove the end
-		plainData.erase(plainData.begin()+count, plainData.end());
+	for (uint32_t chunkIndex = readFirstChunk; chunkIndex <= readLastChunk; chunkIndex++) {
+		if (plainChunks[chunkIndex-readFirstChunk] != nullptr) {
+			plainCacheStore(chunkIndex, plainChunks[chunkIndex-readFirstChunk], chunkPlainSizeGet(chunkIndex, mFileSize));
+		}
 	}
-	return plainData;
+	bctbx_clean(tempChunks.data(), tempChunks.size());
+
+	return count;
 }
 
 size_t VfsEncryption::write(const std::vector<uint8_t> &plainData, size_t offset) {
+	return write(plainData.data(), plainData.size(), offset);
+}
+
+size_t VfsEncryption::write(const uint8_t *plainData, size_t count, size_t offset) {
+	const bctbx_iovec_t iov = {const_cast<uint8_t *>(plainData), count};
+	return writev(&iov, 1, offset);
+}
+
+size_t VfsEncryption::writev(const bctbx_iovec_t *iov, int iovcnt, size_t offset) {
+	const PlainBuffers plainData(iov, iovcnt);
+	const size_t count = plainData.size();
 	// plain file?
 	if (m_module == nullptr) {
-		ssize_t ret = bctbx_file_write(pFileStd, plainData.data(), plainData.size(), offset);
-		if ( ret - plainData.size() == 0) { // compare signed and unsigned
-			return plainData.size();
+		ssize_t ret = bctbx_file_writev(pFileStd, iov, iovcnt, offset);
+		if ( ret - count == 0) { // compare signed and unsigned
+			return count;
 		} else {
 			throw EVFS_EXCEPTION<<"plain file fail to write to physical file "<< ret;
 		}
 	}
 
-	auto plain = plainData; // work on a local copy as we may modify it
-	uint64_t finalFileSize = std::max(mFileSize, static_cast<decltype(mFileSize)>(plain.size()+offset)); // we might need to increase the file size
+	discardPendingRekey();
 
-	// Are we writing after the end of the file, if yes, prepend with zeros
-	if (offset > mFileSize) {
-		plain.insert(plain.begin(), offset-static_cast<size_t>(mFileSize), 0);
-		offset = static_cast<size_t>(mFileSize);
+	const uint64_t finalFileSize = std::max(mFileSize, static_cast<uint64_t>(offset+count)); // we might need to increase the file size
+	// When writing after the end of the file, the gap from current end of file is filled with zeros
+	const uint64_t writeStart = std::min(static_cast<uint64_t>(offset), mFileSize);
+	const uint64_t writeEnd = offset+count;
+	if (writeEnd <= writeStart) { // nothing to write
+		return 0;
 	}
 
-	uint32_t firstChunk = getChunkIndex(offset);
-	uint32_t lastChunk = getChunkIndex(offset+plain.size()-1); // -1 as we write data from indexes offset to offset + data size - 1
-	size_t rawDataSize = (lastChunk-firstChunk+1)*rawChunkSizeGet(); // maximum size used, last chunk might be incomplete
-	std::vector<uint8_t> rawData{}; // Store the existing encrypted chunks with header that are overwritten by this operation
-
-	// Are we overwritting some chunks?
-	size_t readOffset = offset - offset%mChunkSize; // we must start read/write at the begining of a chunk
-	if (readOffset<mFileSize) { // Yes we are overwritting some data, read all the existing chunks we are overwritting
-		rawData.resize(rawDataSize);
-		ssize_t overwrittenSize = bctbx_file_read(pFileStd, rawData.data(), rawDataSize, getChunkOffset(firstChunk));
-		rawData.resize(overwrittenSize);
-		rawData.shrink_to_fit();
-	}
-
-	// prepend the plain buffer if needed
-	if (readOffset<offset) { // we need to get the plain data from readOffset to offset
-		// decrypt the first chunk
-		auto plainChunk = m_module->decryptChunk(firstChunk, std::vector<uint8_t>(rawData.cbegin(), rawData.cbegin() + std::min(rawChunkSizeGet(), rawData.size())));
-		plain.insert(plain.begin(), plainChunk.cbegin(), plainChunk.cbegin()+offset-readOffset); // prepend the begining to our plain buffer
-	}
-
-	// append the plain buffer if needed:
-	if ((plain.size()%mChunkSize != 0) && (plain.size()+readOffset < mFileSize)){ // We do not have an integer number of chunks to write and we have data after our last written byte
-		auto plainChunk = m_module->decryptChunk(lastChunk, std::vector<uint8_t>(rawData.cbegin()+getChunkOffset(lastChunk)-getChunkOffset(firstChunk), rawData.cbegin()+std::min(getChunkOffset(lastChunk+1)-getChunkOffset(firstChunk), rawData.size())));
-		plain.insert(plain.end(), plainChunk.cbegin()+(plain.size()%mChunkSize), plainChunk.cend()); // append what is over the part we will write.
-	}
-
-	// encrypt the overwritten chunks
-	std::vector<uint8_t> updatedRawData{};
-	updatedRawData.reserve(rawDataSize);
-	uint32_t currentChunkIndex = firstChunk;
-	while (rawData.size()>0) {
-		// get a chunk to re-encrypt
-		std::vector<uint8_t> rawChunk(rawData.cbegin(), rawData.cbegin()+std::min(rawChunkSizeGet(), rawData.size()));
-		// delete it
-		rawData.erase(rawData.begin(), rawData.begin()+std::min(rawChunkSizeGet(), rawData.size()));
-		// re-encrypt
-		m_module->encryptChunk(currentChunkIndex++, rawChunk, std::vector<uint8_t>(plain.cbegin(), plain.cbegin()+std::min(mChunkSize, plain.size())));
-		// delete consumed plain
-		plain.erase(plain.begin(), plain.begin()+std::min(mChunkSize, plain.size()));
-		// store the result
-		updatedRawData.insert(updatedRawData.end(), rawChunk.cbegin(), rawChunk.cend());
-	}
-
-	// add new chunks if some data remains in the plain buffer
-	while (plain.size()>0) {
-		auto rawChunk = m_module->encryptChunk(currentChunkIndex++, std::vector<uint8_t>(plain.cbegin(), plain.cbegin()+std::min(mChunkSize, plain.size())));
-		// delete consumed plain
-		plain.erase(plain.begin(), plain.begin()+std::min(mChunkSize, plain.size()));
-		// store the result
-		updatedRawData.insert(updatedRawData.end(), rawChunk.cbegin(), rawChunk.cend());
+	const uint32_t firstChunk = getChunkIndex(writeStart);
+	const uint32_t lastChunk = getChunkIndex(writeEnd-1); // -1 as we write data from indexes writeStart to writeEnd - 1
+	const uint32_t offsetChunk = getChunkIndex(offset);
+	const size_t chunkHeaderSize = m_module->getChunkHeaderSize();
+	const size_t rawChunkSize = rawChunkSizeGet();
+
+	// One buffer to hold all the chunks we are writing, last chunk might be incomplete
+	std::vector<uint8_t> rawData((lastChunk-firstChunk)*rawChunkSize + chunkHeaderSize + chunkPlainSizeGet(lastChunk, finalFileSize));
+
+	// Are we overwritting some chunks? Read them all, they are re-encrypted in place
+	uint32_t existingChunks = getChunkIndex(mFileSize + mChunkSize - 1); // number of chunks in the file
+	if (firstChunk < existingChunks) {
+		uint32_t lastExistingChunk = std::min(lastChunk, existingChunks-1);
+		size_t overwrittenSize = (lastExistingChunk-firstChunk)*rawChunkSize + chunkHeaderSize + chunkPlainSizeGet(lastExistingChunk, mFileSize);
+		ssize_t readSize = bctbx_file_read(pFileStd, rawData.data(), overwrittenSize, getChunkOffset(firstChunk));
+		if (readSize < 0 || static_cast<size_t>(readSize) != overwrittenSize) {
+			throw EVFS_EXCEPTION<<"fail to read file "<<mFilename<<" expected "<<overwrittenSize<<" bytes at offset "<<getChunkOffset(firstChunk)<<" but file_read returned "<<readSize;
+		}
+	}
+
+	// Chunks fully overwritten and held by a single buffer are encrypted directly from it, others get their plain content assembled in a temporary chunk:
+	// the first and last ones which may hold existing data, the one holding offset when writing after the end of file
+	// and the ones spread over several buffers. Chunks in between the end of file and offset are only zeros
+	auto fullyOverwritten = [&](uint32_t chunkIndex) {
+		const uint64_t chunkStart = static_cast<uint64_t>(chunkIndex)*mChunkSize;
+		return offset <= chunkStart && writeEnd >= chunkStart+chunkPlainSizeGet(chunkIndex, finalFileSize);
+	};
+	auto inGap = [&](uint32_t chunkIndex) {
+		return !fullyOverwritten(chunkIndex) && chunkIndex != firstChunk && chunkIndex != lastChunk && chunkIndex != offsetChunk;
+	};
+	std::vector<size_t> tempChunkSlots(lastChunk-firstChunk+1, noTempChunk);
+	size_t tempChunkCount = 0;
+	for (uint32_t chunkIndex = firstChunk; chunkIndex <= lastChunk; chunkIndex++) {
+		if (inGap(chunkIndex)) continue;
+		if (!fullyOverwritten(chunkIndex)
+			|| plainData.contiguous(static_cast<uint64_t>(chunkIndex)*mChunkSize-offset, chunkPlainSizeGet(chunkIndex, finalFileSize)) == nullptr) {
+			tempChunkSlots[chunkIndex-firstChunk] = tempChunkCount++;
+		}
+	}
+	std::vector<uint8_t> tempChunks(tempChunkCount*mChunkSize);
+	std::vector<uint8_t> zeroChunk{};
+	if (offset > mFileSize + mChunkSize) { // there might be a full chunk of zeros between end of file and offset
+		zeroChunk.resize(mChunkSize, 0);
+	}
+
+	// where each chunk full plain content is, to store it in cache
+	std::vector<const uint8_t *> plainChunks(lastChunk-firstChunk+1, nullptr);
+
+	// each chunk is processed independently from the others
+	auto encryptChunk = [&](uint32_t chunkIndex) {
+		const uint64_t chunkStart = static_cast<uint64_t>(chunkIndex)*mChunkSize;
+		const size_t chunkPlainSize = chunkPlainSizeGet(chunkIndex, finalFileSize);
+		const size_t existingPlainSize = chunkPlainSizeGet(chunkIndex, mFileSize);
+		uint8_t *rawChunk = rawData.data() + (chunkIndex-firstChunk)*rawChunkSize;
+		const uint8_t *plainChunk = nullptr;
+
+		if (inGap(chunkIndex)) {
+			plainChunk = zeroChunk.data();
+		} else if (tempChunkSlots[chunkIndex-firstChunk] == noTempChunk) { // fully overwritten from a single buffer
+			plainChunk = plainData.contiguous(chunkStart-offset, chunkPlainSize);
+		} else {
+			uint8_t *assembledChunk = tempChunks.data() + tempChunkSlots[chunkIndex-firstChunk]*mChunkSize;
+			if (fullyOverwritten(chunkIndex)) {
+				plainData.gather(chunkStart-offset, chunkPlainSize, assembledChunk);
+			} else {
+				std::fill(assembledChunk, assembledChunk+chunkPlainSize, 0);
+				if (existingPlainSize > 0 && !plainCacheRead(chunkIndex, assembledChunk, 0, existingPlainSize)) {
+					m_module->decryptChunk(chunkIndex, rawChunk, chunkHeaderSize+existingPlainSize, assembledChunk);
+				}
+				const uint64_t from = std::max(static_cast<uint64_t>(offset), chunkStart);
+				const uint64_t to = std::min(writeEnd, chunkStart+chunkPlainSize);
+				if (to > from) {
+					plainData.gather(static_cast<size_t>(from-offset), static_cast<size_t>(to-from), assembledChunk+(from-chunkStart));
+				}
+			}
+			plainChunk = assembledChunk;
+		}
+		plainChunks[chunkIndex-firstChunk] = plainChunk;
+
+		if (existingPlainSize > 0) {
+			m_module->encryptChunk(chunkIndex, rawChunk, chunkHeaderSize+existingPlainSize, plainChunk, chunkPlainSize);
+		} else {
+			m_module->encryptChunk(chunkIndex, plainChunk, chunkPlainSize, rawChunk);
+		}
+	};
+
+	try {
+		auto workers = workerPoolGet(lastChunk-firstChunk+1);
+		if (workers != nullptr) {
+			workers->parallelFor(lastChunk-firstChunk+1, [&](size_t i) {encryptChunk(firstChunk+static_cast<uint32_t>(i));});
+		} else {
+			for (uint32_t chunkIndex = firstChunk; chunkIndex <= lastChunk; chunkIndex++) {
+				encryptChunk(chunkIndex);
+			}
+		}
+	} catch (...) {
+		bctbx_clean(tempChunks.data(), tempChunks.size());
+		throw;
 	}
 
 	// now actually write the rawData in the file
-	ssize_t ret = bctbx_file_write(pFileStd, updatedRawData.data(), updatedRawData.size(), getChunkOffset(firstChunk));
-	if ( ret - updatedRawData.size() == 0) { // compare signed and unsigned
-		mFileSize = finalFileSize;
-		writeHeader();
-		return plainData.size();
+	ssize_t ret = bctbx_file_write(pFileStd, rawData.data(), rawData.size(), getChunkOffset(firstChunk));
+	if ( ret - rawData.size() == 0) { // compare signed and unsigned
+		for (uint32_t chunkIndex = firstChunk; chunkIndex <= lastChunk; chunkIndex++) {
+			plainCacheStore(chunkIndex, plainChunks[chunkIndex-firstChunk], chunkPlainSizeGet(chunkIndex, finalFileSize));
+		}
+		bctbx_clean(tempChunks.data(), tempChunks.size());
+		// header holds the file size: no need to rewrite it if it did not change
+		if (finalFileSize != mFileSize) {
+			mFileSize = finalFileSize;
+			if (mHeaderWriteBack) {
+				mHeaderDirty = true;
+			} else {
+				writeHeader();
+			}
+		}
+		return count;
 	} else {
+		bctbx_clean(tempChunks.data(), tempChunks.size());
 		throw EVFS_EXCEPTION<<"fail to write to physical file "<<mFilename<<" file_write "<< ret;
 	}
 }
@@ -683,6 +1384,8 @@ void VfsEncryption::truncate(const uint64_t newSize) {
 		return;
 	}
 
+	discardPendingRekey();
+
 	// if current size is smaller, just write 0 at the end
 	if (mFileSize < newSize) {
 		write(std::vector<uint8_t>{}, static_cast<size_t>(newSize)); // write nothing at new size index, the gap is filled with 0 by write
@@ -692,24 +1395,33 @@ void VfsEncryption::truncate(const uint64_t newSize) {
 	if (mFileSize > newSize) {
 		// If the last chunk is modified, we must re-encrypt it
 		if (newSize%mChunkSize != 0) {
+			const uint32_t lastChunk = getChunkIndex(newSize);
+			const size_t chunkHeaderSize = m_module->getChunkHeaderSize();
+			const size_t existingRawSize = chunkHeaderSize + chunkPlainSizeGet(lastChunk, mFileSize);
 			// allocate a vector large enough to store a complete chunk
 			std::vector<uint8_t> rawData(rawChunkSizeGet());
 
 			// read the future last chunk from actual file
-			ssize_t readSize = bctbx_file_read(pFileStd, rawData.data(), rawData.size(), getChunkOffset(getChunkIndex(newSize)));
-			rawData.resize(readSize);
-			// decrypt it
-			auto plainLastChunk = m_module->decryptChunk(getChunkIndex(newSize), std::vector<uint8_t>(rawData.cbegin(), rawData.cbegin()+std::min(rawChunkSizeGet(), rawData.size())));
-			// truncate the part we don't need anymore
-			plainLastChunk.resize(newSize%mChunkSize);
-			// re-encrypt it
-			m_module->encryptChunk(getChunkIndex(newSize), rawData, std::vector<uint8_t>(plainLastChunk.cbegin(), plainLastChunk.cend()));
+			ssize_t readSize = bctbx_file_read(pFileStd, rawData.data(), existingRawSize, getChunkOffset(lastChunk));
+			if (readSize < 0 || static_cast<size_t>(readSize) != existingRawSize) {
+				throw EVFS_EXCEPTION << "Cannot read file "<<mFilename<<" during truncate";
+			}
+			// decrypt it, unless we have it in cache
+			std::vector<uint8_t> plainLastChunk(existingRawSize - chunkHeaderSize);
+			if (!plainCacheRead(lastChunk, plainLastChunk.data(), 0, plainLastChunk.size())) {
+				m_module->decryptChunk(lastChunk, rawData.data(), existingRawSize, plainLastChunk.data());
+			}
+			// re-encrypt only the part we keep
+			const size_t newPlainSize = chunkPlainSizeGet(lastChunk, newSize);
+			m_module->encryptChunk(lastChunk, rawData.data(), existingRawSize, plainLastChunk.data(), newPlainSize);
 
 			/* write it to the actual file */
-			if (bctbx_file_write(pFileStd, rawData.data(), rawData.size(), getChunkOffset(getChunkIndex(newSize))) - rawData.size() != 0) {
+			if (bctbx_file_write(pFileStd, rawData.data(), chunkHeaderSize+newPlainSize, getChunkOffset(lastChunk)) - (chunkHeaderSize+newPlainSize) != 0) {
 				throw EVFS_EXCEPTION << "Cannot write file "<<mFilename<<" during truncate";
 			}
 		}
+		// cached chunks are now out of the file or shorter
+		plainCacheDrop(getChunkIndex(newSize));
 		// update file size in meta data
 		mFileSize = newSize;
 		// truncate the actual file
@@ -719,6 +1431,114 @@ void VfsEncryption::truncate(const uint64_t newSize) {
 	}
 }
 
+bool VfsEncryption::integrityCheck(uint32_t &firstBadChunk, const EncryptedVfsProgressCb &progress) const {
+	if (m_module == nullptr) {
+		throw EVFS_EXCEPTION<<"Cannot check integrity of plain file "<<mFilename;
+	}
+	const uint32_t chunkCount = getChunkIndex(mFileSize + mChunkSize - 1);
+	if (chunkCount == 0) return true;
+
+	const size_t chunkHeaderSize = m_module->getChunkHeaderSize();
+	const size_t rawChunkSize = rawChunkSizeGet();
+	const uint32_t blockChunks = static_cast<uint32_t>(std::max(integrityCheckBlockSize/rawChunkSize, static_cast<size_t>(1)));
+
+	// use the worker pool whatever the chunk threshold is, or a temporary one
+	auto workers = workerPoolGet(std::numeric_limits<size_t>::max());
+	if (workers == nullptr && std::thread::hardware_concurrency() > 1) {
+		workers = std::make_shared<WorkerPool>(std::thread::hardware_concurrency()-1); // the calling thread is working too
+	}
+
+	// Start reading the raw data of the chunks [first, first+count[ in the given buffer on the I/O threads
+	auto readBlock = [this, rawChunkSize, chunkHeaderSize](uint32_t first, uint32_t count, std::vector<uint8_t> &rawData) {
+		const uint32_t last = first+count-1;
+		const size_t size = (last-first)*rawChunkSize + chunkHeaderSize + chunkPlainSizeGet(last, mFileSize);
+		return fileReadAsync(pFileStd, rawData.data(), size, getChunkOffset(first));
+	};
+	// Wait for a block read, returns the number of bytes read
+	auto readSizeGet = [this](std::future<ssize_t> &read) {
+		ssize_t readSize = read.get();
+		if (readSize < 0) {
+			throw EVFS_EXCEPTION<<"fail to read file "<<mFilename<<" while checking its integrity, file_read returned "<<readSize;
+		}
+		return static_cast<size_t>(readSize);
+	};
+
+	// two raw buffers: the next block is read while the current one is authenticated
+	std::vector<uint8_t> rawData(static_cast<size_t>(blockChunks)*rawChunkSize);
+	std::vector<uint8_t> nextRawData(rawData.size());
+	std::vector<uint8_t> plainData(static_cast<size_t>(blockChunks)*mChunkSize);
+
+	uint32_t first = 0;
+	uint32_t count = std::min(blockChunks, chunkCount);
+	std::future<ssize_t> nextRead = readBlock(first, count, rawData);
+	try {
+		size_t readSize = readSizeGet(nextRead);
+		while (count > 0) {
+			// start reading the next block
+			const uint32_t nextFirst = first+count;
+			const uint32_t nextCount = std::min(blockChunks, chunkCount-nextFirst);
+			if (nextCount > 0) {
+				nextRead = readBlock(nextFirst, nextCount, nextRawData);
+			}
+
+			// authenticate the current one
+			std::atomic<uint32_t> badChunk{std::numeric_limits<uint32_t>::max()};
+			auto checkChunk = [&](size_t i) {
+				const uint32_t chunkIndex = first+static_cast<uint32_t>(i);
+				const size_t chunkPlainSize = chunkPlainSizeGet(chunkIndex, mFileSize);
+				try {
+					if (i*rawChunkSize + chunkHeaderSize + chunkPlainSize > readSize) { // this chunk is missing in the file
+						throw EVFS_EXCEPTION<<"chunk "<<chunkIndex<<" is missing";
+					}
+					m_module->decryptChunk(chunkIndex, rawData.data()+i*rawChunkSize, chunkHeaderSize+chunkPlainSize, plainData.data()+i*mChunkSize);
+				} catch (EvfsException const &) {
+					uint32_t current = badChunk.load();
+					while (chunkIndex < current && !badChunk.compare_exchange_weak(current, chunkIndex));
+				}
+			};
+			if (workers != nullptr) {
+				workers->parallelFor(count, checkChunk);
+			} else {
+				for (size_t i=0; i<count; i++) {
+					checkChunk(i);
+				}
+			}
+
+			if (nextRead.valid()) {
+				readSize = readSizeGet(nextRead); // wait for the read to complete before any exit: it uses our buffers
+			}
+			if (badChunk.load() != std::numeric_limits<uint32_t>::max()) {
+				firstBadChunk = badChunk.load();
+				bctbx_clean(plainData.data(), plainData.size());
+				return false;
+			}
+			if (progress) {
+				progress(nextFirst, chunkCount);
+			}
+
+			std::swap(rawData, nextRawData);
+			first = nextFirst;
+			count = nextCount;
+		}
+	} catch (...) {
+		if (nextRead.valid()) {
+			nextRead.wait(); // it uses our buffers
+		}
+		bctbx_clean(plainData.data(), plainData.size());
+		throw;
+	}
+
+	bctbx_clean(plainData.data(), plainData.size());
+	return true;
+}
+
+int VfsEncryption::sync() {
+	if (mHeaderDirty) {
+		writeHeader();
+	}
+	return bctbx_file_sync(pFileStd);
+}
+
 std::string VfsEncryption::filenameGet() const noexcept {
 	return mFilename;
 }
@@ -758,13 +1578,17 @@ static int bcClose(bctbx_vfs_file_t *pFile) {
 }
 
 /**
- * Simply sync the file contents given through the file handle
- * Just forward the request to underlying vfs
+ * Sync the file contents given through the file handle
+ * Write the pending header update if any and forward the request to underlying vfs
  */
 static int bcSync(bctbx_vfs_file_t *pFile) {
 	if (pFile && pFile->pUserData) {
 		VfsEncryption *ctx = static_cast<VfsEncryption *>(pFile->pUserData);
-		return bctbx_file_sync(ctx->pFileStd);
+		try {
+			return ctx->sync();
+		} catch (EvfsException const &e) { // cannot let raise an exception to a C context
+			BCTBX_SLOGE<<"Encrypted VFS: error while syncing file "<<ctx->filenameGet()<<". "<<e;
+		}
 	}
 	return BCTBX_VFS_ERROR;
 }
@@ -785,10 +1609,7 @@ static ssize_t bcRead(bctbx_vfs_file_t *pFile, void *buf, size_t count, off_t of
 		VfsEncryption *ctx = static_cast<VfsEncryption *>(pFile->pUserData);
 
 		try {
-			auto readBuffer = ctx->read(offset, count);
-
-			memcpy (buf, readBuffer.data(), readBuffer.size());
-			return readBuffer.size();
+			return ctx->read(static_cast<uint8_t *>(buf), count, offset);
 		} catch (EvfsException const &e) { // cannot let raise an exception to a C context
 			BCTBX_SLOGE<<"Encrypted VFS: error while reading "<<count<<" bytes from file "<<ctx->filenameGet()<<" at offset "<<offset<<". "<<e;
 		}
@@ -810,7 +1631,53 @@ static ssize_t bcWrite(bctbx_vfs_file_t *pFile, const void *buf, size_t count, o
 	if (offset < 0 ) return BCTBX_VFS_ERROR;
 	if (pFile && pFile->pUserData) {
 		VfsEncryption *ctx = static_cast<VfsEncryption *>(pFile->pUserData);
-		return ctx->write(std::vector<uint8_t>(reinterpret_cast<const uint8_t *>(buf), reinterpret_cast<const uint8_t *>(buf)+count), offset);
+		try {
+			return ctx->write(static_cast<const uint8_t *>(buf), count, offset);
+		} catch (EvfsException const &e) { // cannot let raise an exception to a C context
+			BCTBX_SLOGE<<"Encrypted VFS: error while writing "<<count<<" bytes to file "<<ctx->filenameGet()<<" at offset "<<offset<<". "<<e;
+		}
+	}
+	return BCTBX_VFS_ERROR;
+}
+
+/**
+ * Reads into several buffers: the chunks are read and decrypted once for all of them.
+ * @param  pFile  File handle pointer.
+ * @param  iov    buffers to write the read bytes to.
+ * @param  iovcnt number of buffers
+ * @param  offset file offset where to start reading
+ * @return number of bytes read, BCTBX_VFS_ERROR on error
+ */
+static ssize_t bcReadv(bctbx_vfs_file_t *pFile, const bctbx_iovec_t *iov, int iovcnt, off_t offset) {
+	if (offset < 0) return BCTBX_VFS_ERROR;
+	if (pFile && pFile->pUserData) {
+		VfsEncryption *ctx = static_cast<VfsEncryption *>(pFile->pUserData);
+		try {
+			return static_cast<ssize_t>(ctx->readv(iov, iovcnt, offset));
+		} catch (EvfsException const &e) { // cannot let raise an exception to a C context
+			BCTBX_SLOGE<<"Encrypted VFS: error while reading "<<iovcnt<<" buffers from file "<<ctx->filenameGet()<<" at offset "<<offset<<". "<<e;
+		}
+	}
+	return BCTBX_VFS_ERROR;
+}
+
+/**
+ * Writes several buffers as a single write: each chunk is encrypted once and the header is updated once.
+ * @param  pFile   File handle pointer.
+ * @param  iov     buffers containing data to write
+ * @param  iovcnt  number of buffers
+ * @param  offset  File offset where to write to
+ * @return number of bytes written, BCTBX_VFS_ERROR on error
+ */
+static ssize_t bcWritev(bctbx_vfs_file_t *pFile, const bctbx_iovec_t *iov, int iovcnt, off_t offset) {
+	if (offset < 0) return BCTBX_VFS_ERROR;
+	if (pFile && pFile->pUserData) {
+		VfsEncryption *ctx = static_cast<VfsEncryption *>(pFile->pUserData);
+		try {
+			return static_cast<ssize_t>(ctx->writev(iov, iovcnt, offset));
+		} catch (EvfsException const &e) { // cannot let raise an exception to a C context
+			BCTBX_SLOGE<<"Encrypted VFS: error while writing "<<iovcnt<<" buffers to file "<<ctx->filenameGet()<<" at offset "<<offset<<". "<<e;
+		}
 	}
 	return BCTBX_VFS_ERROR;
 }
@@ -844,8 +1711,12 @@ static int bcTruncate(bctbx_vfs_file_t *pFile, int64_t new_size){
 
 	if (pFile && pFile->pUserData) {
 		VfsEncryption *ctx = static_cast<VfsEncryption *>(pFile->pUserData);
-		ctx->truncate(new_size);
-		return 0;
+		try {
+			ctx->truncate(new_size);
+			return 0;
+		} catch (EvfsException const &e) { // cannot let raise an exception to a C context
+			BCTBX_SLOGE<<"Encrypted VFS: error while truncating file "<<ctx->filenameGet()<<" to "<<new_size<<" bytes. "<<e;
+		}
 	}
 	return ret;
 }
@@ -874,6 +1745,26 @@ static const  bctbx_io_methods_t bcio = {
 	bcIsEncrypted
 };
 
+/**
+ * Reading ahead by whole chunks avoids decrypting them several times
+ * @param  pFile File handle pointer.
+ * @return the chunk size, 0 on plain files to use the default
+ */
+static size_t bcGetBlockSize(bctbx_vfs_file_t *pFile) {
+	if (pFile && pFile->pUserData) {
+		VfsEncryption *ctx = static_cast<VfsEncryption *>(pFile->pUserData);
+		return (ctx->encryptionSuiteGet() == bctoolbox::EncryptionSuite::plain)?0:ctx->chunkSizeGet();
+	}
+	return 0;
+}
+
+static const bctbx_io_methods_ext_t bcioext = {
+	sizeof(bctbx_io_methods_ext_t),	/* size */
+	bcReadv,
+	bcWritev,
+	bcGetBlockSize
+};
+
 
 
 static int bcOpen(bctbx_vfs_t *pVfs, bctbx_vfs_file_t *pFile, const char *fName, int openFlags) {
@@ -895,6 +1786,8 @@ static int bcOpen(bctbx_vfs_t *pVfs, bctbx_vfs_file_t *pFile, const char *fName,
 		stdFp = bctbx_file_open2(bctbx_vfs_get_standard(), fName, openFlags);
 		if (stdFp == NULL) return BCTBX_VFS_ERROR;
 
+		static const int extRegistered = bctbx_io_methods_set_ext(&bcio, &bcioext); // once, at first opening
+		(void)extRegistered;
 		pFile->pMethods = &bcio;
 
 		ctx = new VfsEncryption(stdFp, fName, openFlags, accessMode);
@@ -56,26 +56,38 @@ class VfsEncryptionModule {
 		 */
 		virtual size_t getSecretMaterialSize() const noexcept = 0;
 
+		/**
+		 * Set the maximum number of entries in the module chunk keys cache
+		 * Modules not deriving per chunk keys just ignore it
+		 */
+		virtual void setChunkKeyCacheSize(size_t /*size*/) noexcept {};
+
 		/**
 		 * Decrypt a data chunk
-		 * @param[in] a vector which size shall be chunkHeaderSize + chunkSize holding the raw data read from disk
-		 * @return the decrypted data chunk
+		 * @param[in]	chunkIndex	The chunk index
+		 * @param[in]	rawChunk	the raw data read from disk: chunk header followed by the cipher text
+		 * @param[in]	rawChunkSize	size of rawChunk, at most chunkHeaderSize + chunkSize
+		 * @param[out]	plainData	buffer to store the decrypted data chunk, must hold rawChunkSize - chunkHeaderSize bytes
 		 */
-		virtual std::vector<uint8_t> decryptChunk(const uint32_t chunkIndex, const std::vector<uint8_t> &rawChunk) = 0;
+		virtual void decryptChunk(const uint32_t chunkIndex, const uint8_t *rawChunk, const size_t rawChunkSize, uint8_t *plainData) = 0;
 
 		/**
-		 * ReEncrypt a data chunk
-		 * @param[in/out] rawChunk	The existing encrypted chunk
-		 * @param[in]     plainData	The plain text to be encrypted
+		 * ReEncrypt a data chunk, in place
+		 * @param[in]		chunkIndex	The chunk index
+		 * @param[in/out]	rawChunk	The existing encrypted chunk, replaced by the new one. Buffer must hold chunkHeaderSize + plainDataSize bytes
+		 * @param[in]		rawChunkSize	The size of the existing encrypted chunk
+		 * @param[in]		plainData	The plain text to be encrypted
+		 * @param[in]		plainDataSize	The plain text size, at most chunkSize
 		 */
-		virtual void encryptChunk(const uint32_t chunkIndex, std::vector<uint8_t> &rawChunk, const std::vector<uint8_t> &plainData) = 0;
+		virtual void encryptChunk(const uint32_t chunkIndex, uint8_t *rawChunk, const size_t rawChunkSize, const uint8_t *plainData, const size_t plainDataSize) = 0;
 		/**
 		 * Encrypt a new data chunk
 		 * @param[in]	chunkIndex	The chunk index
 		 * @param[in]	plainData	The plain text to be encrypted
-		 * @return the encrypted chunk
+		 * @param[in]	plainDataSize	The plain text size, at most chunkSize
+		 * @param[out]	rawChunk	The encrypted chunk, buffer must hold chunkHeaderSize + plainDataSize bytes
 		 */
-		virtual std::vector<uint8_t> encryptChunk(const uint32_t chunkIndex, const std::vector<uint8_t> &plainData) = 0;
+		virtual void encryptChunk(const uint32_t chunkIndex, const uint8_t *plainData, const size_t plainDataSize, uint8_t *rawChunk) = 0;
 
 		/**
 		 * Check the integrity over the whole file
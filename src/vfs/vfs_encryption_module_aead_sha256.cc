@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2016-2020 Belledonne Communications SARL.
+ *
+ * This file is part of bctoolbox.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "vfs_encryption_module_aead_sha256.hh"
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include "bctoolbox/crypto.hh"
+#include "bctoolbox/crypto.h" // bctbx_clean
+
+#include "bctoolbox/logging.h"
+using namespace bctoolbox;
+/**
+ * Constants associated to this encryption module
+ */
+
+/** Chunk Header in this module holds: Auth tag(16 bytes), IV : 12 bytes, Encryption Counter 4 bytes
+ */
+static constexpr size_t chunkAuthTagSize = 16;
+static constexpr size_t chunkIVSize = 12;
+static constexpr size_t chunkHeaderSize = chunkAuthTagSize + chunkIVSize;
+/**
+ * File header holds: fileSalt (16 bytes), file header auth tag(32 bytes)
+ */
+static constexpr size_t fileSaltSize = 16;
+static constexpr size_t fileAuthTagSize = 32;
+static constexpr size_t fileHeaderSize = fileSaltSize + fileAuthTagSize;
+
+/**
+ * The master Key is expected to be 32 bytes
+ */
+static constexpr size_t masterKeySize=32;
+
+
+/** constructor called at file creation */
+template <typename AEADAlgo, EncryptionSuite suite>
+VfsEM_AEAD_SHA256<AEADAlgo, suite>::VfsEM_AEAD_SHA256() :
+	mRNG(std::make_shared<bctoolbox::RNG>()), // start the local RNG
+	mFileSalt(mRNG->randomize(fileSaltSize)), // generate a random file Salt
+	mChunkKeyCacheSize(0) // cache is disabled until the VfsEncryption object set its size
+{
+}
+
+/** constructor called when opening an existing file */
+template <typename AEADAlgo, EncryptionSuite suite>
+VfsEM_AEAD_SHA256<AEADAlgo, suite>::VfsEM_AEAD_SHA256(const std::vector<uint8_t> &fileHeader) :
+	mRNG(std::make_shared<bctoolbox::RNG>()), // start the local RNG
+	mFileSalt(std::vector<uint8_t>(fileSaltSize)),
+	mChunkKeyCacheSize(0) // cache is disabled until the VfsEncryption object set its size
+{
+	if (fileHeader.size() != fileHeaderSize) {
+		throw EVFS_EXCEPTION<<"The "<<encryptionSuiteString(suite)<<" encryption module expect a fileHeader of size "<<fileHeaderSize<<" bytes but "<<fileHeader.size()<<" are provided";
+	}
+	// File header Data is 32 bytes of integrity data, 16 bytes of global salt
+	std::copy(fileHeader.cbegin(), fileHeader.cbegin()+fileAuthTagSize, mFileHeaderIntegrity.begin());
+	std::copy(fileHeader.cbegin()+fileAuthTagSize, fileHeader.cend(), mFileSalt.begin());
+}
+
+/** destructor ensure proper cleaning of any key material **/
+template <typename AEADAlgo, EncryptionSuite suite>
+VfsEM_AEAD_SHA256<AEADAlgo, suite>::~VfsEM_AEAD_SHA256() {
+	bctbx_clean(sMasterKey.data(), sMasterKey.size());
+	bctbx_clean(sFileHeaderHMACKey.data(), sFileHeaderHMACKey.size());
+	clearChunkKeyCache();
+}
+
+template <typename AEADAlgo, EncryptionSuite suite>
+void VfsEM_AEAD_SHA256<AEADAlgo, suite>::clearChunkKeyCache() noexcept {
+	std::lock_guard<std::mutex> lock(mChunkKeysMutex);
+	sChunkKeys.clear(); // the keyed contexts zeroize their key when the last thread using them releases them
+	mChunkKeysIndex.clear();
+}
+
+template <typename AEADAlgo, EncryptionSuite suite>
+void VfsEM_AEAD_SHA256<AEADAlgo, suite>::setChunkKeyCacheSize(size_t size) noexcept {
+	std::lock_guard<std::mutex> lock(mChunkKeysMutex);
+	mChunkKeyCacheSize = size;
+	// drop the least recently used keys if the cache is now too large
+	while (sChunkKeys.size() > mChunkKeyCacheSize) {
+		mChunkKeysIndex.erase(sChunkKeys.back().first);
+		sChunkKeys.pop_back();
+	}
+}
+
+template <typename AEADAlgo, EncryptionSuite suite>
+const std::vector<uint8_t> VfsEM_AEAD_SHA256<AEADAlgo, suite>::getModuleFileHeader(const VfsEncryption &fileContext) const {
+	if (sFileHeaderHMACKey.empty()) {
+		throw EVFS_EXCEPTION<<"The "<<encryptionSuiteString(suite)<<" encryption module cannot generate its file header without master key";
+	}
+	// Only the actual file header is to authenticate, the module file header holds the global salt used to derive the key feed to HMAC authenticating the file header
+	// so it is useless to authenticate it
+	const auto &rawHeader = fileContext.rawHeaderGet();
+	std::array<uint8_t, SHA256::ssize()> tag;
+	HMAC<SHA256>(sFileHeaderHMACKey.data(), sFileHeaderHMACKey.size(), rawHeader.data(), rawHeader.size(), tag.data());
+
+	// Append the actual file salt value to the tag
+	auto ret = mFileSalt;
+	ret.insert(ret.begin(), tag.cbegin(), tag.cend());
+	return ret;
+}
+
+template <typename AEADAlgo, EncryptionSuite suite>
+void VfsEM_AEAD_SHA256<AEADAlgo, suite>::setModuleSecretMaterial(const std::vector<uint8_t> &secret) {
+	if (secret.size() != masterKeySize) {
+		throw EVFS_EXCEPTION<<"The "<<encryptionSuiteString(suite)<<" encryption module expect a secret material of size "<<masterKeySize<<" bytes but "<<secret.size()<<" are provided";
+	}
+	sMasterKey = secret;
+	// cached chunk keys were derived from the previous master key
+	clearChunkKeyCache();
+
+	// Now that we have a master key, we can derive the header authentication one
+	sFileHeaderHMACKey = bctoolbox::HKDF<SHA256>(mFileSalt, sMasterKey, "EVFS file Header", masterKeySize);
+}
+
+/**
+ * Derive the key from master key for the given chunkIndex:
+ * HKDF(fileSalt || ChunkIndex, master Key, "EVFS chunk")
+ * Keys are first looked up in the chunk keys cache, a derived key is stored in it
+ *
+ * @param[in]	chunkIndex	the chunk index used in key derivation
+ *
+ * @return	the chunk key, in a keyed AEAD context
+ */
+template <typename AEADAlgo, EncryptionSuite suite>
+std::shared_ptr<typename VfsEM_AEAD_SHA256<AEADAlgo, suite>::ChunkKey> VfsEM_AEAD_SHA256<AEADAlgo, suite>::deriveChunkKey(uint32_t chunkIndex) {
+	{
+		std::lock_guard<std::mutex> lock(mChunkKeysMutex);
+		auto cachedKey = mChunkKeysIndex.find(chunkIndex);
+		if (cachedKey != mChunkKeysIndex.end()) {
+			// move it in front of the list: it is now the most recently used
+			sChunkKeys.splice(sChunkKeys.begin(), sChunkKeys, cachedKey->second);
+			return cachedKey->second->second;
+		}
+	}
+
+	std::array<uint8_t, fileSaltSize+4> chunkSalt;
+	std::copy(mFileSalt.cbegin(), mFileSalt.cend(), chunkSalt.begin());
+	chunkSalt[fileSaltSize] = (chunkIndex>>24)&0xFF;
+	chunkSalt[fileSaltSize+1] = (chunkIndex>>16)&0xFF;
+	chunkSalt[fileSaltSize+2] = (chunkIndex>>8)&0xFF;
+	chunkSalt[fileSaltSize+3] = chunkIndex&0xFF;
+	static constexpr char chunkInfo[] = "EVFS chunk";
+	std::array<uint8_t, AEADAlgo::keySize()> key;
+	bctoolbox::HKDF<SHA256>(chunkSalt.data(), chunkSalt.size(), sMasterKey.data(), sMasterKey.size(),
+			reinterpret_cast<const uint8_t *>(chunkInfo), sizeof(chunkInfo)-1, key.data(), key.size());
+	std::shared_ptr<ChunkKey> chunkKey;
+	try {
+		chunkKey = std::make_shared<ChunkKey>(key.data());
+	} catch (...) {
+		bctbx_clean(key.data(), key.size());
+		throw;
+	}
+	bctbx_clean(key.data(), key.size());
+
+	// the key derivation is performed out of the lock, another thread may have stored this key in the meantime
+	std::lock_guard<std::mutex> lock(mChunkKeysMutex);
+	if (mChunkKeyCacheSize > 0 && mChunkKeysIndex.count(chunkIndex) == 0) {
+		if (sChunkKeys.size() >= mChunkKeyCacheSize) { // cache is full: evict the least recently used entry
+			mChunkKeysIndex.erase(sChunkKeys.back().first);
+			sChunkKeys.pop_back();
+		}
+		sChunkKeys.emplace_front(chunkIndex, chunkKey);
+		mChunkKeysIndex[chunkIndex] = sChunkKeys.begin();
+	}
+	return chunkKey;
+}
+
+template <typename AEADAlgo, EncryptionSuite suite>
+void VfsEM_AEAD_SHA256<AEADAlgo, suite>::decryptChunk(const uint32_t chunkIndex, const uint8_t *rawChunk, const size_t rawChunkSize, uint8_t *plainData) {
+	if (sMasterKey.empty()) {
+		throw EVFS_EXCEPTION<<"No encryption Master key set, cannot decrypt";
+	}
+	if (rawChunkSize < chunkHeaderSize) {
+		throw EVFS_EXCEPTION<<"Cannot decrypt a chunk of "<<rawChunkSize<<" bytes, chunk header alone is "<<chunkHeaderSize<<" bytes";
+	}
+
+	// derive the key : HKDF (fileHeaderSalt || Chunk Index, Master key, "EVFS chunk")
+	auto chunkKey = deriveChunkKey(chunkIndex);
+
+	// the header is: tag, IV, no associated data. Cipher text follows it
+	bool authOk;
+	{
+		std::lock_guard<std::mutex> lock(chunkKey->mutex);
+		authOk = chunkKey->context.decrypt(rawChunk+chunkAuthTagSize, chunkIVSize, rawChunk+chunkHeaderSize, rawChunkSize-chunkHeaderSize,
+			nullptr, 0, rawChunk, plainData);
+	}
+
+	if (authOk == false) {
+		throw EVFS_EXCEPTION<<"Authentication failure during chunk decryption";
+	}
+}
+
+// This module does not reuse any part of its chunk header during encryption
+// So re-encryption is the same than initial encryption
+template <typename AEADAlgo, EncryptionSuite suite>
+void VfsEM_AEAD_SHA256<AEADAlgo, suite>::encryptChunk(const uint32_t chunkIndex, uint8_t *rawChunk, const size_t rawChunkSize, const uint8_t *plainData, const size_t plainDataSize) {
+	encryptChunk(chunkIndex, plainData, plainDataSize, rawChunk);
+}
+
+template <typename AEADAlgo, EncryptionSuite suite>
+void VfsEM_AEAD_SHA256<AEADAlgo, suite>::encryptChunk(const uint32_t chunkIndex, const uint8_t *plainData, const size_t plainDataSize, uint8_t *rawChunk) {
+	if (sMasterKey.empty()) {
+		throw EVFS_EXCEPTION<<"No encryption Master key set, cannot encrypt";
+	}
+	// generate a random IV, directly in the chunk header
+	{
+		std::lock_guard<std::mutex> lock(mRNGMutex);
+		mRNG->randomize(rawChunk+chunkAuthTagSize, chunkIVSize);
+	}
+
+	// derive the key : HKDF (fileHeaderSalt || Chunk Index, Master key, "EVFS chunk")
+	auto chunkKey = deriveChunkKey(chunkIndex);
+
+	// tag goes at the begining of the chunk header, cipher text right after the header
+	std::lock_guard<std::mutex> lock(chunkKey->mutex);
+	chunkKey->context.encrypt(rawChunk+chunkAuthTagSize, chunkIVSize, plainData, plainDataSize,
+			nullptr, 0, rawChunk, rawChunk+chunkHeaderSize);
+}
+
+/**
+ * When this function is called, m_fileHeader holds the integrity tag read from file
+ * and sFileHeaderHMACKey holds the derived key for header authentication
+ * Compute the HMAC on the whole rawfileHeader + the module header
+ * Check it match what we have in the m_fileHeader
+ */
+template <typename AEADAlgo, EncryptionSuite suite>
+bool VfsEM_AEAD_SHA256<AEADAlgo, suite>::checkIntegrity(const VfsEncryption &fileContext) {
+	if (sFileHeaderHMACKey.empty()) {
+		throw EVFS_EXCEPTION<<"The "<<encryptionSuiteString(suite)<<" encryption module cannot generate its file header without master key";
+	}
+	// Only the actual file header is to authenticate, the module file header holds the global salt used to derive the key feed to HMAC authenticating the file header
+	// so it is useless to authenticate it
+	const auto &rawHeader = fileContext.rawHeaderGet();
+	std::array<uint8_t, SHA256::ssize()> tag;
+	HMAC<SHA256>(sFileHeaderHMACKey.data(), sFileHeaderHMACKey.size(), rawHeader.data(), rawHeader.size(), tag.data());
+
+	return (std::equal(tag.cbegin(), tag.cend(), mFileHeaderIntegrity.cbegin()));
+}
+/**
+ * This function exists as static and non static
+ */
+template <typename AEADAlgo, EncryptionSuite suite>
+size_t VfsEM_AEAD_SHA256<AEADAlgo, suite>::moduleFileHeaderSize() noexcept{
+	return fileHeaderSize;
+}
+
+/**
+ * @return the size in bytes of the chunk header
+ */
+template <typename AEADAlgo, EncryptionSuite suite>
+size_t VfsEM_AEAD_SHA256<AEADAlgo, suite>::getChunkHeaderSize() const noexcept {
+	return chunkHeaderSize;
+}
+/**
+ * @return the size in bytes of file header module data
+ */
+template <typename AEADAlgo, EncryptionSuite suite>
+size_t VfsEM_AEAD_SHA256<AEADAlgo, suite>::getModuleFileHeaderSize() const noexcept {
+	return fileHeaderSize;
+}
+
+/**
+ * @return the secret material size
+ */
+template <typename AEADAlgo, EncryptionSuite suite>
+size_t VfsEM_AEAD_SHA256<AEADAlgo, suite>::getSecretMaterialSize() const noexcept {
+	return masterKeySize;
+}
+
+/* instanciate the modules */
+static_assert(AES256GCM128::tagSize() == chunkAuthTagSize && CHACHA20POLY1305::tagSize() == chunkAuthTagSize, "the chunk header holds a 16 bytes tag");
+template class bctoolbox::VfsEM_AEAD_SHA256<AES256GCM128, EncryptionSuite::aes256gcm128_sha256>;
+template class bctoolbox::VfsEM_AEAD_SHA256<CHACHA20POLY1305, EncryptionSuite::chacha20poly1305_sha256>;
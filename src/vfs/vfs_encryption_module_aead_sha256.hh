@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2016-2020 Belledonne Communications SARL.
+ *
+ * This file is part of bctoolbox.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BCTBX_VFS_ENCRYPTION_MODULE_AEAD_SHA256_HH
+#define BCTBX_VFS_ENCRYPTION_MODULE_AEAD_SHA256_HH
+#include "bctoolbox/vfs_encrypted.hh"
+#include "vfs_encryption_module.hh"
+#include "bctoolbox/crypto.hh"
+#include <array>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+/*********** The AEAD SHA256 modules   ************************
+ * AES256-GCM SHA256 and ChaCha20-Poly1305 SHA256 modules share everything but the AEAD used on chunks
+ * Key derivations:
+ *    - file Header HMAC key = HKDF(Mk, fileHeaderSalt, "EVFS file header")
+ *    - chunk encryption key = HKDF(Mk, fileHeaderSalt || Chunk Index, "EVFS chunk")
+ * File Header:
+ *    - 32 bytes auth tag: HMAC-sha256 on the file header
+ *    - 16 bytes salt: random generated at file creation : input of the HKDF keyed by the master key.
+ * Chunk Header:
+ *    - Authentication tag : 16 bytes
+ *    - IV: 12 bytes. A random updated at each encryption
+ * Chunk encryption:
+ *    - AES256-GCM with 128 bit auth tag or ChaCha20-Poly1305. No associated Data.
+ *    - IV is 12 bytes random : MUST use a random for IV as attacker having access to file system could restore an old version of the file and monitor further writing. So deterministic IV could lead to key/IV reuse.
+ * Chunk keys cache:
+ *    - derived chunk keys are kept, expanded in a keyed AEAD context, in a bounded LRU cache indexed by chunk index
+ *      so repeated access to the same chunks skip the HKDF and the AEAD key setup
+ *    - evicted keys are zeroized, the whole cache is zeroized on master key change and on destruction
+ */
+namespace bctoolbox {
+/**
+ * @tparam	AEADAlgo	the AEAD used to encrypt the chunks: AES256GCM128 or CHACHA20POLY1305
+ * @tparam	suite		the EncryptionSuite provided
+ */
+template <typename AEADAlgo, EncryptionSuite suite>
+class VfsEM_AEAD_SHA256 : public VfsEncryptionModule {
+	private:
+		/**
+		 * The local RNG
+		 */
+		std::shared_ptr<bctoolbox::RNG> mRNG; // list it first so it is available in the constructor's init list
+		std::mutex mRNGMutex; /**< chunks may be encrypted concurrently, protect the RNG */
+
+		/**
+		 * File header
+		 */
+		std::vector<uint8_t> mFileSalt;
+		std::array<uint8_t, SHA256::ssize()> mFileHeaderIntegrity;
+
+		/** keys
+		 */
+		std::vector<uint8_t> sMasterKey; // used to derive all keys
+		std::vector<uint8_t> sFileHeaderHMACKey; // used to feed HMAC integrity check on file header
+
+		/**
+		 * A chunk key, ready to use
+		 */
+		struct ChunkKey {
+			std::mutex mutex; /**< a keyed context must not be used by several threads at the same time */
+			AEADContext<AEADAlgo> context; /**< zeroize the key at destruction */
+			explicit ChunkKey(const uint8_t *key) : context(key) {}
+		};
+
+		/**
+		 * Chunk keys cache: most recently used key first, the map gives direct access to the list element
+		 * Keys are shared: an evicted one stays valid until the threads using it are done
+		 */
+		size_t mChunkKeyCacheSize; /**< maximum number of chunk keys kept in cache, 0 disable the cache */
+		std::list<std::pair<uint32_t, std::shared_ptr<ChunkKey>>> sChunkKeys;
+		std::unordered_map<uint32_t, typename decltype(sChunkKeys)::iterator> mChunkKeysIndex;
+		std::mutex mChunkKeysMutex; /**< chunks may be processed concurrently, protect the chunk keys cache */
+
+		/**
+		 * Zeroize and remove all the chunk keys from cache
+		 */
+		void clearChunkKeyCache() noexcept;
+
+		/**
+		 * Derive the key from master key for the given chunkIndex:
+		 * HKDF(fileSalt || ChunkIndex, master Key, "EVFS chunk")
+		 *
+		 * @param[in]	chunkIndex	the chunk index used in key derivation
+		 *
+		 * @return	the chunk key, in a keyed AEAD context
+		 */
+		std::shared_ptr<ChunkKey> deriveChunkKey(uint32_t chunkIndex);
+
+	public:
+		/**
+		 * This function exists as static and non static
+		 */
+		static size_t moduleFileHeaderSize() noexcept;
+
+		/**
+		 * @return the size in bytes of the chunk header
+		 */
+		size_t getChunkHeaderSize() const noexcept override;
+
+		/**
+		 * @return the size in bytes of file header module data
+		 */
+		size_t getModuleFileHeaderSize() const noexcept override;
+
+		/**
+		 * @return the EncryptionSuite provided by this module
+		 */
+		EncryptionSuite getEncryptionSuite() const noexcept override {
+		       return suite;
+		}
+
+		/**
+		 * @return the secret material size
+		 */
+		size_t getSecretMaterialSize() const noexcept override;
+
+		/**
+		 * Decrypt a chunk of data
+		 * @param[in]	chunkIndex	The chunk index
+		 * @param[in]	rawChunk	chunk header followed by the cipher text
+		 * @param[in]	rawChunkSize	size of rawChunk, at most chunkHeaderSize + chunkSize
+		 * @param[out]	plainData	the decrypted data chunk, rawChunkSize - chunkHeaderSize bytes
+		 */
+		void decryptChunk(const uint32_t chunkIndex, const uint8_t *rawChunk, const size_t rawChunkSize, uint8_t *plainData) override;
+
+		void encryptChunk(const uint32_t chunkIndex, uint8_t *rawChunk, const size_t rawChunkSize, const uint8_t *plainData, const size_t plainDataSize) override;
+		void encryptChunk(const uint32_t chunkIndex, const uint8_t *plainData, const size_t plainDataSize, uint8_t *rawChunk) override;
+
+		const std::vector<uint8_t> getModuleFileHeader(const VfsEncryption &fileContext) const override ;
+
+		void setModuleSecretMaterial(const std::vector<uint8_t> &secret) override ;
+
+		/**
+		 * Set the maximum number of derived chunk keys kept in cache
+		 * @param[in]	size	number of keys, 0 disable the cache
+		 */
+		void setChunkKeyCacheSize(size_t size) noexcept override;
+
+		/**
+		 * Check the integrity over the whole file
+		 * @param[in]	fileContext 	a way to access the file content
+		 *
+		 * @return 	true if the integrity check successfully passed, false otherwise
+		 */
+		bool checkIntegrity(const VfsEncryption &fileContext) override;
+
+
+		/**
+		 * constructors
+		 */
+		// At file creation
+		VfsEM_AEAD_SHA256();
+		// Opening an existing file
+		VfsEM_AEAD_SHA256(const std::vector<uint8_t> &fileHeader);
+
+		~VfsEM_AEAD_SHA256();
+};
+
+/* the modules are instanciated in vfs_encryption_module_aead_sha256.cc */
+extern template class VfsEM_AEAD_SHA256<AES256GCM128, EncryptionSuite::aes256gcm128_sha256>;
+extern template class VfsEM_AEAD_SHA256<CHACHA20POLY1305, EncryptionSuite::chacha20poly1305_sha256>;
+
+using VfsEM_AES256GCM_SHA256 = VfsEM_AEAD_SHA256<AES256GCM128, EncryptionSuite::aes256gcm128_sha256>;
+using VfsEM_CHACHA20POLY1305_SHA256 = VfsEM_AEAD_SHA256<CHACHA20POLY1305, EncryptionSuite::chacha20poly1305_sha256>;
+
+} // namespace bctoolbox
+#endif // BCTBX_VFS_ENCRYPTION_MODULE_AEAD_SHA256_HH
+
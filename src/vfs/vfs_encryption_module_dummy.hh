@@ -21,6 +21,7 @@
 #define BCTBX_VFS_ENCRYPTION_MODULE_DUMMY_HH
 #include "bctoolbox/vfs_encrypted.hh"
 #include "vfs_encryption_module.hh"
+#include <array>
 
 namespace bctoolbox {
 class VfsEncryptionModuleDummy : public VfsEncryptionModule {
@@ -35,12 +36,17 @@ class VfsEncryptionModuleDummy : public VfsEncryptionModule {
 		/**
 		 * Compute the integrity tag in the given chunk
 		 */
-		std::vector<uint8_t> chunkIntegrityTag(const std::vector<uint8_t> &chunk) const;
+		std::array<uint8_t, 8> chunkIntegrityTag(const uint8_t *chunk, const size_t chunkSize) const;
 
 		/**
 		 * Get the chunk index from the given chunk
 		 */
-		uint32_t getChunkIndex(const std::vector<uint8_t> &chunk) const;
+		uint32_t getChunkIndex(const uint8_t *chunk) const;
+
+		/**
+		 * Compute the XOR key from the given chunk header
+		 */
+		std::array<uint8_t, 16> chunkXORKey(const uint8_t *chunk) const;
 
 		/**
 		 * Get global IV. Part of IV common to all chunks
@@ -77,13 +83,15 @@ class VfsEncryptionModuleDummy : public VfsEncryptionModule {
 
 		/**
 		 * Decrypt a chunk of data
-		 * @param[in] a vector which size shall be chunkHeaderSize + chunkSize holding the raw data read from disk
-		 * @return the decrypted data chunk
+		 * @param[in]	chunkIndex	The chunk index
+		 * @param[in]	rawChunk	chunk header followed by the cipher text
+		 * @param[in]	rawChunkSize	size of rawChunk, at most chunkHeaderSize + chunkSize
+		 * @param[out]	plainData	the decrypted data chunk, rawChunkSize - chunkHeaderSize bytes
 		 */
-		std::vector<uint8_t> decryptChunk(const uint32_t chunkIndex, const std::vector<uint8_t> &rawChunk) override ;
+		void decryptChunk(const uint32_t chunkIndex, const uint8_t *rawChunk, const size_t rawChunkSize, uint8_t *plainData) override;
 
-		void encryptChunk(const uint32_t chunkIndex, std::vector<uint8_t> &rawChunk, const std::vector<uint8_t> &plainData) override;
-		std::vector<uint8_t> encryptChunk(const uint32_t chunkIndex, const std::vector<uint8_t> &plainData) override;
+		void encryptChunk(const uint32_t chunkIndex, uint8_t *rawChunk, const size_t rawChunkSize, const uint8_t *plainData, const size_t plainDataSize) override;
+		void encryptChunk(const uint32_t chunkIndex, const uint8_t *plainData, const size_t plainDataSize, uint8_t *rawChunk) override;
 
 		const std::vector<uint8_t> getModuleFileHeader(const VfsEncryption &fileContext) const override ;
 
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2016-2020 Belledonne Communications SARL.
+ *
+ * This file is part of bctoolbox.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "vfs_encryption_worker_pool.hh"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+using namespace bctoolbox;
+
+WorkerPool::WorkerPool(size_t threadCount) : mStop(false) {
+	mThreads.reserve(threadCount);
+	for (size_t i=0; i<threadCount; i++) {
+		mThreads.emplace_back(&WorkerPool::workerLoop, this);
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStop = true;
+	}
+	mCondition.notify_all();
+	for (auto &thread:mThreads) {
+		thread.join();
+	}
+}
+
+size_t WorkerPool::sizeGet() const noexcept {
+	return mThreads.size();
+}
+
+void WorkerPool::workerLoop() {
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mCondition.wait(lock, [this]{return mStop || !mJobs.empty();});
+			if (mJobs.empty()) { // stop requested and nothing left to do
+				return;
+			}
+			job = std::move(mJobs.front());
+			mJobs.pop_front();
+		}
+		job();
+	}
+}
+
+namespace {
+/* State shared by all the participants of a parallelFor call */
+struct ParallelForState {
+	explicit ParallelForState(size_t taskCount, size_t helperCount) : count(taskCount), next(0), pendingHelpers(helperCount), failed(false) {}
+	const size_t count;
+	std::atomic<size_t> next; /**< next task index to run */
+	size_t pendingHelpers; /**< number of helper jobs not finished yet, protected by mutex */
+	std::atomic<bool> failed;
+	std::exception_ptr exception; /**< first exception thrown by a task, protected by mutex */
+	std::mutex mutex;
+	std::condition_variable done;
+
+	// Take tasks until there is none left
+	void run(const std::function<void(size_t)> &task) {
+		size_t i;
+		while (!failed.load() && (i = next.fetch_add(1)) < count) {
+			try {
+				task(i);
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(mutex);
+				if (!exception) {
+					exception = std::current_exception();
+				}
+				failed.store(true);
+			}
+		}
+	}
+};
+}
+
+void WorkerPool::parallelFor(size_t count, const std::function<void(size_t)> &task) {
+	if (count == 0) return;
+
+	// the calling thread takes its share of the work, so no need for more helpers than count-1
+	size_t helperCount = std::min(mThreads.size(), count-1);
+	auto state = std::make_shared<ParallelForState>(count, helperCount);
+
+	if (helperCount > 0) {
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			for (size_t i=0; i<helperCount; i++) {
+				// the helpers do not outlive this call: it waits for all of them before returning, so task can be captured by reference
+				mJobs.emplace_back([state, &task]() {
+					state->run(task);
+					std::lock_guard<std::mutex> lock(state->mutex);
+					if (--state->pendingHelpers == 0) {
+						state->done.notify_one();
+					}
+				});
+			}
+		}
+		mCondition.notify_all();
+	}
+
+	state->run(task);
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->done.wait(lock, [&state]{return state->pendingHelpers == 0;});
+	if (state->exception) {
+		std::rethrow_exception(state->exception);
+	}
+}
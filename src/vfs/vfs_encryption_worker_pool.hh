@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2016-2020 Belledonne Communications SARL.
+ *
+ * This file is part of bctoolbox.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BCTBX_VFS_ENCRYPTION_WORKER_POOL_HH
+#define BCTBX_VFS_ENCRYPTION_WORKER_POOL_HH
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bctoolbox {
+/**
+ * A fixed size pool of threads used by the encrypted VFS to process chunks concurrently
+ */
+class WorkerPool {
+	private:
+		std::vector<std::thread> mThreads;
+		std::deque<std::function<void()>> mJobs; /**< jobs waiting for a worker */
+		std::mutex mMutex; /**< protect the jobs queue and the stop flag */
+		std::condition_variable mCondition; /**< signal workers when a job is queued or the pool stops */
+		bool mStop;
+
+		void workerLoop();
+
+	public:
+		/**
+		 * Start the workers
+		 * @param[in]	threadCount	number of worker threads
+		 */
+		explicit WorkerPool(size_t threadCount);
+		/**
+		 * Stop and join the workers, pending jobs are still run before
+		 */
+		~WorkerPool();
+		WorkerPool(const WorkerPool &) = delete;
+		WorkerPool &operator=(const WorkerPool &) = delete;
+
+		/**
+		 * @return the number of worker threads
+		 */
+		size_t sizeGet() const noexcept;
+
+		/**
+		 * Run task(i) for every i in [0, count), spread on the workers and the calling thread.
+		 * Returns when all the tasks are done.
+		 * If tasks throw, remaining tasks are skipped and the first exception is rethrown in the calling thread
+		 * Must not be called from a task running in the pool.
+		 *
+		 * @param[in]	count	number of tasks
+		 * @param[in]	task	the function to run, must be safe to call concurrently with different indexes
+		 */
+		void parallelFor(size_t count, const std::function<void(size_t)> &task);
+};
+
+} // namespace bctoolbox
+#endif // BCTBX_VFS_ENCRYPTION_WORKER_POOL_HH
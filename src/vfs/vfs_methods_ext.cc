@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2016-2020 Belledonne Communications SARL.
+ *
+ * This file is part of bctoolbox.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "bctoolbox/vfs.h"
+#include <atomic>
+#include <mutex>
+
+namespace {
+constexpr size_t maxMethodsExt = 32; // number of distinct vfs registering optional methods in a process
+
+/**
+ * Optional methods of each registered bctbx_io_methods_t, looked up at every file opening
+ * Slots are only appended and the vfs register once: lookups do not lock.
+ * All of it is constant initialised, vfs may register from their own static initialisation.
+ */
+struct MethodsExtSlot {
+	std::atomic<const bctbx_io_methods_t *> methods;
+	std::atomic<const bctbx_io_methods_ext_t *> ext;
+};
+MethodsExtSlot sMethodsExt[maxMethodsExt];
+std::atomic<size_t> sMethodsExtCount{0}; /**< slots in use, published after the slot is filled */
+std::mutex sMethodsExtMutex; /**< serialise the registrations */
+} // anonymous namespace
+
+extern "C" int bctbx_io_methods_set_ext(const bctbx_io_methods_t *methods, const bctbx_io_methods_ext_t *ext) {
+	if (methods == NULL) return BCTBX_VFS_ERROR;
+	std::lock_guard<std::mutex> lock(sMethodsExtMutex);
+	size_t count = sMethodsExtCount.load(std::memory_order_relaxed);
+	for (size_t i = 0; i < count; i++) {
+		if (sMethodsExt[i].methods.load(std::memory_order_relaxed) == methods) {
+			sMethodsExt[i].ext.store(ext, std::memory_order_release);
+			return BCTBX_VFS_OK;
+		}
+	}
+	if (ext == NULL) return BCTBX_VFS_OK;
+	if (count == maxMethodsExt) return BCTBX_VFS_ERROR;
+	sMethodsExt[count].ext.store(ext, std::memory_order_relaxed);
+	sMethodsExt[count].methods.store(methods, std::memory_order_relaxed);
+	sMethodsExtCount.store(count + 1, std::memory_order_release);
+	return BCTBX_VFS_OK;
+}
+
+extern "C" const bctbx_io_methods_ext_t *bctbx_io_methods_get_ext(const bctbx_io_methods_t *methods) {
+	if (methods == NULL) return NULL;
+	size_t count = sMethodsExtCount.load(std::memory_order_acquire);
+	for (size_t i = 0; i < count; i++) {
+		if (sMethodsExt[i].methods.load(std::memory_order_relaxed) == methods) {
+			return sMethodsExt[i].ext.load(std::memory_order_acquire);
+		}
+	}
+	return NULL;
+}
@@ -0,0 +1,346 @@
+/*
+ * Copyright (c) 2016-2020 Belledonne Communications SARL.
+ *
+ * This file is part of bctoolbox.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "bctoolbox/vfs.h"
+#include "bctoolbox/vfs_standard.h"
+#include "bctoolbox/port.h"
+#include "bctoolbox/logging.h"
+#include <sys/types.h>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#include <pthread.h>
+
+/**
+ * Opens the file read only and maps it in memory.
+ * @param  pVfs    		Pointer to  bctx_vfs  VFS.
+ * @param  fName   		Absolute path filename.
+ * @param  openFlags    Flags to use when opening the file, must be O_RDONLY.
+ * @return         		BCTBX_VFS_ERROR if an error occurs, BCTBX_VFS_OK otherwise.
+ */
+static int bcMmapOpen(bctbx_vfs_t *pVfs, bctbx_vfs_file_t *pFile, const char *fName, int openFlags);
+
+/* User data for the mmap vfs */
+typedef struct bctbx_vfs_mmap_t bctbx_vfs_mmap_t;
+struct bctbx_vfs_mmap_t {
+	int fd;                         /* File descriptor */
+	uint8_t *map;                   /* Mapping of the whole file, NULL when the file is empty */
+	size_t size;                    /* Size of the mapping */
+	int advice;                     /* madvise hint, applied again each time the file is mapped */
+	pthread_rwlock_t lock;          /* Readers share the mapping, it is replaced under exclusive lock when the file grows */
+};
+
+bctbx_vfs_t bcMmapVfs = {
+	"bctbx_mmap_vfs",	/* vfsName */
+	bcMmapOpen,		/*xOpen */
+};
+
+/**
+ * Map the whole file again if its size changed since it was mapped.
+ * Must be called with the lock held exclusively.
+ * @param  ctx  The mmap vfs user data.
+ * @return BCTBX_VFS_OK on success, -errno otherwise.
+ */
+static int bcMmapRemap(bctbx_vfs_mmap_t *ctx) {
+	struct stat sStat;
+	void *map = NULL;
+
+	if (fstat(ctx->fd, &sStat) != 0) {
+		return -errno;
+	}
+	if ((uint64_t)sStat.st_size == ctx->size) {
+		return BCTBX_VFS_OK;
+	}
+	if ((uint64_t)sStat.st_size > SIZE_MAX) {
+		return -EFBIG;
+	}
+
+	if (sStat.st_size > 0) {
+		map = mmap(NULL, (size_t)sStat.st_size, PROT_READ, MAP_SHARED, ctx->fd, 0);
+		if (map == MAP_FAILED) {
+			return -errno;
+		}
+		if (ctx->advice != MADV_NORMAL) {
+			madvise(map, (size_t)sStat.st_size, ctx->advice);
+		}
+	}
+	if (ctx->map != NULL) {
+		munmap(ctx->map, ctx->size);
+	}
+	ctx->map = (uint8_t *)map;
+	ctx->size = (size_t)sStat.st_size;
+	return BCTBX_VFS_OK;
+}
+
+/**
+ * Unmaps and closes the file.
+ * @param  pFile 	bctbx_vfs_file_t File handle pointer.
+ * @return       	BCTBX_VFS_OK if successful, -errno otherwise.
+ */
+static int bcMmapClose(bctbx_vfs_file_t *pFile) {
+	int ret;
+	if (pFile==NULL || pFile->pUserData==NULL) return BCTBX_VFS_ERROR;
+	bctbx_vfs_mmap_t *ctx = (bctbx_vfs_mmap_t *)pFile->pUserData;
+	if (ctx->map != NULL) {
+		munmap(ctx->map, ctx->size);
+	}
+	ret = close(ctx->fd);
+	if (!ret) {
+		ret = BCTBX_VFS_OK;
+	} else {
+		ret = -errno;
+	}
+	pthread_rwlock_destroy(&ctx->lock);
+	bctbx_free(pFile->pUserData);
+	return ret;
+}
+
+/**
+ * Called with the lock held shared, when the data needed goes past the mapping.
+ * Release it to remap the file under exclusive lock, in case it grew, then take it shared again.
+ * @param  ctx  The mmap vfs user data.
+ * @return BCTBX_VFS_OK on success with the lock held shared, -errno otherwise with the lock released.
+ */
+static int bcMmapGrow(bctbx_vfs_mmap_t *ctx) {
+	int ret;
+	pthread_rwlock_unlock(&ctx->lock);
+	pthread_rwlock_wrlock(&ctx->lock);
+	ret = bcMmapRemap(ctx);
+	pthread_rwlock_unlock(&ctx->lock);
+	if (ret < 0) {
+		return ret;
+	}
+	pthread_rwlock_rdlock(&ctx->lock);
+	return BCTBX_VFS_OK;
+}
+
+/**
+ * Nothing to sync on a read only file.
+ * @param  pFile  File handle pointer.
+ * @return   BCTBX_VFS_OK
+ */
+static int bcMmapSync(bctbx_vfs_file_t *pFile) {
+	if (pFile==NULL || pFile->pUserData==NULL) return BCTBX_VFS_ERROR;
+	return BCTBX_VFS_OK;
+}
+
+/**
+ * Copy count bytes from the mapping, starting at offset.
+ * The file size is checked again, and the file mapped again if it grew, only when the read goes beyond the mapping.
+ * @param  pFile  File handle pointer.
+ * @param  buf    buffer to write the read bytes to.
+ * @param  count  number of bytes to read
+ * @param  offset file offset where to start reading
+ * @return -errno on error, number of bytes read otherwise (0 at end of file)
+ */
+static ssize_t bcMmapRead(bctbx_vfs_file_t *pFile, void *buf, size_t count, off_t offset) {
+	ssize_t nRead = 0;
+	if (pFile==NULL || pFile->pUserData==NULL) return BCTBX_VFS_ERROR;
+	if (offset < 0) return -EINVAL;
+	bctbx_vfs_mmap_t *ctx = (bctbx_vfs_mmap_t *)pFile->pUserData;
+
+	pthread_rwlock_rdlock(&ctx->lock);
+	if ((uint64_t)offset + count > ctx->size) {
+		int ret = bcMmapGrow(ctx);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+	if ((uint64_t)offset < ctx->size) {
+		size_t available = ctx->size - (size_t)offset;
+		nRead = (ssize_t)((count < available) ? count : available);
+		memcpy(buf, ctx->map + offset, (size_t)nRead);
+	}
+	pthread_rwlock_unlock(&ctx->lock);
+	return nRead;
+}
+
+/**
+ * The mmap vfs is read only.
+ * @return -EBADF
+ */
+static ssize_t bcMmapWrite(bctbx_vfs_file_t *pFile, const void *buf, size_t count, off_t offset) {
+	if (pFile==NULL || pFile->pUserData==NULL) return BCTBX_VFS_ERROR;
+	return -EBADF;
+}
+
+/**
+ * The mmap vfs is read only.
+ * @return -EBADF
+ */
+static int bcMmapTruncate(bctbx_vfs_file_t *pFile, int64_t new_size) {
+	if (pFile==NULL || pFile->pUserData==NULL) return BCTBX_VFS_ERROR;
+	return -EBADF;
+}
+
+/**
+ * Returns the current size of the file, which may be larger than the mapping.
+ * @param pFile File handle pointer.
+ * @return -errno if an error occurred, file size otherwise (can be 0).
+ */
+static int64_t bcMmapFileSize(bctbx_vfs_file_t *pFile) {
+	struct stat sStat;
+	if (pFile==NULL || pFile->pUserData==NULL) return BCTBX_VFS_ERROR;
+	bctbx_vfs_mmap_t *ctx = (bctbx_vfs_mmap_t *)pFile->pUserData;
+
+	if (fstat(ctx->fd, &sStat) != 0) {
+		return -errno;
+	}
+	return sStat.st_size;
+}
+
+/**
+ * Gets a line of at most max_len-1 characters, directly from the mapping, starting at pFile->offset.
+ * A line ends with \r, \n or \r\n, the end of line is not copied in s.
+ * The file size is checked again only when the line is not complete in the mapping.
+ * @param  pFile   File handle pointer.
+ * @param  s       Buffer where to store the line.
+ * @param  max_len Size of s.
+ * @return         number of bytes consumed in the file (line and end of line), 0 at end of file
+ */
+static int bcMmapGetNxtLine(bctbx_vfs_file_t *pFile, char *s, int max_len) {
+	int sizeofline = 0;
+	bool_t grown = FALSE;
+	if (pFile==NULL || pFile->pUserData==NULL) return BCTBX_VFS_ERROR;
+	if (s == NULL || max_len < 1 || pFile->offset < 0) return BCTBX_VFS_ERROR;
+	bctbx_vfs_mmap_t *ctx = (bctbx_vfs_mmap_t *)pFile->pUserData;
+
+	pthread_rwlock_rdlock(&ctx->lock);
+	s[0] = '\0';
+	while ((uint64_t)pFile->offset < ctx->size || !grown) {
+		const size_t available = ((uint64_t)pFile->offset < ctx->size) ? ctx->size - (size_t)pFile->offset : 0;
+		const uint8_t *start = ctx->map + ((available > 0) ? pFile->offset : 0);
+		const size_t len = ((size_t)(max_len-1) < available) ? (size_t)(max_len-1) : available;
+		size_t i;
+		for (i = 0; i < len && start[i] != '\r' && start[i] != '\n'; i++);
+		/* the line, or a \r ending it, reaches the end of the mapping: the file may have grown since it was mapped */
+		if (!grown && (i == available || (i+1 == available && start[i] == '\r'))) {
+			grown = TRUE;
+			if (bcMmapGrow(ctx) < 0) {
+				bctbx_error("bcGetLine error");
+				return BCTBX_VFS_ERROR;
+			}
+			continue;
+		}
+		memcpy(s, start, i);
+		s[i] = '\0';
+		sizeofline = (int)i;
+		if (i < len) { /* found an end of line */
+			sizeofline++;
+			if (start[i] == '\r' && i+1 < available && start[i+1] == '\n') sizeofline++;
+		}
+		pFile->offset += sizeofline;
+		break;
+	}
+	pthread_rwlock_unlock(&ctx->lock);
+	return sizeofline;
+}
+
+static const bctbx_io_methods_t bcmmapio = {
+	bcMmapClose,		/* pFuncClose */
+	bcMmapRead,		/* pFuncRead */
+	bcMmapWrite,		/* pFuncWrite */
+	bcMmapTruncate,		/* pFuncTruncate */
+	bcMmapFileSize,		/* pFuncFileSize */
+	bcMmapSync,
+	bcMmapGetNxtLine,	/* pFuncGetLineFromFd */
+	NULL			/* pFuncIsEncrypted -> no function so we will return false */
+};
+
+static int bcMmapOpen(bctbx_vfs_t *pVfs, bctbx_vfs_file_t *pFile, const char *fName, int openFlags) {
+	int ret;
+	if (pFile == NULL || fName == NULL) {
+		return BCTBX_VFS_ERROR;
+	}
+	if ((openFlags & (O_WRONLY|O_RDWR)) != 0) { /* read only vfs */
+		return -EINVAL;
+	}
+
+	/* Create the userData structure */
+	bctbx_vfs_mmap_t *userData = (bctbx_vfs_mmap_t *)bctbx_malloc0(sizeof(bctbx_vfs_mmap_t));
+	userData->fd = open(fName, openFlags, S_IRUSR | S_IWUSR);
+	if (userData->fd == -1) {
+		bctbx_free(userData);
+		return -errno;
+	}
+	userData->advice = MADV_NORMAL;
+	ret = bcMmapRemap(userData);
+	if (ret < 0) {
+		close(userData->fd);
+		bctbx_free(userData);
+		return ret;
+	}
+	pthread_rwlock_init(&userData->lock, NULL);
+
+	pFile->pMethods = &bcmmapio;
+	pFile->pUserData = (void *)userData;
+	return BCTBX_VFS_OK;
+}
+
+int bctbx_vfs_mmap_advise(bctbx_vfs_file_t *pFile, bctbx_vfs_mmap_advice_t advice) {
+	int ret = BCTBX_VFS_OK;
+	if (pFile == NULL || pFile->pMethods != &bcmmapio || pFile->pUserData == NULL) return BCTBX_VFS_ERROR;
+	bctbx_vfs_mmap_t *ctx = (bctbx_vfs_mmap_t *)pFile->pUserData;
+
+	pthread_rwlock_wrlock(&ctx->lock);
+	switch (advice) {
+		case BCTBX_VFS_MMAP_ADVICE_SEQUENTIAL:
+			ctx->advice = MADV_SEQUENTIAL;
+			break;
+		case BCTBX_VFS_MMAP_ADVICE_RANDOM:
+			ctx->advice = MADV_RANDOM;
+			break;
+		default:
+			ctx->advice = MADV_NORMAL;
+			break;
+	}
+	if (ctx->map != NULL && madvise(ctx->map, ctx->size, ctx->advice) != 0) {
+		ret = BCTBX_VFS_ERROR;
+	}
+	pthread_rwlock_unlock(&ctx->lock);
+	return ret;
+}
+
+#else /* HAVE_MMAP */
+
+/* No mmap on this platform, use the standard vfs */
+static int bcMmapOpen(bctbx_vfs_t *pVfs, bctbx_vfs_file_t *pFile, const char *fName, int openFlags) {
+	if ((openFlags & (O_WRONLY|O_RDWR)) != 0) { /* read only vfs */
+		return -EINVAL;
+	}
+	return bcStandardVfs.pFuncOpen(pVfs, pFile, fName, openFlags);
+}
+
+bctbx_vfs_t bcMmapVfs = {
+	"bctbx_mmap_vfs",	/* vfsName */
+	bcMmapOpen,		/*xOpen */
+};
+
+int bctbx_vfs_mmap_advise(bctbx_vfs_file_t *pFile, bctbx_vfs_mmap_advice_t advice) {
+	return BCTBX_VFS_ERROR;
+}
+
+#endif /* HAVE_MMAP */
@@ -27,6 +27,9 @@
 #include <sys/types.h>
 #include <stdarg.h>
 #include <errno.h>
+#if defined(HAVE_PREADV) && defined(HAVE_PWRITEV)
+#include <sys/uio.h>
+#endif
 
 
 
@@ -96,6 +99,8 @@ static int bcSync(bctbx_vfs_file_t *pFile) {
 
 /**
  * Read count bytes from the open file given by pFile, starting at offset.
+ * When available, use positional read so the file offset is not modified:
+ * a single system call per read and concurrent reads can share the file handle.
  * Sets the error errno in the argument pErrSrvd after allocating it
  * if an error occurrred.
  * @param  pFile  File handle pointer.
@@ -110,6 +115,17 @@ static ssize_t bcRead(bctbx_vfs_file_t *pFile, void *buf, size_t count, off_t of
 	if (pFile==NULL || pFile->pUserData==NULL) return BCTBX_VFS_ERROR;
 	bctbx_vfs_standard_t *ctx = (bctbx_vfs_standard_t *)pFile->pUserData;
 
+#ifdef HAVE_PREAD
+	do {
+		nRead = pread(ctx->fd, buf, count, offset);
+	} while (nRead < 0 && errno == EINTR);
+	/* Error while reading */
+	if (nRead < 0) {
+		if (errno) return -errno;
+		return BCTBX_VFS_ERROR;
+	}
+	return nRead;
+#else
 	if (lseek(ctx->fd, offset, SEEK_SET) < 0) {
 		if (errno) return -errno;
 	} else {
@@ -121,10 +137,12 @@ static ssize_t bcRead(bctbx_vfs_file_t *pFile, void *buf, size_t count, off_t of
 		return nRead;
 	}
 	return BCTBX_VFS_ERROR;
+#endif
 }
 
 /**
  * Writes directly to the open file given through the pFile argument.
+ * When available, use positional write so the file offset is not modified.
  * Sets the error errno in the argument pErrSrvd after allocating it
  * if an error occurrred.
  * @param  pFile       bctbx_vfs_file_t File handle pointer.
@@ -139,19 +157,87 @@ static ssize_t bcWrite(bctbx_vfs_file_t *pFile, const void *buf, size_t count, o
 	if (pFile==NULL || pFile->pUserData==NULL) return BCTBX_VFS_ERROR;
 	bctbx_vfs_standard_t *ctx = (bctbx_vfs_standard_t *)pFile->pUserData;
 
+#ifdef HAVE_PWRITE
+	do {
+		nWrite = pwrite(ctx->fd, buf, count, offset);
+	} while (nWrite < 0 && errno == EINTR);
+	if (nWrite < 0) {
+		if (errno) return -errno;
+		return BCTBX_VFS_ERROR;
+	}
+	return nWrite;
+#else
 	if ((lseek(ctx->fd, offset, SEEK_SET)) < 0) {
 		if (errno) return -errno;
 	} else {
 		nWrite = bctbx_write(ctx->fd, buf, count);
-		if (nWrite > 0) return nWrite;
-		else if (nWrite <= 0) {
+		/* errno is only meaningful on failure: writing 0 bytes is not an error */
+		if (nWrite >= 0) return nWrite;
+		if (errno) return -errno;
+	}
+	return BCTBX_VFS_ERROR;
+#endif
+}
+
+#if defined(HAVE_PREADV) && defined(HAVE_PWRITEV)
+#define BCTBX_VFS_IOV_GROUP 64 /* number of buffers given to each preadv/pwritev call */
+
+/**
+ * Reads or writes at offset in several buffers, with one system call per group of BCTBX_VFS_IOV_GROUP buffers.
+ * @param  pFile   File handle pointer.
+ * @param  iov     the buffers
+ * @param  iovcnt  number of buffers
+ * @param  offset  file offset where to start
+ * @param  write   TRUE to write the buffers, FALSE to read into them
+ * @return -errno on error, number of bytes read or written otherwise.
+ */
+static ssize_t bcVectoredIo(bctbx_vfs_file_t *pFile, const bctbx_iovec_t *iov, int iovcnt, off_t offset, bool_t write) {
+	struct iovec group[BCTBX_VFS_IOV_GROUP];
+	ssize_t total = 0;
+	int i = 0;
+	if (pFile==NULL || pFile->pUserData==NULL) return BCTBX_VFS_ERROR;
+	bctbx_vfs_standard_t *ctx = (bctbx_vfs_standard_t *)pFile->pUserData;
+
+	while (i < iovcnt) {
+		int n;
+		size_t groupSize = 0;
+		ssize_t ret;
+		for (n = 0; n < BCTBX_VFS_IOV_GROUP && i+n < iovcnt; n++) {
+			group[n].iov_base = iov[i+n].base;
+			group[n].iov_len = iov[i+n].len;
+			groupSize += iov[i+n].len;
+		}
+		do {
+			ret = write ? pwritev(ctx->fd, group, n, offset + total) : preadv(ctx->fd, group, n, offset + total);
+		} while (ret < 0 && errno == EINTR);
+		if (ret < 0) {
 			if (errno) return -errno;
-			return 0;
+			return BCTBX_VFS_ERROR;
 		}
+		total += ret;
+		if ((size_t)ret < groupSize) break; /* end of file or partial write */
+		i += n;
 	}
-	return BCTBX_VFS_ERROR;
+	return total;
+}
+
+/**
+ * Reads from the file at offset into several buffers using positional vectored reads.
+ * @return -errno on error, number of bytes read otherwise.
+ */
+static ssize_t bcReadv(bctbx_vfs_file_t *pFile, const bctbx_iovec_t *iov, int iovcnt, off_t offset) {
+	return bcVectoredIo(pFile, iov, iovcnt, offset, FALSE);
 }
 
+/**
+ * Writes several buffers to the file at offset using positional vectored writes.
+ * @return -errno on error, number of bytes written otherwise.
+ */
+static ssize_t bcWritev(bctbx_vfs_file_t *pFile, const bctbx_iovec_t *iov, int iovcnt, off_t offset) {
+	return bcVectoredIo(pFile, iov, iovcnt, offset, TRUE);
+}
+#endif /* HAVE_PREADV && HAVE_PWRITEV */
+
 /**
  * Returns the file size associated with the file handle pFile.
  * @param pFile File handle pointer.
@@ -208,6 +294,15 @@ static const  bctbx_io_methods_t bcio = {
 	NULL			/* pFuncIsEncrypted -> no function so we will return false */
 };
 
+#if defined(HAVE_PREADV) && defined(HAVE_PWRITEV)
+static const bctbx_io_methods_ext_t bcioext = {
+	sizeof(bctbx_io_methods_ext_t),	/* size */
+	bcReadv,		/* pFuncReadv */
+	bcWritev,		/* pFuncWritev */
+	NULL			/* pFuncGetBlockSize: use the default */
+};
+#endif
+
 
 
 static int bcOpen(bctbx_vfs_t *pVfs, bctbx_vfs_file_t *pFile, const char *fName, int openFlags) {
@@ -226,6 +321,10 @@ static int bcOpen(bctbx_vfs_t *pVfs, bctbx_vfs_file_t *pFile, const char *fName,
 		return -errno;
 	}
 
+#if defined(HAVE_PREADV) && defined(HAVE_PWRITEV)
+	/* registered at the first opening, the lookup is lock-free */
+	if (bctbx_io_methods_get_ext(&bcio) == NULL) bctbx_io_methods_set_ext(&bcio, &bcioext);
+#endif
 	pFile->pMethods = &bcio;
 	pFile->pUserData = (void *)userData;
 	return BCTBX_VFS_OK;
@@ -35,10 +35,12 @@ extern "C" {
 
 extern test_suite_t containers_test_suite;
 extern test_suite_t utils_test_suite;
+extern test_suite_t logging_test_suite;
 extern test_suite_t crypto_test_suite;
 extern test_suite_t parser_test_suite;
 extern test_suite_t ios_utils_test_suite;
 extern test_suite_t encrypted_vfs_test_suite;
+extern test_suite_t vfs_test_suite;
 
 #ifdef __cplusplus
 };
@@ -637,10 +637,91 @@ static void hash_test(void) {
 	OKM.assign({0x14, 0x07, 0xd4, 0x60, 0x13, 0xd9, 0x8b, 0xc6, 0xde, 0xce, 0xfc, 0xfe, 0xe5, 0x5f, 0x0f, 0x90, 0xb0, 0xc7, 0xf6, 0x3d, 0x68, 0xeb, 0x1a, 0x80, 0xea, 0xf0, 0x7e, 0x95, 0x3c, 0xfc, 0x0a, 0x3a, 0x52, 0x40, 0xa1, 0x55, 0xd6, 0xe4, 0xda, 0xa9, 0x65, 0xbb});
 	BC_ASSERT_TRUE(OKM == bctoolbox::HKDF<SHA512>(salt, IKM, info, OKM.size()));
 
+	/* allocation free versions, writing in caller provided buffers */
+	std::array<uint8_t, SHA512::ssize()> hmacOutput{};
+	bctoolbox::HMAC<SHA256>(hmac_sha_key.data(), hmac_sha_key.size(), hmac_sha_data.data(), hmac_sha_data.size(), hmacOutput.data());
+	BC_ASSERT_TRUE(std::equal(hmac_sha256_pattern.cbegin(), hmac_sha256_pattern.cend(), hmacOutput.cbegin()));
+	bctoolbox::HMAC<SHA384>(hmac_sha_key.data(), hmac_sha_key.size(), hmac_sha_data.data(), hmac_sha_data.size(), hmacOutput.data());
+	BC_ASSERT_TRUE(std::equal(hmac_sha384_pattern.cbegin(), hmac_sha384_pattern.cend(), hmacOutput.cbegin()));
+	bctoolbox::HMAC<SHA512>(hmac_sha_key.data(), hmac_sha_key.size(), hmac_sha_data.data(), hmac_sha_data.size(), hmacOutput.data());
+	BC_ASSERT_TRUE(std::equal(hmac_sha512_pattern.cbegin(), hmac_sha512_pattern.cend(), hmacOutput.cbegin()));
+	std::array<uint8_t, 42> okmBuffer{};
+	bctoolbox::HKDF<SHA512>(salt.data(), salt.size(), IKM.data(), IKM.size(), info.data(), info.size(), okmBuffer.data(), okmBuffer.size());
+	BC_ASSERT_TRUE(std::equal(OKM.cbegin(), OKM.cend(), okmBuffer.cbegin()));
+
+	/* incremental HMAC: feed the input in several parts, reuse the keyed context and clone it */
+	bctoolbox::HMACContext<SHA256> hmacContext(hmac_sha_key);
+	for (size_t round=0; round<2; round++) {
+		hmacContext.update(hmac_sha_data.data(), 10).update(hmac_sha_data.data()+10, 70);
+		bctoolbox::HMACContext<SHA256> clonedContext(hmacContext);
+		hmacContext.update(hmac_sha_data.data()+80, hmac_sha_data.size()-80);
+		BC_ASSERT_TRUE(hmacContext.finalize() == hmac_sha256_pattern);
+		clonedContext.update(hmac_sha_data.data()+80, hmac_sha_data.size()-80).finalize(hmacOutput.data());
+		BC_ASSERT_TRUE(std::equal(hmac_sha256_pattern.cbegin(), hmac_sha256_pattern.cend(), hmacOutput.cbegin()));
+	}
+	hmacContext.update(info).reset(); // drop this input
+	BC_ASSERT_TRUE(hmacContext.update(hmac_sha_data).finalize() == hmac_sha256_pattern);
+	bctoolbox::HMACContext<SHA512> hmac512Context(hmac_sha_key.data(), hmac_sha_key.size());
+	BC_ASSERT_TRUE(hmac512Context.update(hmac_sha_data).finalize() == hmac_sha512_pattern);
+	bctoolbox::HMACContext<SHA384> hmac384Context(hmac_sha_key);
+	BC_ASSERT_TRUE(hmac384Context.update(hmac_sha_data).finalize() == hmac_sha384_pattern);
+
 #endif // HAVE_MBEDTLS
 
 }
 
+static void hash_batch_test(void) {
+	/* enough data to spread the batch over several lanes, with uneven inputs sizes */
+	const size_t count = 64;
+	std::vector<std::vector<uint8_t>> inputs{};
+	for (size_t i=0; i<count; i++) {
+		inputs.push_back(std::vector<uint8_t>((i*7919)%65536));
+		for (size_t j=0; j<inputs.back().size(); j++) inputs.back()[j] = static_cast<uint8_t>(i+j*13);
+	}
+
+	/* C api, with truncated outputs */
+	std::vector<std::array<uint8_t, 64>> outputs(count);
+	std::vector<bctbx_hash_batch_entry_t> entries(count);
+	for (size_t i=0; i<count; i++) {
+		entries[i] = {inputs[i].data(), inputs[i].size(), outputs[i].data()};
+	}
+	std::array<uint8_t, 64> reference{};
+	bctbx_sha256_batch(entries.data(), entries.size(), 32);
+	for (size_t i=0; i<count; i++) {
+		bctbx_sha256(inputs[i].data(), inputs[i].size(), 32, reference.data());
+		BC_ASSERT_TRUE(memcmp(outputs[i].data(), reference.data(), 32)==0);
+	}
+	bctbx_sha384_batch(entries.data(), entries.size(), 48);
+	for (size_t i=0; i<count; i++) {
+		bctbx_sha384(inputs[i].data(), inputs[i].size(), 48, reference.data());
+		BC_ASSERT_TRUE(memcmp(outputs[i].data(), reference.data(), 48)==0);
+	}
+	outputs.assign(count, std::array<uint8_t, 64>{});
+	bctbx_sha512_batch(entries.data(), entries.size(), 20);
+	for (size_t i=0; i<count; i++) {
+		bctbx_sha512(inputs[i].data(), inputs[i].size(), 20, reference.data());
+		BC_ASSERT_TRUE(memcmp(outputs[i].data(), reference.data(), 20)==0);
+		BC_ASSERT_EQUAL(outputs[i][20], 0, uint8_t, "%d"); // output is truncated
+	}
+
+#ifdef HAVE_MBEDTLS
+	/* C++ api, a small batch is processed in the calling thread */
+	std::vector<HashBatchEntry> cppEntries(count);
+	for (size_t i=0; i<count; i++) {
+		cppEntries[i] = {inputs[i].data(), inputs[i].size(), outputs[i].data()};
+	}
+	for (size_t batchSize:{count, static_cast<size_t>(3)}) {
+		outputs.assign(count, std::array<uint8_t, 64>{});
+		HashBatch<SHA512>(cppEntries.data(), batchSize);
+		for (size_t i=0; i<count; i++) {
+			bctbx_sha512(inputs[i].data(), inputs[i].size(), 64, reference.data());
+			BC_ASSERT_EQUAL((memcmp(outputs[i].data(), reference.data(), 64)==0), (i<batchSize), bool, "%d");
+		}
+	}
+	HashBatch<SHA256>(cppEntries.data(), 0); // empty batch
+#endif // HAVE_MBEDTLS
+}
+
 #ifdef HAVE_MBEDTLS
 template <typename U>
 static void rng_stats_update(size_t &count, double &mean, double &m2, U r) noexcept {
@@ -992,9 +1073,201 @@ static void AEAD(void) {
 	BC_ASSERT_TRUE(tag==pattern_tag);
 	BC_ASSERT_TRUE(AEADDecrypt<AES256GCM128>(key, IV, pattern_cipher, AD, pattern_tag, plain));
 	BC_ASSERT_TRUE(plain==pattern_plain);
+
+	/* buffer version, encrypt and decrypt in place */
+	std::vector<uint8_t> buffer{pattern_plain};
+	std::vector<uint8_t> bufferTag(AES256GCM128::tagSize());
+	AEADEncrypt<AES256GCM128>(key.data(), IV.data(), IV.size(), buffer.data(), buffer.size(), AD.data(), AD.size(), bufferTag.data(), buffer.data());
+	BC_ASSERT_TRUE(buffer==pattern_cipher);
+	BC_ASSERT_TRUE(bufferTag==pattern_tag);
+	BC_ASSERT_TRUE(AEADDecrypt<AES256GCM128>(key.data(), IV.data(), IV.size(), buffer.data(), buffer.size(), AD.data(), AD.size(), bufferTag.data(), buffer.data()));
+	BC_ASSERT_TRUE(buffer==pattern_plain);
+	bufferTag[0] ^= 0x01; // corrupt the tag, authentication shall fail
+	BC_ASSERT_FALSE(AEADDecrypt<AES256GCM128>(key.data(), IV.data(), IV.size(), pattern_cipher.data(), pattern_cipher.size(), AD.data(), AD.size(), bufferTag.data(), buffer.data()));
 }
 
 
+static void AEAD_context(void) {
+	RNG rng;
+	std::vector<uint8_t> key = rng.randomize(AES256GCM128::keySize());
+	AEADContext<AES256GCM128> context(key);
+
+	/* the keyed context gives the same output than the one shot functions, for many messages with different IV */
+	for (size_t i=0; i<50; i++) {
+		std::vector<uint8_t> IV = rng.randomize(12);
+		std::vector<uint8_t> plain(i*37);
+		for (size_t j=0; j<plain.size(); j++) plain[j] = static_cast<uint8_t>(i+j*7);
+		std::vector<uint8_t> AD = rng.randomize(i%13);
+		std::vector<uint8_t> tag{};
+		std::vector<uint8_t> contextTag{};
+		std::vector<uint8_t> cipher = AEADEncrypt<AES256GCM128>(key, IV, plain, AD, tag);
+		std::vector<uint8_t> contextCipher = context.encrypt(IV, plain, AD, contextTag);
+		BC_ASSERT_TRUE(cipher == contextCipher);
+		BC_ASSERT_TRUE(tag == contextTag);
+		std::vector<uint8_t> decrypted{};
+		BC_ASSERT_TRUE(context.decrypt(IV, cipher, AD, tag, decrypted));
+		BC_ASSERT_TRUE(decrypted == plain);
+
+		/* buffer version, in place */
+		std::vector<uint8_t> buffer{plain};
+		std::vector<uint8_t> bufferTag(AES256GCM128::tagSize());
+		context.encrypt(IV.data(), IV.size(), buffer.data(), buffer.size(), AD.data(), AD.size(), bufferTag.data(), buffer.data());
+		BC_ASSERT_TRUE(buffer == cipher);
+		BC_ASSERT_TRUE(bufferTag == tag);
+		BC_ASSERT_TRUE(context.decrypt(IV.data(), IV.size(), buffer.data(), buffer.size(), AD.data(), AD.size(), bufferTag.data(), buffer.data()));
+		BC_ASSERT_TRUE(buffer == plain);
+		bufferTag[0] ^= 0x01; // corrupt the tag, authentication shall fail
+		BC_ASSERT_FALSE(context.decrypt(IV.data(), IV.size(), cipher.data(), cipher.size(), AD.data(), AD.size(), bufferTag.data(), buffer.data()));
+	}
+	bool thrown = false;
+	try {
+		AEADContext<AES256GCM128> badContext(std::vector<uint8_t>(16)); // key too short
+	} catch (BctbxException const &e) {
+		thrown = true;
+	}
+	BC_ASSERT_TRUE(thrown);
+
+	/* C API, with all the AES key sizes */
+	for (size_t keyLength : {16, 24, 32}) {
+		std::vector<uint8_t> cKey = rng.randomize(keyLength);
+		bctbx_aes_gcm_keyed_context_t *cContext = bctbx_aes_gcm_keyed_context_new(cKey.data(), cKey.size());
+		BC_ASSERT_PTR_NOT_NULL(cContext);
+		if (cContext == NULL) continue;
+		for (size_t i=0; i<10; i++) {
+			std::vector<uint8_t> IV = rng.randomize(12);
+			std::vector<uint8_t> plain = rng.randomize(100+i);
+			std::vector<uint8_t> AD = rng.randomize(i);
+			std::vector<uint8_t> tag(16), contextTag(16), cipher(plain.size()), contextCipher(plain.size()), decrypted(plain.size());
+			BC_ASSERT_EQUAL(bctbx_aes_gcm_encrypt_and_tag(cKey.data(), cKey.size(), plain.data(), plain.size(), AD.data(), AD.size(), IV.data(), IV.size(), tag.data(), tag.size(), cipher.data()), 0, int32_t, "%d");
+			BC_ASSERT_EQUAL(bctbx_aes_gcm_keyed_encrypt_and_tag(cContext, plain.data(), plain.size(), AD.data(), AD.size(), IV.data(), IV.size(), contextTag.data(), contextTag.size(), contextCipher.data()), 0, int32_t, "%d");
+			BC_ASSERT_TRUE(cipher == contextCipher);
+			BC_ASSERT_TRUE(tag == contextTag);
+			BC_ASSERT_EQUAL(bctbx_aes_gcm_keyed_decrypt_and_auth(cContext, cipher.data(), cipher.size(), AD.data(), AD.size(), IV.data(), IV.size(), tag.data(), tag.size(), decrypted.data()), 0, int32_t, "%d");
+			BC_ASSERT_TRUE(decrypted == plain);
+			tag[0] ^= 0x01;
+			BC_ASSERT_EQUAL(bctbx_aes_gcm_keyed_decrypt_and_auth(cContext, cipher.data(), cipher.size(), AD.data(), AD.size(), IV.data(), IV.size(), tag.data(), tag.size(), decrypted.data()), BCTBX_ERROR_AUTHENTICATION_FAILED, int32_t, "%d");
+		}
+		bctbx_aes_gcm_keyed_context_free(cContext);
+	}
+	BC_ASSERT_PTR_NULL(bctbx_aes_gcm_keyed_context_new(key.data(), 20));
+}
+static void AEAD_batch(void) {
+	RNG rng;
+	const size_t count = 200;
+	std::vector<uint8_t> key = rng.randomize(AES256GCM128::keySize());
+	std::vector<std::vector<uint8_t>> IVs{}, ADs{}, plains{}, ciphers{}, tags{};
+	for (size_t i=0; i<count; i++) {
+		IVs.push_back(rng.randomize(12));
+		ADs.push_back(rng.randomize(i%20));
+		plains.push_back(std::vector<uint8_t>(i%160));
+		for (size_t j=0; j<plains.back().size(); j++) plains.back()[j] = static_cast<uint8_t>(i*3+j);
+		tags.push_back(std::vector<uint8_t>{});
+		ciphers.push_back(AEADEncrypt<AES256GCM128>(key, IVs[i], plains[i], ADs[i], tags[i]));
+	}
+
+	/* C++: encrypt in place, output and tags match the message per message encryption */
+	std::vector<std::vector<uint8_t>> buffers{plains};
+	std::vector<std::vector<uint8_t>> batchTags(count, std::vector<uint8_t>(AES256GCM128::tagSize()));
+	std::vector<AEADBatchEntry> entries(count);
+	for (size_t i=0; i<count; i++) {
+		entries[i] = {IVs[i].data(), IVs[i].size(), ADs[i].data(), ADs[i].size(), buffers[i].data(), buffers[i].size(), buffers[i].data(), batchTags[i].data(), false};
+	}
+	AEADEncryptBatch<AES256GCM128>(key.data(), entries.data(), entries.size());
+	BC_ASSERT_TRUE(buffers == ciphers);
+	BC_ASSERT_TRUE(batchTags == tags);
+
+	/* decrypt in place, with one corrupted tag */
+	batchTags[count/2][0] ^= 0x01;
+	BC_ASSERT_EQUAL(AEADDecryptBatch<AES256GCM128>(key.data(), entries.data(), entries.size()), 1, size_t, "%zu");
+	for (size_t i=0; i<count; i++) {
+		BC_ASSERT_EQUAL(entries[i].authenticated, (i != count/2), bool, "%d");
+		if (i != count/2) {
+			BC_ASSERT_TRUE(buffers[i] == plains[i]);
+		}
+	}
+
+	/* C API */
+	std::vector<bctbx_aes_gcm_batch_entry_t> cEntries(count);
+	std::vector<std::vector<uint8_t>> outputs(count);
+	for (size_t i=0; i<count; i++) {
+		outputs[i].resize(plains[i].size());
+		batchTags[i].assign(AES256GCM128::tagSize(), 0);
+		cEntries[i] = {IVs[i].data(), IVs[i].size(), ADs[i].data(), ADs[i].size(), plains[i].data(), plains[i].size(), outputs[i].data(), batchTags[i].data(), -1};
+	}
+	BC_ASSERT_EQUAL(bctbx_aes_gcm_encrypt_and_tag_batch(key.data(), key.size(), cEntries.data(), cEntries.size(), AES256GCM128::tagSize()), 0, int32_t, "%d");
+	BC_ASSERT_TRUE(outputs == ciphers);
+	BC_ASSERT_TRUE(batchTags == tags);
+	for (size_t i=0; i<count; i++) {
+		BC_ASSERT_EQUAL(cEntries[i].status, 0, int32_t, "%d");
+		cEntries[i].input = ciphers[i].data();
+		cEntries[i].output = outputs[i].data();
+	}
+	batchTags[1][5] ^= 0x80;
+	BC_ASSERT_EQUAL(bctbx_aes_gcm_decrypt_and_auth_batch(key.data(), key.size(), cEntries.data(), cEntries.size(), AES256GCM128::tagSize()), BCTBX_ERROR_AUTHENTICATION_FAILED, int32_t, "%d");
+	for (size_t i=0; i<count; i++) {
+		BC_ASSERT_EQUAL(cEntries[i].status, (i == 1) ? BCTBX_ERROR_AUTHENTICATION_FAILED : 0, int32_t, "%d");
+		if (i != 1) {
+			BC_ASSERT_TRUE(outputs[i] == plains[i]);
+		}
+	}
+	BC_ASSERT_EQUAL(bctbx_aes_gcm_encrypt_and_tag_batch(key.data(), 20, cEntries.data(), cEntries.size(), AES256GCM128::tagSize()), BCTBX_ERROR_INVALID_INPUT_DATA, int32_t, "%d");
+}
+
+static void chacha20poly1305(void) {
+	/* Test vector from RFC 8439 - section 2.8.2 */
+	std::vector<uint8_t> key{0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f, 0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f};
+	std::vector<uint8_t> IV{0x07, 0x00, 0x00, 0x00, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47};
+	std::vector<uint8_t> AD{0x50, 0x51, 0x52, 0x53, 0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7};
+	const std::string sunscreen{"Ladies and Gentlemen of the class of '99: If I could offer you only one tip for the future, sunscreen would be it."};
+	std::vector<uint8_t> pattern_plain{sunscreen.cbegin(), sunscreen.cend()};
+	std::vector<uint8_t> pattern_cipher{0xd3, 0x1a, 0x8d, 0x34, 0x64, 0x8e, 0x60, 0xdb, 0x7b, 0x86, 0xaf, 0xbc, 0x53, 0xef, 0x7e, 0xc2,
+					0xa4, 0xad, 0xed, 0x51, 0x29, 0x6e, 0x08, 0xfe, 0xa9, 0xe2, 0xb5, 0xa7, 0x36, 0xee, 0x62, 0xd6,
+					0x3d, 0xbe, 0xa4, 0x5e, 0x8c, 0xa9, 0x67, 0x12, 0x82, 0xfa, 0xfb, 0x69, 0xda, 0x92, 0x72, 0x8b,
+					0x1a, 0x71, 0xde, 0x0a, 0x9e, 0x06, 0x0b, 0x29, 0x05, 0xd6, 0xa5, 0xb6, 0x7e, 0xcd, 0x3b, 0x36,
+					0x92, 0xdd, 0xbd, 0x7f, 0x2d, 0x77, 0x8b, 0x8c, 0x98, 0x03, 0xae, 0xe3, 0x28, 0x09, 0x1b, 0x58,
+					0xfa, 0xb3, 0x24, 0xe4, 0xfa, 0xd6, 0x75, 0x94, 0x55, 0x85, 0x80, 0x8b, 0x48, 0x31, 0xd7, 0xbc,
+					0x3f, 0xf4, 0xde, 0xf0, 0x8e, 0x4b, 0x7a, 0x9d, 0xe5, 0x76, 0xd2, 0x65, 0x86, 0xce, 0xc6, 0x4b,
+					0x61, 0x16};
+	std::vector<uint8_t> pattern_tag{0x1a, 0xe1, 0x0b, 0x59, 0x4f, 0x09, 0xe2, 0x6a, 0x7e, 0x90, 0x2e, 0xcb, 0xd0, 0x60, 0x06, 0x91};
+	std::vector<uint8_t> tag{};
+	std::vector<uint8_t> plain{};
+
+	std::vector<uint8_t> cipher = AEADEncrypt<CHACHA20POLY1305>(key, IV, pattern_plain, AD, tag);
+	BC_ASSERT_TRUE(cipher==pattern_cipher);
+	BC_ASSERT_TRUE(tag==pattern_tag);
+	BC_ASSERT_TRUE(AEADDecrypt<CHACHA20POLY1305>(key, IV, pattern_cipher, AD, pattern_tag, plain));
+	BC_ASSERT_TRUE(plain==pattern_plain);
+	pattern_tag[15] ^= 0x01; // corrupt the tag, authentication shall fail
+	BC_ASSERT_FALSE(AEADDecrypt<CHACHA20POLY1305>(key, IV, pattern_cipher, AD, pattern_tag, plain));
+
+	/* the keyed context and the batch give the same output than the one shot functions */
+	AEADContext<CHACHA20POLY1305> context(key);
+	std::vector<uint8_t> contextTag{};
+	BC_ASSERT_TRUE(context.encrypt(IV, pattern_plain, AD, contextTag) == pattern_cipher);
+	BC_ASSERT_TRUE(contextTag == tag);
+	BC_ASSERT_TRUE(context.decrypt(IV, pattern_cipher, AD, contextTag, plain));
+	BC_ASSERT_TRUE(plain==pattern_plain);
+
+	std::vector<uint8_t> buffer{pattern_plain};
+	std::vector<uint8_t> batchTag(CHACHA20POLY1305::tagSize());
+	AEADBatchEntry entry{IV.data(), IV.size(), AD.data(), AD.size(), buffer.data(), buffer.size(), buffer.data(), batchTag.data(), false};
+	AEADEncryptBatch<CHACHA20POLY1305>(key.data(), &entry, 1);
+	BC_ASSERT_TRUE(buffer == pattern_cipher);
+	BC_ASSERT_TRUE(batchTag == tag);
+	BC_ASSERT_EQUAL(AEADDecryptBatch<CHACHA20POLY1305>(key.data(), &entry, 1), 0, size_t, "%zu");
+	BC_ASSERT_TRUE(entry.authenticated);
+	BC_ASSERT_TRUE(buffer == pattern_plain);
+
+	/* only 96 bits nonces are supported */
+	bool thrown = false;
+	try {
+		AEADEncrypt<CHACHA20POLY1305>(key, std::vector<uint8_t>(8), pattern_plain, AD, tag);
+	} catch (BctbxException const &e) {
+		thrown = true;
+	}
+	BC_ASSERT_TRUE(thrown);
+}
+
 static test_t crypto_tests[] = {
 	TEST_NO_TAG("Diffie-Hellman Key exchange", DHM),
 	TEST_NO_TAG("Elliptic Curve Diffie-Hellman Key exchange", ECDH),
@@ -1003,8 +1276,12 @@ static test_t crypto_tests[] = {
 	TEST_NO_TAG("Ed25519 to X25519 key conversion", ed25519_to_x25519_keyconversion),
 	TEST_NO_TAG("Sign message and exchange key using the same base secret", sign_and_key_exchange),
 	TEST_NO_TAG("Hash functions", hash_test),
+	TEST_NO_TAG("Hash batch", hash_batch_test),
 	TEST_NO_TAG("RNG", rng_test),
 	TEST_NO_TAG("AEAD", AEAD),
+	TEST_NO_TAG("AEAD context", AEAD_context),
+	TEST_NO_TAG("AEAD batch", AEAD_batch),
+	TEST_NO_TAG("ChaCha20-Poly1305", chacha20poly1305),
 };
 
 test_suite_t crypto_test_suite = {"Crypto", NULL, NULL, NULL, NULL,
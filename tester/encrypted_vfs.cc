@@ -18,10 +18,16 @@
  */
 
 #include "bctoolbox_tester.h"
+#include "vfs_tester.hh"
 #include "bctoolbox/vfs_encrypted.hh"
 #include "bctoolbox/vfs_standard.h"
 #include "bctoolbox/logging.h"
+#include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
 
 using namespace bctoolbox;
 
@@ -45,6 +51,14 @@ static EncryptedVfsOpenCb set_aes256_encryption_info([](VfsEncryption &settings)
 	settings.chunkSizeSet(16);
 });
 
+static EncryptedVfsOpenCb set_chacha20_encryption_info([](VfsEncryption &settings) {
+	const std::vector<uint8_t> keyMaterial{0xf1, 0xe2, 0xd3, 0xc4, 0xb5, 0xa6, 0x97, 0x88, 0x79, 0x6a, 0x5b, 0x4c, 0x3d, 0x2e, 0x1f, 0x00,
+						0x21, 0x32, 0x43, 0x54, 0x65, 0x76, 0x87, 0x98, 0xa9, 0xba, 0xcb, 0xdc, 0xed, 0xfe, 0x0f, 0x1e};
+	settings.encryptionSuiteSet(EncryptionSuite::chacha20poly1305_sha256);
+	settings.secretMaterialSet(keyMaterial);
+	settings.chunkSizeSet(16);
+});
+
 static EncryptedVfsOpenCb set_encryption_info([](VfsEncryption &settings) {
 	auto filename = settings.filenameGet();
 
@@ -52,6 +66,8 @@ static EncryptedVfsOpenCb set_encryption_info([](VfsEncryption &settings) {
 		set_plain_encryption_info(settings);
 	} else if (filename.find(bctoolbox::encryptionSuiteString(bctoolbox::EncryptionSuite::aes256gcm128_sha256)) != std::string::npos) {
 		set_aes256_encryption_info(settings);
+	} else if (filename.find(bctoolbox::encryptionSuiteString(bctoolbox::EncryptionSuite::chacha20poly1305_sha256)) != std::string::npos) {
+		set_chacha20_encryption_info(settings);
 	} else if (filename.find(bctoolbox::encryptionSuiteString(bctoolbox::EncryptionSuite::dummy)) != std::string::npos) {
 		set_dummy_encryption_info(settings);
 	} else {
@@ -251,6 +267,8 @@ void basic_encryption_test() {
 	basic_encryption_test(EncryptionSuite::plain, true);
 	basic_encryption_test(EncryptionSuite::aes256gcm128_sha256, false);
 	basic_encryption_test(EncryptionSuite::aes256gcm128_sha256, true);
+	basic_encryption_test(EncryptionSuite::chacha20poly1305_sha256, false);
+	basic_encryption_test(EncryptionSuite::chacha20poly1305_sha256, true);
 
 	VfsEncryption::openCallbackSet(nullptr);
 }
@@ -316,6 +334,7 @@ void auth_fail_test() {
 
 	auth_fail_test(EncryptionSuite::dummy);
 	auth_fail_test(EncryptionSuite::aes256gcm128_sha256);
+	auth_fail_test(EncryptionSuite::chacha20poly1305_sha256);
 
 	VfsEncryption::openCallbackSet(nullptr);
 }
@@ -387,6 +406,7 @@ void migration_test() {
 
 	migration_test(EncryptionSuite::dummy);
 	migration_test(EncryptionSuite::aes256gcm128_sha256);
+	migration_test(EncryptionSuite::chacha20poly1305_sha256);
 
 	VfsEncryption::openCallbackSet(nullptr);
 }
@@ -465,15 +485,734 @@ void recovery_test() {
 
 	recovery_test(EncryptionSuite::dummy);
 	recovery_test(EncryptionSuite::aes256gcm128_sha256);
+	recovery_test(EncryptionSuite::chacha20poly1305_sha256);
+
+	VfsEncryption::openCallbackSet(nullptr);
+}
+
+/**
+ * Write and read over more chunks than the module chunk keys cache can hold
+ * so cache hits, misses and evictions all occur, check the content stays correct
+ */
+static size_t chunk_key_cache_size = 0;
+static EncryptedVfsOpenCb set_aes256_small_key_cache_info([](VfsEncryption &settings) {
+	set_aes256_encryption_info(settings);
+	settings.chunkKeyCacheSizeSet(chunk_key_cache_size);
+});
+
+void chunk_key_cache_test(size_t cacheSize) {
+	chunk_key_cache_size = cacheSize;
+	VfsEncryption::openCallbackSet(set_aes256_small_key_cache_info);
+
+	char *path = bc_tester_file("key_cache.");
+	std::string filePath{path};
+	filePath.append(bctoolbox::encryptionSuiteString(EncryptionSuite::aes256gcm128_sha256)).append(".evfs");
+	bctbx_free(path);
+	remove(filePath.data());
+
+	bctbx_vfs_file_t *fp = bctbx_file_open2(&bcEncryptedVfs, filePath.data(), O_RDWR|O_CREAT);
+	BC_ASSERT_PTR_NOT_NULL(fp);
+	if (fp == NULL) return;
+
+	uint8_t readBuffer[256];
+	// 16 chunks of 16 bytes
+	BC_ASSERT_EQUAL(bctbx_file_write(fp, message, 256, 0), 256, ssize_t, "%ld");
+	// overwrite and read back chunks in a non sequential order, each access crosses a chunk boundary
+	for (size_t i=0; i<16; i++) {
+		size_t offset = ((i*7)%16)*16+8; // 7 is prime with 16 so all chunks are visited
+		size_t count = std::min(static_cast<size_t>(16), 256-offset);
+		BC_ASSERT_EQUAL(bctbx_file_write(fp, message+255-offset-count+1, count, offset), count, ssize_t, "%ld");
+		memset(readBuffer, 0, sizeof(readBuffer));
+		BC_ASSERT_EQUAL(bctbx_file_read(fp, readBuffer, count, offset), count, ssize_t, "%ld");
+		BC_ASSERT_TRUE(memcmp(readBuffer, message+255-offset-count+1, count)==0);
+	}
+	bctbx_file_close(fp);
+
+	// reopen: the cache is rebuilt from scratch, full content must be readable
+	fp = bctbx_file_open2(&bcEncryptedVfs, filePath.data(), O_RDWR);
+	BC_ASSERT_PTR_NOT_NULL(fp);
+	if (fp != NULL) {
+		memset(readBuffer, 0, sizeof(readBuffer));
+		BC_ASSERT_EQUAL(bctbx_file_read(fp, readBuffer, 256, 0), 256, ssize_t, "%ld");
+		BC_ASSERT_TRUE(memcmp(readBuffer, message, 8)==0);
+		for (size_t i=0; i<16; i++) {
+			size_t offset = ((i*7)%16)*16+8;
+			size_t count = std::min(static_cast<size_t>(16), 256-offset);
+			BC_ASSERT_TRUE(memcmp(readBuffer+offset, message+255-offset-count+1, count)==0);
+		}
+		bctbx_file_close(fp);
+	}
+
+	remove(filePath.data());
+	VfsEncryption::openCallbackSet(nullptr);
+}
+
+void chunk_key_cache_test() {
+	chunk_key_cache_test(0); // no cache
+	chunk_key_cache_test(3); // small cache, lot of evictions
+	chunk_key_cache_test(64); // default size, the whole file fits in
+}
+
+/**
+ * Random sized reads, writes and truncates on several chunks at random offsets
+ * check the file content against a plain copy kept in memory
+ */
+void random_access_test(bctoolbox::EncryptionSuite suite) {
+	char *path = bc_tester_file("random_access.");
+	std::string filePath{path};
+	filePath.append(bctoolbox::encryptionSuiteString(suite)).append(".evfs");
+	bctbx_free(path);
+	remove(filePath.data());
+
+	bctbx_vfs_file_t *fp = bctbx_file_open2(&bcEncryptedVfs, filePath.data(), O_RDWR|O_CREAT);
+	BC_ASSERT_PTR_NOT_NULL(fp);
+	if (fp == NULL) return;
+
+	std::vector<uint8_t> expected{}; // the plain content of the file
+	std::vector<uint8_t> readBuffer(1024);
+	uint32_t seed = 0x1234567;
+	auto rand = [&seed](uint32_t max) {seed = seed*1103515245 + 12345; return (seed>>8)%max;};
+
+	for (int i=0; i<200; i++) {
+		size_t offset = rand(600);
+		size_t count = rand(300);
+		switch (rand(8)) {
+			case 0: // truncate
+				BC_ASSERT_EQUAL(bctbx_file_truncate(fp, offset), 0, int, "%d");
+				expected.resize(offset, 0);
+				break;
+			case 1: // close and reopen
+				bctbx_file_close(fp);
+				fp = bctbx_file_open2(&bcEncryptedVfs, filePath.data(), O_RDWR);
+				BC_ASSERT_PTR_NOT_NULL(fp);
+				if (fp == NULL) return;
+				break;
+			case 2: // read
+			case 3:
+			case 4: {
+				size_t expectedSize = (offset>=expected.size())?0:std::min(count, expected.size()-offset);
+				BC_ASSERT_EQUAL(bctbx_file_read(fp, readBuffer.data(), count, offset), expectedSize, ssize_t, "%ld");
+				BC_ASSERT_TRUE(std::equal(readBuffer.cbegin(), readBuffer.cbegin()+expectedSize, expected.cbegin()+std::min(offset, expected.size())));
+			}
+				break;
+			default: // write
+				count++; // do not write 0 bytes
+				for (size_t j=0; j<count; j++) {
+					readBuffer[j] = static_cast<uint8_t>(rand(256));
+				}
+				BC_ASSERT_EQUAL(bctbx_file_write(fp, readBuffer.data(), count, offset), count, ssize_t, "%ld");
+				if (offset+count > expected.size()) {
+					expected.resize(offset+count, 0);
+				}
+				std::copy(readBuffer.cbegin(), readBuffer.cbegin()+count, expected.begin()+offset);
+				break;
+		}
+		BC_ASSERT_EQUAL(bctbx_file_size(fp), expected.size(), int64_t, "%ld");
+	}
+
+	// check the whole content
+	bctbx_file_close(fp);
+	fp = bctbx_file_open2(&bcEncryptedVfs, filePath.data(), O_RDONLY);
+	BC_ASSERT_PTR_NOT_NULL(fp);
+	if (fp != NULL) {
+		readBuffer.resize(expected.size()+16);
+		BC_ASSERT_EQUAL(bctbx_file_read(fp, readBuffer.data(), readBuffer.size(), 0), expected.size(), ssize_t, "%ld");
+		BC_ASSERT_TRUE(std::equal(expected.cbegin(), expected.cend(), readBuffer.cbegin()));
+		bctbx_file_close(fp);
+	}
+	remove(filePath.data());
+}
+
+void random_access_test() {
+	VfsEncryption::openCallbackSet(set_encryption_info);
+
+	random_access_test(EncryptionSuite::dummy);
+	random_access_test(EncryptionSuite::plain);
+	random_access_test(EncryptionSuite::aes256gcm128_sha256);
 
 	VfsEncryption::openCallbackSet(nullptr);
 }
 
+/**
+ * Same random accesses with chunks processed by a worker pool
+ * use a low threshold so most of the operations are spread on the workers
+ */
+void parallel_chunks_test() {
+	VfsEncryption::workerPoolSet(4, 2);
+	BC_ASSERT_EQUAL(VfsEncryption::workerPoolThreadCountGet(), 4, size_t, "%zu");
+	VfsEncryption::openCallbackSet(set_encryption_info);
+
+	random_access_test(EncryptionSuite::dummy);
+	random_access_test(EncryptionSuite::aes256gcm128_sha256);
+
+	VfsEncryption::openCallbackSet(nullptr);
+	VfsEncryption::workerPoolSet(0);
+	BC_ASSERT_EQUAL(VfsEncryption::workerPoolThreadCountGet(), 0, size_t, "%zu");
+}
+
+/**
+ * Read the plain file size stored in an encrypted file header
+ */
+static uint64_t header_file_size(const std::string &filePath) {
+	uint8_t size[8];
+	uint64_t ret = 0;
+	bctbx_vfs_file_t *fp = bctbx_file_open2(bctbx_vfs_get_standard(), filePath.data(), O_RDONLY);
+	if (fp == NULL) return 0;
+	if (bctbx_file_read(fp, size, 8, 21) == 8) { // file size is at offset 21 in the header
+		for (auto b:size) {
+			ret = (ret<<8) | b;
+		}
+	}
+	bctbx_file_close(fp);
+	return ret;
+}
+
+static EncryptedVfsOpenCb set_write_back_encryption_info([](VfsEncryption &settings) {
+	set_encryption_info(settings);
+	settings.headerWriteBackSet(true);
+});
+
+/**
+ * In header write-back mode, the header is updated only on sync and close.
+ * A file closed without its header update is recovered at next opening
+ */
+void header_write_back_test(bctoolbox::EncryptionSuite suite) {
+	char *path = bc_tester_file("write_back.");
+	std::string filePath{path};
+	filePath.append(bctoolbox::encryptionSuiteString(suite)).append(".evfs");
+	std::string copyPath{path};
+	copyPath.append("copy.").append(bctoolbox::encryptionSuiteString(suite)).append(".evfs");
+	bctbx_free(path);
+	remove(filePath.data());
+	remove(copyPath.data());
+
+	VfsEncryption::openCallbackSet(set_write_back_encryption_info);
+	bctbx_vfs_file_t *fp = bctbx_file_open2(&bcEncryptedVfs, filePath.data(), O_RDWR|O_CREAT);
+	BC_ASSERT_PTR_NOT_NULL(fp);
+	if (fp == NULL) return;
+
+	// appending writes do not update the header
+	for (size_t i=0; i<8; i++) {
+		BC_ASSERT_EQUAL(bctbx_file_write(fp, message+i*20, 20, i*20), 20, ssize_t, "%ld");
+	}
+	BC_ASSERT_EQUAL(bctbx_file_size(fp), 160, int64_t, "%ld");
+	BC_ASSERT_EQUAL(header_file_size(filePath), 0, uint64_t, "%lu");
+
+	// sync does
+	BC_ASSERT_EQUAL(bctbx_file_sync(fp), BCTBX_VFS_OK, int, "%d");
+	BC_ASSERT_EQUAL(header_file_size(filePath), 160, uint64_t, "%lu");
+
+	// append again and copy the raw file before closing: this is what is on disk after a crash
+	BC_ASSERT_EQUAL(bctbx_file_write(fp, message+160, 96, 160), 96, ssize_t, "%ld");
+	BC_ASSERT_EQUAL(header_file_size(filePath), 160, uint64_t, "%lu");
+	{
+		std::ifstream src(filePath, std::ios::binary);
+		std::ofstream dst(copyPath, std::ios::binary);
+		dst << src.rdbuf();
+	}
+
+	// close updates the header
+	bctbx_file_close(fp);
+	BC_ASSERT_EQUAL(header_file_size(filePath), 256, uint64_t, "%lu");
+
+	// both the original and the copy with an outdated header must be readable
+	VfsEncryption::openCallbackSet(set_encryption_info);
+	uint8_t readBuffer[256];
+	for (const auto &p:{filePath, copyPath}) {
+		fp = bctbx_file_open2(&bcEncryptedVfs, p.data(), O_RDWR);
+		BC_ASSERT_PTR_NOT_NULL(fp);
+		if (fp == NULL) continue;
+		memset(readBuffer, 0, sizeof(readBuffer));
+		BC_ASSERT_EQUAL(bctbx_file_size(fp), 256, int64_t, "%ld");
+		BC_ASSERT_EQUAL(bctbx_file_read(fp, readBuffer, 256, 0), 256, ssize_t, "%ld");
+		BC_ASSERT_TRUE(memcmp(readBuffer, message, 256)==0);
+		// overwrite without changing the size: the header is not rewritten but stays valid
+		BC_ASSERT_EQUAL(bctbx_file_write(fp, message, 32, 100), 32, ssize_t, "%ld");
+		bctbx_file_close(fp);
+		BC_ASSERT_EQUAL(header_file_size(p), 256, uint64_t, "%lu");
+		fp = bctbx_file_open2(&bcEncryptedVfs, p.data(), O_RDONLY);
+		BC_ASSERT_PTR_NOT_NULL(fp);
+		if (fp == NULL) continue;
+		BC_ASSERT_EQUAL(bctbx_file_read(fp, readBuffer, 32, 100), 32, ssize_t, "%ld");
+		BC_ASSERT_TRUE(memcmp(readBuffer, message, 32)==0);
+		bctbx_file_close(fp);
+		remove(p.data());
+	}
+	VfsEncryption::openCallbackSet(nullptr);
+}
+
+void header_write_back_test() {
+	header_write_back_test(EncryptionSuite::dummy);
+	header_write_back_test(EncryptionSuite::aes256gcm128_sha256);
+}
+
+static EncryptedVfsOpenCb set_plain_cache_encryption_info([](VfsEncryption &settings) {
+	set_encryption_info(settings);
+	settings.plainCacheSizeSet(64); // 4 chunks of 16 bytes
+});
+
+/**
+ * Random accesses with a plain chunks cache smaller than the file
+ * Then check the reads are served by the cache: alter the file on disk, cached chunks are still readable
+ */
+void plain_chunk_cache_test() {
+	VfsEncryption::openCallbackSet(set_plain_cache_encryption_info);
+	random_access_test(EncryptionSuite::dummy);
+	random_access_test(EncryptionSuite::aes256gcm128_sha256);
+
+	char *path = bc_tester_file("cache.");
+	std::string filePath{path};
+	filePath.append(bctoolbox::encryptionSuiteString(EncryptionSuite::aes256gcm128_sha256)).append(".evfs");
+	bctbx_free(path);
+	remove(filePath.data());
+
+	bctbx_vfs_file_t *fp = bctbx_file_open2(&bcEncryptedVfs, filePath.data(), O_RDWR|O_CREAT);
+	BC_ASSERT_PTR_NOT_NULL(fp);
+	if (fp == NULL) return;
+	uint8_t readBuffer[256];
+	BC_ASSERT_EQUAL(bctbx_file_write(fp, message, 256, 0), 256, ssize_t, "%ld");
+	// the 4 last written chunks are in cache, read one of them to bring it in front
+	BC_ASSERT_EQUAL(bctbx_file_read(fp, readBuffer, 10, 200), 10, ssize_t, "%ld");
+
+	// corrupt all the cipher text on disk
+	bctbx_vfs_file_t *stdFp = bctbx_file_open2(bctbx_vfs_get_standard(), filePath.data(), O_RDWR);
+	BC_ASSERT_PTR_NOT_NULL(stdFp);
+	if (stdFp != NULL) {
+		auto rawSize = bctbx_file_size(stdFp);
+		std::vector<uint8_t> raw(static_cast<size_t>(rawSize));
+		bctbx_file_read(stdFp, raw.data(), raw.size(), 0);
+		for (size_t i=raw.size()-16*(16+28); i<raw.size(); i++) { // 16 chunks of 16 bytes, each with a 28 bytes header
+			raw[i] ^= 0xA5;
+		}
+		bctbx_file_write(stdFp, raw.data(), raw.size(), 0);
+		bctbx_file_close(stdFp);
+	}
+
+	// cached chunks are still readable, partially or fully, and can be partially overwritten
+	memset(readBuffer, 0, sizeof(readBuffer));
+	BC_ASSERT_EQUAL(bctbx_file_read(fp, readBuffer, 64, 192), 64, ssize_t, "%ld");
+	BC_ASSERT_TRUE(memcmp(readBuffer, message+192, 64)==0);
+	BC_ASSERT_EQUAL(bctbx_file_read(fp, readBuffer, 5, 250), 5, ssize_t, "%ld");
+	BC_ASSERT_TRUE(memcmp(readBuffer, message+250, 5)==0);
+	BC_ASSERT_EQUAL(bctbx_file_write(fp, message, 8, 228), 8, ssize_t, "%ld");
+	BC_ASSERT_EQUAL(bctbx_file_read(fp, readBuffer, 16, 224), 16, ssize_t, "%ld");
+	BC_ASSERT_TRUE(memcmp(readBuffer, message+224, 4)==0);
+	BC_ASSERT_TRUE(memcmp(readBuffer+4, message, 8)==0);
+	BC_ASSERT_TRUE(memcmp(readBuffer+12, message+236, 4)==0);
+	// chunks out of cache are not
+	BC_ASSERT_EQUAL(bctbx_file_read(fp, readBuffer, 16, 0), BCTBX_VFS_ERROR, ssize_t, "%ld");
+
+	// truncate drops the chunks out of the file from cache
+	BC_ASSERT_EQUAL(bctbx_file_truncate(fp, 200), 0, int, "%d");
+	BC_ASSERT_EQUAL(bctbx_file_truncate(fp, 256), 0, int, "%d");
+	BC_ASSERT_EQUAL(bctbx_file_read(fp, readBuffer, 56, 200), 56, ssize_t, "%ld");
+	uint8_t zeros[56] = {0};
+	BC_ASSERT_TRUE(memcmp(readBuffer, zeros, 56)==0);
+
+	bctbx_file_close(fp);
+	remove(filePath.data());
+	VfsEncryption::openCallbackSet(nullptr);
+}
+
+static EncryptedVfsOpenCb set_aes256_large_chunk_encryption_info([](VfsEncryption &settings) {
+	const std::vector<uint8_t> keyMaterial{0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xf0,
+						0x11, 0x12, 0x13, 0x54, 0x55, 0x56, 0xa7, 0xa8, 0xa9, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff, 0xef};
+	settings.encryptionSuiteSet(EncryptionSuite::aes256gcm128_sha256);
+	settings.secretMaterialSet(keyMaterial);
+	settings.chunkSizeSet(4096);
+});
+
+/**
+ * Check a file larger than the integrity check read blocks, then corrupt a chunk and check it is found
+ */
+void integrity_check_test() {
+	VfsEncryption::openCallbackSet(set_aes256_large_chunk_encryption_info);
+	char *path = bc_tester_file("integrity_check.evfs");
+	std::string filePath{path};
+	bctbx_free(path);
+	remove(filePath.data());
+
+	const size_t chunkCount = 1500; // about 6MB of raw file
+	bctbx_vfs_file_t *fp = bctbx_file_open2(&bcEncryptedVfs, filePath.data(), O_RDWR|O_CREAT);
+	BC_ASSERT_PTR_NOT_NULL(fp);
+	if (fp == NULL) return;
+	std::vector<uint8_t> content(chunkCount*4096 - 100);
+	for (size_t i=0; i<content.size(); i++) {
+		content[i] = static_cast<uint8_t>(i*7);
+	}
+	BC_ASSERT_EQUAL(bctbx_file_write(fp, content.data(), content.size(), 0), content.size(), ssize_t, "%ld");
+
+	uint32_t badChunk = 0;
+	uint32_t lastProgress = 0;
+	int progressCalls = 0;
+	auto progress = [&lastProgress, &progressCalls](uint32_t processedChunks, uint32_t totalChunks) {
+		BC_ASSERT_TRUE(processedChunks > lastProgress);
+		BC_ASSERT_EQUAL(totalChunks, chunkCount, uint32_t, "%u");
+		lastProgress = processedChunks;
+		progressCalls++;
+	};
+	auto evfs = static_cast<VfsEncryption *>(fp->pUserData);
+	BC_ASSERT_TRUE(evfs->integrityCheck(badChunk, progress));
+	BC_ASSERT_EQUAL(lastProgress, chunkCount, uint32_t, "%u");
+	BC_ASSERT_TRUE(progressCalls > 1);
+
+	// same with a worker pool
+	VfsEncryption::workerPoolSet(2);
+	lastProgress = 0;
+	BC_ASSERT_TRUE(evfs->integrityCheck(badChunk, progress));
+	BC_ASSERT_EQUAL(lastProgress, chunkCount, uint32_t, "%u");
+	VfsEncryption::workerPoolSet(0);
+
+	// corrupt the last byte of two chunks, the first one is reported
+	bctbx_vfs_file_t *stdFp = bctbx_file_open2(bctbx_vfs_get_standard(), filePath.data(), O_RDWR);
+	BC_ASSERT_PTR_NOT_NULL(stdFp);
+	if (stdFp != NULL) {
+		const int64_t rawChunkSize = 4096+28;
+		const int64_t rawFileSize = bctbx_file_size(stdFp);
+		const int64_t headerSize = rawFileSize - (chunkCount*rawChunkSize-100);
+		for (int64_t chunk:{1400, 1203}) {
+			uint8_t byte = 0;
+			bctbx_file_read(stdFp, &byte, 1, headerSize+(chunk+1)*rawChunkSize-1);
+			byte ^= 0x01;
+			bctbx_file_write(stdFp, &byte, 1, headerSize+(chunk+1)*rawChunkSize-1);
+		}
+		bctbx_file_close(stdFp);
+	}
+	BC_ASSERT_FALSE(evfs->integrityCheck(badChunk));
+	BC_ASSERT_EQUAL(badChunk, 1203, uint32_t, "%u");
+
+	// a missing chunk is reported too
+	bctbx_file_close(fp);
+	fp = bctbx_file_open2(&bcEncryptedVfs, filePath.data(), O_RDWR);
+	BC_ASSERT_PTR_NOT_NULL(fp);
+	if (fp != NULL) {
+		evfs = static_cast<VfsEncryption *>(fp->pUserData);
+		bctbx_file_truncate(evfs->pFileStd, 100000); // truncate the raw file
+		BC_ASSERT_FALSE(evfs->integrityCheck(badChunk));
+		BC_ASSERT_EQUAL(badChunk, 24, uint32_t, "%u");
+		bctbx_file_close(fp);
+	}
+
+	remove(filePath.data());
+	VfsEncryption::openCallbackSet(nullptr);
+}
+
+/**
+ * Migrate a plain file larger than the migration read blocks, with and without worker pool
+ */
+void large_migration_test(size_t threads) {
+	VfsEncryption::openCallbackSet(set_aes256_large_chunk_encryption_info);
+	VfsEncryption::workerPoolSet(threads);
+	char *path = bc_tester_file("large_migration.evfs");
+	std::string filePath{path};
+	bctbx_free(path);
+	remove(filePath.data());
+
+	std::vector<uint8_t> content(1500*4096 - 100);
+	for (size_t i=0; i<content.size(); i++) {
+		content[i] = static_cast<uint8_t>(i*13);
+	}
+	bctbx_vfs_file_t *fp = bctbx_file_open2(bctbx_vfs_get_standard(), filePath.data(), O_RDWR|O_CREAT);
+	BC_ASSERT_PTR_NOT_NULL(fp);
+	if (fp == NULL) return;
+	BC_ASSERT_EQUAL(bctbx_file_write(fp, content.data(), content.size(), 0), content.size(), ssize_t, "%ld");
+	bctbx_file_close(fp);
+
+	fp = bctbx_file_open2(&bcEncryptedVfs, filePath.data(), O_RDWR);
+	BC_ASSERT_PTR_NOT_NULL(fp);
+	if (fp != NULL) {
+		BC_ASSERT_TRUE(bctbx_file_is_encrypted(fp));
+		BC_ASSERT_EQUAL(bctbx_file_size(fp), content.size(), int64_t, "%ld");
+		std::vector<uint8_t> readBuffer(content.size());
+		BC_ASSERT_EQUAL(bctbx_file_read(fp, readBuffer.data(), readBuffer.size(), 0), content.size(), ssize_t, "%ld");
+		BC_ASSERT_TRUE(readBuffer == content);
+		uint32_t badChunk = 0;
+		BC_ASSERT_TRUE(static_cast<VfsEncryption *>(fp->pUserData)->integrityCheck(badChunk));
+		bctbx_file_close(fp);
+	}
+	// the temporary file is gone
+	std::ifstream tmpFile(filePath+".evfs_tmp");
+	BC_ASSERT_FALSE(tmpFile.good());
+
+	remove(filePath.data());
+	VfsEncryption::workerPoolSet(0);
+	VfsEncryption::openCallbackSet(nullptr);
+}
+
+void large_migration_test() {
+	large_migration_test(0);
+	large_migration_test(3);
+}
+
+static const std::vector<uint8_t> rekeyNewKeyMaterial{0xf1, 0xe2, 0xd3, 0xc4, 0xb5, 0xa6, 0x97, 0x88, 0x79, 0x6a, 0x5b, 0x4c, 0x3d, 0x2e, 0x1f, 0x00,
+							0x10, 0x21, 0x32, 0x43, 0x54, 0x65, 0x76, 0x87, 0x98, 0xa9, 0xba, 0xcb, 0xdc, 0xed, 0xfe, 0x0f};
+static EncryptedVfsOpenCb set_aes256_rekeyed_encryption_info([](VfsEncryption &settings) {
+	settings.encryptionSuiteSet(EncryptionSuite::aes256gcm128_sha256);
+	settings.secretMaterialSet(rekeyNewKeyMaterial);
+	settings.chunkSizeSet(4096);
+});
+
+/**
+ * Rekey a file larger than the rekey blocks, interrupt it, resume it and check the old key is not usable anymore
+ */
+void rekey_test() {
+	VfsEncryption::openCallbackSet(set_aes256_large_chunk_encryption_info);
+	char *path = bc_tester_file("rekey.evfs");
+	std::string filePath{path};
+	bctbx_free(path);
+	remove(filePath.data());
+	remove((filePath+".evfs_rekey").data());
+
+	const uint32_t chunkCount = 1500; // two rekey blocks
+	std::vector<uint8_t> content(chunkCount*4096 - 100);
+	for (size_t i=0; i<content.size(); i++) {
+		content[i] = static_cast<uint8_t>(i*11);
+	}
+	bctbx_vfs_file_t *fp = bctbx_file_open2(&bcEncryptedVfs, filePath.data(), O_RDWR|O_CREAT);
+	BC_ASSERT_PTR_NOT_NULL(fp);
+	if (fp == NULL) return;
+	BC_ASSERT_EQUAL(bctbx_file_write(fp, content.data(), content.size(), 0), content.size(), ssize_t, "%ld");
+	auto evfs = static_cast<VfsEncryption *>(fp->pUserData);
+
+	// interrupt the rekey after the first block
+	std::vector<uint32_t> progressCalls{};
+	auto interrupt = [&progressCalls](uint32_t processedChunks, uint32_t totalChunks) {
+		BC_ASSERT_EQUAL(totalChunks, chunkCount, uint32_t, "%u");
+		progressCalls.push_back(processedChunks);
+		if (progressCalls.size() == 1) throw std::runtime_error("interrupted");
+	};
+	auto record = [&progressCalls](uint32_t processedChunks, uint32_t) {
+		progressCalls.push_back(processedChunks);
+	};
+	try {
+		evfs->rekey(rekeyNewKeyMaterial, interrupt);
+		BC_FAIL("rekey was not interrupted");
+	} catch (std::runtime_error const &) {}
+	// the file is still usable with the old key
+	std::vector<uint8_t> readBuffer(content.size());
+	BC_ASSERT_EQUAL(bctbx_file_read(fp, readBuffer.data(), readBuffer.size(), 0), content.size(), ssize_t, "%ld");
+	BC_ASSERT_TRUE(readBuffer == content);
+
+	// resume it: the first block is not processed again
+	progressCalls.clear();
+	evfs->rekey(rekeyNewKeyMaterial, record);
+	BC_ASSERT_EQUAL(progressCalls.size(), 1, size_t, "%zu");
+	if (!progressCalls.empty()) {
+		BC_ASSERT_EQUAL(progressCalls.front(), chunkCount, uint32_t, "%u");
+	}
+	std::fill(readBuffer.begin(), readBuffer.end(), 0);
+	BC_ASSERT_EQUAL(bctbx_file_read(fp, readBuffer.data(), readBuffer.size(), 0), content.size(), ssize_t, "%ld");
+	BC_ASSERT_TRUE(readBuffer == content);
+	// the file is still writable
+	BC_ASSERT_EQUAL(bctbx_file_write(fp, content.data(), 5000, 10000), 5000, ssize_t, "%ld");
+	std::copy(content.cbegin(), content.cbegin()+5000, content.begin()+10000);
+	bctbx_file_close(fp);
+	std::ifstream tmpFile(filePath+".evfs_rekey");
+	BC_ASSERT_FALSE(tmpFile.good());
+
+	// old key is refused
+	fp = bctbx_file_open2(&bcEncryptedVfs, filePath.data(), O_RDWR);
+	BC_ASSERT_PTR_NULL(fp);
+	if (fp != NULL) bctbx_file_close(fp);
+
+	// new key works
+	VfsEncryption::openCallbackSet(set_aes256_rekeyed_encryption_info);
+	fp = bctbx_file_open2(&bcEncryptedVfs, filePath.data(), O_RDWR);
+	BC_ASSERT_PTR_NOT_NULL(fp);
+	if (fp == NULL) return;
+	evfs = static_cast<VfsEncryption *>(fp->pUserData);
+	std::fill(readBuffer.begin(), readBuffer.end(), 0);
+	BC_ASSERT_EQUAL(bctbx_file_read(fp, readBuffer.data(), readBuffer.size(), 0), content.size(), ssize_t, "%ld");
+	BC_ASSERT_TRUE(readBuffer == content);
+	uint32_t badChunk = 0;
+	BC_ASSERT_TRUE(evfs->integrityCheck(badChunk));
+
+	// an interrupted rekey is restarted from scratch once the file is modified, even by another handle
+	progressCalls.clear();
+	try {
+		evfs->rekey(std::vector<uint8_t>(32, 0x42), interrupt);
+	} catch (std::runtime_error const &) {}
+	bctbx_file_close(fp);
+	fp = bctbx_file_open2(&bcEncryptedVfs, filePath.data(), O_RDWR);
+	BC_ASSERT_PTR_NOT_NULL(fp);
+	if (fp == NULL) return;
+	evfs = static_cast<VfsEncryption *>(fp->pUserData);
+	BC_ASSERT_EQUAL(bctbx_file_write(fp, content.data(), 100, 0), 100, ssize_t, "%ld");
+	progressCalls.clear();
+	evfs->rekey(std::vector<uint8_t>(32, 0x42), record);
+	BC_ASSERT_EQUAL(progressCalls.size(), 2, size_t, "%zu");
+	bctbx_file_close(fp);
+
+	remove(filePath.data());
+	VfsEncryption::openCallbackSet(nullptr);
+}
+
+/**
+ * Vectored reads and writes on the encrypted vfs
+ */
+void vectored_io_test() {
+	VfsEncryption::openCallbackSet(set_aes256_large_chunk_encryption_info);
+	vfs_vectored_io_check(&bcEncryptedVfs, "vectored_io.evfs");
+	VfsEncryption::openCallbackSet(nullptr);
+}
+
+/**
+ * Iterate over the lines of an encrypted file larger than the line reader buffer
+ */
+void line_reader_test() {
+	VfsEncryption::openCallbackSet(set_aes256_large_chunk_encryption_info);
+	vfs_line_reader_check(&bcEncryptedVfs, "line_reader.evfs");
+	VfsEncryption::openCallbackSet(nullptr);
+}
+
+/**
+ * Write lines with bctbx_file_fprintf in buffered mode on an encrypted file
+ */
+void buffered_fprintf_test() {
+	VfsEncryption::openCallbackSet(set_aes256_large_chunk_encryption_info);
+	vfs_buffered_fprintf_check(&bcEncryptedVfs, "buffered_fprintf.evfs");
+	VfsEncryption::openCallbackSet(nullptr);
+}
+
+/**
+ * Concurrent asynchronous reads, each larger than the encrypted vfs read blocks
+ */
+void concurrent_async_reads_test() {
+	VfsEncryption::openCallbackSet(set_aes256_large_chunk_encryption_info);
+	std::vector<uint8_t> content(4<<20);
+	for (size_t i=0; i<content.size(); i++) {
+		content[i] = static_cast<uint8_t>(i*11 + i/4096);
+	}
+	std::string filePath{};
+	bctbx_vfs_file_t *fp = vfs_test_file_create(&bcEncryptedVfs, "concurrent_async_reads.evfs", filePath, content.data(), content.size());
+	VfsEncryption::openCallbackSet(nullptr);
+	if (fp == NULL) return;
+
+	// more reads than asynchronous I/O threads
+	const size_t readCount = 3;
+	const size_t readSize = 3<<20;
+	const size_t readStep = 512<<10;
+	std::unique_ptr<std::vector<uint8_t>[]> readBuffers(new std::vector<uint8_t>[readCount]);
+	std::unique_ptr<AsyncIoResult> ioResult(new AsyncIoResult());
+	for (size_t i=0; i<readCount; i++) {
+		readBuffers[i].resize(readSize);
+		BC_ASSERT_EQUAL(bctbx_file_read_async(fp, readBuffers[i].data(), readSize, static_cast<off_t>(i*readStep), async_io_done, ioResult.get()), BCTBX_VFS_OK, int, "%d");
+	}
+	bool done;
+	{
+		std::unique_lock<std::mutex> lock(ioResult->mutex);
+		done = ioResult->condition.wait_for(lock, std::chrono::seconds(30), [&]{return ioResult->results.size() == readCount;});
+	}
+	BC_ASSERT_TRUE(done);
+	if (!done) {
+		// the reads are stuck: leave them the file and the buffers
+		readBuffers.release();
+		ioResult.release();
+		return;
+	}
+	for (auto result:ioResult->results) {
+		BC_ASSERT_EQUAL(result, readSize, ssize_t, "%ld");
+	}
+	for (size_t i=0; i<readCount; i++) {
+		BC_ASSERT_TRUE(std::equal(readBuffers[i].cbegin(), readBuffers[i].cend(), content.cbegin()+i*readStep));
+	}
+	bctbx_file_close(fp);
+	remove(filePath.data());
+}
+
+/**
+ * Asynchronous I/O completion callbacks blocking their thread until released
+ */
+struct BlockedAsyncIo {
+	std::mutex mutex;
+	std::condition_variable condition;
+	size_t blocked = 0;
+	size_t completed = 0;
+	bool released = false;
+
+	static void done(void *userData, ssize_t) {
+		auto blockedIo = static_cast<BlockedAsyncIo *>(userData);
+		std::unique_lock<std::mutex> lock(blockedIo->mutex);
+		blockedIo->blocked++;
+		blockedIo->condition.notify_all();
+		blockedIo->condition.wait(lock, [blockedIo]{return blockedIo->released;});
+		blockedIo->completed++;
+		blockedIo->condition.notify_all();
+	}
+};
+
+/**
+ * A synchronous read larger than the encrypted vfs read blocks does not wait for the asynchronous I/O threads
+ */
+void read_with_busy_async_io_test() {
+	VfsEncryption::openCallbackSet(set_aes256_large_chunk_encryption_info);
+	std::vector<uint8_t> content(3<<20);
+	for (size_t i=0; i<content.size(); i++) {
+		content[i] = static_cast<uint8_t>(i*7 + i/4096);
+	}
+	std::string filePath{};
+	bctbx_vfs_file_t *fp = vfs_test_file_create(&bcEncryptedVfs, "read_with_busy_async_io.evfs", filePath, content.data(), content.size());
+	VfsEncryption::openCallbackSet(nullptr);
+	if (fp == NULL) return;
+
+	// keep both asynchronous I/O threads busy in a completion callback
+	const size_t blockingCount = 4;
+	uint8_t byte = 0;
+	BlockedAsyncIo blockedIo;
+	for (size_t i=0; i<blockingCount; i++) {
+		BC_ASSERT_EQUAL(bctbx_file_read_async(fp, &byte, 0, 0, BlockedAsyncIo::done, &blockedIo), BCTBX_VFS_OK, int, "%d");
+	}
+	bool readDone = false;
+	bool timedOut = false;
+	std::thread watchdog([&]() { // do not leave the test stuck if the read waits for the callbacks
+		std::unique_lock<std::mutex> lock(blockedIo.mutex);
+		timedOut = !blockedIo.condition.wait_for(lock, std::chrono::seconds(30), [&]{return readDone;});
+		blockedIo.released = true;
+		blockedIo.condition.notify_all();
+	});
+	{
+		std::unique_lock<std::mutex> lock(blockedIo.mutex);
+		blockedIo.condition.wait(lock, [&blockedIo]{return blockedIo.blocked > 1 || blockedIo.released;});
+	}
+
+	std::vector<uint8_t> readBuffer(content.size());
+	BC_ASSERT_EQUAL(bctbx_file_read(fp, readBuffer.data(), readBuffer.size(), 0), content.size(), ssize_t, "%ld");
+	BC_ASSERT_TRUE(readBuffer == content);
+	{
+		std::lock_guard<std::mutex> lock(blockedIo.mutex);
+		readDone = true;
+		blockedIo.condition.notify_all();
+	}
+	watchdog.join();
+	BC_ASSERT_FALSE(timedOut);
+
+	// every request must be completed before closing the file
+	{
+		std::unique_lock<std::mutex> lock(blockedIo.mutex);
+		blockedIo.condition.wait(lock, [&]{return blockedIo.completed == blockingCount;});
+	}
+	bctbx_file_close(fp);
+	remove(filePath.data());
+}
+
 static test_t encrypted_vfs_tests[] = {
 	TEST_NO_TAG("basic", basic_encryption_test),
 	TEST_NO_TAG("Authentication failure", auth_fail_test),
 	TEST_NO_TAG("migration", migration_test),
-	TEST_NO_TAG("recovery", recovery_test)
+	TEST_NO_TAG("recovery", recovery_test),
+	TEST_NO_TAG("chunk key cache", chunk_key_cache_test),
+	TEST_NO_TAG("random access", random_access_test),
+	TEST_NO_TAG("parallel chunks", parallel_chunks_test),
+	TEST_NO_TAG("header write-back", header_write_back_test),
+	TEST_NO_TAG("plain chunk cache", plain_chunk_cache_test),
+	TEST_NO_TAG("integrity check", integrity_check_test),
+	TEST_NO_TAG("large migration", large_migration_test),
+	TEST_NO_TAG("rekey", rekey_test),
+	TEST_NO_TAG("vectored io", vectored_io_test),
+	TEST_NO_TAG("line reader", line_reader_test),
+	TEST_NO_TAG("buffered fprintf", buffered_fprintf_test),
+	TEST_NO_TAG("concurrent async reads", concurrent_async_reads_test),
+	TEST_NO_TAG("read with busy async io", read_with_busy_async_io_test)
 };
 
 test_suite_t encrypted_vfs_test_suite = {"Encrypted vfs", NULL, NULL, NULL, NULL,
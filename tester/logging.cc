@@ -0,0 +1,564 @@
+/*
+ * Copyright (c) 2016-2020 Belledonne Communications SARL.
+ *
+ * This file is part of bctoolbox.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bctoolbox_tester.h"
+
+static const char *testDomain = "bctoolbox-logging-tester";
+
+/* Collect the messages logged in the test domain: the message is "<thread> <sequence>", optionally followed by padding */
+struct LogCollector {
+	std::vector<int> lastSequence; /**< last sequence received per logging thread */
+	int received = 0;
+	int outOfOrder = 0;
+	int corrupted = 0;
+	int delayMs = 0; /**< time taken to handle each record */
+
+	explicit LogCollector(int threadCount) : lastSequence(threadCount, -1) {}
+
+	static void handler(void *info, const char *domain, BctbxLogLevel level, const char *fmt, va_list args) {
+		LogCollector *collector = static_cast<LogCollector *>(info);
+		char *msg = bctbx_strdup_vprintf(fmt, args);
+		int thread = -1, sequence = -1;
+		if (domain == nullptr || strcmp(domain, testDomain) != 0 || level != BCTBX_LOG_MESSAGE
+			|| sscanf(msg, "%d %d", &thread, &sequence) != 2 || thread < 0 || thread >= (int)collector->lastSequence.size()) {
+			collector->corrupted++;
+		} else {
+			if (sequence <= collector->lastSequence[thread]) collector->outOfOrder++;
+			collector->lastSequence[thread] = sequence;
+			collector->received++;
+		}
+		bctbx_free(msg);
+		if (collector->delayMs > 0) std::this_thread::sleep_for(std::chrono::milliseconds(collector->delayMs));
+	}
+
+	static void destroy(bctbx_log_handler_t *handler) {
+		bctbx_log_handler_set_domain(handler, NULL);
+		bctbx_free(handler);
+	}
+};
+
+static bctbx_log_handler_t *add_collector(LogCollector &collector) {
+	bctbx_log_handler_t *handler = bctbx_create_log_handler(LogCollector::handler, LogCollector::destroy, &collector);
+	bctbx_log_handler_set_domain(handler, testDomain);
+	bctbx_add_log_handler(handler);
+	return handler;
+}
+
+static void log_from_threads(int threadCount, int logsPerThread) {
+	const std::string padding(150, '-'); // longer than the record size: exercise the heap allocated records
+	std::vector<std::thread> threads;
+	for (int t = 0; t < threadCount; t++) {
+		threads.emplace_back([t, logsPerThread, &padding]() {
+			for (int i = 0; i < logsPerThread; i++) {
+				bctbx_log(testDomain, BCTBX_LOG_MESSAGE, "%d %d %s", t, i, (i % 10 == 0) ? padding.c_str() : "");
+			}
+		});
+	}
+	for (auto &thread : threads) {
+		thread.join();
+	}
+}
+
+static void async_logging_order(void) {
+	const int threadCount = 4;
+	const int logsPerThread = 100;
+	LogCollector collector(threadCount);
+	bctbx_set_log_level(testDomain, BCTBX_LOG_MESSAGE);
+	bctbx_log_handler_t *handler = add_collector(collector);
+
+	BC_ASSERT_EQUAL(bctbx_log_async_start(16, 128, BCTBX_LOG_ASYNC_BLOCK), 0, int, "%d");
+	BC_ASSERT_EQUAL(bctbx_log_async_start(16, 128, BCTBX_LOG_ASYNC_BLOCK), -1, int, "%d");
+	log_from_threads(threadCount, logsPerThread);
+	bctbx_log_async_flush();
+	/* blocking policy: nothing is lost and each thread records come in order */
+	BC_ASSERT_EQUAL(collector.received, threadCount * logsPerThread, int, "%d");
+	BC_ASSERT_EQUAL(collector.outOfOrder, 0, int, "%d");
+	BC_ASSERT_EQUAL(collector.corrupted, 0, int, "%d");
+	BC_ASSERT_EQUAL((int)bctbx_log_async_get_dropped_count(), 0, int, "%d");
+	bctbx_log_async_stop();
+
+	/* back to synchronous logging */
+	bctbx_log(testDomain, BCTBX_LOG_MESSAGE, "%d %d", 0, logsPerThread);
+	BC_ASSERT_EQUAL(collector.received, threadCount * logsPerThread + 1, int, "%d");
+	bctbx_remove_log_handler(handler);
+}
+
+static void async_logging_drop(void) {
+	const int threadCount = 4;
+	const int logsPerThread = 200;
+	LogCollector collector(threadCount);
+	bctbx_set_log_level(testDomain, BCTBX_LOG_MESSAGE);
+	bctbx_log_handler_t *handler = add_collector(collector);
+
+	BC_ASSERT_EQUAL(bctbx_log_async_start(2, 64, BCTBX_LOG_ASYNC_DROP), 0, int, "%d");
+	log_from_threads(threadCount, logsPerThread);
+	bctbx_log_async_flush();
+	int dropped = (int)bctbx_log_async_get_dropped_count();
+	bctbx_log_async_stop();
+	/* the records are either dispatched or accounted as dropped, the dispatched ones are still ordered */
+	BC_ASSERT_EQUAL(collector.received + dropped, threadCount * logsPerThread, int, "%d");
+	BC_ASSERT_EQUAL(collector.outOfOrder, 0, int, "%d");
+	BC_ASSERT_EQUAL(collector.corrupted, 0, int, "%d");
+	bctbx_remove_log_handler(handler);
+}
+
+static void async_logging_handler_removal(void) {
+	const int threadCount = 2;
+	const int logsPerThread = 20;
+	LogCollector collector(threadCount);
+	collector.delayMs = 1;
+	bctbx_set_log_level(testDomain, BCTBX_LOG_MESSAGE);
+	bctbx_log_handler_t *handler = add_collector(collector);
+
+	BC_ASSERT_EQUAL(bctbx_log_async_start(64, 64, BCTBX_LOG_ASYNC_BLOCK), 0, int, "%d");
+	log_from_threads(threadCount, logsPerThread);
+	/* the writer is still dispatching: the handler gets the queued records before being destroyed */
+	bctbx_remove_log_handler(handler);
+	BC_ASSERT_EQUAL(collector.received, threadCount * logsPerThread, int, "%d");
+	bctbx_log(testDomain, BCTBX_LOG_MESSAGE, "%d %d", 0, logsPerThread);
+	bctbx_log_async_stop();
+	BC_ASSERT_EQUAL(collector.received, threadCount * logsPerThread, int, "%d");
+	BC_ASSERT_EQUAL(collector.corrupted, 0, int, "%d");
+}
+
+static void log_domain_handles(void) {
+	const char *name = "bctoolbox-logging-tester-handle";
+	unsigned int defaultMask = bctbx_get_log_level_mask(NULL);
+	bctbx_log_domain_t *domain = bctbx_log_domain_get(name);
+	BC_ASSERT_PTR_NOT_NULL(domain);
+	BC_ASSERT_PTR_EQUAL(bctbx_log_domain_get(name), domain);
+
+	/* not configured yet: follow the default domain */
+	bctbx_set_log_level(NULL, BCTBX_LOG_MESSAGE);
+	BC_ASSERT_TRUE(bctbx_log_domain_level_enabled(domain, BCTBX_LOG_MESSAGE));
+	BC_ASSERT_FALSE(bctbx_log_domain_level_enabled(domain, BCTBX_LOG_DEBUG));
+	bctbx_set_log_level(NULL, BCTBX_LOG_ERROR);
+	BC_ASSERT_FALSE(bctbx_log_domain_level_enabled(domain, BCTBX_LOG_MESSAGE));
+	BC_ASSERT_TRUE(bctbx_log_domain_level_enabled(domain, BCTBX_LOG_ERROR));
+	BC_ASSERT_EQUAL(bctbx_get_log_level_mask(name), bctbx_get_log_level_mask(NULL), unsigned int, "%u");
+
+	/* configured: independent from the default domain, whether looked up by handle or by name */
+	bctbx_set_log_level(name, BCTBX_LOG_WARNING);
+	bctbx_set_log_level(NULL, BCTBX_LOG_DEBUG);
+	BC_ASSERT_TRUE(bctbx_log_domain_level_enabled(domain, BCTBX_LOG_WARNING));
+	BC_ASSERT_FALSE(bctbx_log_domain_level_enabled(domain, BCTBX_LOG_MESSAGE));
+	BC_ASSERT_FALSE(bctbx_log_level_enabled(name, BCTBX_LOG_MESSAGE));
+
+	/* a thread specific level only applies to its thread */
+	bctbx_set_thread_log_level(name, BCTBX_LOG_DEBUG);
+	BC_ASSERT_TRUE(bctbx_log_domain_level_enabled(domain, BCTBX_LOG_DEBUG));
+	int enabledInOtherThread = -1;
+	std::thread([domain, &enabledInOtherThread]() {
+		enabledInOtherThread = bctbx_log_domain_level_enabled(domain, BCTBX_LOG_DEBUG);
+	}).join();
+	BC_ASSERT_EQUAL(enabledInOtherThread, 0, int, "%d");
+	bctbx_clear_thread_log_level(name);
+	BC_ASSERT_FALSE(bctbx_log_domain_level_enabled(domain, BCTBX_LOG_DEBUG));
+	/* the level of an exited thread no longer applies */
+	std::thread([name]() {
+		bctbx_set_thread_log_level(name, BCTBX_LOG_DEBUG);
+	}).join();
+	BC_ASSERT_FALSE(bctbx_log_domain_level_enabled(domain, BCTBX_LOG_DEBUG));
+
+	/* lookups by name among many domains */
+	for (int i = 0; i < 200; i++) {
+		std::string other = std::string(name) + "-" + std::to_string(i);
+		bctbx_set_log_level_mask(other.c_str(), i % 2 ? BCTBX_LOG_ERROR : BCTBX_LOG_DEBUG);
+	}
+	for (int i = 0; i < 200; i++) {
+		std::string other = std::string(name) + "-" + std::to_string(i);
+		int debugEnabled = (i % 2) ? 0 : 1;
+		BC_ASSERT_EQUAL(bctbx_log_level_enabled(other.c_str(), BCTBX_LOG_DEBUG), debugEnabled, int, "%d");
+		BC_ASSERT_PTR_EQUAL(bctbx_log_domain_get(other.c_str()), bctbx_log_domain_get(other.c_str()));
+	}
+
+	/* logging through the handle */
+	LogCollector collector(1);
+	bctbx_log_handler_t *handler = add_collector(collector);
+	bctbx_set_log_level(testDomain, BCTBX_LOG_MESSAGE);
+	bctbx_log_domain_t *testDomainHandle = bctbx_log_domain_get(testDomain);
+	bctbx_log_domain_log(testDomainHandle, BCTBX_LOG_MESSAGE, "%d %d", 0, 0);
+	bctbx_log_domain_log(testDomainHandle, BCTBX_LOG_DEBUG, "%d %d", 0, 1);
+	BC_ASSERT_EQUAL(collector.received, 1, int, "%d");
+	BC_ASSERT_EQUAL(collector.corrupted, 0, int, "%d");
+	bctbx_remove_log_handler(handler);
+
+	bctbx_set_log_level_mask(NULL, (int)defaultMask);
+}
+
+struct RotatedFiles {
+	int count = 0;
+	bool wrongName = false;
+	std::string expectedName;
+
+	static void rotated(void *userData, const char *rotatedFile) {
+		RotatedFiles *rotated = static_cast<RotatedFiles *>(userData);
+		rotated->count++;
+		if (rotated->expectedName != rotatedFile) rotated->wrongName = true;
+	}
+};
+
+/* Count the records of the test domain in a log file, -1 if it does not exist */
+static int count_file_records(const std::string &path) {
+	FILE *f = fopen(path.c_str(), "r");
+	if (f == NULL) return -1;
+	const std::string tag = std::string(testDomain) + "-message-";
+	char line[512];
+	int count = 0;
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (strstr(line, tag.c_str()) != NULL) count++;
+	}
+	fclose(f);
+	return count;
+}
+
+static void buffered_file_log_handler(void) {
+	const int threadCount = 4;
+	const int logsPerThread = 100;
+	char *dir = bc_tester_file(".");
+	const std::string path(dir);
+	bctbx_free(dir);
+	const std::string name("buffered_log_test.log");
+	const int maxRotatedFiles = 100;
+	auto rotatedName = [&path](int n) {return path + "/buffered_log_test_" + std::to_string(n) + ".log";};
+	remove((path + "/" + name).c_str());
+	for (int n = 1; n <= maxRotatedFiles; n++) remove(rotatedName(n).c_str());
+
+	bctbx_set_log_level(testDomain, BCTBX_LOG_MESSAGE);
+	bctbx_log_handler_t *handler = bctbx_create_buffered_file_log_handler(4096, path.c_str(), name.c_str(), 1024, 50);
+	if (!BC_ASSERT_PTR_NOT_NULL(handler)) return;
+	RotatedFiles rotated;
+	rotated.expectedName = rotatedName(1);
+	bctbx_buffered_file_log_handler_set_rotated_callback(handler, RotatedFiles::rotated, &rotated);
+	bctbx_log_handler_set_domain(handler, testDomain);
+	bctbx_add_log_handler(handler);
+
+	/* a record is written within the flush interval without any explicit flush */
+	bctbx_log(testDomain, BCTBX_LOG_MESSAGE, "%d %d", 0, -1);
+	int written = 0;
+	for (int i = 0; i < 200 && written <= 0; i++) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		written = count_file_records(path + "/" + name);
+	}
+	BC_ASSERT_EQUAL(written, 1, int, "%d");
+
+	/* the records are spread over rotated files, rotated by the background thread */
+	log_from_threads(threadCount, logsPerThread);
+	bctbx_buffered_file_log_handler_flush(handler);
+	bctbx_remove_log_handler(handler);
+	BC_ASSERT_TRUE(rotated.count > 0);
+	BC_ASSERT_FALSE(rotated.wrongName);
+	int total = count_file_records(path + "/" + name);
+	for (int n = 1; n <= rotated.count; n++) {
+		int count = count_file_records(rotatedName(n));
+		BC_ASSERT_TRUE(count >= 0);
+		total += count;
+	}
+	BC_ASSERT_EQUAL(total, threadCount * logsPerThread + 1, int, "%d");
+
+	remove((path + "/" + name).c_str());
+	for (int n = 1; n <= maxRotatedFiles; n++) remove(rotatedName(n).c_str());
+}
+
+/* Rotation callback logging and flushing from the background thread, as a fatal record does */
+struct FlushingRotatedCallback {
+	bctbx_log_handler_t *handler = nullptr;
+	int count = 0;
+
+	static void rotated(void *userData, const char *rotatedFile) {
+		FlushingRotatedCallback *callback = static_cast<FlushingRotatedCallback *>(userData);
+		callback->count++;
+		bctbx_log(testDomain, BCTBX_LOG_MESSAGE, "rotated to %s", rotatedFile);
+		bctbx_buffered_file_log_handler_flush(callback->handler);
+	}
+};
+
+static void buffered_file_log_handler_rotated_flush(void) {
+	const int logCount = 200;
+	char *dir = bc_tester_file(".");
+	const std::string path(dir);
+	bctbx_free(dir);
+	const std::string name("buffered_log_flush_test.log");
+	const int maxRotatedFiles = 100;
+	auto rotatedName = [&path](int n) {return path + "/buffered_log_flush_test_" + std::to_string(n) + ".log";};
+	remove((path + "/" + name).c_str());
+	for (int n = 1; n <= maxRotatedFiles; n++) remove(rotatedName(n).c_str());
+
+	bctbx_set_log_level(testDomain, BCTBX_LOG_MESSAGE);
+	bctbx_log_handler_t *handler = bctbx_create_buffered_file_log_handler(2048, path.c_str(), name.c_str(), 256, 50);
+	if (!BC_ASSERT_PTR_NOT_NULL(handler)) return;
+	FlushingRotatedCallback callback;
+	callback.handler = handler;
+	bctbx_buffered_file_log_handler_set_rotated_callback(handler, FlushingRotatedCallback::rotated, &callback);
+	bctbx_log_handler_set_domain(handler, testDomain);
+	bctbx_add_log_handler(handler);
+
+	/* the flush requested by the callback does not wait for the background thread running it */
+	for (int i = 0; i < logCount; i++) {
+		bctbx_log(testDomain, BCTBX_LOG_MESSAGE, "%d %d", 0, i);
+	}
+	bctbx_buffered_file_log_handler_flush(handler);
+	bctbx_remove_log_handler(handler);
+	BC_ASSERT_TRUE(callback.count > 0);
+	int total = count_file_records(path + "/" + name);
+	for (int n = 1; n <= callback.count; n++) {
+		int count = count_file_records(rotatedName(n));
+		BC_ASSERT_TRUE(count >= 0);
+		total += count;
+	}
+	BC_ASSERT_EQUAL(total, logCount + callback.count, int, "%d");
+
+	remove((path + "/" + name).c_str());
+	for (int n = 1; n <= maxRotatedFiles; n++) remove(rotatedName(n).c_str());
+}
+
+/* Rotation callback keeping the background thread busy */
+struct SlowRotatedCallback {
+	int count = 0;
+
+	static void rotated(void *userData, const char *) {
+		static_cast<SlowRotatedCallback *>(userData)->count++;
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	}
+};
+
+/* Count the records of the test domain in a log file and add the dropped records it accounts for to dropped */
+static int count_file_records_and_dropped(const std::string &path, unsigned long long &dropped) {
+	FILE *f = fopen(path.c_str(), "r");
+	if (f == NULL) return -1;
+	const char *tag = "log handler full: ";
+	char line[512];
+	while (fgets(line, sizeof(line), f) != NULL) {
+		const char *note = strstr(line, tag);
+		if (note) dropped += strtoull(note + strlen(tag), NULL, 10);
+	}
+	fclose(f);
+	return count_file_records(path);
+}
+
+static void buffered_file_log_handler_overflow(void) {
+	const int logCount = 200;
+	char *dir = bc_tester_file(".");
+	const std::string path(dir);
+	bctbx_free(dir);
+	const std::string name("buffered_log_overflow_test.log");
+	const int maxRotatedFiles = 100;
+	auto rotatedName = [&path](int n) {return path + "/buffered_log_overflow_test_" + std::to_string(n) + ".log";};
+	remove((path + "/" + name).c_str());
+	for (int n = 1; n <= maxRotatedFiles; n++) remove(rotatedName(n).c_str());
+
+	bctbx_set_log_level(testDomain, BCTBX_LOG_MESSAGE);
+	/* every write rotates the file: the background thread is busy in the callback while the buffer fills up */
+	bctbx_log_handler_t *handler = bctbx_create_buffered_file_log_handler(1, path.c_str(), name.c_str(), 256, 60000);
+	if (!BC_ASSERT_PTR_NOT_NULL(handler)) return;
+	SlowRotatedCallback callback;
+	bctbx_buffered_file_log_handler_set_rotated_callback(handler, SlowRotatedCallback::rotated, &callback);
+	bctbx_buffered_file_log_handler_set_overflow_policy(handler, 1024, BCTBX_LOG_ASYNC_DROP);
+	bctbx_log_handler_set_domain(handler, testDomain);
+	bctbx_add_log_handler(handler);
+	for (int i = 0; i < logCount; i++) {
+		bctbx_log(testDomain, BCTBX_LOG_MESSAGE, "%d %d", 0, i);
+	}
+	bctbx_buffered_file_log_handler_flush(handler);
+	/* the first record logged once there is room again accounts for the dropped ones */
+	bctbx_log(testDomain, BCTBX_LOG_MESSAGE, "%d %d", 0, logCount);
+	bctbx_remove_log_handler(handler);
+
+	unsigned long long dropped = 0;
+	int written = count_file_records_and_dropped(path + "/" + name, dropped);
+	for (int n = 1; n <= callback.count; n++) {
+		int count = count_file_records_and_dropped(rotatedName(n), dropped);
+		BC_ASSERT_TRUE(count >= 0);
+		written += count;
+	}
+	BC_ASSERT_TRUE(dropped > 0);
+	BC_ASSERT_EQUAL(written + (int)dropped, logCount + 1, int, "%d");
+
+	remove((path + "/" + name).c_str());
+	for (int n = 1; n <= maxRotatedFiles; n++) remove(rotatedName(n).c_str());
+}
+
+/* Log a message in the test domain and keep its text formatting */
+static void log_expected(std::vector<std::string> &expected, const char *fmt, ...) {
+	char text[256];
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(text, sizeof(text), fmt, args);
+	va_end(args);
+	expected.push_back(text);
+	va_start(args, fmt);
+	bctbx_logv(testDomain, BCTBX_LOG_MESSAGE, fmt, args);
+	va_end(args);
+}
+
+static void binary_file_log_handler(void) {
+	char *dir = bc_tester_file(".");
+	const std::string path(dir);
+	bctbx_free(dir);
+	const std::string name("binary_log_test.blog");
+	remove((path + "/" + name).c_str());
+	const char notTerminated[4] = {'a', 'b', 'c', 'd'};
+	std::vector<std::string> expected;
+
+	bctbx_set_log_level(testDomain, BCTBX_LOG_MESSAGE);
+	for (int opening = 0; opening < 2; opening++) { // the second opening appends a new header to the file
+		bctbx_log_handler_t *handler = bctbx_create_binary_file_log_handler(path.c_str(), name.c_str());
+		if (!BC_ASSERT_PTR_NOT_NULL(handler)) return;
+		bctbx_log_handler_set_domain(handler, testDomain);
+		bctbx_add_log_handler(handler);
+		for (int i = 0; i < 2; i++) { // same formats again, written once per file
+			log_expected(expected, "%d %i %u %ld", -42 * i, 7, 4000000000u, -100000L);
+			log_expected(expected, "%hhd %hu %lld %llx %#o %zu", 300 + i, 70000, -1234567890123LL, 0xdeadbeefcafeULL, 8u, (size_t)i);
+			log_expected(expected, "[%.*s] [%-8s] [%5s] [%.2s] [%c]", 3, notTerminated, "left", "r", "truncated", 'x');
+			log_expected(expected, "%5.2f %e %g %Lf", 3.14159, -1e-10 * i, 0.5, (long double)1.25);
+			log_expected(expected, "%p 100%% %*d|%-*d|%.*d", (void *)(uintptr_t)0x1234, 6, i, -4, 42, 3, 5);
+		}
+		bctbx_log(testDomain, BCTBX_LOG_MESSAGE, "null string %s", (const char *)NULL);
+		expected.push_back("null string (null)");
+		bctbx_remove_log_handler(handler);
+	}
+
+	FILE *input = fopen((path + "/" + name).c_str(), "rb");
+	if (!BC_ASSERT_PTR_NOT_NULL(input)) return;
+	FILE *output = tmpfile();
+	if (!BC_ASSERT_PTR_NOT_NULL(output)) {
+		fclose(input);
+		return;
+	}
+	int ret = bctbx_binary_log_decode(input, output);
+	BC_ASSERT_EQUAL(ret, 0, int, "%d");
+	fclose(input);
+
+	rewind(output);
+	const std::string tag = std::string(testDomain) + "-message-";
+	std::vector<std::string> decoded;
+	char line[512];
+	while (fgets(line, sizeof(line), output) != NULL) {
+		const char *msg = strstr(line, tag.c_str());
+		if (msg == NULL) continue;
+		std::string text(msg + tag.size());
+		if (!text.empty() && text.back() == '\n') text.pop_back();
+		decoded.push_back(text);
+	}
+	fclose(output);
+	BC_ASSERT_EQUAL(decoded.size(), expected.size(), size_t, "%zu");
+	size_t mismatches = 0;
+	for (size_t i = 0; i < decoded.size() && i < expected.size(); i++) {
+		if (decoded[i] != expected[i]) {
+			bctbx_error("binary log record %zu decoded as [%s] instead of [%s]", i, decoded[i].c_str(), expected[i].c_str());
+			mismatches++;
+		}
+	}
+	BC_ASSERT_EQUAL(mismatches, 0, size_t, "%zu");
+
+	/* not a binary log */
+	input = tmpfile();
+	if (BC_ASSERT_PTR_NOT_NULL(input)) {
+		fputs("2020-01-01 00:00:00:000 bctoolbox-message-text\n", input);
+		rewind(input);
+		ret = bctbx_binary_log_decode(input, stdout);
+		BC_ASSERT_EQUAL(ret, -1, int, "%d");
+		fclose(input);
+	}
+	remove((path + "/" + name).c_str());
+}
+
+/* Collect the text of the messages logged in the test domain */
+struct MessageCollector {
+	std::vector<std::string> messages;
+
+	static void handler(void *info, const char *domain, BctbxLogLevel level, const char *fmt, va_list args) {
+		char *msg = bctbx_strdup_vprintf(fmt, args);
+		static_cast<MessageCollector *>(info)->messages.push_back(msg);
+		bctbx_free(msg);
+	}
+};
+
+/* A value whose formatting logs itself */
+struct NestedLog {};
+static std::ostream &operator<<(std::ostream &os, const NestedLog &) {
+	BCTBX_SLOG(testDomain, BCTBX_LOG_MESSAGE) << "nested " << 1;
+	return os << "outer";
+}
+
+static void stream_logging(void) {
+	MessageCollector collector;
+	bctbx_set_log_level(testDomain, BCTBX_LOG_MESSAGE);
+	bctbx_log_handler_t *handler = bctbx_create_log_handler(MessageCollector::handler, LogCollector::destroy, &collector);
+	bctbx_log_handler_set_domain(handler, testDomain);
+	bctbx_add_log_handler(handler);
+
+	int evaluated = 0;
+	auto evaluate = [&evaluated]() {return ++evaluated;};
+	BCTBX_SLOG(testDomain, BCTBX_LOG_DEBUG) << "disabled " << evaluate();
+	BC_ASSERT_EQUAL(evaluated, 0, int, "%d");
+
+	BCTBX_SLOG(testDomain, BCTBX_LOG_MESSAGE) << "value " << 42 << ' ' << 1.5 << " " << std::string("end");
+	BCTBX_SLOG(testDomain, BCTBX_LOG_MESSAGE) << "before " << NestedLog() << " after";
+	const std::string longText(10000, 'x'); // beyond the initial storage of the stream buffer
+	BCTBX_SLOG(testDomain, BCTBX_LOG_MESSAGE) << longText << std::endl;
+	BCTBX_SLOG(testDomain, BCTBX_LOG_MESSAGE) << "reused";
+	BCTBX_SLOG(testDomain, BCTBX_LOG_MESSAGE) << "from " << evaluate();
+	BC_ASSERT_EQUAL(evaluated, 1, int, "%d");
+
+	/* streams used directly: str() as with std::ostringstream, and destruction in any order */
+	{
+		std::unique_ptr<pumpstream> first(new pumpstream(testDomain, BCTBX_LOG_MESSAGE));
+		std::unique_ptr<pumpstream> second(new pumpstream(testDomain, BCTBX_LOG_MESSAGE));
+		*first << "first " << 1;
+		const std::string firstText = first->str();
+		BC_ASSERT_STRING_EQUAL(firstText.c_str(), "first 1");
+		*second << "replaced";
+		second->str("second");
+		first.reset();
+		BCTBX_SLOG(testDomain, BCTBX_LOG_MESSAGE) << "third";
+		*second << " " << 2;
+	}
+	bctbx_remove_log_handler(handler);
+
+	const std::vector<std::string> expected = {"value 42 1.5 end", "nested 1", "before outer after", longText + "\n", "reused", "from 1",
+		"first 1", "third", "second 2"};
+	BC_ASSERT_EQUAL(collector.messages.size(), expected.size(), size_t, "%zu");
+	bool match = (collector.messages == expected);
+	BC_ASSERT_TRUE(match);
+}
+
+static test_t logging_tests[] = {
+	TEST_NO_TAG("Async logging order", async_logging_order),
+	TEST_NO_TAG("Async logging drop", async_logging_drop),
+	TEST_NO_TAG("Async logging handler removal", async_logging_handler_removal),
+	TEST_NO_TAG("Log domain handles", log_domain_handles),
+	TEST_NO_TAG("Buffered file log handler", buffered_file_log_handler),
+	TEST_NO_TAG("Buffered file rotation callback flush", buffered_file_log_handler_rotated_flush),
+	TEST_NO_TAG("Buffered file log handler overflow", buffered_file_log_handler_overflow),
+	TEST_NO_TAG("Binary file log handler", binary_file_log_handler),
+	TEST_NO_TAG("Stream logging", stream_logging)
+};
+
+test_suite_t logging_test_suite = {"Logging", NULL, NULL, NULL, NULL,
+							   sizeof(logging_tests) / sizeof(logging_tests[0]), logging_tests};
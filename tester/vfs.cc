@@ -0,0 +1,504 @@
+/*
+ * Copyright (c) 2020 Belledonne Communications SARL.
+ *
+ * This file is part of bctoolbox.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bctoolbox_tester.h"
+#include "vfs_tester.hh"
+#include "bctoolbox/vfs_standard.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+bctbx_vfs_file_t *vfs_test_file_create(bctbx_vfs_t *vfs, const char *name, std::string &filePath, const void *content, size_t size) {
+	char *path = bc_tester_file(name);
+	filePath = path;
+	bctbx_free(path);
+	remove(filePath.data());
+
+	const bool readOnly = (vfs == &bcMmapVfs);
+	bctbx_vfs_file_t *fp = bctbx_file_open2(readOnly ? bctbx_vfs_get_standard() : vfs, filePath.data(), O_RDWR|O_CREAT);
+	BC_ASSERT_PTR_NOT_NULL(fp);
+	if (fp == NULL) return NULL;
+	if (size > 0) {
+		BC_ASSERT_EQUAL(bctbx_file_write(fp, content, size, 0), size, ssize_t, "%ld");
+	}
+	if (readOnly) {
+		bctbx_file_close(fp);
+		fp = bctbx_file_open2(vfs, filePath.data(), O_RDONLY);
+		BC_ASSERT_PTR_NOT_NULL(fp);
+	}
+	return fp;
+}
+
+void vfs_vectored_io_check(bctbx_vfs_t *vfs, const char *name) {
+	std::vector<uint8_t> content(3*4096+1000);
+	for (size_t i=0; i<content.size(); i++) {
+		content[i] = static_cast<uint8_t>(i*7+1);
+	}
+	std::string filePath{};
+	bctbx_vfs_file_t *fp = vfs_test_file_create(vfs, name, filePath);
+	if (fp == NULL) return;
+
+	// write in three buffers, the middle one is empty, at an offset so the file starts with zeros
+	bctbx_iovec_t writeIov[3] = {{content.data(), 5000}, {content.data()+5000, 0}, {content.data()+5000, content.size()-5000}};
+	BC_ASSERT_EQUAL(bctbx_file_writev(fp, writeIov, 3, 100), content.size(), ssize_t, "%ld");
+	BC_ASSERT_EQUAL(bctbx_file_size(fp), content.size()+100, int64_t, "%ld");
+
+	// read back in buffers of various sizes, the last one goes beyond the end of file
+	std::vector<uint8_t> head(150);
+	std::vector<uint8_t> middle(4000);
+	std::vector<uint8_t> tail(content.size());
+	bctbx_iovec_t readIov[3] = {{head.data(), head.size()}, {middle.data(), middle.size()}, {tail.data(), tail.size()}};
+	BC_ASSERT_EQUAL(bctbx_file_readv(fp, readIov, 3, 0), content.size()+100, ssize_t, "%ld");
+	std::vector<uint8_t> readData(head);
+	readData.insert(readData.end(), middle.cbegin(), middle.cend());
+	readData.insert(readData.end(), tail.cbegin(), tail.cbegin()+(content.size()+100-head.size()-middle.size()));
+	BC_ASSERT_TRUE(std::all_of(readData.cbegin(), readData.cbegin()+100, [](uint8_t b){return b==0;}));
+	BC_ASSERT_TRUE(std::equal(content.cbegin(), content.cend(), readData.cbegin()+100));
+
+	// overwrite two aligned 4096 bytes blocks, the first one spread over two buffers
+	std::vector<uint8_t> overwrite(2*4096);
+	for (size_t i=0; i<overwrite.size(); i++) {
+		overwrite[i] = static_cast<uint8_t>(i*3+5);
+	}
+	bctbx_iovec_t overwriteIov[3] = {{overwrite.data(), 1000}, {overwrite.data()+1000, 3096}, {overwrite.data()+4096, 4096}};
+	BC_ASSERT_EQUAL(bctbx_file_writev(fp, overwriteIov, 3, 4096), overwrite.size(), ssize_t, "%ld");
+	std::vector<uint8_t> fileData(content.size()+100);
+	BC_ASSERT_EQUAL(bctbx_file_read(fp, fileData.data(), fileData.size(), 0), fileData.size(), ssize_t, "%ld");
+	BC_ASSERT_TRUE(std::equal(content.cbegin(), content.cbegin()+(4096-100), fileData.cbegin()+100));
+	BC_ASSERT_TRUE(std::equal(overwrite.cbegin(), overwrite.cend(), fileData.cbegin()+4096));
+	BC_ASSERT_TRUE(std::equal(content.cbegin()+(3*4096-100), content.cend(), fileData.cbegin()+3*4096));
+
+	bctbx_file_close(fp);
+	remove(filePath.data());
+}
+
+void vfs_line_reader_check(bctbx_vfs_t *vfs, const char *name) {
+	// lines of various lengths, some longer than the line buffer, with all kind of end of line
+	std::string content{};
+	std::vector<std::string> expectedLines{};
+	std::vector<int> expectedSizes{};
+	const int maxLen = 200;
+	const char *endOfLines[] = {"\n", "\r\n", "\r"};
+	for (size_t i=0; i<3000; i++) {
+		// no empty line: it would make a \r end of line followed by a \n one a \r\n
+		std::string line(1 + (i%7 == 0 ? (i*37)%450 : (i*13)%120), static_cast<char>('a'+i%26));
+		const std::string endOfLine{endOfLines[i%3]};
+		content += line + endOfLine;
+		// long lines are returned in pieces of maxLen-1 characters
+		while (line.size() >= static_cast<size_t>(maxLen-1)) {
+			expectedLines.push_back(line.substr(0, maxLen-1));
+			expectedSizes.push_back(maxLen-1);
+			line.erase(0, maxLen-1);
+		}
+		expectedLines.push_back(line);
+		expectedSizes.push_back(static_cast<int>(line.size()+endOfLine.size()));
+	}
+	content += "no end of line";
+	expectedLines.push_back("no end of line");
+	expectedSizes.push_back(14);
+
+	std::string filePath{};
+	bctbx_vfs_file_t *fp = vfs_test_file_create(vfs, name, filePath, content.data(), content.size());
+	if (fp == NULL) return;
+
+	char line[maxLen];
+	size_t mismatches = 0;
+	for (size_t i=0; i<expectedLines.size(); i++) {
+		int size = bctbx_file_get_nxtline(fp, line, maxLen);
+		if (size != expectedSizes[i] || expectedLines[i] != line) {
+			if (mismatches++ == 0) {
+				bctbx_error("line %zu: got [%s] size %d expected [%s] size %d", i, line, size, expectedLines[i].data(), expectedSizes[i]);
+			}
+		}
+	}
+	BC_ASSERT_EQUAL(mismatches, 0, size_t, "%zu");
+	BC_ASSERT_EQUAL(bctbx_file_get_nxtline(fp, line, maxLen), 0, int, "%d");
+
+	// a write through the handle is seen by the next line read
+	if (vfs != &bcMmapVfs) {
+		BC_ASSERT_EQUAL(bctbx_file_seek(fp, 0, SEEK_SET), 0, off_t, "%ld");
+		BC_ASSERT_EQUAL(bctbx_file_get_nxtline(fp, line, maxLen), 2, int, "%d");
+		BC_ASSERT_EQUAL(bctbx_file_write(fp, "modified", 8, 2), 8, ssize_t, "%ld");
+		BC_ASSERT_EQUAL(bctbx_file_get_nxtline(fp, line, maxLen), 16, int, "%d");
+		BC_ASSERT_STRING_EQUAL(line, "modifiedbbbbbb");
+	}
+	bctbx_file_close(fp);
+	remove(filePath.data());
+}
+
+void vfs_buffered_fprintf_check(bctbx_vfs_t *vfs, const char *name) {
+	std::string filePath{};
+	bctbx_vfs_file_t *fp = vfs_test_file_create(vfs, name, filePath);
+	if (fp == NULL) return;
+	BC_ASSERT_EQUAL(bctbx_file_set_write_buffer(fp, 10000), BCTBX_VFS_OK, int, "%d");
+	// the physical file, seen through another handle, is not modified until the buffer is flushed
+	bctbx_vfs_file_t *rawFp = bctbx_file_open2(bctbx_vfs_get_standard(), filePath.data(), O_RDONLY);
+	BC_ASSERT_PTR_NOT_NULL(rawFp);
+	const int64_t rawSize = bctbx_file_size(rawFp);
+
+	std::string expected{};
+	ssize_t ret;
+	ret = bctbx_file_fprintf(fp, 0, "%s;%s;%s\n", "index", "value", "label");
+	BC_ASSERT_EQUAL(ret, 18, ssize_t, "%ld");
+	expected += "index;value;label\n";
+	for (int i=0; i<20; i++) {
+		std::string label(i*17, static_cast<char>('a'+i));
+		ret = bctbx_file_fprintf(fp, 0, "%d;%08x;%s\n", i, i*0x1234567, label.data());
+		char line[600];
+		snprintf(line, sizeof(line), "%d;%08x;%s\n", i, i*0x1234567, label.data());
+		BC_ASSERT_EQUAL(ret, static_cast<ssize_t>(strlen(line)), ssize_t, "%ld");
+		expected += line;
+	}
+	BC_ASSERT_EQUAL(bctbx_file_size(rawFp), rawSize, int64_t, "%ld");
+	BC_ASSERT_EQUAL(bctbx_file_flush(fp), BCTBX_VFS_OK, int, "%d");
+	BC_ASSERT_TRUE(bctbx_file_size(rawFp) > rawSize);
+
+	// formatted strings larger than the write buffer
+	std::string large(30000, 'x');
+	for (int i=0; i<5; i++) {
+		ret = bctbx_file_fprintf(fp, 0, "%s%d\n", large.data(), i);
+		BC_ASSERT_EQUAL(ret, 30002, ssize_t, "%ld");
+		expected += large + std::to_string(i) + "\n";
+	}
+	// reads through the handle see the pending content
+	std::vector<char> readBack(expected.size());
+	BC_ASSERT_EQUAL(bctbx_file_read(fp, readBack.data(), readBack.size(), 0), static_cast<ssize_t>(expected.size()), ssize_t, "%ld");
+	BC_ASSERT_TRUE(std::equal(expected.cbegin(), expected.cend(), readBack.cbegin()));
+
+	// an append at an explicit offset, the pending content is flushed on close
+	ret = bctbx_file_fprintf(fp, 5, "%s", "XY");
+	BC_ASSERT_EQUAL(ret, 2, ssize_t, "%ld");
+	expected.replace(5, 2, "XY");
+	ret = bctbx_file_fprintf(fp, 0, "%s", "end");
+	BC_ASSERT_EQUAL(ret, 3, ssize_t, "%ld");
+	expected.replace(7, 3, "end");
+	bctbx_file_close(rawFp);
+	bctbx_file_close(fp);
+
+	fp = bctbx_file_open2(vfs, filePath.data(), O_RDONLY);
+	BC_ASSERT_PTR_NOT_NULL(fp);
+	if (fp != NULL) {
+		BC_ASSERT_EQUAL(bctbx_file_size(fp), static_cast<int64_t>(expected.size()), int64_t, "%ld");
+		readBack.assign(expected.size(), 0);
+		BC_ASSERT_EQUAL(bctbx_file_read(fp, readBack.data(), readBack.size(), 0), static_cast<ssize_t>(expected.size()), ssize_t, "%ld");
+		BC_ASSERT_TRUE(std::equal(expected.cbegin(), expected.cend(), readBack.cbegin()));
+		bctbx_file_close(fp);
+	}
+	remove(filePath.data());
+}
+
+/**
+ * Read a standard vfs file from several threads sharing the same handle: positional reads do not share a file offset
+ */
+static void concurrent_standard_reads_test(void) {
+	std::vector<uint8_t> content(256*1024);
+	for (size_t i=0; i<content.size(); i++) {
+		content[i] = static_cast<uint8_t>(i*3 + i/256);
+	}
+	std::string filePath{};
+	bctbx_vfs_file_t *fp = vfs_test_file_create(bctbx_vfs_get_standard(), "concurrent_reads.bin", filePath, content.data(), content.size());
+	if (fp == NULL) return;
+	// writing nothing is not an error
+	BC_ASSERT_EQUAL(bctbx_file_write(fp, content.data(), 0, 10), 0, ssize_t, "%ld");
+
+	std::atomic<int> mismatches{0};
+	std::vector<std::thread> readers{};
+	for (size_t t=0; t<4; t++) {
+		readers.emplace_back([&, t]() {
+			std::vector<uint8_t> buffer(1000);
+			for (size_t i=0; i<500; i++) {
+				size_t offset = ((t*7919 + i*104729)%(content.size()-buffer.size()));
+				if (bctbx_file_read(fp, buffer.data(), buffer.size(), offset) != static_cast<ssize_t>(buffer.size())
+					|| !std::equal(buffer.cbegin(), buffer.cend(), content.cbegin()+offset)) {
+					mismatches++;
+				}
+			}
+		});
+	}
+	for (auto &reader:readers) {
+		reader.join();
+	}
+	BC_ASSERT_EQUAL(mismatches.load(), 0, int, "%d");
+
+	bctbx_file_close(fp);
+	remove(filePath.data());
+}
+
+void async_io_done(void *userData, ssize_t result) {
+	auto ioResult = static_cast<AsyncIoResult *>(userData);
+	std::lock_guard<std::mutex> lock(ioResult->mutex);
+	ioResult->results.push_back(result);
+	ioResult->condition.notify_all();
+}
+
+/**
+ * Asynchronous writes and reads through the standard vfs
+ */
+static void async_io_test(void) {
+	std::string filePath{};
+	bctbx_vfs_file_t *fp = vfs_test_file_create(bctbx_vfs_get_standard(), "async_io.bin", filePath);
+	if (fp == NULL) return;
+
+	std::vector<uint8_t> content(64*1024);
+	for (size_t i=0; i<content.size(); i++) {
+		content[i] = static_cast<uint8_t>(i*5);
+	}
+	AsyncIoResult ioResult{};
+	auto waitResults = [&ioResult](size_t count) {
+		std::unique_lock<std::mutex> lock(ioResult.mutex);
+		return ioResult.condition.wait_for(lock, std::chrono::seconds(10), [&]{return ioResult.results.size() >= count;});
+	};
+
+	// write the two halves concurrently
+	const size_t half = content.size()/2;
+	BC_ASSERT_EQUAL(bctbx_file_write_async(fp, content.data(), half, 0, async_io_done, &ioResult), BCTBX_VFS_OK, int, "%d");
+	BC_ASSERT_EQUAL(bctbx_file_write_async(fp, content.data()+half, half, half, async_io_done, &ioResult), BCTBX_VFS_OK, int, "%d");
+	BC_ASSERT_TRUE(waitResults(2));
+	for (auto result:ioResult.results) {
+		BC_ASSERT_EQUAL(result, half, ssize_t, "%ld");
+	}
+
+	// and read them back
+	std::vector<uint8_t> readBuffer(content.size());
+	BC_ASSERT_EQUAL(bctbx_file_read_async(fp, readBuffer.data(), half, 0, async_io_done, &ioResult), BCTBX_VFS_OK, int, "%d");
+	BC_ASSERT_EQUAL(bctbx_file_read_async(fp, readBuffer.data()+half, half, half, async_io_done, &ioResult), BCTBX_VFS_OK, int, "%d");
+	BC_ASSERT_TRUE(waitResults(4));
+	BC_ASSERT_TRUE(readBuffer == content);
+	BC_ASSERT_EQUAL(bctbx_file_read_async(NULL, readBuffer.data(), half, 0, async_io_done, &ioResult), BCTBX_VFS_ERROR, int, "%d");
+
+	bctbx_file_close(fp);
+	remove(filePath.data());
+}
+
+/**
+ * Read a file through the mmap vfs, including lines and data appended after opening
+ */
+static void mmap_vfs_test(void) {
+	const std::string content{"first line\nsecond line\r\nthird\rlast without end of line"};
+	std::string filePath{};
+	bctbx_vfs_file_t *stdFp = vfs_test_file_create(bctbx_vfs_get_standard(), "mmap_vfs.txt", filePath, content.data(), content.size());
+	if (stdFp == NULL) return;
+
+	// read only vfs
+	bctbx_vfs_file_t *fp = bctbx_file_open2(&bcMmapVfs, filePath.data(), O_RDWR);
+	BC_ASSERT_PTR_NULL(fp);
+	if (fp != NULL) bctbx_file_close(fp);
+
+	fp = bctbx_file_open2(&bcMmapVfs, filePath.data(), O_RDONLY);
+	BC_ASSERT_PTR_NOT_NULL(fp);
+	if (fp != NULL) {
+		BC_ASSERT_EQUAL(bctbx_vfs_mmap_advise(fp, BCTBX_VFS_MMAP_ADVICE_SEQUENTIAL), BCTBX_VFS_OK, int, "%d");
+		BC_ASSERT_EQUAL(bctbx_file_size(fp), content.size(), int64_t, "%ld");
+		std::vector<char> buffer(content.size()+10);
+		BC_ASSERT_EQUAL(bctbx_file_read(fp, buffer.data(), buffer.size(), 0), content.size(), ssize_t, "%ld");
+		BC_ASSERT_TRUE(std::string(buffer.data(), content.size()) == content);
+		BC_ASSERT_EQUAL(bctbx_file_read(fp, buffer.data(), 6, 11), 6, ssize_t, "%ld");
+		BC_ASSERT_TRUE(std::string(buffer.data(), 6) == "second");
+		BC_ASSERT_EQUAL(bctbx_file_read(fp, buffer.data(), 6, content.size()), 0, ssize_t, "%ld");
+		BC_ASSERT_TRUE(bctbx_file_write(fp, content.data(), 1, 0) < 0);
+
+		// lines
+		char line[64];
+		BC_ASSERT_EQUAL(bctbx_file_get_nxtline(fp, line, sizeof(line)), 11, int, "%d");
+		BC_ASSERT_STRING_EQUAL(line, "first line");
+		BC_ASSERT_EQUAL(bctbx_file_get_nxtline(fp, line, sizeof(line)), 13, int, "%d");
+		BC_ASSERT_STRING_EQUAL(line, "second line");
+		BC_ASSERT_EQUAL(bctbx_file_get_nxtline(fp, line, sizeof(line)), 6, int, "%d");
+		BC_ASSERT_STRING_EQUAL(line, "third");
+		BC_ASSERT_EQUAL(bctbx_file_get_nxtline(fp, line, sizeof(line)), 24, int, "%d");
+		BC_ASSERT_STRING_EQUAL(line, "last without end of line");
+		BC_ASSERT_EQUAL(bctbx_file_get_nxtline(fp, line, sizeof(line)), 0, int, "%d");
+
+		// the file grows after the mapping
+		const std::string appended{"\nappended"};
+		BC_ASSERT_EQUAL(bctbx_file_write(stdFp, appended.data(), appended.size(), content.size()), appended.size(), ssize_t, "%ld");
+		BC_ASSERT_EQUAL(bctbx_file_read(fp, buffer.data(), appended.size(), content.size()), appended.size(), ssize_t, "%ld");
+		BC_ASSERT_TRUE(std::string(buffer.data(), appended.size()) == appended);
+		BC_ASSERT_EQUAL(bctbx_file_get_nxtline(fp, line, sizeof(line)), 1, int, "%d");
+		BC_ASSERT_EQUAL(bctbx_file_get_nxtline(fp, line, sizeof(line)), 8, int, "%d");
+		BC_ASSERT_STRING_EQUAL(line, "appended");
+
+		// readers share the mapping while it is replaced each time the file grows
+		const std::string expected{content + appended};
+		std::atomic<int> mismatches{0};
+		std::vector<std::thread> readers{};
+		for (size_t t=0; t<4; t++) {
+			readers.emplace_back([&, t]() {
+				std::vector<char> readBuffer(16);
+				for (size_t i=0; i<2000; i++) {
+					size_t offset = (t*13 + i*7)%(expected.size()-readBuffer.size());
+					if (bctbx_file_read(fp, readBuffer.data(), readBuffer.size(), offset) != static_cast<ssize_t>(readBuffer.size())
+						|| !std::equal(readBuffer.cbegin(), readBuffer.cend(), expected.cbegin()+offset)) {
+						mismatches++;
+					}
+				}
+			});
+		}
+		for (size_t i=0; i<50; i++) {
+			bctbx_file_write(stdFp, "x", 1, expected.size()+i);
+			bctbx_file_read(fp, buffer.data(), 1, expected.size()+i);
+		}
+		for (auto &reader:readers) {
+			reader.join();
+		}
+		BC_ASSERT_EQUAL(mismatches.load(), 0, int, "%d");
+		BC_ASSERT_EQUAL(bctbx_file_read(fp, buffer.data(), 10, expected.size()+45), 5, ssize_t, "%ld");
+		bctbx_file_close(fp);
+	}
+
+	bctbx_file_close(stdFp);
+	remove(filePath.data());
+}
+
+/**
+ * Iterate over the lines of a file while asynchronous writes modify another part of it through the same handle
+ */
+static void line_reader_async_writes_test(void) {
+	std::string content{};
+	for (size_t i=0; i<2000; i++) {
+		content += std::to_string(i) + "\n";
+	}
+	std::string filePath{};
+	bctbx_vfs_file_t *fp = vfs_test_file_create(bctbx_vfs_get_standard(), "line_reader_async_writes.txt", filePath, content.data(), content.size());
+	if (fp == NULL) return;
+
+	const size_t writeCount = 200;
+	const std::string written(100, 'w');
+	AsyncIoResult ioResult{};
+	for (size_t i=0; i<writeCount; i++) {
+		BC_ASSERT_EQUAL(bctbx_file_write_async(fp, written.data(), written.size(), static_cast<off_t>(content.size()+i*written.size()), async_io_done, &ioResult), BCTBX_VFS_OK, int, "%d");
+	}
+	char line[32];
+	int mismatches = 0;
+	for (size_t i=0; i<2000; i++) {
+		bctbx_file_get_nxtline(fp, line, sizeof(line));
+		if (std::to_string(i) != line) mismatches++;
+	}
+	BC_ASSERT_EQUAL(mismatches, 0, int, "%d");
+	{
+		std::unique_lock<std::mutex> lock(ioResult.mutex);
+		BC_ASSERT_TRUE(ioResult.condition.wait_for(lock, std::chrono::seconds(10), [&]{return ioResult.results.size() == writeCount;}));
+	}
+	BC_ASSERT_EQUAL(bctbx_file_size(fp), content.size()+writeCount*written.size(), int64_t, "%ld");
+
+	bctbx_file_close(fp);
+	remove(filePath.data());
+}
+
+/**
+ * Write lines with bctbx_file_fprintf in buffered mode while asynchronous reads flush the write buffer
+ */
+static void buffered_fprintf_async_reads_test(void) {
+	std::string filePath{};
+	bctbx_vfs_file_t *fp = vfs_test_file_create(bctbx_vfs_get_standard(), "buffered_fprintf_async_reads.txt", filePath);
+	if (fp == NULL) return;
+	BC_ASSERT_EQUAL(bctbx_file_set_write_buffer(fp, 4096), BCTBX_VFS_OK, int, "%d");
+
+	const size_t readCount = 100;
+	std::vector<char> readBuffer(readCount*16);
+	AsyncIoResult ioResult{};
+	std::string expected{};
+	for (size_t i=0; i<2000; i++) {
+		if (i%20 == 0) {
+			BC_ASSERT_EQUAL(bctbx_file_read_async(fp, readBuffer.data()+(i/20)*16, 16, 0, async_io_done, &ioResult), BCTBX_VFS_OK, int, "%d");
+		}
+		bctbx_file_fprintf(fp, 0, "%zu\n", i);
+		expected += std::to_string(i) + "\n";
+	}
+	{
+		std::unique_lock<std::mutex> lock(ioResult.mutex);
+		BC_ASSERT_TRUE(ioResult.condition.wait_for(lock, std::chrono::seconds(10), [&]{return ioResult.results.size() == readCount;}));
+	}
+	bctbx_file_close(fp);
+
+	fp = bctbx_file_open2(bctbx_vfs_get_standard(), filePath.data(), O_RDONLY);
+	BC_ASSERT_PTR_NOT_NULL(fp);
+	if (fp != NULL) {
+		std::vector<char> content(expected.size());
+		BC_ASSERT_EQUAL(bctbx_file_read(fp, content.data(), content.size(), 0), static_cast<ssize_t>(expected.size()), ssize_t, "%ld");
+		BC_ASSERT_TRUE(std::equal(expected.cbegin(), expected.cend(), content.cbegin()));
+		bctbx_file_close(fp);
+	}
+	remove(filePath.data());
+}
+
+static void vectored_io_test(void) {
+	vfs_vectored_io_check(bctbx_vfs_get_standard(), "vectored_io.bin");
+}
+
+static void line_reader_test(void) {
+	vfs_line_reader_check(bctbx_vfs_get_standard(), "line_reader.txt");
+	vfs_line_reader_check(&bcMmapVfs, "line_reader.txt");
+}
+
+/**
+ * Lines completed through another handle after the line reader reached the end of file
+ */
+static void line_reader_appended_test(void) {
+	const std::string content("first\npar");
+	std::string filePath{};
+	bctbx_vfs_file_t *fp = vfs_test_file_create(bctbx_vfs_get_standard(), "line_reader_appended.txt", filePath, content.data(), content.size());
+	if (fp == NULL) return;
+	bctbx_vfs_file_t *writer = bctbx_file_open2(bctbx_vfs_get_standard(), filePath.data(), O_WRONLY);
+	BC_ASSERT_PTR_NOT_NULL(writer);
+	if (writer == NULL) {
+		bctbx_file_close(fp);
+		return;
+	}
+
+	char line[64];
+	BC_ASSERT_EQUAL(bctbx_file_get_nxtline(fp, line, sizeof(line)), 6, int, "%d");
+	BC_ASSERT_STRING_EQUAL(line, "first");
+	// the rest of the partial line and a \r which may start a \r\n
+	BC_ASSERT_EQUAL(bctbx_file_write(writer, "tial\r", 5, content.size()), 5, ssize_t, "%ld");
+	BC_ASSERT_EQUAL(bctbx_file_write(writer, "\n", 1, content.size()+5), 1, ssize_t, "%ld");
+	BC_ASSERT_EQUAL(bctbx_file_get_nxtline(fp, line, sizeof(line)), 9, int, "%d");
+	BC_ASSERT_STRING_EQUAL(line, "partial");
+	BC_ASSERT_EQUAL(bctbx_file_get_nxtline(fp, line, sizeof(line)), 0, int, "%d");
+	BC_ASSERT_EQUAL(bctbx_file_write(writer, "last\n", 5, content.size()+6), 5, ssize_t, "%ld");
+	BC_ASSERT_EQUAL(bctbx_file_get_nxtline(fp, line, sizeof(line)), 5, int, "%d");
+	BC_ASSERT_STRING_EQUAL(line, "last");
+
+	bctbx_file_close(writer);
+	bctbx_file_close(fp);
+	remove(filePath.data());
+}
+
+static void buffered_fprintf_test(void) {
+	vfs_buffered_fprintf_check(bctbx_vfs_get_standard(), "buffered_fprintf.txt");
+}
+
+static test_t vfs_tests[] = {
+	TEST_NO_TAG("concurrent standard reads", concurrent_standard_reads_test),
+	TEST_NO_TAG("mmap vfs", mmap_vfs_test),
+	TEST_NO_TAG("async io", async_io_test),
+	TEST_NO_TAG("vectored io", vectored_io_test),
+	TEST_NO_TAG("line reader", line_reader_test),
+	TEST_NO_TAG("line reader appended lines", line_reader_appended_test),
+	TEST_NO_TAG("line reader with async writes", line_reader_async_writes_test),
+	TEST_NO_TAG("buffered fprintf", buffered_fprintf_test),
+	TEST_NO_TAG("buffered fprintf with async reads", buffered_fprintf_async_reads_test)
+};
+
+test_suite_t vfs_test_suite = {"Vfs", NULL, NULL, NULL, NULL,
+							   sizeof(vfs_tests) / sizeof(vfs_tests[0]), vfs_tests};
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2020 Belledonne Communications SARL.
+ *
+ * This file is part of bctoolbox.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BCTBX_VFS_TESTER_HH
+#define BCTBX_VFS_TESTER_HH
+
+#include "bctoolbox/vfs.h"
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Create a test file in the tester writable directory, replacing any previous one, and open it
+ * Implemented in vfs.cc, the checks below run on any vfs: the vfs test suite gives them the plain ones,
+ * the encrypted vfs test suite the encrypted one.
+ *
+ * @param[in]	vfs		the vfs to open the file with
+ * @param[in]	name		the file name
+ * @param[out]	filePath	the file path, to remove the file at the end of the test
+ * @param[in]	content		written at the beginning of the file
+ * @param[in]	size		size of content
+ * @return the file handle opened for reading and writing, NULL on error
+ * The mmap vfs being read only, the content is written with the standard vfs and the file opened read only.
+ */
+bctbx_vfs_file_t *vfs_test_file_create(bctbx_vfs_t *vfs, const char *name, std::string &filePath, const void *content = nullptr, size_t size = 0);
+
+/**
+ * Vectored reads and writes with empty buffers, an initial offset and a read beyond the end of file
+ */
+void vfs_vectored_io_check(bctbx_vfs_t *vfs, const char *name);
+
+/**
+ * Iterate over the lines of a file larger than the line reader buffer, then modify it and read a line again
+ */
+void vfs_line_reader_check(bctbx_vfs_t *vfs, const char *name);
+
+/**
+ * Write lines with bctbx_file_fprintf in buffered mode and read them back
+ */
+void vfs_buffered_fprintf_check(bctbx_vfs_t *vfs, const char *name);
+
+/**
+ * Results of the asynchronous I/O completed with async_io_done, in completion order
+ */
+struct AsyncIoResult {
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::vector<ssize_t> results;
+};
+
+/**
+ * bctbx_vfs_async_cb_t callback storing the result in the AsyncIoResult given as user data
+ */
+void async_io_done(void *userData, ssize_t result);
+
+#endif /* BCTBX_VFS_TESTER_HH */
@@ -0,0 +1,319 @@
+/*
+ * Copyright (c) 2020 Belledonne Communications SARL.
+ *
+ * This file is part of bctoolbox.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Measure the encrypted VFS throughput and latency against the standard VFS
+ * Each configuration (vfs, encryption suite, chunk size) runs the same workloads on a fresh file,
+ * results are written on stdout in CSV or JSON.
+ */
+
+#include "bctoolbox/vfs_encrypted.hh"
+#include "bctoolbox/vfs_standard.h"
+#include "bctoolbox/port.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace bctoolbox;
+
+namespace {
+
+struct BenchConfig {
+	std::string vfsName;
+	bctbx_vfs_t *vfs;
+	EncryptionSuite suite;
+	size_t chunkSize;
+};
+
+struct BenchResult {
+	std::string workload;
+	uint64_t operations;
+	uint64_t bytes;
+	double seconds;
+};
+
+// settings applied by the open callback to the file being benchmarked
+BenchConfig currentConfig{};
+
+class Stopwatch {
+	public:
+		Stopwatch() : mStart(std::chrono::steady_clock::now()) {}
+		double elapsed() const {
+			return std::chrono::duration<double>(std::chrono::steady_clock::now() - mStart).count();
+		}
+	private:
+		std::chrono::steady_clock::time_point mStart;
+};
+
+std::vector<size_t> parseSizeList(const std::string &list) {
+	std::vector<size_t> sizes{};
+	std::stringstream stream(list);
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		sizes.push_back(std::stoul(item));
+	}
+	return sizes;
+}
+
+bctbx_vfs_file_t *openFile(const std::string &path, int flags) {
+	bctbx_vfs_file_t *fp = bctbx_file_open2(currentConfig.vfs, path.data(), flags);
+	if (fp == nullptr) {
+		throw std::runtime_error("cannot open file "+path);
+	}
+	return fp;
+}
+
+void checkIo(ssize_t ret, size_t expected, const char *operation) {
+	if (ret < 0 || static_cast<size_t>(ret) != expected) {
+		throw std::runtime_error(std::string(operation)+" failed");
+	}
+}
+
+/**
+ * Run all the workloads on the current configuration
+ * @param[in]	path		the benchmark file, removed before and after
+ * @param[in]	fileSize	size in bytes of the plain file
+ * @param[in]	ioSize		size of the sequential read and write operations
+ * @param[in]	pageSize	size of the random and mixed workloads operations
+ * @param[in]	randomOps	number of operations of the random and mixed workloads
+ */
+std::vector<BenchResult> runWorkloads(const std::string &path, uint64_t fileSize, size_t ioSize, size_t pageSize, uint64_t randomOps) {
+	std::vector<BenchResult> results{};
+	std::vector<uint8_t> buffer(std::max(ioSize, pageSize));
+	std::mt19937_64 rng(42); // same sequence for all configurations
+	for (auto &byte:buffer) {
+		byte = static_cast<uint8_t>(rng());
+	}
+	const uint64_t pageCount = std::max(fileSize/pageSize, static_cast<uint64_t>(1));
+	std::remove(path.data());
+
+	// sequential write, file creation included
+	{
+		Stopwatch watch;
+		bctbx_vfs_file_t *fp = openFile(path, O_RDWR|O_CREAT);
+		uint64_t ops = 0;
+		for (uint64_t offset = 0; offset < fileSize; offset += ioSize, ops++) {
+			size_t size = static_cast<size_t>(std::min(static_cast<uint64_t>(ioSize), fileSize-offset));
+			checkIo(bctbx_file_write(fp, buffer.data(), size, static_cast<off_t>(offset)), size, "sequential write");
+		}
+		bctbx_file_sync(fp);
+		bctbx_file_close(fp);
+		results.push_back({"sequential_write", ops, fileSize, watch.elapsed()});
+	}
+
+	bctbx_vfs_file_t *fp = openFile(path, O_RDWR);
+	// sequential read
+	{
+		Stopwatch watch;
+		uint64_t ops = 0;
+		for (uint64_t offset = 0; offset < fileSize; offset += ioSize, ops++) {
+			size_t size = static_cast<size_t>(std::min(static_cast<uint64_t>(ioSize), fileSize-offset));
+			checkIo(bctbx_file_read(fp, buffer.data(), size, static_cast<off_t>(offset)), size, "sequential read");
+		}
+		results.push_back({"sequential_read", ops, fileSize, watch.elapsed()});
+	}
+
+	// random page aligned reads
+	{
+		Stopwatch watch;
+		for (uint64_t i = 0; i < randomOps; i++) {
+			uint64_t offset = (rng()%pageCount)*pageSize;
+			size_t size = static_cast<size_t>(std::min(static_cast<uint64_t>(pageSize), fileSize-offset));
+			checkIo(bctbx_file_read(fp, buffer.data(), size, static_cast<off_t>(offset)), size, "random read");
+		}
+		results.push_back({"random_read", randomOps, randomOps*pageSize, watch.elapsed()});
+	}
+
+	// random page aligned writes
+	{
+		Stopwatch watch;
+		for (uint64_t i = 0; i < randomOps; i++) {
+			uint64_t offset = (rng()%pageCount)*pageSize;
+			size_t size = static_cast<size_t>(std::min(static_cast<uint64_t>(pageSize), fileSize-offset));
+			checkIo(bctbx_file_write(fp, buffer.data(), size, static_cast<off_t>(offset)), size, "random write");
+		}
+		results.push_back({"random_write", randomOps, randomOps*pageSize, watch.elapsed()});
+	}
+
+	// SQLite like workload: mostly page reads, some page writes grouped in transactions ending with a sync
+	{
+		Stopwatch watch;
+		for (uint64_t i = 0; i < randomOps; i++) {
+			uint64_t offset = (rng()%pageCount)*pageSize;
+			size_t size = static_cast<size_t>(std::min(static_cast<uint64_t>(pageSize), fileSize-offset));
+			if (rng()%10 < 7) {
+				checkIo(bctbx_file_read(fp, buffer.data(), size, static_cast<off_t>(offset)), size, "mixed read");
+			} else {
+				checkIo(bctbx_file_write(fp, buffer.data(), size, static_cast<off_t>(offset)), size, "mixed write");
+			}
+			if (i%100 == 99) {
+				bctbx_file_sync(fp);
+			}
+		}
+		results.push_back({"sqlite_mixed", randomOps, randomOps*pageSize, watch.elapsed()});
+	}
+
+	// truncate to unaligned sizes: the last chunk is re-encrypted each time
+	{
+		const uint64_t truncateOps = 64;
+		Stopwatch watch;
+		uint64_t size = fileSize;
+		uint64_t ops = 0; // a small file stops the truncates early
+		for (; ops < truncateOps && size > pageSize; ops++) {
+			size -= pageSize/2 + 1;
+			if (bctbx_file_truncate(fp, static_cast<int64_t>(size)) < 0) {
+				throw std::runtime_error("truncate failed");
+			}
+		}
+		results.push_back({"truncate", ops, 0, watch.elapsed()});
+	}
+	bctbx_file_close(fp);
+
+	// open latency: header parsing and authentication
+	{
+		const uint64_t openOps = 200;
+		Stopwatch watch;
+		for (uint64_t i = 0; i < openOps; i++) {
+			bctbx_file_close(openFile(path, O_RDONLY));
+		}
+		results.push_back({"open", openOps, 0, watch.elapsed()});
+	}
+
+	std::remove(path.data());
+	return results;
+}
+
+void usage(const char *name) {
+	std::cerr<<"Usage: "<<name<<" [options] <benchmark file path>"<<std::endl;
+	std::cerr<<"  --format <csv|json>        output format, default to csv"<<std::endl;
+	std::cerr<<"  --size <MB>                plain file size, default to 64"<<std::endl;
+	std::cerr<<"  --io-size <bytes>          sequential operations size, default to 65536"<<std::endl;
+	std::cerr<<"  --page-size <bytes>        random operations size, default to 4096"<<std::endl;
+	std::cerr<<"  --random-ops <count>       number of random and mixed operations, default to 10000"<<std::endl;
+	std::cerr<<"  --chunk-sizes <list>       comma separated chunk sizes, default to 1024,4096,16384,65536"<<std::endl;
+	std::cerr<<"  --threads <count>          encrypted vfs worker pool size, default to 0 (disabled)"<<std::endl;
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[]) {
+	std::string format{"csv"};
+	std::string path{};
+	uint64_t fileSize = 64*1024*1024;
+	size_t ioSize = 65536;
+	size_t pageSize = 4096;
+	uint64_t randomOps = 10000;
+	size_t threads = 0;
+	std::vector<size_t> chunkSizes{1024, 4096, 16384, 65536};
+
+	try {
+		for (int i=1; i<argc; i++) {
+			bool hasValue = (i+1 < argc);
+			if (strcmp(argv[i], "--format") == 0 && hasValue) {
+				format = argv[++i];
+			} else if (strcmp(argv[i], "--size") == 0 && hasValue) {
+				fileSize = std::stoull(argv[++i])*1024*1024;
+			} else if (strcmp(argv[i], "--io-size") == 0 && hasValue) {
+				ioSize = std::stoul(argv[++i]);
+			} else if (strcmp(argv[i], "--page-size") == 0 && hasValue) {
+				pageSize = std::stoul(argv[++i]);
+			} else if (strcmp(argv[i], "--random-ops") == 0 && hasValue) {
+				randomOps = std::stoull(argv[++i]);
+			} else if (strcmp(argv[i], "--chunk-sizes") == 0 && hasValue) {
+				chunkSizes = parseSizeList(argv[++i]);
+			} else if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+				threads = std::stoul(argv[++i]);
+			} else if (argv[i][0] != '-' && path.empty()) {
+				path = argv[i];
+			} else {
+				usage(argv[0]);
+				return 2;
+			}
+		}
+	} catch (std::exception const &) {
+		usage(argv[0]);
+		return 2;
+	}
+	if (path.empty() || (format != "csv" && format != "json") || fileSize == 0 || ioSize == 0 || pageSize == 0) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	// the standard vfs is the reference, then each encryption suite with each chunk size
+	std::vector<BenchConfig> configs{{"standard", &bcStandardVfs, EncryptionSuite::plain, 0}};
+	for (auto suite:{EncryptionSuite::dummy, EncryptionSuite::aes256gcm128_sha256, EncryptionSuite::chacha20poly1305_sha256}) {
+		for (auto chunkSize:chunkSizes) {
+			configs.push_back({"encrypted", &bcEncryptedVfs, suite, chunkSize});
+		}
+	}
+
+	VfsEncryption::openCallbackSet([](VfsEncryption &settings) {
+		settings.encryptionSuiteSet(currentConfig.suite);
+		// the dummy suite uses a 16 bytes key, AES256 and ChaCha20 a 32 bytes one
+		settings.secretMaterialSet(std::vector<uint8_t>((currentConfig.suite == EncryptionSuite::dummy)?16:32, 0x5a));
+		settings.chunkSizeSet(currentConfig.chunkSize);
+	});
+	VfsEncryption::workerPoolSet(threads);
+
+	int ret = 0;
+	bool first = true;
+	if (format == "csv") {
+		std::cout<<"vfs,suite,chunk_size,workload,operations,bytes,seconds,ops_per_second,mb_per_second"<<std::endl;
+	} else {
+		std::cout<<"["<<std::endl;
+	}
+	for (const auto &config:configs) {
+		currentConfig = config;
+		const std::string suiteName = (config.suite == EncryptionSuite::plain)?"none":encryptionSuiteString(config.suite);
+		try {
+			for (const auto &result:runWorkloads(path, fileSize, ioSize, pageSize, randomOps)) {
+				const double opsPerSecond = (result.seconds > 0)?result.operations/result.seconds:0;
+				const double mbPerSecond = (result.seconds > 0)?result.bytes/result.seconds/(1024*1024):0;
+				if (format == "csv") {
+					std::cout<<config.vfsName<<","<<suiteName<<","<<config.chunkSize<<","<<result.workload<<","
+						<<result.operations<<","<<result.bytes<<","<<result.seconds<<","<<opsPerSecond<<","<<mbPerSecond<<std::endl;
+				} else {
+					std::cout<<(first?"":",\n")<<"  {\"vfs\": \""<<config.vfsName<<"\", \"suite\": \""<<suiteName
+						<<"\", \"chunk_size\": "<<config.chunkSize<<", \"workload\": \""<<result.workload
+						<<"\", \"operations\": "<<result.operations<<", \"bytes\": "<<result.bytes
+						<<", \"seconds\": "<<result.seconds<<", \"ops_per_second\": "<<opsPerSecond
+						<<", \"mb_per_second\": "<<mbPerSecond<<"}";
+					first = false;
+				}
+			}
+		} catch (std::exception const &e) {
+			std::cerr<<"Benchmark "<<config.vfsName<<" "<<suiteName<<" chunk size "<<config.chunkSize<<" failed: "<<e.what()<<std::endl;
+			std::remove(path.data());
+			ret = 1;
+		}
+	}
+	if (format == "json") {
+		std::cout<<std::endl<<"]"<<std::endl;
+	}
+
+	VfsEncryption::openCallbackSet(nullptr);
+	VfsEncryption::workerPoolSet(0);
+	return ret;
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2020 Belledonne Communications SARL.
+ *
+ * This file is part of bctoolbox.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Authenticate all the chunks of an encrypted file
+ * Exit with 0 if the file is valid, 1 if a chunk fails authentication, 2 on any other error
+ */
+
+#include "bctoolbox/vfs_encrypted.hh"
+#include "bctoolbox/vfs_standard.h"
+#include "bctoolbox/port.h"
+#include "bctoolbox/crypto.h" // bctbx_clean
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace bctoolbox;
+
+static void usage(const char *name) {
+	std::cerr<<"Usage: "<<name<<" [--threads <count>] [--quiet] --key <hex secret material> <file>"<<std::endl;
+	std::cerr<<"  --threads <count>  number of threads used to authenticate the chunks, default to all available cores"<<std::endl;
+	std::cerr<<"  --quiet            do not report progress"<<std::endl;
+}
+
+int main(int argc, char *argv[]) {
+	std::string key{};
+	std::string filename{};
+	size_t threads = 0;
+	bool quiet = false;
+
+	for (int i=1; i<argc; i++) {
+		if (strcmp(argv[i], "--key") == 0 && i+1 < argc) {
+			key = argv[++i];
+		} else if (strcmp(argv[i], "--threads") == 0 && i+1 < argc) {
+			try {
+				threads = std::stoul(argv[++i]);
+			} catch (std::exception const &) { // not a number or out of range
+				usage(argv[0]);
+				return 2;
+			}
+		} else if (strcmp(argv[i], "--quiet") == 0) {
+			quiet = true;
+		} else if (argv[i][0] != '-' && filename.empty()) {
+			filename = argv[i];
+		} else {
+			usage(argv[0]);
+			return 2;
+		}
+	}
+	if (key.empty() || key.size()%2 != 0 || filename.empty()) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	std::vector<uint8_t> secret(key.size()/2);
+	bctbx_str_to_uint8(secret.data(), reinterpret_cast<const uint8_t *>(key.data()), key.size());
+	bctbx_clean(&key[0], key.size());
+
+	// the encryption suite is given by the file header, we just need to provide the key
+	VfsEncryption::openCallbackSet([&secret](VfsEncryption &settings) {
+		if (settings.encryptionSuiteGet() != EncryptionSuite::plain) {
+			settings.secretMaterialSet(secret);
+		}
+	});
+	if (threads > 0) {
+		VfsEncryption::workerPoolSet(threads);
+	}
+
+	int ret = 2;
+	bctbx_vfs_file_t *stdFp = bctbx_file_open2(bctbx_vfs_get_standard(), filename.data(), O_RDONLY);
+	if (stdFp == nullptr) {
+		std::cerr<<"Cannot open file "<<filename<<std::endl;
+	} else {
+		try {
+			VfsEncryption file(stdFp, filename, O_RDONLY, O_RDONLY); // closes the file when destroyed
+			stdFp = nullptr;
+			uint32_t badChunk = 0;
+			bool valid = file.integrityCheck(badChunk, [quiet](uint32_t processedChunks, uint32_t totalChunks) {
+				if (!quiet) {
+					std::cerr<<"\rChecked "<<processedChunks<<"/"<<totalChunks<<" chunks"<<std::flush;
+				}
+			});
+			if (!quiet) std::cerr<<std::endl;
+			if (valid) {
+				std::cout<<filename<<": "<<file.fileSizeGet()<<" bytes, all chunks are authenticated"<<std::endl;
+				ret = 0;
+			} else {
+				std::cout<<filename<<": chunk "<<badChunk<<" at plain offset "<<static_cast<uint64_t>(badChunk)*file.chunkSizeGet()<<" fails authentication"<<std::endl;
+				ret = 1;
+			}
+		} catch (EvfsException const &e) {
+			if (stdFp != nullptr) {
+				bctbx_file_close(stdFp);
+			}
+			std::cerr<<"Cannot check file "<<filename<<": "<<e.what()<<std::endl;
+		}
+	}
+
+	bctbx_clean(secret.data(), secret.size());
+	VfsEncryption::openCallbackSet(nullptr);
+	VfsEncryption::workerPoolSet(0);
+	return ret;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2020 Belledonne Communications SARL.
+ *
+ * This file is part of bctoolbox.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Decode a log file written by a binary file log handler into text, on the standard output
+ * Exit with 0 on success, 1 if the file is truncated or is not a binary log file, 2 on any other error
+ */
+
+#include "bctoolbox/logging.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+static void usage(const char *name) {
+	std::cerr<<"Usage: "<<name<<" <binary log file>"<<std::endl;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 2 || argv[1][0] == '-') {
+		usage(argv[0]);
+		return 2;
+	}
+
+	FILE *input = fopen(argv[1], "rb");
+	if (input == nullptr) {
+		std::cerr<<"Cannot open "<<argv[1]<<": "<<strerror(errno)<<std::endl;
+		return 2;
+	}
+	int ret = bctbx_binary_log_decode(input, stdout);
+	fclose(input);
+	if (ret != 0) {
+		std::cerr<<argv[1]<<" is truncated or is not a binary log file"<<std::endl;
+		return 1;
+	}
+	return 0;
+}